@@ -0,0 +1,80 @@
+#pragma once
+
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// Inputs shared by the benchmarks: the real instance, loaded once, cut down
+// to the benchmarked station counts and cluster compositions. Run from the
+// build directory, like the tests.
+namespace bench {
+
+constexpr const char *kInstancePath = "../data/results.csv";
+
+// Swallows std::cout (the loader's progress lines) while in scope.
+class QuietStdout {
+public:
+  QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+  ~QuietStdout() { std::cout.rdbuf(saved); }
+  QuietStdout(const QuietStdout &) = delete;
+  QuietStdout &operator=(const QuietStdout &) = delete;
+
+private:
+  std::ostringstream sink;
+  std::streambuf *saved;
+};
+
+inline const ProblemInstance &instance() {
+  static const ProblemInstance loaded = [] {
+    QuietStdout quiet;
+    return ProblemInstance(kInstancePath);
+  }();
+  return loaded;
+}
+
+inline Param param() { return Param(60, 2, 0.5, 10, 10, 10); }
+
+// The depot and the first n - 1 stations, with their BCRF computed.
+inline std::vector<Station> stations(int n) {
+  const std::vector<Station> &all = instance().getStations();
+  std::vector<Station> prefix(all.begin(),
+                              all.begin() + std::min<size_t>(n, all.size()));
+  Param p = param();
+  MetricCalculator::computeBCRF(prefix, p);
+  return prefix;
+}
+
+inline std::vector<std::vector<double>> timeMatrix(int n) {
+  const std::vector<std::vector<double>> &all = instance().getTimeMatrix();
+  const size_t size = std::min<size_t>(n, all.size());
+  std::vector<std::vector<double>> prefix(size);
+  for (size_t i = 0; i < size; ++i)
+    prefix[i].assign(all[i].begin(), all[i].begin() + size);
+  return prefix;
+}
+
+// A cluster of the given composition: the first `surplus` surplus and
+// `deficit` deficit stations of the instance. Returns false if it has
+// fewer.
+inline bool composition(const std::vector<Station> &all, int surplus,
+                        int deficit, std::vector<int> &surplusIndices,
+                        std::vector<int> &deficitIndices) {
+  surplusIndices.clear();
+  deficitIndices.clear();
+  for (size_t i = 1; i < all.size(); ++i) {
+    if (all[i].getStatus() == StationStatus::SURPLUS &&
+        (int)surplusIndices.size() < surplus)
+      surplusIndices.push_back(i);
+    else if (all[i].getStatus() == StationStatus::DEFICIT &&
+             (int)deficitIndices.size() < deficit)
+      deficitIndices.push_back(i);
+  }
+  return (int)surplusIndices.size() == surplus &&
+         (int)deficitIndices.size() == deficit;
+}
+
+} // namespace bench
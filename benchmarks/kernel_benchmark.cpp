@@ -0,0 +1,238 @@
+#include "bench_common.hpp"
+#include "clustering/kmedoids.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "core/instance_generator.hpp"
+#include "core/station_io.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Kernels of the clustering pipeline, one benchmark each, over station
+// counts (prefixes of the real instance) and, for the tuple kernels, the
+// surplus/deficit composition of a cluster.
+
+// CSV parse, depot centroid and Euclidean time matrix of the first n - 1
+// stations, written to a temporary copy of the instance. No cached
+// time_matrix.csv is involved, so the time scales with n.
+static void BM_LoadInstance(benchmark::State &state) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() /
+       ("brp_bench_" + std::to_string(state.range(0)) + ".csv"))
+          .string();
+  {
+    std::ifstream in(bench::kInstancePath);
+    std::ofstream out(path);
+    std::string line;
+    for (int row = 0; row < state.range(0) && std::getline(in, line); ++row)
+      out << line << "\n";
+  }
+  size_t loaded = 0;
+  for (auto _ : state) {
+    std::ifstream in(path);
+    ProblemInstance instance(readStationsCsv(in));
+    loaded = instance.getStations().size();
+    benchmark::DoNotOptimize(instance.getTimeMatrix().data());
+  }
+  std::remove(path.c_str());
+  state.SetItemsProcessed(state.iterations() * loaded);
+  state.counters["stations"] = loaded;
+}
+BENCHMARK(BM_LoadInstance)
+    ->Arg(100)
+    ->Arg(500)
+    ->Arg(2200)
+    ->Unit(benchmark::kMillisecond);
+
+// Synthetic instances at the sizes the real one cannot reach.
+static void BM_GenerateStations(benchmark::State &state) {
+  InstanceGeneratorOptions options;
+  options.stations = state.range(0);
+  for (auto _ : state) {
+    std::vector<Station> stations = generateStations(options);
+    benchmark::DoNotOptimize(stations.data());
+  }
+  state.SetItemsProcessed(state.iterations() * options.stations);
+}
+BENCHMARK(BM_GenerateStations)
+    ->Arg(10000)
+    ->Arg(50000)
+    ->Arg(200000)
+    ->Unit(benchmark::kMillisecond);
+
+// Parse of a synthetic station file held in memory, CSV (0) or binary (1).
+static void BM_ReadStations(benchmark::State &state) {
+  InstanceGeneratorOptions options;
+  options.stations = state.range(0);
+  const std::vector<Station> stations = generateStations(options);
+  std::stringstream file;
+  if (state.range(1))
+    writeStationsBinary(file, stations);
+  else
+    writeStationsCsv(file, stations);
+  const std::string bytes = file.str();
+  for (auto _ : state) {
+    std::istringstream in(bytes);
+    std::vector<Station> loaded =
+        state.range(1) ? readStationsBinary(in) : readStationsCsv(in);
+    benchmark::DoNotOptimize(loaded.data());
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+  state.SetItemsProcessed(state.iterations() * stations.size());
+}
+BENCHMARK(BM_ReadStations)
+    ->ArgNames({"stations", "binary"})
+    ->Args({50000, 0})
+    ->Args({50000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_TimeMatrix(benchmark::State &state) {
+  const std::vector<Station> stations = bench::stations(state.range(0));
+  for (auto _ : state) {
+    std::vector<std::vector<double>> matrix =
+        ProblemInstance::computeTimeMatrix(stations);
+    benchmark::DoNotOptimize(matrix.data());
+  }
+  state.SetComplexityN(stations.size());
+  state.SetItemsProcessed(state.iterations() * stations.size() *
+                          stations.size());
+}
+BENCHMARK(BM_TimeMatrix)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(2048)
+    ->Complexity(benchmark::oNSquared)
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_ComputeBCRF(benchmark::State &state) {
+  std::vector<Station> stations = bench::stations(state.range(0));
+  Param param = bench::param();
+  for (auto _ : state) {
+    MetricCalculator::computeBCRF(stations, param);
+    benchmark::ClobberMemory();
+  }
+  state.SetComplexityN(stations.size());
+  state.SetItemsProcessed(state.iterations() * stations.size());
+}
+BENCHMARK(BM_ComputeBCRF)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(2048)
+    ->Complexity(benchmark::oN);
+
+static void BM_CompositeDistanceMatrix(benchmark::State &state) {
+  const std::vector<Station> stations = bench::stations(state.range(0));
+  const std::vector<std::vector<double>> times =
+      bench::timeMatrix(state.range(0));
+  bench::QuietStdout quiet;
+  for (auto _ : state) {
+    std::vector<std::vector<double>> matrix =
+        MetricCalculator::computeCompositeDistanceMatrix(stations, times, 0.5,
+                                                         0.5);
+    benchmark::DoNotOptimize(matrix.data());
+  }
+  state.SetComplexityN(stations.size());
+  state.SetItemsProcessed(state.iterations() * stations.size() *
+                          stations.size());
+}
+BENCHMARK(BM_CompositeDistanceMatrix)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(2048)
+    ->Complexity(benchmark::oNSquared)
+    ->Unit(benchmark::kMicrosecond);
+
+// Args: station count, k.
+static void BM_KMedoids(benchmark::State &state) {
+  const std::vector<Station> stations = bench::stations(state.range(0));
+  bench::QuietStdout quiet;
+  KMedoid kmedoid(stations, state.range(1));
+  kmedoid.setCompositeDistanceMatrix(
+      MetricCalculator::computeCompositeDistanceMatrix(
+          stations, bench::timeMatrix(state.range(0)), 0.5, 0.5));
+  for (auto _ : state) {
+    std::vector<std::vector<int>> clusters = kmedoid.run(0.5);
+    benchmark::DoNotOptimize(clusters.data());
+  }
+  state.counters["iterations"] =
+      kmedoid.getCounters()[Counter::KMEDOIDS_ITERATIONS];
+}
+BENCHMARK(BM_KMedoids)
+    ->Args({128, 8})
+    ->Args({512, 32})
+    ->Args({512, 64})
+    ->Args({2048, 128})
+    ->Unit(benchmark::kMillisecond);
+
+// Args: surplus stations, deficit stations, pattern (p-to-p tuples). A
+// fresh evaluator per iteration, as for one cluster.
+static void BM_GenerateTuples(benchmark::State &state) {
+  const std::vector<Station> stations = bench::stations(2200);
+  std::vector<int> surplus, deficit;
+  if (!bench::composition(stations, state.range(0), state.range(1), surplus,
+                          deficit)) {
+    state.SkipWithError("instance too small for this composition");
+    return;
+  }
+  const int pattern = state.range(2);
+  TupleSearchStats stats;
+  size_t accepted = 0;
+  for (auto _ : state) {
+    TupleClusterEvaluator evaluator(pattern, pattern);
+    std::vector<TransferTuple> tuples;
+    evaluator.generateTuples(surplus, deficit, tuples, stations);
+    accepted = tuples.size();
+    stats = evaluator.getSearchStats();
+  }
+  state.counters["tuples"] = accepted;
+  state.counters["evaluated"] = stats.combinationsEvaluated;
+  state.counters["evaluated/s"] = benchmark::Counter(
+      static_cast<double>(stats.combinationsEvaluated) * state.iterations(),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_GenerateTuples)
+    ->ArgNames({"surplus", "deficit", "pattern"})
+    ->Args({4, 4, 2})
+    ->Args({8, 8, 2})
+    ->Args({16, 16, 2})
+    ->Args({4, 28, 2})
+    ->Args({28, 4, 2})
+    ->Args({32, 32, 2})
+    ->Args({8, 8, 3})
+    ->Args({16, 16, 3})
+    ->Unit(benchmark::kMicrosecond);
+
+// Args as BM_GenerateTuples; the tuples are generated once, outside the
+// timed loop.
+static void BM_GreedySelectExclusiveTuples(benchmark::State &state) {
+  const std::vector<Station> stations = bench::stations(2200);
+  std::vector<int> surplus, deficit;
+  if (!bench::composition(stations, state.range(0), state.range(1), surplus,
+                          deficit)) {
+    state.SkipWithError("instance too small for this composition");
+    return;
+  }
+  TupleClusterEvaluator evaluator(state.range(2), state.range(2));
+  std::vector<TransferTuple> tuples;
+  evaluator.generateTuples(surplus, deficit, tuples, stations);
+  size_t selected = 0;
+  for (auto _ : state) {
+    std::vector<TransferTuple> picked =
+        evaluator.greedySelectExclusiveTuples(tuples);
+    selected = picked.size();
+    benchmark::DoNotOptimize(picked.data());
+  }
+  state.SetItemsProcessed(state.iterations() * tuples.size());
+  state.counters["tuples"] = tuples.size();
+  state.counters["selected"] = selected;
+}
+BENCHMARK(BM_GreedySelectExclusiveTuples)
+    ->ArgNames({"surplus", "deficit", "pattern"})
+    ->Args({8, 8, 2})
+    ->Args({16, 16, 2})
+    ->Args({32, 32, 2})
+    ->Args({16, 16, 3})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,39 @@
+#include "bench_common.hpp"
+#include "clustering/kmedoids.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// The clustering pipeline end to end on the first n - 1 stations: BCRF,
+// composite distances, k-medoids and the evaluation of every cluster on
+// one thread. Args: station count, k; the 300-station run has a cluster of
+// over 100 deficit stations.
+static void BM_ClusterPipeline(benchmark::State &state) {
+  const std::vector<Station> prefix = bench::stations(state.range(0));
+  const std::vector<std::vector<double>> times =
+      bench::timeMatrix(state.range(0));
+  NetworkEvaluationOptions options;
+  options.threads = 1;
+  NetworkPlan plan;
+  bench::QuietStdout quiet;
+  for (auto _ : state) {
+    std::vector<Station> stations = prefix;
+    Param param = bench::param();
+    MetricCalculator::computeBCRF(stations, param);
+    KMedoid kmedoid(stations, state.range(1));
+    kmedoid.setCompositeDistanceMatrix(
+        MetricCalculator::computeCompositeDistanceMatrix(stations, times, 0.5,
+                                                         0.5));
+    std::vector<std::vector<int>> clusters = kmedoid.run(0.5);
+    TupleClusterEvaluator evaluator(2, 2);
+    plan = evaluator.evaluateNetwork(clusters, stations, options);
+    benchmark::DoNotOptimize(plan.totalDeltaUDF);
+  }
+  state.counters["deltaUDF"] = plan.totalDeltaUDF;
+  state.counters["evaluated"] = plan.counters[Counter::TUPLE_COMBINATIONS];
+}
+BENCHMARK(BM_ClusterPipeline)
+    ->Args({128, 12})
+    ->Args({256, 24})
+    ->Args({300, 12})
+    ->Unit(benchmark::kMillisecond);
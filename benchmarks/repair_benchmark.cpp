@@ -0,0 +1,68 @@
+#include "bench_common.hpp"
+#include "operators/Repair.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Repair throughput on synthetic children: random 2-to-2 tuples over the
+// real instance, routed as shuffled giant tours with tuple precedence on.
+static void BM_LoadFeasibilityRepair(benchmark::State &state) {
+  const ProblemInstance &instance = bench::instance();
+  Param param(60, 2, 0.5, 10, 10, 3, 12);
+  const int numStations = static_cast<int>(instance.getStations().size());
+
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int> pick(1, numStations - 1), bikes(1, 4);
+  std::vector<TransferTuple> tuples(state.range(0));
+  for (TransferTuple &tuple : tuples) {
+    std::vector<int> chosen;
+    while (chosen.size() < 4) {
+      int station = pick(rng);
+      if (std::find(chosen.begin(), chosen.end(), station) == chosen.end())
+        chosen.push_back(station);
+    }
+    tuple.surplusStationIndices = {chosen[0], chosen[1]};
+    tuple.deficitStationIndices = {chosen[2], chosen[3]};
+    tuple.bikeAllocations[{chosen[0], chosen[2]}] = bikes(rng);
+    tuple.bikeAllocations[{chosen[1], chosen[3]}] = bikes(rng);
+  }
+
+  RoutingOptions options;
+  options.tuplePrecedence = true;
+  { // the fleet can serve about half of the work
+    RoutingModel probe(instance, param, tuples);
+    double service = 0.0;
+    for (int id = 0; id < probe.getNumStops(); ++id)
+      service += probe.serviceTime(id);
+    options.routeTimeLimit = service / (2 * param.numOfVehicles);
+  }
+  RoutingModel model(instance, param, tuples, options);
+  const int n = model.getNumStops();
+
+  LoadFeasibilityRepair repair(model);
+  std::vector<int> children(64 * static_cast<size_t>(n));
+  for (int c = 0; c < 64; ++c) {
+    std::iota(children.begin() + c * n, children.begin() + (c + 1) * n, 0);
+    std::shuffle(children.begin() + c * n, children.begin() + (c + 1) * n,
+                 rng);
+  }
+  std::vector<int> genes(n);
+  Individual child(genes.data(), n);
+  int c = 0;
+  for (auto _ : state) {
+    std::copy(children.begin() + c * n, children.begin() + (c + 1) * n,
+              child.begin());
+    child.evaluated = false;
+    repair.repair(child);
+    benchmark::DoNotOptimize(child.evaluation.objective);
+    c = (c + 1) % 64;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["stops"] = n;
+  state.counters["candidates/repair"] = benchmark::Counter(
+      static_cast<double>(repair.getStats().candidates) /
+      repair.getStats().repaired);
+}
+BENCHMARK(BM_LoadFeasibilityRepair)->Arg(25)->Arg(100)->Arg(400);
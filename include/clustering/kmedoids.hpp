@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/station.hpp"
+#include "utils/Counters.hpp"
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -30,8 +31,12 @@ public:
   setCompositeDistanceMatrix(const std::vector<std::vector<double>> &matrix);
   void setK(int k);
 
+  // Iterations, reassignments and medoid swaps of the last run()
+  const CounterSet &getCounters() const { return counters; }
+
 private:
   const std::vector<Station> &stations;
   int k;
   std::vector<std::vector<double>> compositeDistance;
+  CounterSet counters;
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include "clustering/tuple_sink.hpp"
+#include "core/param.hpp"
+#include "core/transfer_tuple.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Cheapest way for one vehicle to serve a tuple on its own.
+struct TupleRoute {
+  bool feasible = false;
+  double serviceTime = 0.0; // travel between the stops + tLoad per bike moved
+  std::vector<int> order;   // station indices in visiting order
+};
+
+// Identifies the routing problem of a tuple by its allocations: they fix the
+// stations, the bikes picked up or dropped at each, and which pickups must
+// precede each drop. Unlike the candidate masks of the evaluation cache, the
+// key stays valid across generateTuples calls and inventory changes.
+struct AllocationKey {
+  static constexpr int kMaxAllocations = 16;
+  std::array<std::uint64_t, kMaxAllocations> words{};
+  int count = 0;
+
+  bool operator==(const AllocationKey &other) const;
+};
+
+struct AllocationKeyHash {
+  std::size_t operator()(const AllocationKey &key) const;
+};
+
+struct RouteCostStats {
+  std::size_t hits = 0;
+  std::size_t misses = 0; // Held-Karp solves
+  std::size_t evictions = 0;
+  std::size_t infeasible = 0; // solves with no load-feasible order
+  std::size_t entries = 0;
+};
+
+// Exact service time of a tuple by Held-Karp over (visited set, last stop).
+// A drop may only follow every pickup allocated to it, and the load carried
+// between stops must stay within [0, vehicleCapacity]. The route is open: it
+// starts at the first stop and ends at the last. A tuple has at most
+// maxSurplus + maxDeficit stations, so 2^n * n^2 stays small for the patterns
+// used in practice; results are memoized (FIFO-bounded) by AllocationKey.
+class TupleRouteCost {
+public:
+  static constexpr int kMaxStations = 12;
+
+  TupleRouteCost(const std::vector<std::vector<double>> &timeMatrix,
+                 const Param &param, std::size_t maxEntries = 1 << 16);
+
+  // Throws std::invalid_argument if the tuple has more than kMaxStations
+  // stations.
+  const TupleRoute &solve(const TransferTuple &tuple);
+  // Fills tuple.serviceTime and tuple.visitOrder; returns false (and leaves
+  // the tuple untouched) if no vehicle of this capacity can serve it alone.
+  bool apply(TransferTuple &tuple);
+
+  void clear();
+  RouteCostStats getStats() const;
+  const std::vector<std::vector<double>> &getTimeMatrix() const {
+    return timeMatrix;
+  }
+  const Param &getParam() const { return param; }
+  std::size_t getMaxEntries() const { return maxEntries; }
+
+private:
+  TupleRoute heldKarp(const TransferTuple &tuple);
+
+  const std::vector<std::vector<double>> &timeMatrix;
+  Param param;
+
+  std::unordered_map<AllocationKey, TupleRoute, AllocationKeyHash> entries;
+  std::vector<AllocationKey> insertionOrder; // ring buffer of live keys
+  std::size_t nextVictim = 0;
+  std::size_t maxEntries;
+  TupleRoute uncached;
+  RouteCostStats stats;
+
+  // DP workspace, reused between solves
+  std::vector<double> dp;
+  std::vector<signed char> parent;
+};
+
+// Scores tuples on their way to another sink: each gets its service time and
+// visiting order, and tuples no single vehicle can serve are rejected.
+class RouteScoringSink : public TupleSink {
+public:
+  RouteScoringSink(TupleRouteCost &routeCost, TupleSink &downstream)
+      : routeCost(routeCost), downstream(downstream) {}
+
+  bool accept(const TransferTuple &tuple) override;
+  double threshold() const override { return downstream.threshold(); }
+
+private:
+  TupleRouteCost &routeCost;
+  TupleSink &downstream;
+  TransferTuple scored;
+};
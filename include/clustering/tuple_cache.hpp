@@ -0,0 +1,129 @@
+#pragma once
+#include "core/transfer_tuple.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Bitset over the positions of a candidate list, as long as the list needs:
+// clusters of any size keep the mask-based search and memo. Masks compare
+// equal when they hold the same positions, whatever their word count.
+class CandidateMask {
+public:
+  CandidateMask() = default;
+  explicit CandidateMask(std::size_t positions)
+      : words((positions + 63) / 64, 0) {}
+
+  void set(std::size_t i) {
+    if (i / 64 >= words.size())
+      words.resize(i / 64 + 1, 0);
+    words[i / 64] |= std::uint64_t{1} << (i % 64);
+  }
+  void reset(std::size_t i) {
+    if (i / 64 < words.size())
+      words[i / 64] &= ~(std::uint64_t{1} << (i % 64));
+  }
+  bool test(std::size_t i) const {
+    return i / 64 < words.size() && (words[i / 64] >> (i % 64) & 1);
+  }
+  bool subsetOf(const CandidateMask &other) const {
+    for (std::size_t w = 0; w < words.size(); ++w)
+      if (words[w] & ~other.word(w))
+        return false;
+    return true;
+  }
+  bool operator==(const CandidateMask &other) const {
+    for (std::size_t w = 0; w < std::max(words.size(), other.words.size());
+         ++w)
+      if (word(w) != other.word(w))
+        return false;
+    return true;
+  }
+  // Calls f(position) for every set position, ascending.
+  template <typename F> void forEach(F f) const {
+    for (std::size_t w = 0; w < words.size(); ++w)
+      for (std::uint64_t bits = words[w]; bits; bits &= bits - 1)
+        f(w * 64 + __builtin_ctzll(bits));
+  }
+  std::size_t hash() const;
+  std::size_t heapBytes() const {
+    return words.capacity() * sizeof(std::uint64_t);
+  }
+
+private:
+  std::uint64_t word(std::size_t w) const {
+    return w < words.size() ? words[w] : 0;
+  }
+
+  std::vector<std::uint64_t> words;
+};
+
+// Identifies a (surplus set, deficit set) pair by masks over the candidate
+// lists handed to generateTuples: position i of surplus is surplusIndices[i].
+struct SubsetKey {
+  CandidateMask surplus;
+  CandidateMask deficit;
+
+  bool operator==(const SubsetKey &other) const {
+    return surplus == other.surplus && deficit == other.deficit;
+  }
+  bool subsetOf(const SubsetKey &other) const {
+    return surplus.subsetOf(other.surplus) && deficit.subsetOf(other.deficit);
+  }
+};
+
+struct SubsetKeyHash {
+  std::size_t operator()(const SubsetKey &key) const;
+};
+
+// Mask of the stations of `candidate` that actually moved bikes in `tuple`.
+SubsetKey usedSubsetKey(const TransferTuple &tuple, const SubsetKey &candidate,
+                        const std::vector<int> &surplusCandidates,
+                        const std::vector<int> &deficitCandidates);
+
+struct TupleCacheStats {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t evictions = 0;
+  std::size_t entries = 0;
+  std::size_t bytes = 0; // Approximate heap footprint of the cached tuples
+};
+
+// Bounded memo of evaluateTuple results. The greedy transfer only depends on
+// the stations it is given, and stations that end up moving no bikes do not
+// influence the others, so a result is stored under the mask of the stations
+// it actually used. Candidates are looked up under the same key, worked out
+// before the transfer (see TupleClusterEvaluator::evaluateTuple), so every
+// candidate whose greedy uses the same stations shares one entry. Once
+// full, the oldest entry is evicted (FIFO).
+class TupleEvaluationCache {
+public:
+  explicit TupleEvaluationCache(std::size_t maxEntries = 1 << 16);
+
+  // Returns the cached tuple or nullptr; counts a hit or a miss. The pointer
+  // stays valid until the next insert() or clear().
+  const TransferTuple *find(const SubsetKey &key);
+  // Requires getMaxEntries() > 0; a cache of size 0 is treated as disabled.
+  const TransferTuple &insert(const SubsetKey &key, TransferTuple tuple);
+
+  // Drops all entries but keeps the hit/miss/eviction counters.
+  void clear();
+  void resetStats();
+  void setMaxEntries(std::size_t maxEntries);
+  std::size_t getMaxEntries() const { return maxEntries; }
+  TupleCacheStats getStats() const;
+
+private:
+  static std::size_t footprint(const SubsetKey &key,
+                               const TransferTuple &tuple);
+
+  std::unordered_map<SubsetKey, TransferTuple, SubsetKeyHash> entries;
+  std::vector<SubsetKey> insertionOrder; // ring buffer of live keys
+  std::size_t nextVictim = 0;
+  std::size_t maxEntries;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t evictions = 0;
+  std::size_t bytes = 0;
+};
@@ -1,31 +1,130 @@
 #pragma once
+#include "clustering/route_cost.hpp"
+#include "clustering/tuple_cache.hpp"
+#include "clustering/tuple_search.hpp"
+#include "clustering/tuple_selector.hpp"
+#include "clustering/tuple_sink.hpp"
 #include "core/station.hpp"
 #include "core/transfer_tuple.hpp"
+#include "utils/Counters.hpp"
+#include <memory>
 #include <vector>
 
 struct ClusterEvaluationResult {
-  std::vector<TransferTuple> assignedTuples;
-  double totalDeltaUDF;
+  std::vector<int> stationIndices;
+  std::vector<TransferTuple> assignedTuples; // station-disjoint selection
+  double totalDeltaUDF = 0.0;                // sum over assignedTuples
+  double elapsedSeconds = 0.0;
+  bool evaluated = false; // false if the network deadline skipped it
+  CounterSet counters;    // work done by this evaluation
+};
+
+struct NetworkEvaluationOptions {
+  unsigned threads = 0;       // 0: std::thread::hardware_concurrency()
+  double deadlineSeconds = 0; // 0: no deadline
+  SelectionOptions selection; // applied to every cluster
+};
+
+// Plan for the whole network, one entry per input cluster (same order).
+struct NetworkPlan {
+  std::vector<ClusterEvaluationResult> clusters;
+  double totalDeltaUDF = 0.0;
+  double elapsedSeconds = 0.0;
+  std::size_t clustersEvaluated = 0;
+  bool complete = false; // every cluster evaluated before the deadline
+  CounterSet counters;   // summed over the evaluated clusters
 };
 
 class TupleClusterEvaluator {
 public:
   // Patterns: e.g., maxSurplus = 3, maxDeficit = 3 for 3-to-3, etc.
   TupleClusterEvaluator(int maxSurplus, int maxDeficit);
+  // Generates the cluster's tuples and selects a station-disjoint subset.
   ClusterEvaluationResult
   evaluateCluster(const std::vector<int> &stationIndices,
-                  const std::vector<Station> &stations);
+                  const std::vector<Station> &stations,
+                  const SelectionOptions &selection = {});
+  // Evaluates every cluster on a pool of worker threads, largest clusters
+  // first. Each worker owns an evaluator configured like this one; their
+  // search statistics are added to this evaluator's afterwards. Clusters not
+  // started when the deadline passes are returned unevaluated, and ANYTIME
+  // selection is capped at the time remaining; a cluster already being
+  // generated at the deadline still completes.
+  NetworkPlan evaluateNetwork(const std::vector<std::vector<int>> &clusters,
+                              const std::vector<Station> &stations,
+                              const NetworkEvaluationOptions &options = {});
   // Helper functions
   void generateTuples(const std::vector<int> &surplusIndices,
                       const std::vector<int> &deficitIndices,
                       std::vector<TransferTuple> &tuples,
                       const std::vector<Station> &stations);
+  // Streaming form: tuples go to the sink as they are accepted, and a sink
+  // threshold (e.g. TopKTupleSink) lets the search prune weaker subtrees.
+  void generateTuples(const std::vector<int> &surplusIndices,
+                      const std::vector<int> &deficitIndices, TupleSink &sink,
+                      const std::vector<Station> &stations);
+  // The candidates selection works on: the options.maxCandidates best tuples
+  // by options.score, kept in a TopKTupleSink whose threshold also prunes the
+  // search (every accepted tuple if maxCandidates is 0).
+  std::vector<TransferTuple>
+  generateCandidates(const std::vector<int> &surplusIndices,
+                     const std::vector<int> &deficitIndices,
+                     const std::vector<Station> &stations,
+                     const SelectionOptions &options = {});
   TransferTuple evaluateTuple(const std::vector<int> &surplusIndices,
                               const std::vector<int> &deficitIndices,
                               const std::vector<Station> &stations);
+  // Memoized variant: the key's masks pick entries of the candidate lists.
+  // The returned reference is valid until the next evaluateTuple call.
+  const TransferTuple &evaluateTuple(const SubsetKey &candidate,
+                                     const std::vector<int> &surplusCandidates,
+                                     const std::vector<int> &deficitCandidates,
+                                     const std::vector<Station> &stations);
   std::vector<TransferTuple>
   greedySelectExclusiveTuples(const std::vector<TransferTuple> &tuples);
+  // Greedy by default; SelectionStrategy::ANYTIME improves on the greedy
+  // selection with a time-bounded exact search and reports the gap.
+  SelectionResult
+  selectExclusiveTuples(const std::vector<TransferTuple> &tuples,
+                        const SelectionOptions &options = {});
+
+  // Cache bound in entries; 0 disables memoization.
+  void setCacheCapacity(std::size_t maxEntries);
+  TupleCacheStats getCacheStats() const;
+  // Branch-and-bound enumeration (default); off runs every combination.
+  void setPruning(bool enabled);
+  // Accumulated over all generateTuples calls of this evaluator
+  TupleSearchStats getSearchStats() const;
+  // Route-aware scoring: generated tuples get the exact service time of one
+  // vehicle (see TupleRouteCost) so they can be ranked by
+  // TupleScore::DELTA_UDF_PER_TIME; tuples it cannot serve are dropped. The
+  // time matrix must outlive the evaluator. Throws std::invalid_argument if
+  // the pattern allows more stations than TupleRouteCost::kMaxStations.
+  void enableRouteScoring(const std::vector<std::vector<double>> &timeMatrix,
+                          const Param &param);
+  void disableRouteScoring();
+  RouteCostStats getRouteCostStats() const;
 
 private:
+  // Fresh evaluator with the same pattern, pruning, cache bound and route
+  // scoring, for use on another thread.
+  std::unique_ptr<TupleClusterEvaluator> makeWorker() const;
+  // The stations of `candidate` that its greedy transfer moves bikes at,
+  // worked out from the inventories without evaluating the transfer.
+  static SubsetKey greedySubsetKey(const SubsetKey &candidate,
+                                   const std::vector<int> &surplusCandidates,
+                                   const std::vector<int> &deficitCandidates,
+                                   const std::vector<Station> &stations);
+  TupleSearchStats
+  generateTuplesExhaustive(const std::vector<int> &surplusIndices,
+                           const std::vector<int> &deficitIndices,
+                           TupleSink &sink,
+                           const std::vector<Station> &stations);
+
   int maxSurplus, maxDeficit;
+  bool pruning = true;
+  TupleSearchStats searchStats;
+  TupleEvaluationCache cache;
+  TransferTuple uncachedTuple;
+  std::unique_ptr<TupleRouteCost> routeCost; // null unless route scoring
 };
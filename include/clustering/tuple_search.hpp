@@ -0,0 +1,93 @@
+#pragma once
+#include "clustering/tuple_cache.hpp"
+#include "clustering/tuple_sink.hpp"
+#include "core/station.hpp"
+#include "core/transfer_tuple.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TupleClusterEvaluator;
+
+struct TupleSearchStats {
+  std::size_t nodesVisited = 0;
+  std::size_t combinationsEvaluated = 0;
+  std::size_t prunedByBound = 0;     // subtrees whose ΔUDF bound is too low
+  std::size_t prunedByDominance = 0; // subtrees inside an accepted tuple
+  std::size_t tuplesPositive = 0;   // evaluated with a positive ΔUDF
+  std::size_t rejectedAsSubset = 0; // positive, inside an accepted tuple
+  std::size_t tuplesAccepted = 0;   // positive, not inside, kept by the sink
+
+  TupleSearchStats &operator+=(const TupleSearchStats &other);
+};
+
+// Largest UDF reduction a station can reach by moving bikes towards its
+// optimal inventory, i.e. max over t in [0, gap] of udf[c] - udf[c -/+ t].
+double maxUdfReduction(const Station &station);
+
+// Branch-and-bound version of the generateTuples enumeration. Candidates are
+// visited in the same order as the exhaustive loops (s, d descending, then
+// combinations in lexicographic order) so the anti-subset rule accepts the
+// same tuples. Two kinds of subtrees are skipped without evaluation:
+//  - the sum of the per-station maxUdfReduction bounds of the chosen stations
+//    plus the best possible completion cannot exceed the sink's threshold;
+//  - every completion lies inside the stations of an already accepted tuple,
+//    so its used set would be rejected as a subset anyway.
+// A bound-pruned subtree can only hide tuples (and subsets of them) at or
+// below the threshold, so the sink still sees every tuple above it. Every
+// station bound is positive, so bound pruning only ever triggers under a
+// TopKTupleSink once it holds k tuples; with the default threshold of 0
+// (VectorTupleSink, the generateTuples path) only dominance prunes.
+// Candidate lists of any length are searched; masks grow with them.
+class TupleSearch {
+public:
+  TupleSearch(TupleClusterEvaluator &evaluator,
+              const std::vector<int> &surplusIndices,
+              const std::vector<int> &deficitIndices,
+              const std::vector<Station> &stations, TupleSink &sink);
+
+  void run(int maxSurplus, int maxDeficit);
+  const TupleSearchStats &getStats() const { return stats; }
+
+private:
+  void chooseSurplus(int next, int remaining, double bound);
+  void chooseDeficit(int next, int remaining, double bound);
+  void evaluateLeaf();
+  // Whether the stations (ascending positions) lie inside an accepted tuple:
+  // one lookup in the index of the accepted tuples' sub-tuples.
+  bool inside(const std::vector<int> &surplus,
+              const std::vector<int> &deficit) const;
+  void accept(const SubsetKey &used);
+  void index(std::uint64_t fingerprint, std::uint32_t tuple);
+  // Sum of the r largest bounds among positions [next, n) of a side
+  double bestSurplus(int next, int r) const;
+  double bestDeficit(int next, int r) const;
+
+  TupleClusterEvaluator &evaluator;
+  const std::vector<int> &surplusIndices;
+  const std::vector<int> &deficitIndices;
+  const std::vector<Station> &stations;
+  TupleSink &sink;
+
+  std::vector<double> surplusBound, deficitBound;
+  // best completion tables, (n + 1) x (maxPick + 1), row-major
+  std::vector<double> surplusBest, deficitBest;
+  int surplusStride = 0, deficitStride = 0;
+
+  double threshold = 0.0; // pruning threshold, refreshed from the sink
+  int deficitPick = 0;    // d of the current (s, d) pass
+  SubsetKey candidate;    // the stations picked so far, as masks
+  std::vector<int> surplusPicks, deficitPicks; // and as positions, ascending
+  double surplusMaskBound = 0.0;
+  // Used stations of the accepted tuples, flat: per tuple its surplus
+  // count, surplus positions, deficit count and deficit positions.
+  std::vector<int> accepted;
+  std::size_t maxAccepted = 0; // most deficit stations in one of them
+  // Open-addressing index of every sub-tuple (both sides non-empty) not yet
+  // covered when its tuple was accepted: slots hold the sub-tuple's
+  // fingerprint (high half) and its tuple's offset in `accepted` + 1, 0 for
+  // free. Lookups verify against the tuple, so collisions are harmless.
+  std::vector<std::uint64_t> covered;
+  std::size_t coveredEntries = 0;
+  TupleSearchStats stats;
+};
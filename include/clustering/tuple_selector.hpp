@@ -0,0 +1,73 @@
+#pragma once
+#include "core/transfer_tuple.hpp"
+#include "utils/Timer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum class SelectionStrategy { GREEDY, ANYTIME };
+
+struct SelectionResult {
+  std::vector<TransferTuple> selected;
+  double totalDeltaUDF = 0.0;
+  double totalScore = 0.0; // equals totalDeltaUDF unless ranking by rate
+  double upperBound = 0.0; // no exclusive selection can exceed this score
+  double gap = 0.0;        // (upperBound - totalScore) / upperBound
+  bool provedOptimal = false;
+  std::size_t nodesExplored = 0;
+  // tuples skipped for sharing a station, by the greedy pass and the search
+  std::size_t conflicts = 0;
+};
+
+struct SelectionOptions {
+  SelectionStrategy strategy = SelectionStrategy::GREEDY;
+  TupleScore score = TupleScore::DELTA_UDF; // weight of a tuple
+  double timeLimitSeconds = 0.05; // budget of the ANYTIME search
+  // Candidates kept per cluster, best by score first, so generation holds a
+  // bounded set instead of every accepted tuple; 0 keeps them all. A bound
+  // can change the selection on clusters with more tuples than that.
+  std::size_t maxCandidates = 0;
+  // Called with the greedy selection first, then after every improvement
+  std::function<void(const SelectionResult &)> onImprovement;
+};
+
+// Picks station-disjoint tuples maximizing the summed score (weighted set
+// packing). GREEDY takes tuples by score descending; ANYTIME starts from the
+// greedy selection and runs a depth-first branch and bound until it proves
+// optimality or runs out of time, reporting the remaining optimality gap.
+class ExclusiveTupleSelector {
+public:
+  explicit ExclusiveTupleSelector(const std::vector<TransferTuple> &tuples,
+                                  TupleScore score = TupleScore::DELTA_UDF);
+
+  SelectionResult select(const SelectionOptions &options = {});
+
+private:
+  bool conflicts(int tuple) const;
+  void occupy(int tuple, bool value);
+  void search(int pos, double value, double share);
+  void record(double value);
+  SelectionResult makeResult(const std::vector<int> &picked,
+                             double upperBound) const;
+
+  const std::vector<TransferTuple> &tuples;
+  std::vector<double> weight; // score of each tuple
+  std::vector<int> order;     // tuple indices, weight descending
+  // stations of tuple t (local ids) are stations[offset[t] .. offset[t + 1])
+  std::vector<int> offset, stations;
+  std::vector<double> tupleShare;  // sum of station shares of each tuple
+  std::vector<double> suffixValue; // weight sum of order[pos ..]
+  double totalShare = 0.0;
+  std::vector<std::uint64_t> used; // bitset over local station ids
+
+  // search state
+  std::vector<int> chosen, best;
+  double bestValue = 0.0;
+  double openBound = 0.0; // largest bound among nodes cut by the deadline
+  bool timedOut = false;
+  std::size_t nodes = 0;
+  std::size_t conflictCount = 0;
+  const SelectionOptions *options = nullptr;
+  Timer timer;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include "core/transfer_tuple.hpp"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Receives the tuples accepted by generateTuples as they are found.
+class TupleSink {
+public:
+  virtual ~TupleSink() = default;
+
+  // False if the tuple is not a valid one (e.g. no vehicle can serve it): it
+  // then does not hide its sub-tuples from the anti-subset rule. A sink that
+  // only drops a tuple for ranking too low still returns true.
+  virtual bool accept(const TransferTuple &tuple) = 0;
+
+  // Tuples with deltaUDF at or below this value will be discarded by the
+  // sink anyway, so the search may skip subtrees that cannot exceed it.
+  virtual double threshold() const { return 0.0; }
+};
+
+// Collects every tuple, in the order generateTuples accepts them.
+class VectorTupleSink : public TupleSink {
+public:
+  explicit VectorTupleSink(std::vector<TransferTuple> &tuples)
+      : tuples(tuples) {}
+
+  bool accept(const TransferTuple &tuple) override {
+    tuples.push_back(tuple);
+    return true;
+  }
+
+private:
+  std::vector<TransferTuple> &tuples;
+};
+
+// Forwards every tuple to a callback.
+class CallbackTupleSink : public TupleSink {
+public:
+  explicit CallbackTupleSink(std::function<void(const TransferTuple &)> fn)
+      : fn(std::move(fn)) {}
+
+  bool accept(const TransferTuple &tuple) override {
+    fn(tuple);
+    return true;
+  }
+
+private:
+  std::function<void(const TransferTuple &)> fn;
+};
+
+// Keeps the k tuples with the largest score in a min-heap, so memory stays
+// proportional to k however many tuples the enumeration produces. When ranking
+// by deltaUDF, its smallest kept value becomes the pruning threshold of the
+// search once full.
+class TopKTupleSink : public TupleSink {
+public:
+  explicit TopKTupleSink(std::size_t k,
+                         TupleScore score = TupleScore::DELTA_UDF);
+
+  bool accept(const TransferTuple &tuple) override;
+  double threshold() const override;
+
+  std::size_t size() const { return heap.size(); }
+  std::size_t getSeen() const { return seen; }
+  // Moves the kept tuples out, score descending, and empties the sink.
+  std::vector<TransferTuple> take();
+
+private:
+  bool weaker(const TransferTuple &a, const TransferTuple &b) const;
+  auto cmp() const {
+    return [this](const TransferTuple &a, const TransferTuple &b) {
+      return weaker(a, b);
+    };
+  }
+
+  std::size_t k;
+  TupleScore score;
+  std::size_t seen = 0;
+  std::vector<TransferTuple> heap;
+};
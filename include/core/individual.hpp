@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/routing_model.hpp"
+#include <algorithm>
+#include <limits>
+
+// A giant tour over the stops of a RoutingModel. The genes live in the
+// population's pool; an Individual is a view on its slot plus the scores the
+// split decoder gave it, so swapping two individuals never copies genes.
+class Individual {
+public:
+  Individual() = default;
+  Individual(int *genes, int size) : genes(genes), size(size) {}
+
+  int *begin() { return genes; }
+  int *end() { return genes + size; }
+  const int *begin() const { return genes; }
+  const int *end() const { return genes + size; }
+  int &operator[](int i) { return genes[i]; }
+  int operator[](int i) const { return genes[i]; }
+  int getSize() const { return size; }
+
+  // Copies genes and scores; both individuals must have the same size.
+  void copyFrom(const Individual &other) {
+    std::copy(other.begin(), other.end(), genes);
+    evaluation = other.evaluation;
+    evaluated = other.evaluated;
+  }
+  void evaluate(const RoutingModel &model) {
+    evaluation = model.split(genes, size);
+    evaluated = true;
+  }
+  double getObjective() const {
+    return evaluated ? evaluation.objective
+                     : -std::numeric_limits<double>::infinity();
+  }
+
+  RouteEvaluation evaluation;
+  bool evaluated = false;
+
+private:
+  int *genes = nullptr;
+  int size = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "core/station.hpp"
+#include <cstdint>
+#include <vector>
+
+// Synthetic instances shaped like data/results.csv, at any size. The same
+// options and seed give the same stations.
+struct InstanceGeneratorOptions {
+  int stations = 2109;
+  std::uint64_t seed = 1;
+
+  // Layout: hotspotShare of the stations scattered around Gaussian
+  // hotspots, the rest uniform over the bounding box. The default box is
+  // that of the real instance; with scaleArea it grows about its centre so
+  // that station density stays that of the real instance.
+  double minLatitude = 40.633, maxLatitude = 40.887;
+  double minLongitude = -74.027, maxLongitude = -73.846;
+  bool scaleArea = true;
+  int hotspots = 0;             // 0: one per 100 stations
+  double hotspotShare = 0.7;
+  double hotspotRadius = 0.006; // standard deviation, degrees latitude
+
+  // Capacities: log-normal about the median, clamped to [min, max].
+  int medianCapacity = 25;
+  double capacitySpread = 0.35; // standard deviation of log(capacity)
+  int minCapacity = 15, maxCapacity = 123;
+
+  // Share of stations above and below their optimal inventory; the rest
+  // are balanced. The defaults are the real instance's.
+  double surplusShare = 0.36, deficitShare = 0.60;
+
+  // UDF curves: convex, with the minimum at the optimal inventory (drawn
+  // from 20-80% of capacity). The minimum is 10-60% of capacity; the ends
+  // rise above it by up to udfRise times the capacity.
+  double udfRise = 0.15;
+};
+
+// Stations with ids 1..n, without the depot (see ProblemInstance). Throws
+// std::invalid_argument on inconsistent options.
+std::vector<Station> generateStations(const InstanceGeneratorOptions &options);
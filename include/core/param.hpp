@@ -1,3 +1,5 @@
+#pragma once
+
 class Param {
 public:
   double tLoad;
@@ -6,7 +8,8 @@ public:
   int numOfStations;
   int numOfClusters;
   int numOfVehicles;
+  int vehicleCapacity; // bikes a rebalancing vehicle can carry
 
   Param(double tLoad, double alpha, double beta, int numOfStations,
-        int numOfClusters, int numOfVehicles);
-};
\ No newline at end of file
+        int numOfClusters, int numOfVehicles, int vehicleCapacity = 20);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "core/individual.hpp"
+#include <vector>
+
+// Fixed number of individual slots whose genes share one contiguous pool,
+// allocated once. Reusing slots for offspring keeps a run allocation-free.
+class Population {
+public:
+  Population(int slots, int genomeSize);
+
+  Individual &operator[](int slot) { return individuals[slot]; }
+  const Individual &operator[](int slot) const { return individuals[slot]; }
+  int getSlots() const { return static_cast<int>(individuals.size()); }
+  int getGenomeSize() const { return genomeSize; }
+  // Exchanges the individuals in two slots (views only, no gene copy).
+  void swap(int a, int b) { std::swap(individuals[a], individuals[b]); }
+  // Index of the pool segment the slot's genes live in. Stays with the
+  // individual through swap() and reorder(); genomeSize must be positive.
+  int getStorage(int slot) const {
+    return static_cast<int>((individuals[slot].begin() - pool.data()) /
+                            genomeSize);
+  }
+  // Moves the individual of slot order[i] to slot i, for all slots.
+  void reorder(const std::vector<int> &order);
+
+private:
+  int genomeSize;
+  std::vector<int> pool;
+  std::vector<Individual> individuals;
+  std::vector<Individual> scratch; // reorder() buffer, one per slot
+};
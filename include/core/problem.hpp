@@ -2,19 +2,44 @@
 
 #include "core/station.hpp"
 #include "core/transfer_tuple.hpp"
+#include <iosfwd>
+#include <string>
 #include <vector>
 
 class ProblemInstance {
 public:
   ProblemInstance() = default;
 
+  // Station CSV (as data/results.csv) or the binary station format (see
+  // core/station_io.hpp). The time matrix is read from time_matrix.csv in
+  // the working directory, or computed and saved there if that is missing
+  // or belongs to other stations.
   explicit ProblemInstance(const std::string &filename);
+  // In memory, e.g. from generateStations(): adds the depot and, unless
+  // buildTimeMatrix is false, the Euclidean time matrix, without touching
+  // the disk. The matrix takes n^2 doubles; skip it for very large n.
+  explicit ProblemInstance(std::vector<Station> stations,
+                           bool buildTimeMatrix = true);
 
   std::vector<Station> &getStations();
+  const std::vector<Station> &getStations() const;
   const std::vector<std::vector<double>> &getTimeMatrix() const;
   const std::vector<TransferTuple> &getTransfers() const;
 
+  // Euclidean travel times at 25.2 km/h, used when no time_matrix.csv is
+  // found in the working directory.
+  static std::vector<std::vector<double>>
+  computeTimeMatrix(const std::vector<Station> &stations);
+  // A matrix in the time_matrix.csv format (header row, then the station id
+  // and its row) over exactly `stations`, in order; empty entries are 0.
+  // Throws std::runtime_error if the ids or the size differ.
+  static std::vector<std::vector<double>>
+  readTimeMatrix(std::istream &in, const std::vector<Station> &stations);
+
 private:
+  // Prepends the depot (station 0) at the centroid of the stations.
+  void addDepot();
+
   std::vector<Station> stations;
   std::vector<std::vector<double>> timeMatrix;
   std::vector<TransferTuple> transfers;
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include "core/solution.hpp"
+#include "core/transfer_tuple.hpp"
+#include <limits>
+#include <vector>
+
+// A station visit of a selected tuple: pick up (quantity > 0) or drop
+// (quantity < 0) bikes there.
+struct Stop {
+  int station;
+  int quantity;
+  int tuple;       // index into the model's tuples
+  double deltaUDF; // UDF reduction at the station once the stop is served
+};
+
+struct RoutingOptions {
+  // Longest route a vehicle may drive, depot to depot (time matrix units,
+  // loading included). Infinite by default, which lets one vehicle serve
+  // everything its load allows.
+  double routeTimeLimit = std::numeric_limits<double>::infinity();
+  // Objective = served ΔUDF - timeWeight * total duration
+  double timeWeight = 1e-4;
+  // Also require every drop to follow all pickups of its own tuple in the
+  // same route, not just enough bikes on board.
+  bool tuplePrecedence = false;
+};
+
+// Score of a giant tour after the split decoder.
+struct RouteEvaluation {
+  double objective = 0.0;
+  double deltaUDF = 0.0;
+  double duration = 0.0;
+  int routes = 0;
+  int unserved = 0;
+};
+
+// Routes as stop ids, one vector per vehicle that left the depot.
+struct RoutingPlan {
+  std::vector<std::vector<int>> routes;
+  std::vector<int> unserved;
+  RouteEvaluation evaluation;
+};
+
+// Turns a set of selected transfer tuples into a multi-vehicle routing
+// problem over their stops. Routes start and end at the depot (station 0);
+// the load must stay within [0, vehicleCapacity] after every stop. Bikes are
+// interchangeable, so by default the load window is what makes pickups
+// precede drops; RoutingOptions::tuplePrecedence ties drops to their tuple.
+class RoutingModel {
+public:
+  RoutingModel(const ProblemInstance &instance, const Param &param,
+               const std::vector<TransferTuple> &tuples,
+               const RoutingOptions &options = {});
+
+  int getNumStops() const { return static_cast<int>(stops.size()); }
+  const Stop &getStop(int stop) const { return stops[stop]; }
+  const std::vector<Stop> &getStops() const { return stops; }
+  // stops of tuple t are tupleStart[t] .. tupleStart[t + 1] - 1, visiting
+  // order of the tuple (TransferTuple::visitOrder if set)
+  int getTupleBegin(int tuple) const { return tupleStart[tuple]; }
+  int getTupleEnd(int tuple) const { return tupleStart[tuple + 1]; }
+  int getNumTuples() const { return static_cast<int>(tuples.size()); }
+  int getTuplePickups(int tuple) const { return tuplePickups[tuple]; }
+  const std::vector<TransferTuple> &getTuples() const { return tuples; }
+
+  const ProblemInstance &getInstance() const { return instance; }
+  const Param &getParam() const { return param; }
+  const RoutingOptions &getOptions() const { return options; }
+  int getNumVehicles() const { return param.numOfVehicles; }
+  int getVehicleCapacity() const { return param.vehicleCapacity; }
+  double travelTime(int fromStation, int toStation) const {
+    return timeMatrix[fromStation][toStation];
+  }
+  double serviceTime(int stop) const;
+
+  // The stops of each tuple back to back, tuples by ΔUDF descending.
+  std::vector<int> tupleOrderTour() const;
+
+  // Linear split of a giant tour into at most numOfVehicles routes. Stops are
+  // appended to the open route; a stop that would overfill the vehicle or
+  // break the time limit closes it and opens the next one, a drop with too
+  // few bikes on board (or, with tuplePrecedence, ahead of its tuple's
+  // pickups) is skipped. Stops left over or skipped are unserved.
+  // If routeOf is given, routeOf[stop] receives the route or -1.
+  RouteEvaluation split(const int *tour, int size,
+                        int *routeOf = nullptr) const;
+  RoutingPlan decode(const std::vector<int> &tour) const;
+  // The plan's routes as a Solution (station and quantity per stop); it
+  // refers to this model's instance and param, so the model must outlive it.
+  Solution toSolution(const RoutingPlan &plan) const;
+
+private:
+  const ProblemInstance &instance;
+  const std::vector<std::vector<double>> &timeMatrix;
+  Param param;
+  RoutingOptions options;
+  std::vector<TransferTuple> tuples;
+  std::vector<Stop> stops;
+  std::vector<int> tupleStart;
+  std::vector<int> tuplePickups; // pickup stops per tuple
+};
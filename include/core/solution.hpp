@@ -1,16 +1,86 @@
 #pragma once
 
-#include "Data/Station.hpp"
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
 #include <vector>
 
+// Vehicle routes over station indices of a ProblemInstance. Each route is a
+// sequence of visits (station, quantity: + pickup / - drop); routes start
+// and end at the depot (station 0). Per route the load profile, duration
+// (travel + tLoad per bike) and ΔUDF are cached and only recomputed for
+// routes modified since they were last read. Routes are shared between
+// copies and cloned on the first write, so copying a solution for an
+// offspring costs one pointer per route. The instance and param must
+// outlive every solution built on them.
 class Solution {
 public:
-  Solution() = default;
+  Solution(const ProblemInstance &instance, const Param &param);
+  // Copies evaluate pending routes of `other` first, so that shared routes
+  // are never modified afterwards.
+  Solution(const Solution &other);
+  Solution &operator=(const Solution &other);
+  Solution(Solution &&) = default;
+  Solution &operator=(Solution &&) = default;
 
-  void addStation(const Station &station) { stations.push_back(station); }
+  int getNumRoutes() const { return static_cast<int>(routes.size()); }
+  int addRoute(); // appends an empty route, returns its index
+  void removeRoute(int route);
+  int getRouteSize(int route) const;
+  const std::vector<int> &getStations(int route) const;
+  const std::vector<int> &getQuantities(int route) const;
 
-  const std::vector<Station> &getStations() const { return stations; }
+  // pos in [0, getRouteSize(route)]; throws std::out_of_range otherwise
+  void insertVisit(int route, int pos, int station, int quantity);
+  void eraseVisit(int route, int pos);
+  void setQuantity(int route, int pos, int quantity);
+
+  // Bikes on board after each visit.
+  const std::vector<int> &getLoads(int route) const;
+  double getDuration(int route) const;
+  // Sum over the route's visits of udf(inventory) - udf(inventory - q),
+  // each taken from the station's current inventory.
+  double getDeltaUDF(int route) const;
+  // Load within [0, vehicleCapacity] after every visit.
+  bool isFeasible(int route) const;
+
+  double getTotalDuration() const;
+  double getTotalDeltaUDF() const;
+  bool isFeasible() const;
+  // Routes re-evaluated so far by this solution and the ones it was copied
+  // from; shows how much the caches save.
+  std::size_t getEvaluations() const { return evaluations; }
+
+  // Compact checkpoint: routes as varint-coded stations and zigzag-coded
+  // quantities; caches are rebuilt after loading. load() throws
+  // std::runtime_error on a malformed stream and std::invalid_argument on a
+  // station the instance does not have.
+  void save(std::ostream &out) const;
+  static Solution load(std::istream &in, const ProblemInstance &instance,
+                       const Param &param);
+
+  const ProblemInstance &getInstance() const { return *instance; }
+  const Param &getParam() const { return *param; }
 
 private:
-  std::vector<Station> stations;
-};
\ No newline at end of file
+  struct Route {
+    std::vector<int> stations, quantities;
+    // caches, valid unless dirty
+    std::vector<int> loads;
+    double duration = 0.0, deltaUDF = 0.0;
+    bool feasible = true, dirty = false;
+  };
+
+  const Route &read(int route) const; // evaluated
+  Route &write(int route);            // unshared and marked dirty
+  void evaluate(Route &route) const;
+  void evaluateAll() const;
+
+  const ProblemInstance *instance;
+  const Param *param;
+  // a dirty route is never shared: write() clones before marking it
+  std::vector<std::shared_ptr<Route>> routes;
+  mutable std::size_t evaluations = 0;
+};
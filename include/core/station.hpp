@@ -32,6 +32,8 @@ public:
   int getCurrentInventory() const;
   int getOptimalInventory() const;
   const std::vector<double> &getUdfValues() const;
+  // UDF at an inventory level, clamped to the recorded curve (0 if empty)
+  double getUdfAt(int inventory) const;
   double getBcrf() const;
   void setUdfValues(const std::vector<double> &values);
   void setCapacity(int cap);
@@ -47,5 +49,5 @@ private:
   int optimalInventory;
   std::vector<double> udfValues;
   Coordinate coordinate{0.0, 0.0}; // Default to (0,0)
-  double bcrf;
+  double bcrf = 0.0; // set by MetricCalculator::computeBCRF; 0 for the depot
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "core/station.hpp"
+#include <iosfwd>
+#include <vector>
+
+// Station files. The CSV format is that of data/results.csv: StationID,
+// StationName, Latitude, Longitude, Capacity, CurrentInventory, Optimal
+// Inventory, Min UDF, then UDF(0) .. UDF(capacity), padded with empty
+// fields to the largest capacity. Names are not kept by Station; the
+// writer fills in the system id.
+//
+// The binary format holds the same fields in a fraction of the size and
+// parses without text conversion: "BRPI", then varints for the version,
+// the station count and, per station, the id length, capacity and
+// inventories, with the id bytes and the coordinates and UDF values as
+// little-endian IEEE doubles.
+//
+// Readers assign ids 1..n in file order.
+std::vector<Station> readStationsCsv(std::istream &in);
+void writeStationsCsv(std::ostream &out, const std::vector<Station> &stations);
+void writeStationsBinary(std::ostream &out,
+                         const std::vector<Station> &stations);
+// Throws std::runtime_error on a stream that is not a station file or is
+// truncated.
+std::vector<Station> readStationsBinary(std::istream &in);
+// True if the stream starts with the binary magic; does not consume it.
+bool isStationsBinary(std::istream &in);
@@ -2,23 +2,43 @@
 
 #pragma once
 #include "core/station.hpp"
-#include "utils/debug_utils.h"
+#include "utils/Logger.hpp"
+#include <algorithm>
 #include <map>
 #include <unordered_set>
 #include <vector>
 
+enum class TupleScore { DELTA_UDF, DELTA_UDF_PER_TIME };
+
 struct TransferTuple {
   std::vector<int> surplusStationIndices;
   std::vector<int> deficitStationIndices;
   std::map<std::pair<int, int>, int>
       bikeAllocations; // <which station, which station>: how many bikes
-  double deltaUDF;     // Total UDF reduction from this tuple
+  double deltaUDF = 0.0; // Total UDF reduction from this tuple
+  // Filled when route scoring is enabled: time one vehicle needs to serve the
+  // tuple (travel + loading) and the station order achieving it
+  double serviceTime = 0.0;
+  std::vector<int> visitOrder;
+
+  // Shortest service time DELTA_UDF_PER_TIME divides by. A tuple without
+  // one (route scoring off, or tLoad 0 at co-located stations) counts as
+  // taking this long, so its score stays in ΔUDF per time unit like every
+  // other; route-scored tuples take at least tLoad per bike, far above it.
+  static constexpr double kMinServiceTime = 1.0;
+
+  // deltaUDF, or deltaUDF per unit of service time
+  double score(TupleScore kind) const {
+    if (kind == TupleScore::DELTA_UDF_PER_TIME)
+      return deltaUDF / std::max(serviceTime, kMinServiceTime);
+    return deltaUDF;
+  }
 
   // print the transfer information (which station -> which station: how many
   // bikes)
   void print() const {
     for (const auto &[key, value] : bikeAllocations) {
-      DEBUG_PRINT(key.first << " -> " << key.second << ": " << value);
+      LOG_INFO(key.first << " -> " << key.second << ": " << value);
     }
   }
 };
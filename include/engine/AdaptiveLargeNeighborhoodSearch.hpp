@@ -0,0 +1,116 @@
+#pragma once
+
+#include "core/routing_model.hpp"
+#include "engine/HeuristicBase.hpp"
+#include "utils/Random.hpp"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+enum class RemovalOperator { RANDOM, RELATED, WORST };
+enum class InsertionOperator { GREEDY, REGRET };
+
+struct AlnsOptions {
+  int iterations = 1000;       // 0: until the time limit
+  double timeLimitSeconds = 0; // 0: `iterations` only
+  // share of the served stops removed per iteration, drawn uniformly
+  double minRemoval = 0.1, maxRemoval = 0.3;
+  int regretK = 3;
+  // selection bias of related and worst removal (Ropke & Pisinger's p)
+  double removalPower = 4.0;
+  // adaptive weights: scores per outcome, updated every segment. A worse
+  // candidate the annealing accepts earns scoreAccepted; one no better and
+  // no worse than the current solution is accepted but earns nothing.
+  int segmentLength = 50;
+  double reaction = 0.1;
+  double scoreNewBest = 33, scoreBetter = 9, scoreAccepted = 13;
+  // simulated annealing: a start temperature that accepts a solution
+  // `startWorse` (relative) below the initial one half of the time, cooled
+  // geometrically down to `endTemperature` times that over the run
+  double startWorse = 0.05;
+  double endTemperature = 1e-3;
+  unsigned seed = 1;
+};
+
+struct AlnsResult {
+  RoutingPlan best;
+  std::vector<int> bestTour; // routes back to back, then unserved stops
+  std::vector<double> trace; // best objective after each iteration
+  int iterations = 0;
+  std::size_t accepted = 0, improved = 0;
+  std::array<double, 3> removalWeights{};
+  std::array<double, 2> insertionWeights{};
+  double elapsedSeconds = 0.0;
+};
+
+// Adaptive large neighbourhood search over the stops of a RoutingModel.
+// Every iteration removes a share of the served stops (random, related by
+// travel time to a seed stop, or worst ΔUDF for their time; the last two
+// rank the stops once and draw from that ranking), reinserts unserved stops
+// greedily or by regret-k, and accepts the result by simulated annealing on
+// ΔUDF - timeWeight * duration. Operators are drawn by roulette on weights
+// learnt from their recent success. Routes keep their load profile with
+// suffix load minima/maxima, so inserting or removing a stop is checked in
+// O(1); only the routes an operator touches are rebuilt, and the regret
+// table is refreshed for the changed route alone. Routes obey the load
+// window, the time limit and, if set, tuple precedence, like split().
+class AdaptiveLargeNeighborhoodSearch : public HeuristicBase {
+public:
+  AdaptiveLargeNeighborhoodSearch(const RoutingModel &model,
+                                  const AlnsOptions &options = {});
+
+  // Starts from these routes instead of greedy insertion into empty ones.
+  // Throws std::invalid_argument if a route breaks a constraint, a stop
+  // appears twice or there are more routes than vehicles.
+  void setInitialPlan(const RoutingPlan &plan);
+
+  AlnsResult run();
+  Solution solve(const ProblemInstance &instance) override;
+
+private:
+  struct Route {
+    std::vector<int> stops;
+    std::vector<int> load;               // [0] = 0, [k] after the k-th stop
+    std::vector<int> suffixMin, suffixMax; // of load[k ..], sentinel at end
+    double duration = 0.0, deltaUDF = 0.0;
+  };
+  struct State {
+    std::vector<Route> routes;
+    std::vector<int> routeOf, posOf; // posOf: 1-based position in its route
+    std::vector<int> unassigned;
+    double objective = 0.0;
+  };
+  struct Insertion {
+    double value; // ΔUDF - timeWeight * added duration
+    int after;    // position the stop goes behind (0: depot)
+  };
+
+  int station(const Route &route, int pos) const;
+  void rebuild(State &state, int r) const;
+  void score(State &state) const;
+  bool precedenceOk(const State &state, int r, int after, int stop) const;
+  Insertion bestInsertion(const State &state, int r, int stop) const;
+  bool removable(const State &state, int stop) const;
+  void remove(State &state, int stop) const;
+  void insert(State &state, int r, int after, int stop) const;
+  // Removes the stop if it can go (with tuple precedence, after the drops
+  // of its tuple that depend on it); returns how many stops were removed.
+  int take(State &state, int stop) const;
+
+  void randomRemoval(State &state, int count);
+  void relatedRemoval(State &state, int count);
+  void worstRemoval(State &state, int count);
+  // Takes out up to `count` stops drawn from `ranked` with a bias towards
+  // its front (removalPower); drawn stops leave the ranking.
+  void removeRanked(State &state, std::vector<int> &ranked, int count);
+  void reinsert(State &state, InsertionOperator kind);
+  int roulette(const double *weights, int count);
+
+  RoutingPlan toPlan(const State &state) const;
+
+  const RoutingModel &model;
+  AlnsOptions options;
+  RandomEngine rng;
+  RoutingPlan initialPlan;
+  bool hasInitialPlan = false;
+};
@@ -1,10 +1,107 @@
 #pragma once
 
-#include "corePopulation.hpp"
+#include "core/population.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
+// Survivor selection and clone control for the GA. Each generation the GA
+// calls reset() with its parents in the first slots, asks admit() before
+// evaluating an offspring, and lets diversify() pick the survivors.
 class Diversification {
 public:
   Diversification() = default;
+  virtual ~Diversification() = default;
 
-  virtual void diversify(Population &population) = 0;
-};
\ No newline at end of file
+  // Slots [0, parents) hold the unchanged parents; all other slots are about
+  // to be overwritten.
+  virtual void reset(const Population &population, int parents) = 0;
+  // false if an equal tour is already among the parents or the admitted
+  // offspring of this generation; the tour is recorded otherwise.
+  virtual bool admit(const Individual &individual) = 0;
+  // Reorders the slots so that the first `survivors` are kept, best
+  // objective first; unevaluated slots are never preferred.
+  virtual void diversify(Population &population, int survivors) = 0;
+};
+
+// Zobrist-style hash of a giant tour: the XOR of one random key per directed
+// edge, the depot (stop n) closing the tour at both ends. Changing an edge
+// toggles one key, so a move that relinks k edges updates the hash in O(k).
+class TourHash {
+public:
+  TourHash(int numStops, std::uint64_t seed = 0x5eed);
+
+  std::uint64_t edge(int from, int to) const;
+  std::uint64_t of(const int *tour, int size) const;
+  // Removes the edge if the hash contains it, adds it otherwise.
+  std::uint64_t toggle(std::uint64_t hash, int from, int to) const {
+    return hash ^ edge(from, to);
+  }
+  int getDepot() const { return depot; }
+
+private:
+  int depot;
+  std::vector<std::uint64_t> outKey, inKey;
+};
+
+// Broken-pairs distance: the share of successor links (depot included) of
+// tour a that tour b does not have, in [0, 1]. Builds a successor array;
+// BrokenPairsDiversification keeps those per individual instead.
+double brokenPairsDistance(const Individual &a, const Individual &b);
+
+struct DiversityOptions {
+  int closest = 5; // neighbours averaged in an individual's diversity
+  int elites = 4;  // survivors kept mostly on objective alone
+};
+
+struct DiversityStats {
+  std::size_t rejected = 0;  // clones refused by admit()
+  std::size_t distances = 0; // broken-pairs distances computed
+};
+
+// Biased-fitness survivor selection (Vidal et al., HGS): an individual's
+// diversity is its mean broken-pairs distance to its `closest` nearest
+// neighbours, and its biased fitness is its objective rank plus
+// (1 - elites / m) times its diversity rank among the m candidates. The
+// worst biased fitness, or a clone, is removed until `survivors` remain;
+// the best objective always stays. The broken-pairs distance is the share
+// of successor links (depot included) two tours do not have in common, read
+// off per-storage successor arrays; distances between individuals that did
+// not change since the last call are reused. Nothing is allocated after
+// construction.
+class BrokenPairsDiversification : public Diversification {
+public:
+  BrokenPairsDiversification(int slots, int numStops,
+                             const DiversityOptions &options = {});
+
+  void reset(const Population &population, int parents) override;
+  bool admit(const Individual &individual) override;
+  void diversify(Population &population, int survivors) override;
+
+  const TourHash &getHash() const { return hash; }
+  const DiversityStats &getStats() const { return stats; }
+
+private:
+  void checkSlots(const Population &population) const;
+  void insertHash(std::uint64_t h);
+  bool containsHash(std::uint64_t h) const;
+  void fillSuccessors(int storage, const Individual &individual);
+  float &dist(int a, int b) { return distances[a * slots + b]; }
+
+  int slots, numStops;
+  DiversityOptions options;
+  TourHash hash;
+  DiversityStats stats;
+
+  std::vector<std::uint64_t> table; // open addressing, 0 marks a free cell
+  std::vector<int> successors;      // (numStops + 1) per storage index
+  std::vector<std::uint64_t> hashOf;
+  std::vector<char> known; // successors, hash and distances are current
+  std::vector<float> distances;
+
+  // diversify() scratch, indexed by candidate
+  std::vector<int> storage, slotOf, byObjective, byDiversity, order;
+  std::vector<double> diversity, biased;
+  std::vector<float> nearest;
+  std::vector<char> fresh, alive, kept; // kept is indexed by slot
+};
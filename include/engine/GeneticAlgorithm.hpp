@@ -1,27 +1,100 @@
 #pragma once
 
-#include "Operators/Crossover.hpp"
-#include "Operators/LocalSearch.hpp"
-#include "Operators/Mutation.hpp"
-#include "Operators/Repair.hpp"
-#include "corePopulation.hpp"
-#include "coreProblemInstance.hpp"
-
-class GeneticAlgorithm {
+#include "core/population.hpp"
+#include "core/routing_model.hpp"
+#include "engine/Diversification.hpp"
+#include "engine/HeuristicBase.hpp"
+#include "operators/Crossover.hpp"
+#include "operators/LocalSearch.hpp"
+#include "operators/Mutation.hpp"
+#include "operators/Repair.hpp"
+#include "utils/Random.hpp"
+#include <cstddef>
+#include <vector>
+
+struct GeneticAlgorithmOptions {
+  int populationSize = 50;
+  int generations = 200;
+  double timeLimitSeconds = 0; // 0: stop after `generations` only
+  double crossoverRate = 0.9;
+  double mutationRate = 0.3;
+  int tournamentSize = 2;
+  unsigned seed = 1;
+  // Stream of `seed` the run draws from (see Xoshiro256::stream); runs on
+  // the same seed with different streams never share random numbers.
+  unsigned stream = 0;
+};
+
+struct GeneticAlgorithmResult {
+  RoutingPlan best;
+  std::vector<int> bestTour;
+  std::vector<double> trace; // best objective after each generation
+  int generations = 0;
+  std::size_t evaluations = 0;    // giant tours split, operators' included
+  std::size_t clonesRejected = 0; // offspring not evaluated as duplicates
+  double elapsedSeconds = 0.0;
+};
+
+// Generational GA with (mu + lambda) survivor selection over giant tours of
+// the model's stops, decoded by RoutingModel::split. Offspring are written
+// into preallocated population slots, so once initialize() has run, step()
+// does not allocate. Local search and repair are optional (nullptr). With a
+// Diversification set, offspring equal to a parent or an earlier offspring
+// are not evaluated and it picks the survivors instead of the objective.
+class GeneticAlgorithm : public HeuristicBase {
 public:
-  GeneticAlgorithm(const ProblemInstance &instance, Crossover *crossover,
-                   Mutation *mutation, LocalSearch *localSearch, Repair *repair)
-      : instance(instance), crossover(crossover), mutation(mutation),
-        localSearch(localSearch), repair(repair) {}
+  GeneticAlgorithm(const RoutingModel &model, Crossover *crossover,
+                   Mutation *mutation, LocalSearch *localSearch,
+                   Repair *repair, const GeneticAlgorithmOptions &options = {});
+
+  GeneticAlgorithmResult run();
+  // run() for the model's instance, best plan as a Solution
+  Solution solve(const ProblemInstance &instance) override;
 
-  void run() {
-    // TODO: Implement genetic algorithm
+  // Tours placed in the initial population ahead of random ones. Throws
+  // std::invalid_argument unless the tour is a permutation of the stops.
+  void addInitialTour(const std::vector<int> &tour);
+  // Survivor selection and clone control; the population has
+  // 2 * populationSize slots of getModel().getNumStops() genes. nullptr
+  // (the default) keeps plain (mu + lambda).
+  void setDiversification(Diversification *diversification) {
+    this->diversification = diversification;
   }
+  // run() is initialize() followed by step() once per generation.
+  void initialize();
+  void step();
+
+  // Offers `count` tours (stored back to back) to the population; each
+  // replaces the current worst individual if it is better.
+  void insertMigrants(const int *tours, int count);
+
+  // Slots are sorted best first after initialize(), step() and
+  // insertMigrants(); slot 0 holds the best individual.
+  const Individual &getBest() const { return population[0]; }
+  Population &getPopulation() { return population; }
+  std::size_t getEvaluations() const { return evaluations; }
+  std::size_t getClonesRejected() const { return clonesRejected; }
+  const RoutingModel &getModel() const { return model; }
 
 private:
-  ProblemInstance instance;
+  int tournament();
+  void evaluate(Individual &individual);
+  // splits run by repair and local search so far
+  std::size_t operatorEvaluations() const;
+  void sortSurvivors();
+  void selectSurvivors();
+
+  const RoutingModel &model;
   Crossover *crossover;
   Mutation *mutation;
   LocalSearch *localSearch;
   Repair *repair;
-};
\ No newline at end of file
+  Diversification *diversification = nullptr;
+  GeneticAlgorithmOptions options;
+  RandomEngine rng;
+  Population population; // parents in [0, P), offspring in [P, 2P)
+  std::vector<int> order;
+  std::vector<std::vector<int>> initialTours;
+  std::size_t evaluations = 0;
+  std::size_t clonesRejected = 0;
+};
@@ -1,11 +1,20 @@
 #pragma once
 
-#include "coreProblemInstance.hpp"
-#include "coreSolution.hpp"
+#include "core/problem.hpp"
+#include "core/solution.hpp"
 
+// Common entry point of the routing heuristics (GA, ALNS). A heuristic is
+// built on a RoutingModel of one instance and solves that instance only.
 class HeuristicBase {
 public:
   HeuristicBase() = default;
+  virtual ~HeuristicBase() = default;
 
   virtual Solution solve(const ProblemInstance &instance) = 0;
-};
\ No newline at end of file
+
+protected:
+  // Throws std::invalid_argument unless `instance` is the one the heuristic
+  // was built for.
+  static void requireInstance(const ProblemInstance &instance,
+                              const ProblemInstance &expected);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "engine/GeneticAlgorithm.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+enum class MigrationTopology { RING, FULLY_CONNECTED };
+
+// Operators of one island; each island owns its own set because operators
+// keep scratch state.
+struct IslandOperators {
+  std::unique_ptr<Crossover> crossover;
+  std::unique_ptr<Mutation> mutation;
+  std::unique_ptr<LocalSearch> localSearch;
+  std::unique_ptr<Repair> repair;
+  std::unique_ptr<Diversification> diversification; // optional
+};
+
+struct IslandModelOptions {
+  int islands = 4;
+  MigrationTopology topology = MigrationTopology::RING;
+  int migrationInterval = 10; // generations per epoch
+  int migrants = 2;           // elites sent to each neighbour per epoch
+  int queueCapacity = 4;      // packets in flight per channel, at least 2
+  // Per-island GA settings; island i draws from stream ga.stream + i of
+  // ga.seed.
+  GeneticAlgorithmOptions ga;
+  // Builds the operators of one island; OrderCrossover + InversionMutation
+  // if unset.
+  std::function<IslandOperators()> makeOperators;
+};
+
+struct IslandModelResult {
+  RoutingPlan best;
+  std::vector<int> bestTour;
+  int bestIsland = -1;
+  // best objective of island i after each of its generations
+  std::vector<std::vector<double>> traces;
+  std::size_t evaluations = 0;
+  std::size_t migrationsReceived = 0;
+  double elapsedSeconds = 0.0;
+  double evaluationsPerSecondPerThread = 0.0;
+};
+
+// Runs one GeneticAlgorithm per thread. Every migrationInterval generations
+// an island sends copies of its best tours to its neighbours through bounded
+// lock-free SPSC queues, and takes in the packets its neighbours sent one
+// epoch earlier. A receiver only waits if a neighbour is a whole epoch
+// behind, and since each island always consumes the same epoch's packets,
+// a fixed seed and island count give the same run whatever the thread
+// timing. A time limit (ga.timeLimitSeconds) stops all islands at the first
+// expiry and gives up that guarantee.
+class IslandModel {
+public:
+  IslandModel(const RoutingModel &model, const IslandModelOptions &options);
+
+  IslandModelResult run();
+
+private:
+  const RoutingModel &model;
+  IslandModelOptions options;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/routing_model.hpp"
+#include <cstddef>
+#include <vector>
+
+struct ConstructionOptions {
+  unsigned threads = 0; // savings workers; 0: hardware_concurrency()
+  // best savings kept per block (successor candidates); 0 keeps them all
+  int neighbours = 40;
+};
+
+struct ConstructionResult {
+  RoutingPlan plan;      // the constructed routes, scored like split()
+  std::vector<int> tour; // routes back to back, then the unserved stops
+  std::size_t savings = 0; // positive merge candidates considered
+  std::size_t merges = 0;
+  double elapsedSeconds = 0.0;
+};
+
+// Clarke-Wright savings over tuple blocks: every tuple's stops form a block
+// whose load starts and ends at zero, so routes are chains of blocks and only
+// the time limit constrains a merge. Within a block, drops are moved up
+// between pickups where they fit, unless RoutingOptions::tuplePrecedence
+// fixes the model order. Starting from one route per block, the savings
+// t(last_i, 0) + t(0, first_j) - t(last_i, first_j) of appending block j's
+// route to block i's are computed in parallel, each block keeping its
+// `neighbours` best, and merges are applied in decreasing saving order. The
+// best numOfVehicles routes by ΔUDF - timeWeight * duration are kept. Blocks
+// that break the load window or the time limit on their own are unserved.
+// The tour is meant as a GA seed (GeneticAlgorithm::addInitialTour); split()
+// may cut it differently from the plan.
+class SavingsConstruction {
+public:
+  explicit SavingsConstruction(const RoutingModel &model,
+                               const ConstructionOptions &options = {});
+
+  ConstructionResult run() const;
+
+private:
+  const RoutingModel &model;
+  ConstructionOptions options;
+};
@@ -1,11 +1,29 @@
 #pragma once
 
-#include "coreIndividual.hpp"
+#include "core/individual.hpp"
+#include "utils/Random.hpp"
+#include <vector>
 
 class Crossover {
 public:
   Crossover() = default;
+  virtual ~Crossover() = default;
 
-  virtual Individual crossover(const Individual &parent1,
-                               const Individual &parent2) = 0;
-};
\ No newline at end of file
+  // Writes a child of the two parents into `child`, a slot of the same
+  // genome size; the child is left unevaluated.
+  virtual void crossover(const Individual &parent1, const Individual &parent2,
+                         Individual &child, RandomEngine &rng) = 0;
+};
+
+// Order crossover (OX): the child keeps a random slice of parent1 and fills
+// the rest with the missing genes in parent2's order, starting after the
+// slice.
+class OrderCrossover : public Crossover {
+public:
+  void crossover(const Individual &parent1, const Individual &parent2,
+                 Individual &child, RandomEngine &rng) override;
+
+private:
+  std::vector<int> taken; // generation stamp per gene, reused across calls
+  int stamp = 0;
+};
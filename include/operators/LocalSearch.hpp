@@ -1,10 +1,130 @@
 #pragma once
 
-#include "coreIndividual.hpp"
+#include "core/individual.hpp"
+#include "utils/Random.hpp"
+#include <array>
+#include <cstddef>
+#include <vector>
 
 class LocalSearch {
 public:
   LocalSearch() = default;
+  virtual ~LocalSearch() = default;
 
-  virtual void improve(Individual &individual) = 0;
-};
\ No newline at end of file
+  // Leaves the individual evaluated.
+  virtual void improve(Individual &individual, RandomEngine &rng) = 0;
+  // Giant tours split so far, for the GA's evaluation count
+  std::size_t getEvaluations() const { return evaluations; }
+
+protected:
+  std::size_t evaluations = 0;
+};
+
+struct LocalSearchOptions {
+  int neighbours = 10; // granularity: nearest stops tried for each stop
+  int maxPasses = 50;  // passes over all stops without improvement stop it
+};
+
+enum class MoveType { RELOCATE, SWAP, TWO_OPT, OR_OPT, TUPLE_SWAP, INSERT };
+
+struct LocalSearchStats {
+  std::array<std::size_t, 6> applied{}; // indexed by MoveType
+  std::size_t evaluated = 0;
+  std::size_t passes = 0;
+  std::size_t undone = 0;   // moves the decoder would cut differently
+  std::size_t reverted = 0; // runs whose input split was better
+};
+
+// First-improvement local search on the routes of the split decoder.
+// Neighbourhoods: relocate and swap (within and between vehicles), 2-opt and
+// Or-opt (segments of 2-3 stops) within a route, swapping runs of one tuple's
+// stops between vehicles, and inserting unserved stops. Moves are granular:
+// stop a only meets the stops nearest to it in the time matrix. Each route
+// caches its prefix travel, service and load arrays plus sparse tables of the
+// load minimum/maximum, so a move's duration change and load feasibility are
+// known in O(1); only routes a move changes are rebuilt. Stops and move types
+// are tried in a random order on every pass. The routes always are the ones
+// the split decoder cuts the stored tour into, so the tour is split once per
+// improve() and its score follows from the routes. A move is undone when the
+// decoder would cut differently: a changed route whose prefix runs over the
+// time limit, a route boundary next to it where the following route's first
+// stop would still fit, or an unserved stop the decoder would now serve (only
+// checked when the last route or the unserved stops change). With
+// RoutingOptions::tuplePrecedence, a move must also leave every drop behind
+// all pickups of its tuple in its route.
+class RouteLocalSearch : public LocalSearch {
+public:
+  explicit RouteLocalSearch(const RoutingModel &model,
+                            const LocalSearchOptions &options = {});
+
+  void improve(Individual &individual, RandomEngine &rng) override;
+  const LocalSearchStats &getStats() const { return stats; }
+
+private:
+  struct Route {
+    std::vector<int> nodes; // stop ids framed by -1 (the depot) at both ends
+    std::vector<int> load;  // bikes on board after each node
+    std::vector<double> fwd, bwd; // travel along / against the route so far
+    std::vector<double> svc;      // service time so far
+    std::vector<double> time;     // route time so far, summed as split() does
+    std::vector<int> minLoad, maxLoad; // sparse tables over load
+    double duration = 0.0;
+    int size() const { return static_cast<int>(nodes.size()) - 2; }
+  };
+
+  int station(const Route &route, int pos) const;
+  double travel(int fromStation, int toStation) const;
+  int rangeMin(const Route &route, int first, int last) const;
+  int rangeMax(const Route &route, int first, int last) const;
+  bool loadOk(int low, int high) const;
+  bool durationOk(double duration) const;
+  void rebuild(int r);
+  void place(int r);
+  bool improves(double durationDelta, double udfGain) const;
+
+  bool load(const int *genes, RouteEvaluation &input);
+  void store(int *genes) const;
+  bool decodes();
+  bool routeOk(const Route &route);
+  bool absorbs(const Route &route, int stop) const;
+  bool tailUnserved();
+  int previousUsed(int r) const;
+  int nextUsed(int r) const;
+  RouteEvaluation evaluation() const;
+  bool precedenceOk(const Route &route);
+  void backup(int r);
+  bool commit();
+  bool tryMove(MoveType type, int a);
+  bool tryRelocate(int a, int b);
+  bool trySwap(int a, int b);
+  bool tryTwoOpt(int a, int b);
+  bool tryOrOpt(int a, int b);
+  bool tryTupleSwap(int a, int b);
+  bool tryInsert(int a, int b);
+  bool tryInsertNewRoute(int a);
+  bool moveSegment(int r, int first, int last, int after);
+  void removeUnserved(int stop);
+  void restoreUnserved();
+
+  const RoutingModel &model;
+  LocalSearchOptions options;
+  LocalSearchStats stats;
+  std::vector<std::vector<int>> neighbours; // nearest stops of each stop
+  int levels;                                // sparse table depth
+
+  // state of the current improve() call
+  std::vector<Route> routes; // one per vehicle, empty if unused
+  std::vector<int> routeOf, posOf; // -1 if unserved
+  std::vector<int> unserved, unservedPos;
+  std::vector<int> stopOrder;
+  std::array<MoveType, 6> moveOrder;
+  std::vector<int> routeScratch;
+  std::vector<int> tour;        // stored tour, re-read by load()
+  std::vector<int> pickupsSeen; // per tuple, for precedenceOk()
+
+  // routes a move changes, as they were before it, for commit() to restore
+  std::array<std::vector<int>, 2> saved;
+  std::array<int, 2> savedRoute{};
+  int savedCount = 0;
+  int insertedStop = -1, insertedPos = -1; // taken from unserved[insertedPos]
+};
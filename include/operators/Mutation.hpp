@@ -1,10 +1,24 @@
 #pragma once
 
-#include "coreIndividual.hpp"
+#include "core/individual.hpp"
+#include "utils/Random.hpp"
 
 class Mutation {
 public:
   Mutation() = default;
+  virtual ~Mutation() = default;
 
-  virtual void mutate(Individual &individual) = 0;
-};
\ No newline at end of file
+  virtual void mutate(Individual &individual, RandomEngine &rng) = 0;
+};
+
+// Reverses a random segment of the giant tour.
+class InversionMutation : public Mutation {
+public:
+  void mutate(Individual &individual, RandomEngine &rng) override;
+};
+
+// Moves one random gene to a random position.
+class RelocateMutation : public Mutation {
+public:
+  void mutate(Individual &individual, RandomEngine &rng) override;
+};
@@ -1,10 +1,75 @@
 #pragma once
 
-#include "coreIndividual.hpp"
+#include "core/individual.hpp"
+#include <cstddef>
+#include <vector>
 
 class Repair {
 public:
   Repair() = default;
+  virtual ~Repair() = default;
 
+  // Leaves the individual evaluated.
   virtual void repair(Individual &individual) = 0;
-};
\ No newline at end of file
+  // Giant tours split so far, for the GA's evaluation count
+  std::size_t getEvaluations() const { return evaluations; }
+
+protected:
+  std::size_t evaluations = 0;
+};
+
+struct RepairStats {
+  std::size_t repaired = 0;    // repair() calls
+  std::size_t removed = 0;     // stops taken out by the feasibility pass
+  std::size_t reinserted = 0;  // stops placed back (incl. unserved ones)
+  std::size_t candidates = 0;  // insertion positions tested
+  std::size_t reverted = 0;    // re-split worse than the input, undone
+};
+
+// Makes a child's routes feasible and fills them up again. The tour is cut
+// into consecutive routes on the time limit only, and each route is then
+// filtered in one pass, dropping every stop that would take the load out of
+// [0, vehicleCapacity] or, with tuplePrecedence, visit a drop before its
+// tuple's pickups. Removed and unserved stops are
+// then reinserted one by one at their cheapest feasible position over all
+// routes (pickups of a tuple before its drops). Each route keeps its load
+// profile with prefix and suffix load minima/maxima, so testing a position
+// is O(1): the new stop's load plus the suffix shifted by its quantity.
+// The repaired tour is the routes concatenated, then the stops that fit
+// nowhere; it is kept only if its split is not worse than the input's. An
+// evaluated input is not split again, and reverting restores its score, so
+// a repair costs one split, two for an unevaluated input.
+class LoadFeasibilityRepair : public Repair {
+public:
+  explicit LoadFeasibilityRepair(const RoutingModel &model);
+
+  void repair(Individual &individual) override;
+  const RepairStats &getStats() const { return stats; }
+
+private:
+  struct Route {
+    std::vector<int> nodes; // stop ids framed by -1 (the depot) at both ends
+    std::vector<int> load;  // bikes on board after each node
+    std::vector<int> prefixMin, prefixMax; // of load[0 .. p]
+    std::vector<int> suffixMin, suffixMax; // of load[p .. size() + 1]
+    double duration = 0.0;
+    int size() const { return static_cast<int>(nodes.size()) - 2; }
+  };
+
+  int station(const Route &route, int pos) const;
+  void rebuild(int r);
+  void filter(int r);
+  bool insert(int stop);
+  // true if `stop` may follow node `after` of route r as far as precedence
+  // is concerned
+  bool precedenceOk(int r, int after, int stop) const;
+
+  const RoutingModel &model;
+  RepairStats stats;
+
+  std::vector<Route> routes;
+  std::vector<int> routeOf, posOf; // -1 if unserved
+  std::vector<int> pending;
+  std::vector<int> original; // input tour, restored if repair made it worse
+  std::vector<int> pickupsKept; // filter(): pickups of each tuple so far
+};
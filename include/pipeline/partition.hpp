@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core/station.hpp"
+#include "pipeline/pipeline.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Partitioned mode, for networks whose N x N matrices do not fit in one
+// process: the stations are split into geographic regions, each region
+// (with a halo of its neighbours' stations) is planned by its own worker
+// process on its own instance slice, and the boundary is reconciled
+// afterwards. The coordinator holds stations only, never a full matrix,
+// and talks to the workers through files in the work directory:
+//
+//   region-R.bin          the slice's stations (binary station format)
+//   region-R.matrix.csv   its rows and columns of the time matrix, if any
+//   region-R.json         its pipeline config
+//   region-R.plan.json    the worker's plan (see writePlanJson)
+//   region-R.log          the worker's output
+//   seam.matrix.csv       the seam stations' rows and columns, if route
+//                         scoring uses a time matrix file
+//
+// Each region keeps the tuples that use only stations it owns away from
+// the seam. The rest, stations within the margin of another region and
+// those of the tuples given up, are grouped by location into seam clusters
+// and planned again by tuple evaluation, with the BCRF, route scoring and
+// selection options a worker would use.
+struct PartitionOptions {
+  int regions = 4;
+  double marginMeters = 500; // halo: other regions' stations this close
+  int maxSeamClusterStations = 64;
+  unsigned jobs = 0;         // worker processes at once; 0: hardware
+  std::string workDirectory; // created if missing
+  // Run as `workerCommand REGION_CONFIG`, searched in PATH without a '/'.
+  std::string workerCommand = "BRP-cluster";
+};
+
+struct Region {
+  std::vector<int> owned; // station indices, ascending
+  std::vector<int> halo;  // other regions' stations within the margin
+  double minLatitude = 0, maxLatitude = 0; // box around the owned stations
+  double minLongitude = 0, maxLongitude = 0;
+};
+
+// k-d split of the stations other than the depot (index 0): a set is cut
+// across its wider side, in metres, into parts proportional to the regions
+// each side gets. Every station is owned by exactly one region.
+std::vector<Region> partitionStations(const std::vector<Station> &stations,
+                                      int regions, double marginMeters);
+
+struct RegionReport {
+  int k = 0; // the config's k, scaled to the slice
+  size_t tuplesKept = 0, tuplesDropped = 0;
+  double deltaUDF = 0.0; // of the kept tuples
+  double seconds = 0.0;  // worker wall time
+};
+
+struct PartitionedResult {
+  // Stations (depot first) and clusters of the whole network, each with its
+  // selection: the regions' clusters without their seam stations, then the
+  // seam clusters. No time matrix and no stages.
+  PipelineResult plan;
+  std::vector<Region> regions;
+  std::vector<RegionReport> reports;
+  size_t seamStations = 0, seamClusters = 0;
+  double seamDeltaUDF = 0.0;
+  double seconds = 0.0;
+};
+
+// Writes the region files, runs the workers (options.jobs at a time) and
+// merges their plans; config.output, if set, receives the merged plan and
+// the workers share config.cache. Throws std::runtime_error, naming the
+// log, if a worker fails.
+PartitionedResult runPartitioned(const PipelineConfig &config,
+                                 const PartitionOptions &options);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "clustering/tuple_selector.hpp"
+#include "core/station.hpp"
+#include "core/transfer_tuple.hpp"
+#include <iosfwd>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+// Configuration of the clustering pipeline, read from JSON:
+//
+//   {"instance": "results.csv", "timeMatrix": "time_matrix.csv",
+//    "cache": "cache", "output": "plan.json", "threads": 0,
+//    "bcrf": {"tLoad": 60},
+//    "composite": {"alpha": 0.5, "beta": 0.5},
+//    "clustering": {"k": 24, "lambda": 0.5, "maxIterations": 1000,
+//                   "convergenceThreshold": 1e-6},
+//    "tuples": {"maxSurplus": 2, "maxDeficit": 2, "routeScoring": false,
+//               "vehicleCapacity": 20},
+//    "selection": {"strategy": "greedy", "score": "deltaUDF",
+//                  "timeLimitSeconds": 0.05, "maxCandidates": 0}}
+//
+// Every field is optional except "instance". Without "timeMatrix" travel
+// times are Euclidean; without "cache" nothing is cached; without "output"
+// the plan is not exported.
+struct PipelineConfig {
+  std::string instance;   // station file, CSV or binary
+  std::string timeMatrix; // time_matrix.csv format
+  std::string cache;      // artifact directory
+  std::string output;     // plan JSON
+  unsigned threads = 0;   // tuple generation; 0: hardware concurrency
+
+  double tLoad = 60;
+  double alpha = 0.5, beta = 0.5;
+  int k = 24;
+  double lambda = 0.5;
+  int maxIterations = 1000;
+  double convergenceThreshold = 1e-6;
+  int maxSurplus = 2, maxDeficit = 2;
+  bool routeScoring = false;
+  int vehicleCapacity = 20;
+  SelectionOptions selection;
+
+  // Relative input paths (instance, timeMatrix) are taken relative to
+  // baseDirectory, outputs (cache, output) to the working directory.
+  // Throws std::invalid_argument on unknown enum names or out-of-range
+  // values.
+  static PipelineConfig fromJson(const nlohmann::json &json,
+                                 const std::string &baseDirectory = "");
+  // Reads a config file; its input paths are relative to its directory.
+  static PipelineConfig load(const std::string &path);
+  // Every field, in the form fromJson reads; paths are written as they are.
+  nlohmann::json toJson() const;
+};
+
+// Command-line override of a config field: "clustering.k=48" sets
+// config["clustering"]["k"] to 48. The value is JSON, or a string if it
+// does not parse. Throws std::invalid_argument without "PATH=".
+void applyConfigOverride(nlohmann::json &config,
+                         const std::string &assignment);
+
+enum class StageStatus {
+  COMPUTED,  // cache miss or no cache
+  CACHED,    // loaded from the cache
+  NOT_NEEDED // a downstream stage was cached
+};
+
+struct StageReport {
+  std::string name;
+  std::string key; // content hash of the stage's inputs and parameters
+  StageStatus status = StageStatus::NOT_NEEDED;
+  double seconds = 0.0; // computing or loading, plus storing
+};
+
+struct PipelineResult {
+  std::vector<Station> stations; // depot first; BCRF unless loadInstance
+  std::vector<std::vector<double>> timeMatrix; // as loaded, depot first
+  std::vector<std::vector<int>> clusters;
+  std::vector<SelectionResult> selections; // one per cluster
+  double totalDeltaUDF = 0.0;
+  // load, bcrf, composite, clustering, tuples, selection, export
+  std::vector<StageReport> stages;
+};
+
+// Load, BCRF, composite distances, k-medoids, tuple generation, selection
+// and export. Each stage's output is cached under a hash of its inputs
+// (input file contents, parameters, the keys of the stages it reads), so a
+// change re-runs only the stages downstream of it: a new k starts from
+// clustering, a new selection strategy from selection. Stages whose output
+// no cached downstream stage needs are not run at all, except BCRF, which the
+// returned stations always carry.
+PipelineResult runPipeline(const PipelineConfig &config);
+// The load stage alone: stations and time matrix, cached like the rest.
+PipelineResult loadInstance(const PipelineConfig &config);
+
+// {"totalDeltaUDF", "clusters": [{"stations": [sysId], "deltaUDF",
+//  "tuples": [{"deltaUDF", "transfers": [{"from", "to", "bikes"}]}]}],
+//  "stages": [{"name", "key", "status", "seconds"}]}
+void writePlanJson(std::ostream &out, const PipelineResult &result);
+
+const char *toString(StageStatus status);
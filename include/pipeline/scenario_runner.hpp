@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/station.hpp"
+#include "pipeline/pipeline.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Inventory of every station in one scenario, depot first (its entry is
+// ignored). This is all a scenario owns; the rest of the network is shared.
+using InventoryOverlay = std::vector<int>;
+
+struct ScenarioOptions {
+  int scenarios = 100;
+  std::uint64_t seed = 1;
+  // Sampled inventories: the base inventory plus normal noise with this
+  // standard deviation, as a share of the station's capacity, rounded and
+  // clamped to 0..capacity.
+  double inventoryNoise = 0.15;
+  unsigned threads = 0; // 0: hardware concurrency
+};
+
+struct ScenarioOutcome {
+  double totalDeltaUDF = 0.0;
+  double adjustedRandIndex = 1.0; // its clustering against the reference
+  int clusters = 0;
+  int surplusStations = 0, deficitStations = 0;
+  double seconds = 0.0;
+};
+
+struct Distribution {
+  double mean = 0, stddev = 0, min = 0, p05 = 0, p50 = 0, p95 = 0, max = 0;
+  // Quantiles interpolate between ranks; all zero when empty.
+  static Distribution of(std::vector<double> values);
+};
+
+struct ScenarioSummary {
+  ScenarioOutcome reference; // the base inventories
+  std::vector<std::vector<int>> referenceClusters;
+  std::vector<ScenarioOutcome> scenarios; // by index
+  Distribution deltaUDF, adjustedRandIndex;
+  // Per station, depot first: mean Jaccard similarity of the station's
+  // cluster in a scenario and in the reference (1: always the same peers).
+  std::vector<double> stationStability;
+  double seconds = 0.0;
+};
+
+// Runs inventory scenarios of one network through BCRF, composite
+// distances, k-medoids and tuple evaluation, with the parameters of a
+// PipelineConfig, several scenarios at a time. Stations (coordinates,
+// capacities, UDF curves) and the time matrix are shared read-only by all
+// of them: each worker thread keeps one working copy of the stations and
+// lays each scenario's overlay over it, so memory does not grow with the
+// number of scenarios. Results do not depend on the thread count.
+class ScenarioRunner {
+public:
+  ScenarioRunner(
+      std::shared_ptr<const std::vector<Station>> stations,
+      std::shared_ptr<const std::vector<std::vector<double>>> timeMatrix,
+      PipelineConfig config);
+
+  // Scenario `index` of a seed, as run(options) samples it.
+  InventoryOverlay sample(std::uint64_t seed, std::uint64_t index,
+                          double noise) const;
+
+  ScenarioSummary run(const ScenarioOptions &options) const;
+  // Given overlays; throws std::invalid_argument if one has the wrong size
+  // or an inventory outside 0..capacity.
+  ScenarioSummary run(const std::vector<InventoryOverlay> &overlays,
+                      unsigned threads = 0) const;
+
+private:
+  class Worker;
+
+  ScenarioSummary
+  runAll(size_t count, unsigned threads,
+         const std::function<void(size_t, InventoryOverlay &)> &overlay) const;
+
+  std::shared_ptr<const std::vector<Station>> stations; // depot first
+  std::shared_ptr<const std::vector<std::vector<double>>> timeMatrix;
+  PipelineConfig config;
+};
+
+// Adjusted Rand index of two clusterings of stations 0..stations-1;
+// stations in no cluster count as one more group. 1 for equal partitions.
+double adjustedRandIndex(const std::vector<std::vector<int>> &a,
+                         const std::vector<std::vector<int>> &b,
+                         size_t stations);
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "clustering/tuple_selector.hpp"
+#include "core/param.hpp"
+#include "core/station.hpp"
+#include "pipeline/pipeline.hpp"
+#include "utils/LatencyHistogram.hpp"
+#include "utils/Timer.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A cluster's selection, computed at most once, by the first request that
+// needs it; concurrent requests wait for that one. Consecutive snapshots
+// share it for as long as none of the cluster's inventories changes.
+class ClusterPlan {
+public:
+  ClusterPlan() = default;
+  explicit ClusterPlan(SelectionResult selection);
+
+  const SelectionResult &get(const std::function<SelectionResult()> &compute);
+  bool ready() const { return done.load(std::memory_order_acquire); }
+
+private:
+  std::once_flag once;
+  SelectionResult selection;
+  std::atomic<bool> done{false};
+};
+
+// One immutable state of the network. A request works on the snapshot
+// current when it starts, whatever is published meanwhile.
+struct ServiceSnapshot {
+  std::uint64_t version = 1;
+  std::shared_ptr<const std::vector<Station>> stations; // depot first
+  std::shared_ptr<const std::vector<std::vector<int>>> clusters;
+  std::shared_ptr<const std::vector<int>> clusterOf; // per station, or -1
+  std::vector<std::shared_ptr<ClusterPlan>> plans;   // one per cluster
+};
+
+// Keeps an instance, its travel times and its clustering resident and
+// answers JSON requests against them. Reads never wait for writers: they
+// use the current snapshot, while updates (serialized among themselves)
+// build the next one, sharing the clusters and the plans they do not touch,
+// and publish it atomically. handle() may be called from any thread.
+class RebalancingService {
+public:
+  // Starts from a pipeline run (see runPipeline); its selections, when it
+  // has them, are the first snapshot's plans.
+  RebalancingService(PipelineResult warm, PipelineConfig config);
+
+  std::shared_ptr<const ServiceSnapshot> snapshot() const;
+
+  // Requests are {"op": ..., "id": ...} objects, "id" optional and echoed.
+  // Failed requests get {"error": message}, and change nothing.
+  //   update     {"inventories": {"<sysId>": bikes, ...}} -> {"version"};
+  //              each within 0..capacity
+  //   plan       {"clusters": [index, ...]} (default all) -> {"version",
+  //              "totalDeltaUDF", "computed", "clusters": [{"cluster",
+  //              "deltaUDF", "tuples": [{"deltaUDF", "transfers":
+  //              [{"from", "to", "bikes"}]}]}]}; "computed" counts the
+  //              clusters this request had to plan
+  //   recluster  {"k": k} (default the config's) -> {"version", "clusters"}
+  //   status     -> {"version", "stations", "clusters", "plansReady",
+  //              "uptimeSeconds"}
+  //   latency    -> {op: {"count", "meanMs", "p50Ms", "p90Ms", "p99Ms",
+  //              "maxMs", "buckets": [[upper bound ms, count], ...]}}
+  //   shutdown   -> {}, then the shutdown handler runs
+  // The time of every request goes into its op's latency histogram.
+  nlohmann::json handle(const nlohmann::json &request);
+  // handle() on a line of JSON text, answered with one line.
+  std::string handleLine(const std::string &line);
+
+  // Sets station inventories (index, bikes), recomputes BCRF and publishes
+  // the next snapshot; returns its version. Throws std::invalid_argument,
+  // applying nothing, if an index or inventory is out of range.
+  std::uint64_t update(const std::vector<std::pair<int, int>> &inventories);
+  // Recomputes BCRF, composite distances and k-medoids from the current
+  // inventories and publishes the result; returns its version.
+  std::uint64_t recluster(int k);
+  // The plan of the given clusters in the snapshot, computing missing ones.
+  nlohmann::json plan(const ServiceSnapshot &snapshot,
+                      const std::vector<int> &clusters);
+
+  // Runs on the requesting thread once a shutdown request is handled, just
+  // before handle() returns its response.
+  void setShutdownHandler(std::function<void()> handler);
+  // Null for ops that are not served.
+  const LatencyHistogram *latency(const std::string &op) const;
+
+private:
+  using Clusters = std::vector<std::vector<int>>;
+
+  nlohmann::json dispatch(const std::string &op,
+                          const nlohmann::json &request);
+  nlohmann::json latencyJson() const;
+  SelectionResult selectCluster(const ServiceSnapshot &snapshot,
+                                int cluster) const;
+  // stations counts the depot
+  Param makeParam(size_t stations, size_t clusters) const;
+  void publish(std::shared_ptr<const ServiceSnapshot> next);
+  static std::shared_ptr<const std::vector<int>>
+  clusterIndex(const Clusters &clusters, size_t stations);
+
+  const PipelineConfig config;
+  const std::shared_ptr<const std::vector<std::vector<double>>> timeMatrix;
+  std::unordered_map<std::string, int> stationIndex; // sysId
+  std::shared_ptr<const ServiceSnapshot> current;    // atomic_load/store
+  std::mutex writer;
+  std::map<std::string, LatencyHistogram> histograms; // fixed set of ops
+  std::function<void()> onShutdown;
+  Timer uptime;
+};
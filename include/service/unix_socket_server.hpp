@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Line-oriented server on a Unix domain socket: every line a client sends
+// is passed to the handler, and the handler's answer is written back as a
+// line. Each connection has its own thread, so a slow request holds up only
+// its own client; the handler must therefore be thread-safe.
+class UnixSocketServer {
+public:
+  using Handler = std::function<std::string(const std::string &)>;
+
+  static constexpr size_t kMaxLineBytes = 1 << 20; // longer lines: error, close
+
+  UnixSocketServer(std::string path, Handler handler);
+  ~UnixSocketServer();
+  UnixSocketServer(const UnixSocketServer &) = delete;
+  UnixSocketServer &operator=(const UnixSocketServer &) = delete;
+
+  // Binds the path (replacing a stale socket file) and starts accepting.
+  // Throws std::runtime_error if the socket cannot be set up.
+  void start();
+  // Stops accepting, closes every connection, waits for the requests in
+  // progress and removes the socket file.
+  void stop();
+
+private:
+  struct Connection {
+    int fd;
+    std::thread thread;
+    std::atomic<bool> finished{false};
+  };
+
+  void acceptLoop();
+  void serve(Connection &connection);
+  void reapFinished();
+
+  const std::string path;
+  const Handler handler;
+  int listenFd = -1;
+  std::atomic<bool> running{false};
+  std::thread acceptor;
+  std::mutex mutex; // connections
+  std::list<std::unique_ptr<Connection>> connections;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+// 128-bit FNV-1a over everything that determines an artifact: input file
+// bytes, stage parameters, the keys of upstream stages. Values are hashed
+// with their type's width and strings with their length, so that adjacent
+// fields cannot run into each other.
+class ContentHash {
+public:
+  ContentHash &add(const void *data, std::size_t size);
+  ContentHash &add(const std::string &value);
+  ContentHash &add(const char *value) { return add(std::string(value)); }
+  ContentHash &add(std::int64_t value);
+  ContentHash &add(int value) { return add(static_cast<std::int64_t>(value)); }
+  ContentHash &add(unsigned value) {
+    return add(static_cast<std::int64_t>(value));
+  }
+  ContentHash &add(double value);
+  ContentHash &add(bool value) { return add(static_cast<std::int64_t>(value)); }
+  // Contents of the stream up to its end; throws std::runtime_error if it
+  // cannot be read.
+  ContentHash &addStream(std::istream &in);
+  ContentHash &addFile(const std::string &path);
+
+  std::string hex() const; // 32 lowercase hex digits
+
+private:
+  unsigned __int128 state =
+      (static_cast<unsigned __int128>(0x6c62272e07bb0142ULL) << 64) |
+      0x62b821756295c58dULL;
+};
+
+// Stage outputs on disk, addressed by stage name and content key:
+// <directory>/<stage>-<key>.bin. Writes go to a temporary file renamed into
+// place, so a crashed run leaves no partial artifact behind. A cache with
+// an empty directory is disabled: every lookup misses and nothing is
+// written.
+class ArtifactCache {
+public:
+  explicit ArtifactCache(std::string directory = "");
+
+  bool enabled() const { return !directory.empty(); }
+  const std::string &getDirectory() const { return directory; }
+  std::string path(const std::string &stage, const std::string &key) const;
+
+  // Runs `read` on the artifact if it exists. An artifact `read` rejects
+  // with an exception counts as a miss and is removed.
+  bool load(const std::string &stage, const std::string &key,
+            const std::function<void(std::istream &)> &read) const;
+  // Throws std::runtime_error if the artifact cannot be written.
+  void store(const std::string &stage, const std::string &key,
+             const std::function<void(std::ostream &)> &write) const;
+
+private:
+  std::string directory;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+// Building blocks of the binary files (station files, pipeline artifacts):
+// LEB128 varints and little-endian IEEE doubles. Readers throw
+// std::runtime_error("<context>: truncated stream") at end of input.
+namespace BinaryIO {
+
+inline void writeVarint(std::ostream &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.put(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.put(static_cast<char>(value));
+}
+
+inline std::uint64_t readVarint(std::istream &in, const char *context) {
+  std::uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = in.get();
+    if (byte == std::char_traits<char>::eof())
+      throw std::runtime_error(std::string(context) + ": truncated stream");
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+  throw std::runtime_error(std::string(context) + ": malformed varint");
+}
+
+// A varint that must fit an int.
+inline int readInt(std::istream &in, const char *context) {
+  const std::uint64_t value = readVarint(in, context);
+  if (value > static_cast<std::uint64_t>(INT32_MAX))
+    throw std::runtime_error(std::string(context) + ": value out of range");
+  return static_cast<int>(value);
+}
+
+// Signed values, zigzag-encoded so that small negatives stay short.
+inline void writeSigned(std::ostream &out, std::int64_t value) {
+  writeVarint(out, (static_cast<std::uint64_t>(value) << 1) ^
+                       static_cast<std::uint64_t>(value >> 63));
+}
+
+inline std::int64_t readSigned(std::istream &in, const char *context) {
+  const std::uint64_t value = readVarint(in, context);
+  return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+inline void writeDouble(std::ostream &out, double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  char bytes[8];
+  for (int i = 0; i < 8; ++i)
+    bytes[i] = static_cast<char>(bits >> (8 * i));
+  out.write(bytes, sizeof(bytes));
+}
+
+inline double readDouble(std::istream &in, const char *context) {
+  unsigned char bytes[8];
+  if (!in.read(reinterpret_cast<char *>(bytes), sizeof(bytes)))
+    throw std::runtime_error(std::string(context) + ": truncated stream");
+  std::uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i)
+    bits |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline void writeString(std::ostream &out, const std::string &value) {
+  writeVarint(out, value.size());
+  out.write(value.data(), value.size());
+}
+
+// Rejects strings longer than maxLength before allocating them.
+inline std::string readString(std::istream &in, const char *context,
+                              std::size_t maxLength = 1024) {
+  const std::uint64_t length = readVarint(in, context);
+  if (length > maxLength)
+    throw std::runtime_error(std::string(context) + ": malformed string");
+  std::string value(length, '\0');
+  if (!in.read(value.data(), value.size()))
+    throw std::runtime_error(std::string(context) + ": truncated stream");
+  return value;
+}
+
+} // namespace BinaryIO
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Work done by the algorithmic hot paths.
+enum class Counter {
+  TUPLE_COMBINATIONS,     // (surplus, deficit) combinations evaluated
+  TUPLE_POSITIVE,         // of which with a positive ΔUDF
+  TUPLE_SUBSET_REJECTED,  // positive, but inside an accepted tuple
+  TUPLE_ACCEPTED,         // passed to the sink
+  KMEDOIDS_ITERATIONS,
+  KMEDOIDS_REASSIGNMENTS, // stations that changed cluster between iterations
+  KMEDOIDS_SWAPS,         // medoids replaced
+  SELECTION_CONFLICTS,    // tuples skipped for sharing a station
+  COUNT
+};
+
+constexpr std::size_t kCounters = static_cast<std::size_t>(Counter::COUNT);
+
+struct CounterSet {
+  std::array<std::uint64_t, kCounters> values{};
+
+  std::uint64_t operator[](Counter counter) const {
+    return values[static_cast<std::size_t>(counter)];
+  }
+  std::uint64_t &operator[](Counter counter) {
+    return values[static_cast<std::size_t>(counter)];
+  }
+  CounterSet &operator+=(const CounterSet &other);
+  CounterSet &operator-=(const CounterSet &other);
+};
+
+const char *metricName(Counter counter); // e.g. "brp_tuple_accepted_total"
+
+// Prometheus text exposition format, one counter per metric. `labels` is
+// inserted verbatim between braces, e.g. `run="nightly"`.
+void writePrometheus(std::ostream &out, const CounterSet &counters,
+                     const std::string &labels = "");
+// Writes to a temporary file renamed over `path`, so a scraper (e.g. the
+// node exporter textfile collector) never reads a partial file. Throws
+// std::runtime_error if the file cannot be written.
+void writePrometheus(const std::string &path, const CounterSet &counters,
+                     const std::string &labels = "");
+
+// Process-wide counters. Each thread increments its own block with plain
+// relaxed stores (no read-modify-write, no sharing); reads merge the blocks
+// of live threads with the totals of finished ones. Hot loops should count
+// locally and add once per call.
+class Counters {
+public:
+  static void add(Counter counter, std::uint64_t n = 1) {
+    std::atomic<std::uint64_t> &value =
+        local().values[static_cast<std::size_t>(counter)];
+    value.store(value.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+  }
+  static void add(const CounterSet &counters);
+
+  // This thread's counts so far; the difference of two calls is the work
+  // done in between, as the results of the instrumented calls report it.
+  static CounterSet thread();
+  // All threads, merged on read.
+  static CounterSet total();
+
+private:
+  struct Block {
+    Block();
+    ~Block();
+    std::array<std::atomic<std::uint64_t>, kCounters> values{};
+  };
+
+  static Block &local() {
+    thread_local Block block;
+    return block;
+  }
+  static CounterSet read(const Block &block);
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Durations in nanoseconds on a log scale, 8 buckets per octave, so that
+// any quantile is known to within 1/8 of an octave. record() is lock-free
+// and may be called from any thread; reads see a consistent-enough view
+// (each bucket individually exact) without stopping writers.
+class LatencyHistogram {
+public:
+  static constexpr int kBuckets = 8 * 62; // up to 2^63 ns
+
+  static int bucketOf(std::int64_t nanoseconds);
+  static std::int64_t bucketValue(int bucket); // largest value in the bucket
+
+  void record(std::int64_t nanoseconds);
+
+  std::uint64_t count() const { return total.load(std::memory_order_relaxed); }
+  std::int64_t sumNanoseconds() const {
+    return sum.load(std::memory_order_relaxed);
+  }
+  std::int64_t maxNanoseconds() const {
+    return largest.load(std::memory_order_relaxed);
+  }
+  // Smallest bucket bound with at least the fraction q of the values at or
+  // below it, capped at the maximum; 0 when empty.
+  std::int64_t quantile(double q) const;
+  // (bucket bound in ns, count) for every non-empty bucket, ascending.
+  std::vector<std::pair<std::int64_t, std::uint64_t>> buckets() const;
+
+private:
+  std::array<std::atomic<std::uint64_t>, kBuckets> counts{};
+  std::atomic<std::uint64_t> total{0};
+  std::atomic<std::int64_t> sum{0}, largest{0};
+};
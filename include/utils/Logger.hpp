@@ -1,35 +1,166 @@
 #pragma once
 
-#include <string>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Compile-time threshold: LOG_* statements below BRP_LOG_LEVEL expand to
+// nothing, arguments included. Set with -DBRP_LOG_LEVEL=<name> in CMake.
+#define BRP_LOG_LEVEL_TRACE 0
+#define BRP_LOG_LEVEL_DEBUG 1
+#define BRP_LOG_LEVEL_INFO 2
+#define BRP_LOG_LEVEL_WARN 3
+#define BRP_LOG_LEVEL_ERROR 4
+#define BRP_LOG_LEVEL_OFF 5
+#ifndef BRP_LOG_LEVEL
+#define BRP_LOG_LEVEL BRP_LOG_LEVEL_DEBUG
+#endif
 
+enum class LogLevel { TRACE, DEBUG, INFO, WARN, ERROR, OFF };
+
+const char *toString(LogLevel level);
+// Case-insensitive level name ("trace" ... "off"); throws
+// std::invalid_argument on anything else.
+LogLevel parseLogLevel(const std::string &name);
+
+// Asynchronous logger. log() formats nothing and takes no lock: it claims a
+// fixed-size slot of a bounded multi-producer ring, copies the message in
+// and returns; a background thread writes the slots out and flushes only
+// when the ring runs dry. When the ring is full the message is dropped and
+// counted rather than making the caller wait.
 class Logger {
 public:
-    static Logger& getInstance() {
-        static Logger instance;
-        return instance;
-    }
-    
-    void log(const std::string& message) {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (logFile.is_open()) {
-            logFile << message << std::endl;
-        }
-    }
-    
-    void setLogFile(const std::string& filename) {
-        logFile.open(filename);
-    }
-    
-    ~Logger() {
-        if (logFile.is_open()) {
-            logFile.close();
-        }
-    }
-    
+  static constexpr std::size_t kMessageSize = 240; // longer ones truncated
+  static constexpr std::size_t kCapacity = 4096;   // slots, a power of two
+
+  static Logger &getInstance();
+
+  // Runtime threshold, above the compile-time one. Starts from the
+  // BRP_LOG_LEVEL environment variable if set, INFO otherwise.
+  static void setLevel(LogLevel level) {
+    threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+  static LogLevel getLevel() {
+    return static_cast<LogLevel>(threshold.load(std::memory_order_relaxed));
+  }
+  static bool enabled(LogLevel level) {
+    return static_cast<int>(level) >=
+           threshold.load(std::memory_order_relaxed);
+  }
+
+  void log(LogLevel level, const char *text, std::size_t length);
+  void log(const std::string &message) {
+    log(LogLevel::INFO, message.data(), message.size());
+  }
+
+  // Redirects output to a file, or back to standard output if `filename`
+  // is empty; throws std::runtime_error if the file cannot be opened.
+  void setLogFile(const std::string &filename);
+  // Blocks until every message logged before the call has been written.
+  void flush();
+  std::size_t getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  ~Logger();
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    LogLevel level;
+    unsigned length;
+    char text[kMessageSize];
+  };
+
+  Logger();
+  void writerLoop();
+  bool ready() const; // the next slot is written; writer thread only
+  std::size_t drain(); // writes ready slots, returns how many; under mutex
+
+  static std::atomic<int> threshold;
+
+  std::unique_ptr<Slot[]> slots;
+  alignas(64) std::atomic<std::size_t> enqueuePos{0};
+  alignas(64) std::size_t dequeuePos = 0; // writer thread only
+  std::atomic<std::size_t> dropped{0};
+
+  std::mutex mutex; // output stream and the handshakes below
+  std::condition_variable wake, drained;
+  std::size_t written = 0; // slots written out and flushed
+  bool flushRequested = false, stopping = false;
+  std::ofstream file;
+  std::ostream *out;
+  std::thread writer;
+};
+
+// Formats one message into a per-thread fixed buffer, so LOG_* statements
+// do not allocate. Do not log from inside the arguments of another LOG_*.
+class LogLine : public std::ostream {
+public:
+  static LogLine &get();
+
+  const char *data() const { return buffer.text; }
+  std::size_t size() const { return buffer.size(); }
+
 private:
-    Logger() = default;
-    std::ofstream logFile;
-    std::mutex mutex;
-}; 
\ No newline at end of file
+  struct Buffer : std::streambuf {
+    char text[Logger::kMessageSize];
+    void reset() { setp(text, text + Logger::kMessageSize); }
+    std::size_t size() const { return pptr() - pbase(); }
+  };
+
+  LogLine() : std::ostream(&buffer) {}
+
+  Buffer buffer;
+};
+
+#define BRP_LOG(level, x)                                                      \
+  do {                                                                         \
+    if (Logger::enabled(level)) {                                              \
+      LogLine &brpLogLine = LogLine::get();                                    \
+      brpLogLine << x;                                                         \
+      Logger::getInstance().log(level, brpLogLine.data(),                      \
+                                brpLogLine.size());                            \
+    }                                                                          \
+  } while (0)
+// Compiled out: never evaluated, but still type-checked and counted as a
+// use of its variables.
+#define BRP_LOG_DISCARD(x)                                                     \
+  do {                                                                         \
+    if (false)                                                                 \
+      LogLine::get() << x;                                                     \
+  } while (0)
+
+#if BRP_LOG_LEVEL <= BRP_LOG_LEVEL_TRACE
+#define LOG_TRACE(x) BRP_LOG(LogLevel::TRACE, x)
+#else
+#define LOG_TRACE(x) BRP_LOG_DISCARD(x)
+#endif
+#if BRP_LOG_LEVEL <= BRP_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(x) BRP_LOG(LogLevel::DEBUG, x)
+#else
+#define LOG_DEBUG(x) BRP_LOG_DISCARD(x)
+#endif
+#if BRP_LOG_LEVEL <= BRP_LOG_LEVEL_INFO
+#define LOG_INFO(x) BRP_LOG(LogLevel::INFO, x)
+#else
+#define LOG_INFO(x) BRP_LOG_DISCARD(x)
+#endif
+#if BRP_LOG_LEVEL <= BRP_LOG_LEVEL_WARN
+#define LOG_WARN(x) BRP_LOG(LogLevel::WARN, x)
+#else
+#define LOG_WARN(x) BRP_LOG_DISCARD(x)
+#endif
+#if BRP_LOG_LEVEL <= BRP_LOG_LEVEL_ERROR
+#define LOG_ERROR(x) BRP_LOG(LogLevel::ERROR, x)
+#else
+#define LOG_ERROR(x) BRP_LOG_DISCARD(x)
+#endif
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "utils/Timer.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// PROFILE_SCOPE compiles to nothing unless BRP_PROFILING is non-zero (the
+// BRP_PROFILING CMake option, on by default).
+#ifndef BRP_PROFILING
+#define BRP_PROFILING 1
+#endif
+
+// Aggregated timings of one scope, identified by its path from the thread's
+// outermost scope ("load;time matrix").
+struct ScopeStats {
+  std::string path;
+  int depth = 0;
+  std::uint64_t count = 0;
+  double totalSeconds = 0.0, selfSeconds = 0.0; // self: minus child scopes
+  double minSeconds = 0.0, maxSeconds = 0.0;
+  double p99Seconds = 0.0; // from a log histogram, within 1/8 of an octave
+};
+
+// Hierarchical phase profiler. Each thread records into its own tree of
+// scopes, keyed by the path of enclosing scopes, with call count, total,
+// min, max and a latency histogram per node; reports merge the trees by
+// path. Disabled, a scope costs one relaxed atomic load.
+//
+// Enabled by setEnabled() or the BRP_PROFILE environment variable; with
+// BRP_PROFILE=<prefix> the report is also written to <prefix>.json and
+// <prefix>.folded when the program exits.
+class Profiler {
+public:
+  struct Node;
+
+  static Profiler &getInstance();
+
+  static bool enabled() { return on.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enabled) {
+    on.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Scopes in depth-first order, children by first entry.
+  std::vector<ScopeStats> snapshot() const;
+  // {"scopes": [{"name", "count", "totalSeconds", ..., "children": []}]}
+  void writeJson(std::ostream &out) const;
+  // One "outer;inner <self microseconds>" line per scope, the input format
+  // of flamegraph.pl and speedscope.
+  void writeFolded(std::ostream &out) const;
+  // Writes <prefix>.json and <prefix>.folded; throws std::runtime_error if
+  // either cannot be opened.
+  void writeReport(const std::string &prefix) const;
+  // Zeroes all statistics; scopes open on other threads keep running.
+  void reset();
+
+  // Used by ScopedTimer.
+  Node *enter(const char *name);
+  void leave(Node *node, std::int64_t nanoseconds);
+
+  ~Profiler();
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  static constexpr int kBuckets = 8 * 62; // as in LatencyHistogram
+
+  struct Node {
+    std::string name;
+    Node *parent = nullptr;
+    std::vector<std::unique_ptr<Node>> children;
+    std::uint64_t count = 0;
+    std::int64_t totalNs = 0, minNs = 0, maxNs = 0;
+    std::array<std::uint64_t, kBuckets> histogram{};
+  };
+
+private:
+  struct ThreadTree;
+  friend struct ProfilerAttachment;
+
+  Profiler();
+  ThreadTree &threadTree();
+  void release(ThreadTree *tree);
+  std::unique_ptr<Node> merged() const;
+
+  static std::atomic<bool> on;
+
+  mutable std::mutex mutex; // the tree list
+  std::vector<std::unique_ptr<ThreadTree>> trees;
+  std::string reportPrefix;
+};
+
+// Times the enclosing block as a child of the innermost open scope on this
+// thread. `name` is copied on the first entry only.
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const char *name) {
+    if (Profiler::enabled()) {
+      node = Profiler::getInstance().enter(name);
+      timer.emplace();
+    }
+  }
+  ~ScopedTimer() {
+    if (node)
+      Profiler::getInstance().leave(node, timer->elapsedNanoseconds());
+  }
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  Profiler::Node *node = nullptr;
+  std::optional<Timer> timer;
+};
+
+#define BRP_PROFILE_CONCAT_(a, b) a##b
+#define BRP_PROFILE_CONCAT(a, b) BRP_PROFILE_CONCAT_(a, b)
+#if BRP_PROFILING
+#define PROFILE_SCOPE(name)                                                    \
+  ScopedTimer BRP_PROFILE_CONCAT(brpProfileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
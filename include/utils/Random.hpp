@@ -1,25 +1,114 @@
 #pragma once
 
-#include <random>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
 
-class Random {
+// xoshiro256** (Blackman & Vigna): 256 bits of state, period 2^256 - 1, a
+// few cycles per draw. Seeded through splitmix64, so any 64-bit seed gives
+// a well-mixed state. A UniformRandomBitGenerator, so it also works with
+// std::shuffle and the <random> distributions; the members below are
+// faster, free of division bias and the same on every platform.
+class Xoshiro256 {
 public:
-    static Random& getInstance() {
-        static Random instance;
-        return instance;
-    }
-    
-    int getInt(int min, int max) {
-        std::uniform_int_distribution<int> dist(min, max);
-        return dist(generator);
-    }
-    
-    double getDouble(double min, double max) {
-        std::uniform_real_distribution<double> dist(min, max);
-        return dist(generator);
+  using result_type = std::uint64_t;
+
+  explicit Xoshiro256(std::uint64_t seed = 1);
+  // Stream `index` of a seed: the seeded generator after `index` jumps, so
+  // streams never overlap within 2^128 draws. Costs `index` jumps; use
+  // split() to hand out many streams in turn.
+  static Xoshiro256 stream(std::uint64_t seed, std::uint64_t index);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const std::uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // Advances by 2^128 (jump) or 2^192 (longJump) draws.
+  void jump();
+  void longJump();
+  // Returns the current stream and moves this generator to the next one:
+  // successive splits give non-overlapping streams for threads or tasks.
+  Xoshiro256 split() {
+    Xoshiro256 child = *this;
+    jump();
+    return child;
+  }
+
+  // Uniform in [0, bound), bound > 0 (Lemire's multiply-and-reject).
+  std::uint64_t below(std::uint64_t bound) {
+    __uint128_t m = static_cast<__uint128_t>((*this)()) * bound;
+    std::uint64_t low = static_cast<std::uint64_t>(m);
+    if (low < bound) {
+      const std::uint64_t threshold = -bound % bound;
+      while (low < threshold) {
+        m = static_cast<__uint128_t>((*this)()) * bound;
+        low = static_cast<std::uint64_t>(m);
+      }
     }
-    
+    return static_cast<std::uint64_t>(m >> 64);
+  }
+  // Uniform in [lo, hi], lo <= hi.
+  int between(int lo, int hi) {
+    return lo + static_cast<int>(below(static_cast<std::uint64_t>(hi) -
+                                       static_cast<std::uint64_t>(lo) + 1));
+  }
+  // Uniform in [0, 1) with 53 random bits.
+  double uniform() { return ((*this)() >> 11) * 0x1.0p-53; }
+  double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+  // Standard normal by Box-Muller from two uniform draws; unlike
+  // std::normal_distribution, the same on every standard library.
+  double normal();
+
+  // Batched: n values in [0, bound), two per 64-bit draw.
+  void fillBelow(std::uint32_t *out, std::size_t n, std::uint32_t bound);
+  void fillUniform(double *out, std::size_t n);
+
+  template <class RandomIt> void shuffle(RandomIt first, RandomIt last) {
+    for (auto i = last - first; i > 1; --i)
+      std::swap(first[i - 1], first[below(static_cast<std::uint64_t>(i))]);
+  }
+
+private:
+  static std::uint64_t rotl(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+  void apply(const std::uint64_t (&polynomial)[4]);
+
+  std::uint64_t s[4];
+};
+
+// Engine handed to the GA operators; each run or thread owns its own.
+using RandomEngine = Xoshiro256;
+
+// Seedable convenience wrapper; not shared between threads: give each
+// thread or task its own through split().
+class Random {
+public:
+  explicit Random(std::uint64_t seed) : engine(seed) {}
+
+  int getInt(int min, int max) { return engine.between(min, max); }
+  double getDouble(double min, double max) {
+    return engine.uniform(min, max);
+  }
+  Random split() { return Random(engine.split()); }
+  RandomEngine &getEngine() { return engine; }
+
 private:
-    Random() : generator(std::random_device{}()) {}
-    std::mt19937 generator;
-}; 
\ No newline at end of file
+  explicit Random(const RandomEngine &engine) : engine(engine) {}
+
+  RandomEngine engine;
+};
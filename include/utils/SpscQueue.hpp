@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer single-consumer ring. Slots are constructed once
+// from a prototype and values are copy-assigned in and out, so element types
+// such as std::vector reuse their buffers after the first lap.
+template <typename T> class SpscQueue {
+public:
+  explicit SpscQueue(std::size_t capacity, const T &prototype = T())
+      : slots(capacity + 1, prototype) {}
+
+  // Producer side; false if the queue is full.
+  bool tryPush(const T &value) {
+    std::size_t tail = this->tail.load(std::memory_order_relaxed);
+    std::size_t next = tail + 1 == slots.size() ? 0 : tail + 1;
+    if (next == head.load(std::memory_order_acquire))
+      return false;
+    slots[tail] = value;
+    this->tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side; false if the queue is empty.
+  bool tryPop(T &value) {
+    std::size_t head = this->head.load(std::memory_order_relaxed);
+    if (head == tail.load(std::memory_order_acquire))
+      return false;
+    value = slots[head];
+    this->head.store(head + 1 == slots.size() ? 0 : head + 1,
+                     std::memory_order_release);
+    return true;
+  }
+
+  std::size_t capacity() const { return slots.size() - 1; }
+
+private:
+  std::vector<T> slots;
+  alignas(64) std::atomic<std::size_t> head{0};
+  alignas(64) std::atomic<std::size_t> tail{0};
+};
@@ -1,16 +1,25 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 
 class Timer {
 public:
-    Timer() : startTime(std::chrono::high_resolution_clock::now()) {}
-    
+    Timer() : startTime(std::chrono::steady_clock::now()) {}
+
     double elapsed() const {
-        auto endTime = std::chrono::high_resolution_clock::now();
+        auto endTime = std::chrono::steady_clock::now();
         return std::chrono::duration<double>(endTime - startTime).count();
     }
-    
+
+    std::int64_t elapsedNanoseconds() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - startTime)
+            .count();
+    }
+
+    void reset() { startTime = std::chrono::steady_clock::now(); }
+
 private:
-    std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
-}; 
\ No newline at end of file
+    std::chrono::steady_clock::time_point startTime;
+};
@@ -1,38 +1,41 @@
 #ifndef DEBUG_UTILS_H
 #define DEBUG_UTILS_H
 
-#define DEBUG_MODE 1
+// Legacy debug macros, now DEBUG-level messages of the asynchronous logger:
+// compiled out when BRP_LOG_LEVEL is above DEBUG, shown when the runtime
+// level is DEBUG or lower. New code should use the LOG_* macros directly.
+#include "utils/Logger.hpp"
 
-#if DEBUG_MODE
-#include <iostream>
-#include <vector>
-#define DEBUG_PRINT(x) std::cout << "[DEBUG] " << x << std::endl
-#define DEBUG_HERE()                                                           \
-  std::cout << "[DEBUG] Reached " << __FILE__ << ":" << __LINE__ << std::endl
-#define DEBUG_PRINT_VAR(x)                                                     \
-  std::cout << "[DEBUG] " << #x << " = " << x << std::endl
+#define DEBUG_PRINT(x) LOG_DEBUG(x)
+#define DEBUG_HERE() LOG_DEBUG("Reached " << __FILE__ << ":" << __LINE__)
+#define DEBUG_PRINT_VAR(x) LOG_DEBUG(#x << " = " << x)
 #define DEBUG_PRINT_TUPLE(x)                                                   \
-  do {                                                                         \
-    std::cout << "[DEBUG] surplus stations [";                                 \
-    for (size_t i = 0; i < x.surplusStationIndices.size(); ++i) {              \
-      std::cout << x.surplusStationIndices[i];                                 \
-      if (i < x.surplusStationIndices.size() - 1)                              \
-        std::cout << ", ";                                                     \
-    }                                                                          \
-    std::cout << "], deficit stations [";                                      \
-    for (size_t i = 0; i < x.deficitStationIndices.size(); ++i) {              \
-      std::cout << x.deficitStationIndices[i];                                 \
-      if (i < x.deficitStationIndices.size() - 1)                              \
-        std::cout << ", ";                                                     \
-    }                                                                          \
-    std::cout << "]" << std::endl;                                             \
-  } while (0)
+  LOG_DEBUG("surplus stations ["                                               \
+            << debug_utils::join(x.surplusStationIndices)                      \
+            << "], deficit stations ["                                         \
+            << debug_utils::join(x.deficitStationIndices) << "]")
 
-#else
-#define DEBUG_PRINT(x)
-#define DEBUG_HERE()
-#define DEBUG_PRINT_VAR(x)
-#define DEBUG_PRINT_TUPLE(x)
-#endif
+namespace debug_utils {
 
-#endif // DEBUG_UTILS_H
\ No newline at end of file
+// Streams a sequence as "a, b, c".
+template <typename Container> struct Joined {
+  const Container &items;
+  friend std::ostream &operator<<(std::ostream &out, const Joined &joined) {
+    bool first = true;
+    for (const auto &item : joined.items) {
+      if (!first)
+        out << ", ";
+      out << item;
+      first = false;
+    }
+    return out;
+  }
+};
+
+template <typename Container> Joined<Container> join(const Container &items) {
+  return {items};
+}
+
+} // namespace debug_utils
+
+#endif // DEBUG_UTILS_H
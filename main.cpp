@@ -1,8 +1,81 @@
-#include "coreProblemInstance.hpp"
+#include "pipeline/pipeline.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+
+// Runs the clustering pipeline described by a config file (see
+// pipeline/pipeline.hpp), e.g.
+//   BRP-cluster ../data/pipeline.json --set clustering.k=48
+namespace {
+
+const char *const kUsage =
+    "usage: BRP-cluster CONFIG [options]\n"
+    "  --set PATH=VALUE   override a config field, e.g. clustering.k=48;\n"
+    "                     VALUE is JSON, or a string if it does not parse\n"
+    "  --no-cache         compute every stage, read and write no artifacts\n";
+
+} // namespace
 
 int main(int argc, char *argv[]) {
-  ProblemInstance instance("../data/results.csv");
+  std::string configPath;
+  nlohmann::json config;
+  bool noCache = false;
+  try {
+    std::vector<std::string> overrides;
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--set" && i + 1 < argc)
+        overrides.push_back(argv[++i]);
+      else if (arg == "--no-cache")
+        noCache = true;
+      else if (arg == "--help" || arg == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else if (arg[0] != '-' && configPath.empty())
+        configPath = arg;
+      else
+        throw std::invalid_argument("unexpected argument " + arg);
+    }
+    if (configPath.empty())
+      throw std::invalid_argument("no config file");
+    std::ifstream in(configPath);
+    if (!in)
+      throw std::invalid_argument("cannot open " + configPath);
+    config = nlohmann::json::parse(in);
+    for (const std::string &assignment : overrides)
+      applyConfigOverride(config, assignment);
+    if (noCache)
+      config.erase("cache");
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-cluster: " << e.what() << "\n" << kUsage;
+    return 2;
+  }
+
+  try {
+    const PipelineConfig pipeline = PipelineConfig::fromJson(
+        config, std::filesystem::path(configPath).parent_path().string());
+    const PipelineResult result = runPipeline(pipeline);
 
+    std::printf("\n%-12s %-11s %10s  %s\n", "stage", "status", "seconds",
+                "key");
+    double total = 0.0;
+    for (const StageReport &stage : result.stages) {
+      std::printf("%-12s %-11s %10.3f  %s\n", stage.name.c_str(),
+                  toString(stage.status), stage.seconds,
+                  stage.key.substr(0, 12).c_str());
+      total += stage.seconds;
+    }
+    std::printf("%-12s %-11s %10.3f\n", "total", "", total);
+    std::printf("\n%zu clusters, delta UDF %.4f\n", result.clusters.size(),
+                result.totalDeltaUDF);
+    if (!pipeline.output.empty())
+      std::printf("plan written to %s\n", pipeline.output.c_str());
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-cluster: " << e.what() << "\n";
+    return 1;
+  }
   return 0;
-}
\ No newline at end of file
+}
@@ -1,27 +1,29 @@
 #include "clustering/kmedoids.hpp"
-#include "utils/debug_utils.h"
+#include "utils/Counters.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
 #include <algorithm>
 #include <cmath>
 #include <limits>
 
 KMedoid::KMedoid(const std::vector<Station> &stations, int k)
     : stations(stations), k(k) {
-  DEBUG_PRINT("KMedoid constructor called with " << stations.size()
-                                                 << " stations and k=" << k);
+  LOG_DEBUG("KMedoid constructor called with " << stations.size()
+                                               << " stations and k=" << k);
 }
 
 void KMedoid::setCompositeDistanceMatrix(
     const std::vector<std::vector<double>> &matrix) {
-  DEBUG_PRINT("Setting composite distance matrix of size "
-              << matrix.size() << "x"
-              << (matrix.empty() ? 0 : matrix[0].size()));
+  LOG_DEBUG("Setting composite distance matrix of size "
+            << matrix.size() << "x"
+            << (matrix.empty() ? 0 : matrix[0].size()));
   compositeDistance = matrix;
 }
 
 void KMedoid::setK(int k) { this->k = k; }
 
 std::vector<int> KMedoid::initMedoidsBCRF() {
-  DEBUG_HERE();
+  LOG_TRACE("Entering " << __func__);
   std::vector<Station> sortedStations = stations;
   std::sort(sortedStations.begin(), sortedStations.end(),
             [](const Station &a, const Station &b) {
@@ -41,7 +43,7 @@ std::vector<int> KMedoid::initMedoidsBCRF() {
 }
 
 std::vector<int> KMedoid::initMedoidsBalanced() {
-  DEBUG_HERE();
+  LOG_TRACE("Entering " << __func__);
   std::vector<Station> sortedStations = stations;
   std::sort(sortedStations.begin(), sortedStations.end(),
             [](const Station &a, const Station &b) {
@@ -61,9 +63,10 @@ std::vector<int> KMedoid::initMedoidsBalanced() {
 }
 
 std::vector<int> KMedoid::initMedoidsDispersion() {
-  DEBUG_HERE();
+  PROFILE_SCOPE("init medoids");
+  LOG_TRACE("Entering " << __func__);
   std::vector<Station> sortedStations = stations;
-  DEBUG_PRINT("Sorting " << sortedStations.size() << " stations by BCRF");
+  LOG_DEBUG("Sorting " << sortedStations.size() << " stations by BCRF");
 
   std::sort(sortedStations.begin(), sortedStations.end(),
             [](const Station &a, const Station &b) {
@@ -74,7 +77,7 @@ std::vector<int> KMedoid::initMedoidsDispersion() {
 
   // Verify matrix dimensions
   if (compositeDistance.empty() || compositeDistance[0].empty()) {
-    DEBUG_PRINT("ERROR: Empty composite distance matrix");
+    LOG_ERROR("Empty composite distance matrix");
     return medoids;
   }
 
@@ -82,14 +85,14 @@ std::vector<int> KMedoid::initMedoidsDispersion() {
   for (size_t i = 0; i < stations.size(); ++i) {
     if (stations[i].getCoordinate() == sortedStations[0].getCoordinate()) {
       medoids.push_back(i);
-      DEBUG_PRINT("First medoid added at index " << i);
+      LOG_TRACE("First medoid added at index " << i);
       break;
     }
   }
 
   // Find remaining medoids
   for (int i = 1; i < k; i++) {
-    DEBUG_PRINT("Finding medoid " << i + 1 << " of " << k);
+    LOG_TRACE("Finding medoid " << i + 1 << " of " << k);
     double maxMinDistance = -1;
     int maxMinDistanceIndex = -1;
 
@@ -105,8 +108,8 @@ std::vector<int> KMedoid::initMedoidsDispersion() {
       for (size_t medoidIdx : medoids) {
         if (j >= compositeDistance.size() ||
             medoidIdx >= compositeDistance[j].size()) {
-          DEBUG_PRINT("ERROR: Invalid matrix access at j="
-                      << j << ", medoidIdx=" << medoidIdx);
+          LOG_ERROR("Invalid matrix access at j="
+                    << j << ", medoidIdx=" << medoidIdx);
           validDistance = false;
           break;
         }
@@ -124,17 +127,17 @@ std::vector<int> KMedoid::initMedoidsDispersion() {
     }
 
     if (maxMinDistanceIndex == -1) {
-      DEBUG_PRINT("WARNING: Could not find valid medoid for cluster " << i);
+      LOG_WARN("Could not find valid medoid for cluster " << i);
       continue;
     }
 
     medoids.push_back(maxMinDistanceIndex);
-    DEBUG_PRINT("Added medoid at index " << maxMinDistanceIndex);
+    LOG_TRACE("Added medoid at index " << maxMinDistanceIndex);
   }
 
   if (medoids.size() != k) {
-    DEBUG_PRINT("WARNING: Could only initialize "
-                << medoids.size() << " medoids out of " << k << " requested");
+    LOG_WARN("Could only initialize "
+             << medoids.size() << " medoids out of " << k << " requested");
   }
 
   return medoids;
@@ -142,16 +145,17 @@ std::vector<int> KMedoid::initMedoidsDispersion() {
 
 std::vector<std::vector<int>>
 KMedoid::assignToClusters(const std::vector<int> &medoids) {
-  DEBUG_HERE();
-  DEBUG_PRINT("Assigning " << stations.size() << " stations to "
-                           << medoids.size() << " clusters");
+  PROFILE_SCOPE("assign");
+  LOG_TRACE("Entering " << __func__);
+  LOG_DEBUG("Assigning " << stations.size() << " stations to "
+                         << medoids.size() << " clusters");
 
   // Initialize clusters with empty vectors
   std::vector<std::vector<int>> clusters(medoids.size());
 
   // Verify matrix dimensions
   if (compositeDistance.empty() || compositeDistance[0].empty()) {
-    DEBUG_PRINT("ERROR: Empty composite distance matrix");
+    LOG_ERROR("Empty composite distance matrix");
     return clusters;
   }
 
@@ -162,8 +166,8 @@ KMedoid::assignToClusters(const std::vector<int> &medoids) {
     for (size_t j = 0; j < medoids.size(); ++j) {
       if (i >= compositeDistance.size() ||
           medoids[j] >= compositeDistance[i].size()) {
-        DEBUG_PRINT("ERROR: Invalid matrix access at i=" << i << ", medoid="
-                                                         << medoids[j]);
+        LOG_ERROR("Invalid matrix access at i=" << i << ", medoid="
+                                                << medoids[j]);
         continue;
       }
       double distance = compositeDistance[i][medoids[j]];
@@ -176,7 +180,7 @@ KMedoid::assignToClusters(const std::vector<int> &medoids) {
     if (closestMedoidIdx != -1) {
       clusters[closestMedoidIdx].push_back(i);
     } else {
-      DEBUG_PRINT("WARNING: No valid medoid found for station " << i);
+      LOG_WARN("No valid medoid found for station " << i);
     }
   }
   return clusters;
@@ -184,19 +188,20 @@ KMedoid::assignToClusters(const std::vector<int> &medoids) {
 
 std::vector<int>
 KMedoid::updateMedoids(const std::vector<std::vector<int>> &clusters) {
-  DEBUG_HERE();
-  DEBUG_PRINT("Updating medoids for " << clusters.size());
+  PROFILE_SCOPE("update");
+  LOG_TRACE("Entering " << __func__);
+  LOG_DEBUG("Updating medoids for " << clusters.size());
 
   std::vector<int> newMedoids(clusters.size(), -1);
   for (size_t j = 0; j < clusters.size(); ++j) {
-    DEBUG_PRINT("Processing cluster " << j << " with " << clusters[j].size()
-                                      << " stations");
+    LOG_TRACE("Processing cluster " << j << " with " << clusters[j].size()
+                                    << " stations");
     double minCentrality = std::numeric_limits<double>::max();
     int bestStation = -1;
 
     for (int stationIdx : clusters[j]) {
       if (stationIdx >= stations.size()) {
-        DEBUG_PRINT("ERROR: Invalid station index " << stationIdx);
+        LOG_ERROR("Invalid station index " << stationIdx);
         continue;
       }
 
@@ -205,9 +210,9 @@ KMedoid::updateMedoids(const std::vector<std::vector<int>> &clusters) {
         if (stationIdx != otherStationIdx) {
           if (stationIdx >= compositeDistance.size() ||
               otherStationIdx >= compositeDistance[stationIdx].size()) {
-            DEBUG_PRINT("ERROR: Invalid matrix access at stationIdx="
-                        << stationIdx
-                        << ", otherStationIdx=" << otherStationIdx);
+            LOG_ERROR("Invalid matrix access at stationIdx="
+                      << stationIdx
+                      << ", otherStationIdx=" << otherStationIdx);
             continue;
           }
           sumDistances += compositeDistance[stationIdx][otherStationIdx];
@@ -221,7 +226,7 @@ KMedoid::updateMedoids(const std::vector<std::vector<int>> &clusters) {
     }
 
     if (bestStation == -1) {
-      DEBUG_PRINT("ERROR: No valid medoid found for cluster " << j);
+      LOG_WARN("No valid medoid found for cluster " << j);
       continue;
     }
     newMedoids[j] = bestStation;
@@ -231,46 +236,65 @@ KMedoid::updateMedoids(const std::vector<std::vector<int>> &clusters) {
 
 std::vector<std::vector<int>>
 KMedoid::run(double lambda, double convergenceThreshold, int maxIterations) {
-  DEBUG_HERE();
-  DEBUG_PRINT("Starting KMedoid clustering with lambda="
-              << lambda << ", threshold=" << convergenceThreshold
-              << ", maxIter=" << maxIterations);
+  PROFILE_SCOPE("kmedoids");
+  LOG_TRACE("Entering " << __func__);
+  LOG_DEBUG("Starting KMedoid clustering with lambda="
+            << lambda << ", threshold=" << convergenceThreshold
+            << ", maxIter=" << maxIterations);
 
   std::vector<int> currentMedoids = initMedoidsDispersion();
-  DEBUG_PRINT("Initial medoids initialized: " << currentMedoids.size());
+  LOG_DEBUG("Initial medoids initialized: " << currentMedoids.size());
 
   std::vector<std::vector<int>> clusters;
   int iteration = 0;
   bool converged = false;
+  counters = CounterSet();
+  std::vector<int> clusterOf(stations.size(), -1);
 
   while (!converged && iteration < maxIterations) {
-    DEBUG_PRINT("Iteration " << iteration + 1 << " of " << maxIterations);
+    PROFILE_SCOPE("iteration");
+    LOG_TRACE("Iteration " << iteration + 1 << " of " << maxIterations);
 
     clusters = assignToClusters(currentMedoids);
-    DEBUG_PRINT("Clusters assigned");
+    LOG_TRACE("Clusters assigned");
+    for (size_t c = 0; c < clusters.size(); ++c)
+      for (int station : clusters[c]) {
+        if (iteration > 0 && clusterOf[station] != (int)c)
+          counters[Counter::KMEDOIDS_REASSIGNMENTS]++;
+        clusterOf[station] = c;
+      }
 
     std::vector<int> newMedoids = updateMedoids(clusters);
-    DEBUG_PRINT("Medoids updated");
+    LOG_TRACE("Medoids updated");
+    // a cluster left empty keeps its medoid rather than dropping out
+    for (size_t i = 0; i < newMedoids.size() && i < currentMedoids.size(); ++i)
+      if (newMedoids[i] == -1)
+        newMedoids[i] = currentMedoids[i];
 
     double maxChange = 0.0;
     for (size_t i = 0; i < currentMedoids.size(); ++i) {
       if (i >= newMedoids.size() ||
           currentMedoids[i] >= compositeDistance.size() ||
           newMedoids[i] >= compositeDistance[currentMedoids[i]].size()) {
-        DEBUG_PRINT("ERROR: Invalid matrix access in convergence check");
+        LOG_ERROR("Invalid matrix access in convergence check");
         continue;
       }
       maxChange = std::max(maxChange,
                            compositeDistance[currentMedoids[i]][newMedoids[i]]);
     }
 
-    DEBUG_PRINT("Max change: "
-                << maxChange << ", Converged: "
-                << (maxChange < convergenceThreshold ? "yes" : "no"));
+    LOG_TRACE("Max change: "
+              << maxChange << ", Converged: "
+              << (maxChange < convergenceThreshold ? "yes" : "no"));
     converged = maxChange < convergenceThreshold;
+    for (size_t i = 0; i < currentMedoids.size() && i < newMedoids.size(); ++i)
+      if (newMedoids[i] != currentMedoids[i])
+        counters[Counter::KMEDOIDS_SWAPS]++;
     currentMedoids = newMedoids;
     iteration++;
   }
+  counters[Counter::KMEDOIDS_ITERATIONS] = iteration;
+  Counters::add(counters);
 
   return clusters;
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "clustering/route_cost.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr int kFieldBits = 21; // station index / bike count per key field
+constexpr std::uint64_t kFieldMask = (std::uint64_t{1} << kFieldBits) - 1;
+
+// Packs the allocations into key; false if they do not fit.
+bool makeKey(const TransferTuple &tuple, AllocationKey &key) {
+  if ((int)tuple.bikeAllocations.size() > AllocationKey::kMaxAllocations)
+    return false;
+  key.count = 0;
+  for (const auto &entry : tuple.bikeAllocations) {
+    std::uint64_t s = entry.first.first, d = entry.first.second,
+                  q = entry.second;
+    if (s > kFieldMask || d > kFieldMask || q > kFieldMask)
+      return false;
+    key.words[key.count++] = s << (2 * kFieldBits) | d << kFieldBits | q;
+  }
+  return true;
+}
+
+} // namespace
+
+bool AllocationKey::operator==(const AllocationKey &other) const {
+  return count == other.count &&
+         std::equal(words.begin(), words.begin() + count, other.words.begin());
+}
+
+std::size_t AllocationKeyHash::operator()(const AllocationKey &key) const {
+  std::uint64_t h = static_cast<std::uint64_t>(key.count);
+  for (int i = 0; i < key.count; ++i) {
+    // splitmix64 finalizer, chained over the words
+    h = (h ^ key.words[i]) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+  }
+  return static_cast<std::size_t>(h);
+}
+
+TupleRouteCost::TupleRouteCost(
+    const std::vector<std::vector<double>> &timeMatrix, const Param &param,
+    std::size_t maxEntries)
+    : timeMatrix(timeMatrix), param(param), maxEntries(maxEntries) {}
+
+const TupleRoute &TupleRouteCost::solve(const TransferTuple &tuple) {
+  AllocationKey key;
+  if (maxEntries == 0 || !makeKey(tuple, key)) {
+    stats.misses++;
+    uncached = heldKarp(tuple);
+    return uncached;
+  }
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    stats.hits++;
+    return it->second;
+  }
+  stats.misses++;
+  TupleRoute route = heldKarp(tuple);
+
+  if (entries.size() >= maxEntries) {
+    // evict the oldest key and reuse its slot in the ring
+    entries.erase(insertionOrder[nextVictim]);
+    insertionOrder[nextVictim] = key;
+    nextVictim = (nextVictim + 1) % maxEntries;
+    stats.evictions++;
+  } else {
+    insertionOrder.push_back(key);
+  }
+  return entries.emplace(key, std::move(route)).first->second;
+}
+
+bool TupleRouteCost::apply(TransferTuple &tuple) {
+  const TupleRoute &route = solve(tuple);
+  if (!route.feasible)
+    return false;
+  tuple.serviceTime = route.serviceTime;
+  tuple.visitOrder = route.order;
+  return true;
+}
+
+TupleRoute TupleRouteCost::heldKarp(const TransferTuple &tuple) {
+  // stops: surplus stations first, then deficit stations
+  std::vector<int> stops = tuple.surplusStationIndices;
+  stops.insert(stops.end(), tuple.deficitStationIndices.begin(),
+               tuple.deficitStationIndices.end());
+  const int n = static_cast<int>(stops.size());
+  if (n > kMaxStations)
+    throw std::invalid_argument("TupleRouteCost: tuple has " +
+                                std::to_string(n) + " stations, at most " +
+                                std::to_string(kMaxStations) +
+                                " are supported");
+  TupleRoute route;
+  if (n == 0)
+    return route;
+
+  // net bikes loaded at each stop, and the pickups each drop must follow
+  std::vector<int> delta(n, 0);
+  std::vector<std::uint32_t> required(n, 0);
+  auto stopOf = [&stops](int station) {
+    return static_cast<int>(std::find(stops.begin(), stops.end(), station) -
+                            stops.begin());
+  };
+  for (const auto &entry : tuple.bikeAllocations) {
+    int s = stopOf(entry.first.first), d = stopOf(entry.first.second);
+    if (s == n || d == n || entry.second <= 0)
+      continue;
+    delta[s] += entry.second;
+    delta[d] -= entry.second;
+    required[d] |= std::uint32_t{1} << s;
+  }
+
+  const std::uint32_t full = (std::uint32_t{1} << n) - 1;
+  std::vector<int> load(full + 1, 0); // bikes on board after visiting a set
+  for (std::uint32_t mask = 1; mask <= full; ++mask) {
+    int low = __builtin_ctz(mask);
+    load[mask] = load[mask & (mask - 1)] + delta[low];
+  }
+  auto handling = [&](int stop) {
+    return param.tLoad * std::abs(delta[stop]);
+  };
+  auto loadOk = [&](std::uint32_t mask) {
+    return load[mask] >= 0 && load[mask] <= param.vehicleCapacity;
+  };
+
+  dp.assign(static_cast<std::size_t>(full + 1) * n, kInf);
+  parent.assign(dp.size(), -1);
+  for (int i = 0; i < n; ++i)
+    if (required[i] == 0 && loadOk(std::uint32_t{1} << i))
+      dp[(std::size_t{1} << i) * n + i] = handling(i);
+
+  for (std::uint32_t mask = 1; mask < full; ++mask) {
+    for (int last = 0; last < n; ++last) {
+      double base = dp[static_cast<std::size_t>(mask) * n + last];
+      if (base == kInf)
+        continue;
+      const std::vector<double> &row = timeMatrix[stops[last]];
+      for (int next = 0; next < n; ++next) {
+        std::uint32_t bit = std::uint32_t{1} << next;
+        if ((mask & bit) || (required[next] & ~mask) || !loadOk(mask | bit))
+          continue;
+        double cost = base + row[stops[next]] + handling(next);
+        std::size_t cell = static_cast<std::size_t>(mask | bit) * n + next;
+        if (cost < dp[cell]) {
+          dp[cell] = cost;
+          parent[cell] = static_cast<signed char>(last);
+        }
+      }
+    }
+  }
+
+  int last = -1;
+  double best = kInf;
+  for (int i = 0; i < n; ++i)
+    if (dp[static_cast<std::size_t>(full) * n + i] < best) {
+      best = dp[static_cast<std::size_t>(full) * n + i];
+      last = i;
+    }
+  if (last < 0) {
+    stats.infeasible++;
+    return route;
+  }
+
+  route.feasible = true;
+  route.serviceTime = best;
+  for (std::uint32_t mask = full; last >= 0;) {
+    route.order.push_back(stops[last]);
+    int prev = parent[static_cast<std::size_t>(mask) * n + last];
+    mask &= ~(std::uint32_t{1} << last);
+    last = prev;
+  }
+  std::reverse(route.order.begin(), route.order.end());
+  return route;
+}
+
+void TupleRouteCost::clear() {
+  entries.clear();
+  insertionOrder.clear();
+  nextVictim = 0;
+}
+
+RouteCostStats TupleRouteCost::getStats() const {
+  RouteCostStats result = stats;
+  result.entries = entries.size();
+  return result;
+}
+
+bool RouteScoringSink::accept(const TransferTuple &tuple) {
+  scored = tuple;
+  return routeCost.apply(scored) && downstream.accept(scored);
+}
@@ -0,0 +1,121 @@
+#include "clustering/tuple_cache.hpp"
+
+namespace {
+
+// splitmix64 finalizer
+std::uint64_t mix(std::uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+  return h ^ (h >> 31);
+}
+
+} // namespace
+
+std::size_t CandidateMask::hash() const {
+  // trailing zero words do not change the hash, as they do not change ==
+  std::uint64_t h = 0;
+  for (std::size_t w = 0; w < words.size(); ++w)
+    if (words[w])
+      h ^= mix(words[w] * 0x9E3779B97F4A7C15ULL + w);
+  return static_cast<std::size_t>(h);
+}
+
+std::size_t SubsetKeyHash::operator()(const SubsetKey &key) const {
+  return static_cast<std::size_t>(
+      mix(key.surplus.hash() * 0x9E3779B97F4A7C15ULL ^ key.deficit.hash()));
+}
+
+SubsetKey usedSubsetKey(const TransferTuple &tuple, const SubsetKey &candidate,
+                        const std::vector<int> &surplusCandidates,
+                        const std::vector<int> &deficitCandidates) {
+  SubsetKey used;
+  auto pick = [](const std::vector<int> &used, const CandidateMask &from,
+                 const std::vector<int> &candidates, CandidateMask &into) {
+    from.forEach([&](std::size_t i) {
+      if (std::find(used.begin(), used.end(), candidates[i]) != used.end())
+        into.set(i);
+    });
+  };
+  pick(tuple.surplusStationIndices, candidate.surplus, surplusCandidates,
+       used.surplus);
+  pick(tuple.deficitStationIndices, candidate.deficit, deficitCandidates,
+       used.deficit);
+  return used;
+}
+
+TupleEvaluationCache::TupleEvaluationCache(std::size_t maxEntries)
+    : maxEntries(maxEntries) {}
+
+const TransferTuple *TupleEvaluationCache::find(const SubsetKey &key) {
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    misses++;
+    return nullptr;
+  }
+  hits++;
+  return &it->second;
+}
+
+const TransferTuple &TupleEvaluationCache::insert(const SubsetKey &key,
+                                                  TransferTuple tuple) {
+  auto existing = entries.find(key);
+  if (existing != entries.end())
+    return existing->second;
+
+  if (entries.size() >= maxEntries) {
+    // evict the oldest key and reuse its slot in the ring
+    const SubsetKey &victim = insertionOrder[nextVictim];
+    auto it = entries.find(victim);
+    bytes -= footprint(it->first, it->second);
+    entries.erase(it);
+    insertionOrder[nextVictim] = key;
+    nextVictim = (nextVictim + 1) % maxEntries;
+    evictions++;
+  } else {
+    insertionOrder.push_back(key);
+  }
+  bytes += footprint(key, tuple);
+  return entries.emplace(key, std::move(tuple)).first->second;
+}
+
+void TupleEvaluationCache::clear() {
+  entries.clear();
+  insertionOrder.clear();
+  nextVictim = 0;
+  bytes = 0;
+}
+
+void TupleEvaluationCache::resetStats() {
+  hits = 0;
+  misses = 0;
+  evictions = 0;
+}
+
+void TupleEvaluationCache::setMaxEntries(std::size_t maxEntries) {
+  this->maxEntries = maxEntries;
+  clear();
+}
+
+TupleCacheStats TupleEvaluationCache::getStats() const {
+  TupleCacheStats stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.evictions = evictions;
+  stats.entries = entries.size();
+  stats.bytes = bytes + insertionOrder.capacity() * sizeof(SubsetKey);
+  return stats;
+}
+
+std::size_t TupleEvaluationCache::footprint(const SubsetKey &key,
+                                            const TransferTuple &tuple) {
+  // hash node + the key's words, held by the node and the ring + the tuple's
+  // own heap blocks (vector buffers, map nodes)
+  constexpr std::size_t mapNode = 4 * sizeof(void *) +
+                                  sizeof(std::pair<int, int>) + sizeof(int);
+  return sizeof(SubsetKey) + sizeof(TransferTuple) + 2 * sizeof(void *) +
+         2 * (key.surplus.heapBytes() + key.deficit.heapBytes()) +
+         (tuple.surplusStationIndices.capacity() +
+          tuple.deficitStationIndices.capacity()) *
+             sizeof(int) +
+         tuple.bikeAllocations.size() * mapNode;
+}
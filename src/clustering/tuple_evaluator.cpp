@@ -1,8 +1,15 @@
 #include "clustering/tuple_evaluator.hpp"
 #include "core/transfer_tuple.hpp"
-#include "utils/debug_utils.h"
+#include "utils/Counters.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/Timer.hpp"
 #include <algorithm>
+#include <atomic>
+#include <numeric>
 #include <set>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 TupleClusterEvaluator::TupleClusterEvaluator(int maxSurplus, int maxDeficit)
@@ -10,8 +17,13 @@ TupleClusterEvaluator::TupleClusterEvaluator(int maxSurplus, int maxDeficit)
 
 ClusterEvaluationResult
 TupleClusterEvaluator::evaluateCluster(const std::vector<int> &stationIndices,
-                                       const std::vector<Station> &stations) {
+                                       const std::vector<Station> &stations,
+                                       const SelectionOptions &selection) {
+  PROFILE_SCOPE("evaluate cluster");
+  Timer timer;
+  const CounterSet countersBefore = Counters::thread();
   ClusterEvaluationResult result;
+  result.stationIndices = stationIndices;
   // step 0: split the stationIndices into surplus and deficit
   std::vector<int> surplusIndices;
   std::vector<int> deficitIndices;
@@ -24,49 +36,202 @@ TupleClusterEvaluator::evaluateCluster(const std::vector<int> &stationIndices,
     }
   }
   // step 1: decide the tuples in the cluster
-  std::vector<TransferTuple> tuples;
-  generateTuples(surplusIndices, deficitIndices, tuples, stations);
+  std::vector<TransferTuple> tuples =
+      generateCandidates(surplusIndices, deficitIndices, stations, selection);
 
-  // step 2: evaluate the tuple by summing up the delta UDFs
-  for (auto &tuple : tuples) {
-    result.totalDeltaUDF += tuple.deltaUDF;
-  }
+  // step 2: keep a station-disjoint subset and sum up its delta UDFs
+  SelectionResult selected = selectExclusiveTuples(tuples, selection);
+  result.assignedTuples = std::move(selected.selected);
+  result.totalDeltaUDF = selected.totalDeltaUDF;
+  result.evaluated = true;
+  result.elapsedSeconds = timer.elapsed();
+  result.counters = Counters::thread();
+  result.counters -= countersBefore;
   // step 3: return the result
   return result;
 }
 
+NetworkPlan TupleClusterEvaluator::evaluateNetwork(
+    const std::vector<std::vector<int>> &clusters,
+    const std::vector<Station> &stations,
+    const NetworkEvaluationOptions &options) {
+  PROFILE_SCOPE("evaluate network");
+  Timer timer;
+  NetworkPlan plan;
+  plan.clusters.resize(clusters.size());
+  for (size_t c = 0; c < clusters.size(); ++c)
+    plan.clusters[c].stationIndices = clusters[c];
+
+  // largest first, so a long cluster does not start last and stall the pool
+  std::vector<size_t> order(clusters.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&clusters](size_t a, size_t b) {
+    return clusters[a].size() > clusters[b].size();
+  });
+
+  unsigned threads = options.threads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(
+      std::max<size_t>(1, std::min<size_t>(threads, clusters.size())));
+
+  const bool hasDeadline = options.deadlineSeconds > 0;
+  std::atomic<size_t> next{0};
+  std::vector<std::unique_ptr<TupleClusterEvaluator>> workers;
+  for (unsigned w = 0; w < threads; ++w)
+    workers.push_back(makeWorker());
+
+  auto work = [&](TupleClusterEvaluator &worker) {
+    for (size_t k = next.fetch_add(1); k < order.size();
+         k = next.fetch_add(1)) {
+      SelectionOptions selection = options.selection;
+      if (hasDeadline) {
+        double remaining = options.deadlineSeconds - timer.elapsed();
+        if (remaining <= 0)
+          continue; // leave the cluster unevaluated
+        selection.timeLimitSeconds =
+            std::min(selection.timeLimitSeconds, remaining);
+      }
+      size_t c = order[k];
+      plan.clusters[c] =
+          worker.evaluateCluster(clusters[c], stations, selection);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned w = 1; w < threads; ++w)
+    pool.emplace_back(work, std::ref(*workers[w]));
+  work(*workers[0]);
+  for (auto &thread : pool)
+    thread.join();
+
+  for (const auto &worker : workers)
+    searchStats += worker->searchStats;
+  for (const auto &cluster : plan.clusters) {
+    if (!cluster.evaluated)
+      continue;
+    plan.totalDeltaUDF += cluster.totalDeltaUDF;
+    plan.counters += cluster.counters;
+    plan.clustersEvaluated++;
+  }
+  plan.complete = plan.clustersEvaluated == clusters.size();
+  plan.elapsedSeconds = timer.elapsed();
+  LOG_DEBUG("Network evaluation: " << plan.clustersEvaluated << "/"
+                                   << clusters.size() << " clusters on "
+                                   << threads << " threads, deltaUDF "
+                                   << plan.totalDeltaUDF << " in "
+                                   << plan.elapsedSeconds << "s");
+  return plan;
+}
+
+std::unique_ptr<TupleClusterEvaluator>
+TupleClusterEvaluator::makeWorker() const {
+  auto worker = std::make_unique<TupleClusterEvaluator>(maxSurplus, maxDeficit);
+  worker->pruning = pruning;
+  worker->cache.setMaxEntries(cache.getMaxEntries());
+  if (routeCost)
+    worker->routeCost = std::make_unique<TupleRouteCost>(
+        routeCost->getTimeMatrix(), routeCost->getParam(),
+        routeCost->getMaxEntries());
+  return worker;
+}
+
 void TupleClusterEvaluator::generateTuples(
     const std::vector<int> &surplusIndices,
     const std::vector<int> &deficitIndices, std::vector<TransferTuple> &tuples,
     const std::vector<Station> &stations) {
+  VectorTupleSink sink(tuples);
+  generateTuples(surplusIndices, deficitIndices, sink, stations);
+}
+
+std::vector<TransferTuple> TupleClusterEvaluator::generateCandidates(
+    const std::vector<int> &surplusIndices,
+    const std::vector<int> &deficitIndices,
+    const std::vector<Station> &stations, const SelectionOptions &options) {
+  std::vector<TransferTuple> tuples;
+  if (options.maxCandidates == 0) {
+    generateTuples(surplusIndices, deficitIndices, tuples, stations);
+    return tuples;
+  }
+  TopKTupleSink sink(options.maxCandidates, options.score);
+  generateTuples(surplusIndices, deficitIndices, sink, stations);
+  return sink.take();
+}
+
+void TupleClusterEvaluator::generateTuples(
+    const std::vector<int> &surplusIndices,
+    const std::vector<int> &deficitIndices, TupleSink &target,
+    const std::vector<Station> &stations) {
+  PROFILE_SCOPE("tuple generation");
+  // The cache is keyed by masks over this call's candidate lists, so entries
+  // from a previous call are meaningless here.
+  cache.clear();
 
+  std::unique_ptr<RouteScoringSink> scoring;
+  if (routeCost)
+    scoring = std::make_unique<RouteScoringSink>(*routeCost, target);
+  TupleSink &sink = scoring ? static_cast<TupleSink &>(*scoring) : target;
+
+  TupleSearchStats stats;
+  if (!pruning) {
+    stats = generateTuplesExhaustive(surplusIndices, deficitIndices, sink,
+                                     stations);
+  } else {
+    TupleSearch search(*this, surplusIndices, deficitIndices, stations, sink);
+    search.run(maxSurplus, maxDeficit);
+    stats = search.getStats();
+  }
+  searchStats += stats;
+  CounterSet counters;
+  counters[Counter::TUPLE_COMBINATIONS] = stats.combinationsEvaluated;
+  counters[Counter::TUPLE_POSITIVE] = stats.tuplesPositive;
+  counters[Counter::TUPLE_SUBSET_REJECTED] = stats.rejectedAsSubset;
+  counters[Counter::TUPLE_ACCEPTED] = stats.tuplesAccepted;
+  Counters::add(counters);
+  LOG_DEBUG("Tuple search: " << stats.nodesVisited << " nodes, "
+                             << stats.combinationsEvaluated << " evaluated, "
+                             << stats.prunedByBound << " pruned by bound, "
+                             << stats.prunedByDominance
+                             << " pruned by dominance, "
+                             << stats.tuplesAccepted << " accepted");
+}
+
+TupleSearchStats TupleClusterEvaluator::generateTuplesExhaustive(
+    const std::vector<int> &surplusIndices,
+    const std::vector<int> &deficitIndices, TupleSink &sink,
+    const std::vector<Station> &stations) {
+  TupleSearchStats stats;
   std::vector<std::set<int>> acceptedSurSets, acceptedDefSets;
   for (int s = std::min(maxSurplus, (int)surplusIndices.size()); s >= 1; --s) {
-    DEBUG_PRINT("Generating tuples with " << s << " surplus stations");
+    LOG_TRACE("Generating tuples with " << s << " surplus stations");
     for (int d = std::min(maxDeficit, (int)deficitIndices.size()); d >= 1;
          --d) {
-      DEBUG_PRINT("Generating tuples with " << d << " deficit stations");
+      LOG_TRACE("Generating tuples with " << d << " deficit stations");
       std::vector<bool> surSelect(surplusIndices.size(), false);
       std::fill(surSelect.begin(), surSelect.begin() + s, true);
       do {
-        std::vector<int> surCombo;
+        SubsetKey candidate{CandidateMask(surplusIndices.size()),
+                            CandidateMask(deficitIndices.size())};
         for (size_t i = 0; i < surSelect.size(); ++i)
           if (surSelect[i])
-            surCombo.push_back(surplusIndices[i]);
+            candidate.surplus.set(i);
 
         std::vector<bool> defSelect(deficitIndices.size(), false);
         std::fill(defSelect.begin(), defSelect.begin() + d, true);
         do {
-          std::vector<int> defCombo;
+          candidate.deficit = CandidateMask(deficitIndices.size());
           for (size_t j = 0; j < defSelect.size(); ++j)
             if (defSelect[j])
-              defCombo.push_back(deficitIndices[j]);
+              candidate.deficit.set(j);
 
           // Immediate evaluation — note: evaluateTuple now returns only
           // stations with positive transfer!
-          auto tuple = evaluateTuple(surCombo, defCombo, stations);
+          const TransferTuple &tuple = evaluateTuple(
+              candidate, surplusIndices, deficitIndices, stations);
 
+          stats.combinationsEvaluated++;
           if (tuple.deltaUDF > 0) {
+            stats.tuplesPositive++;
             std::set<int> usedSurSet(tuple.surplusStationIndices.begin(),
                                      tuple.surplusStationIndices.end());
             std::set<int> usedDefSet(tuple.deficitStationIndices.begin(),
@@ -86,16 +251,19 @@ void TupleClusterEvaluator::generateTuples(
                 break;
               }
             }
-            if (!isSubset) {
-              tuples.push_back(tuple);
+            if (isSubset) {
+              stats.rejectedAsSubset++;
+            } else if (sink.accept(tuple)) {
               acceptedSurSets.push_back(usedSurSet);
               acceptedDefSets.push_back(usedDefSet);
+              stats.tuplesAccepted++;
             }
           }
         } while (std::prev_permutation(defSelect.begin(), defSelect.end()));
       } while (std::prev_permutation(surSelect.begin(), surSelect.end()));
     }
   }
+  return stats;
 }
 
 TransferTuple
@@ -122,14 +290,16 @@ TupleClusterEvaluator::evaluateTuple(const std::vector<int> &surplusIndices,
                        stations[idx].getOptimalInventory(),
                        stations[idx].getBcrf(), &stations[idx].getUdfValues()});
 
-  std::sort(surplus.begin(), surplus.end(),
-            [](const LocalStation &a, const LocalStation &b) {
-              return a.bcrf > b.bcrf;
-            });
-  std::sort(deficit.begin(), deficit.end(),
-            [](const LocalStation &a, const LocalStation &b) {
-              return a.bcrf > b.bcrf;
-            });
+  // stable, so that ties keep the candidate order: the memo relies on a
+  // subset of the stations being visited in the same relative order
+  std::stable_sort(surplus.begin(), surplus.end(),
+                   [](const LocalStation &a, const LocalStation &b) {
+                     return a.bcrf > b.bcrf;
+                   });
+  std::stable_sort(deficit.begin(), deficit.end(),
+                   [](const LocalStation &a, const LocalStation &b) {
+                     return a.bcrf > b.bcrf;
+                   });
 
   double deltaUDF = 0.0;
   std::vector<int> surplusMoved(surplus.size(), 0),
@@ -186,54 +356,138 @@ TupleClusterEvaluator::evaluateTuple(const std::vector<int> &surplusIndices,
   return tuple;
 }
 
-// Main greedy selector
-std::vector<TransferTuple> TupleClusterEvaluator::greedySelectExclusiveTuples(
-    const std::vector<TransferTuple> &tuples) {
+const TransferTuple &TupleClusterEvaluator::evaluateTuple(
+    const SubsetKey &candidate, const std::vector<int> &surplusCandidates,
+    const std::vector<int> &deficitCandidates,
+    const std::vector<Station> &stations) {
+  auto stationsOf = [](const SubsetKey &key, const std::vector<int> &surplus,
+                       const std::vector<int> &deficit,
+                       std::vector<int> &surCombo, std::vector<int> &defCombo) {
+    key.surplus.forEach([&](std::size_t i) { surCombo.push_back(surplus[i]); });
+    key.deficit.forEach([&](std::size_t j) { defCombo.push_back(deficit[j]); });
+  };
+  std::vector<int> surCombo, defCombo;
+  if (cache.getMaxEntries() == 0) {
+    stationsOf(candidate, surplusCandidates, deficitCandidates, surCombo,
+               defCombo);
+    uncachedTuple = evaluateTuple(surCombo, defCombo, stations);
+    return uncachedTuple;
+  }
 
-  // Sort tuples by deltaUDF descending (break ties by tuple size descending)
-  std::vector<TransferTuple> sortedTuples = tuples;
-  std::sort(sortedTuples.begin(), sortedTuples.end(),
-            [](const TransferTuple &a, const TransferTuple &b) {
-              if (a.deltaUDF != b.deltaUDF)
-                return a.deltaUDF > b.deltaUDF;
-              size_t sizeA = a.surplusStationIndices.size() +
-                             a.deficitStationIndices.size();
-              size_t sizeB = b.surplusStationIndices.size() +
-                             b.deficitStationIndices.size();
-              return sizeA > sizeB;
-            });
-  DEBUG_PRINT("sort OK");
-  std::vector<TransferTuple> selected;
-  std::set<int> usedStations; // IDs of stations already assigned
-
-  for (const auto &tuple : sortedTuples) {
-    bool conflict = false;
-    // Check surplus
-    for (int sid : tuple.surplusStationIndices) {
-      if (usedStations.count(sid)) {
-        conflict = true;
-        break;
-      }
-    }
-    if (conflict)
-      continue;
-    // Check deficit
-    for (int did : tuple.deficitStationIndices) {
-      if (usedStations.count(did)) {
-        conflict = true;
+  // Any candidate whose greedy moves bikes at the same stations evaluates to
+  // the same tuple, so look it up, and evaluate it, under those stations.
+  SubsetKey used =
+      greedySubsetKey(candidate, surplusCandidates, deficitCandidates,
+                      stations);
+  if (const TransferTuple *hit = cache.find(used))
+    return *hit;
+  stationsOf(used, surplusCandidates, deficitCandidates, surCombo, defCombo);
+  return cache.insert(used, evaluateTuple(surCombo, defCombo, stations));
+}
+
+SubsetKey TupleClusterEvaluator::greedySubsetKey(
+    const SubsetKey &candidate, const std::vector<int> &surplusCandidates,
+    const std::vector<int> &deficitCandidates,
+    const std::vector<Station> &stations) {
+  // The greedy transfer fills the deficit stations in BCRF order from the
+  // surplus stations in BCRF order. So it uses the surplus stations it
+  // reaches before the deficits' total need is met, and the deficit stations
+  // it reaches before the surplus' total supply runs out; balanced or
+  // crossed stations never move bikes.
+  struct Entry {
+    std::size_t position;
+    int gap;
+    double bcrf;
+  };
+  auto entries = [&stations](const CandidateMask &mask,
+                             const std::vector<int> &candidates, int sign,
+                             int &total) {
+    std::vector<Entry> side;
+    mask.forEach([&](std::size_t i) {
+      const Station &station = stations[candidates[i]];
+      int gap = sign * (station.getCurrentInventory() -
+                        station.getOptimalInventory());
+      if (gap <= 0)
+        return;
+      side.push_back({i, gap, station.getBcrf()});
+      total += gap;
+    });
+    std::stable_sort(side.begin(), side.end(),
+                     [](const Entry &a, const Entry &b) {
+                       return a.bcrf > b.bcrf;
+                     });
+    return side;
+  };
+  auto reached = [](const std::vector<Entry> &side, int other,
+                    CandidateMask &used) {
+    int before = 0;
+    for (const Entry &entry : side) {
+      if (before >= other)
         break;
-      }
+      used.set(entry.position);
+      before += entry.gap;
     }
-    if (conflict)
-      continue;
+  };
+  int supply = 0, need = 0;
+  const std::vector<Entry> surplus =
+      entries(candidate.surplus, surplusCandidates, 1, supply);
+  const std::vector<Entry> deficit =
+      entries(candidate.deficit, deficitCandidates, -1, need);
+  SubsetKey used{CandidateMask(surplusCandidates.size()),
+                 CandidateMask(deficitCandidates.size())};
+  reached(surplus, need, used.surplus);
+  reached(deficit, supply, used.deficit);
+  return used;
+}
 
-    // If no conflict, select this tuple
-    selected.push_back(tuple);
-    for (int sid : tuple.surplusStationIndices)
-      usedStations.insert(sid);
-    for (int did : tuple.deficitStationIndices)
-      usedStations.insert(did);
-  }
+void TupleClusterEvaluator::setPruning(bool enabled) { pruning = enabled; }
 
-  return selected;
+TupleSearchStats TupleClusterEvaluator::getSearchStats() const {
+  return searchStats;
+}
+
+void TupleClusterEvaluator::setCacheCapacity(std::size_t maxEntries) {
+  cache.setMaxEntries(maxEntries);
+}
+
+TupleCacheStats TupleClusterEvaluator::getCacheStats() const {
+  return cache.getStats();
+}
+
+void TupleClusterEvaluator::enableRouteScoring(
+    const std::vector<std::vector<double>> &timeMatrix, const Param &param) {
+  if (maxSurplus + maxDeficit > TupleRouteCost::kMaxStations)
+    throw std::invalid_argument(
+        "Route scoring supports at most " +
+        std::to_string(TupleRouteCost::kMaxStations) +
+        " stations per tuple, pattern allows " +
+        std::to_string(maxSurplus + maxDeficit));
+  routeCost = std::make_unique<TupleRouteCost>(timeMatrix, param);
+}
+
+void TupleClusterEvaluator::disableRouteScoring() { routeCost.reset(); }
+
+RouteCostStats TupleClusterEvaluator::getRouteCostStats() const {
+  return routeCost ? routeCost->getStats() : RouteCostStats{};
+}
+
+// Main greedy selector
+std::vector<TransferTuple> TupleClusterEvaluator::greedySelectExclusiveTuples(
+    const std::vector<TransferTuple> &tuples) {
+  PROFILE_SCOPE("tuple selection");
+  // Tuples are taken by deltaUDF descending (ties: larger tuple first) unless
+  // one of their stations is already assigned
+  return ExclusiveTupleSelector(tuples).select().selected;
+}
+
+SelectionResult TupleClusterEvaluator::selectExclusiveTuples(
+    const std::vector<TransferTuple> &tuples,
+    const SelectionOptions &options) {
+  PROFILE_SCOPE("tuple selection");
+  SelectionResult result =
+      ExclusiveTupleSelector(tuples, options.score).select(options);
+  LOG_DEBUG("Selected " << result.selected.size() << " tuples, deltaUDF "
+                        << result.totalDeltaUDF << ", gap " << result.gap
+                        << (result.provedOptimal ? " (optimal)" : ""));
+  return result;
 }
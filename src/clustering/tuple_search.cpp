@@ -0,0 +1,298 @@
+#include "clustering/tuple_search.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+
+// Slack on bound comparisons: the evaluated ΔUDF is a sum of per-bike
+// differences and may exceed the telescoped bound by rounding error.
+constexpr double kBoundSlack = 1e-9;
+
+// Fills a (n + 1) x (maxPick + 1) table whose entry (next, r) is the sum of
+// the r largest bounds among positions [next, n).
+std::vector<double> bestCompletionTable(const std::vector<double> &bounds,
+                                        int maxPick) {
+  const int n = static_cast<int>(bounds.size());
+  const int stride = maxPick + 1;
+  std::vector<double> table((n + 1) * stride,
+                            -std::numeric_limits<double>::infinity());
+  std::vector<double> top; // largest bounds of the suffix, descending
+  for (int next = n; next >= 0; --next) {
+    if (next < n) {
+      top.insert(std::upper_bound(top.begin(), top.end(), bounds[next],
+                                  std::greater<double>()),
+                 bounds[next]);
+      if ((int)top.size() > maxPick)
+        top.pop_back();
+    }
+    double sum = 0.0;
+    table[next * stride] = 0.0;
+    for (int r = 1; r <= (int)top.size(); ++r) {
+      sum += top[r - 1];
+      table[next * stride + r] = sum;
+    }
+  }
+  return table;
+}
+
+// Order-dependent hash of two ascending position lists.
+std::uint64_t fingerprint(const std::vector<int> &surplus,
+                          const std::vector<int> &deficit) {
+  std::uint64_t h = 0x9E3779B97F4A7C15ULL;
+  auto add = [&h](std::uint64_t value) {
+    h = (h ^ value) * 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+  };
+  for (int i : surplus)
+    add(static_cast<std::uint64_t>(i) + 1);
+  add(0); // separates the sides
+  for (int j : deficit)
+    add(static_cast<std::uint64_t>(j) + 1);
+  return h;
+}
+
+} // namespace
+
+TupleSearchStats &TupleSearchStats::operator+=(const TupleSearchStats &other) {
+  nodesVisited += other.nodesVisited;
+  combinationsEvaluated += other.combinationsEvaluated;
+  prunedByBound += other.prunedByBound;
+  prunedByDominance += other.prunedByDominance;
+  tuplesPositive += other.tuplesPositive;
+  rejectedAsSubset += other.rejectedAsSubset;
+  tuplesAccepted += other.tuplesAccepted;
+  return *this;
+}
+
+double maxUdfReduction(const Station &station) {
+  const std::vector<double> &udf = station.getUdfValues();
+  int current = station.getCurrentInventory();
+  int optimal = station.getOptimalInventory();
+  if (current < 0 || current >= (int)udf.size())
+    return std::numeric_limits<double>::infinity(); // cannot bound
+  int step = optimal > current ? 1 : -1;
+  double best = 0.0;
+  for (int inv = current; inv != optimal;) {
+    inv += step;
+    if (inv < 0 || inv >= (int)udf.size())
+      return std::numeric_limits<double>::infinity();
+    best = std::max(best, udf[current] - udf[inv]);
+  }
+  return best;
+}
+
+TupleSearch::TupleSearch(TupleClusterEvaluator &evaluator,
+                         const std::vector<int> &surplusIndices,
+                         const std::vector<int> &deficitIndices,
+                         const std::vector<Station> &stations,
+                         TupleSink &sink)
+    : evaluator(evaluator), surplusIndices(surplusIndices),
+      deficitIndices(deficitIndices), stations(stations), sink(sink) {
+  for (int idx : surplusIndices)
+    surplusBound.push_back(maxUdfReduction(stations[idx]));
+  for (int idx : deficitIndices)
+    deficitBound.push_back(maxUdfReduction(stations[idx]));
+}
+
+void TupleSearch::run(int maxSurplus, int maxDeficit) {
+  const int maxS = std::min(maxSurplus, (int)surplusIndices.size());
+  const int maxD = std::min(maxDeficit, (int)deficitIndices.size());
+  if (maxS < 1 || maxD < 1)
+    return;
+
+  surplusBest = bestCompletionTable(surplusBound, maxS);
+  deficitBest = bestCompletionTable(deficitBound, maxD);
+  surplusStride = maxS + 1;
+  deficitStride = maxD + 1;
+  threshold = std::max(0.0, sink.threshold());
+  candidate = {CandidateMask(surplusIndices.size()),
+               CandidateMask(deficitIndices.size())};
+
+  for (int s = maxS; s >= 1; --s) {
+    LOG_TRACE("Generating tuples with " << s << " surplus stations");
+    for (int d = maxD; d >= 1; --d) {
+      LOG_TRACE("Generating tuples with " << d << " deficit stations");
+      deficitPick = d;
+      chooseSurplus(0, s, 0.0);
+    }
+  }
+}
+
+double TupleSearch::bestSurplus(int next, int r) const {
+  return surplusBest[next * surplusStride + r];
+}
+
+double TupleSearch::bestDeficit(int next, int r) const {
+  return deficitBest[next * deficitStride + r];
+}
+
+void TupleSearch::chooseSurplus(int next, int remaining, double bound) {
+  stats.nodesVisited++;
+  if (remaining == 0) {
+    surplusMaskBound = bound;
+    chooseDeficit(0, deficitPick, 0.0);
+    return;
+  }
+
+  const int n = static_cast<int>(surplusIndices.size());
+  for (int i = next; i <= n - remaining; ++i) {
+    double childBound = bound + surplusBound[i];
+    double optimistic = childBound + bestSurplus(i + 1, remaining - 1) +
+                        bestDeficit(0, deficitPick);
+    if (optimistic + kBoundSlack <= threshold) {
+      stats.prunedByBound++;
+      continue;
+    }
+    candidate.surplus.set(i);
+    surplusPicks.push_back(i);
+    chooseSurplus(i + 1, remaining - 1, childBound);
+    surplusPicks.pop_back();
+    candidate.surplus.reset(i);
+  }
+}
+
+void TupleSearch::chooseDeficit(int next, int remaining, double bound) {
+  stats.nodesVisited++;
+  if (remaining == 0) {
+    evaluateLeaf();
+    return;
+  }
+
+  const int m = static_cast<int>(deficitIndices.size());
+  std::vector<int> reach;
+  for (int j = next; j <= m - remaining; ++j) {
+    double childBound = bound + deficitBound[j];
+    double optimistic =
+        surplusMaskBound + childBound + bestDeficit(j + 1, remaining - 1);
+    if (optimistic + kBoundSlack <= threshold) {
+      stats.prunedByBound++;
+      continue;
+    }
+    // Every completion of this child lies inside an accepted tuple if the
+    // picks, and all positions a completion may still pick, do.
+    deficitPicks.push_back(j);
+    bool dominated = false;
+    if (remaining == 1) {
+      dominated = inside(surplusPicks, deficitPicks);
+    } else if (deficitPicks.size() + (m - j - 1) <= maxAccepted) {
+      reach = deficitPicks;
+      for (int k = j + 1; k < m; ++k)
+        reach.push_back(k);
+      dominated = inside(surplusPicks, reach);
+    }
+    if (dominated) {
+      stats.prunedByDominance++;
+    } else {
+      candidate.deficit.set(j);
+      chooseDeficit(j + 1, remaining - 1, childBound);
+      candidate.deficit.reset(j);
+    }
+    deficitPicks.pop_back();
+  }
+}
+
+void TupleSearch::evaluateLeaf() {
+  stats.combinationsEvaluated++;
+  const TransferTuple &tuple = evaluator.evaluateTuple(
+      candidate, surplusIndices, deficitIndices, stations);
+  if (!(tuple.deltaUDF > 0))
+    return;
+  stats.tuplesPositive++;
+
+  // The candidate itself passed the dominance check; only a strictly smaller
+  // used set can still fall inside an accepted tuple.
+  SubsetKey used =
+      usedSubsetKey(tuple, candidate, surplusIndices, deficitIndices);
+  if (!(used == candidate)) {
+    std::vector<int> surplus, deficit;
+    used.surplus.forEach([&](std::size_t i) { surplus.push_back(i); });
+    used.deficit.forEach([&](std::size_t j) { deficit.push_back(j); });
+    if (inside(surplus, deficit)) {
+      stats.rejectedAsSubset++;
+      return;
+    }
+  }
+
+  // A tuple the sink ranks out still takes part in the anti-subset rule; one
+  // it rejects as invalid must not hide its sub-tuples.
+  if (!sink.accept(tuple))
+    return;
+  accept(used);
+  stats.tuplesAccepted++;
+  threshold = std::max(0.0, sink.threshold());
+}
+
+bool TupleSearch::inside(const std::vector<int> &surplus,
+                         const std::vector<int> &deficit) const {
+  if (covered.empty())
+    return false;
+  const std::uint64_t tag = fingerprint(surplus, deficit) >> 32;
+  const std::size_t mask = covered.size() - 1;
+  for (std::size_t slot = tag & mask; covered[slot]; slot = (slot + 1) & mask) {
+    if (covered[slot] >> 32 != tag)
+      continue;
+    // verify: every position inside the tuple's
+    const int *tuple = &accepted[(covered[slot] & 0xFFFFFFFFu) - 1];
+    const int *tupleSurplus = tuple + 1, *tupleDeficit = tuple + tuple[0] + 2;
+    if (std::includes(tupleSurplus, tupleSurplus + tuple[0], surplus.begin(),
+                      surplus.end()) &&
+        std::includes(tupleDeficit, tupleDeficit + tupleDeficit[-1],
+                      deficit.begin(), deficit.end()))
+      return true;
+  }
+  return false;
+}
+
+void TupleSearch::accept(const SubsetKey &used) {
+  std::vector<int> surplus, deficit;
+  used.surplus.forEach([&](std::size_t i) { surplus.push_back(i); });
+  used.deficit.forEach([&](std::size_t j) { deficit.push_back(j); });
+  maxAccepted = std::max(maxAccepted, deficit.size());
+  const std::uint32_t offset = static_cast<std::uint32_t>(accepted.size());
+  accepted.push_back(static_cast<int>(surplus.size()));
+  accepted.insert(accepted.end(), surplus.begin(), surplus.end());
+  accepted.push_back(static_cast<int>(deficit.size()));
+  accepted.insert(accepted.end(), deficit.begin(), deficit.end());
+
+  // every non-empty subset of each side, positions kept ascending; one
+  // already inside an earlier tuple needs no second witness
+  std::vector<int> subSurplus, subDeficit;
+  for (std::uint32_t a = 1; a < 1u << surplus.size(); ++a) {
+    subSurplus.clear();
+    for (size_t i = 0; i < surplus.size(); ++i)
+      if (a >> i & 1)
+        subSurplus.push_back(surplus[i]);
+    for (std::uint32_t b = 1; b < 1u << deficit.size(); ++b) {
+      subDeficit.clear();
+      for (size_t j = 0; j < deficit.size(); ++j)
+        if (b >> j & 1)
+          subDeficit.push_back(deficit[j]);
+      if (!inside(subSurplus, subDeficit))
+        index(fingerprint(subSurplus, subDeficit), offset);
+    }
+  }
+}
+
+void TupleSearch::index(std::uint64_t key, std::uint32_t tuple) {
+  if (2 * (coveredEntries + 1) > covered.size()) {
+    // keep the load at most 1/2
+    std::vector<std::uint64_t> old(
+        std::max<std::size_t>(64, 2 * covered.size()));
+    old.swap(covered);
+    coveredEntries = 0;
+    for (std::uint64_t entry : old)
+      if (entry)
+        index(entry, static_cast<std::uint32_t>((entry & 0xFFFFFFFFu) - 1));
+  }
+  // the slot follows the high half, the part kept in the table
+  const std::uint64_t tag = key >> 32;
+  const std::size_t mask = covered.size() - 1;
+  std::size_t slot = tag & mask;
+  while (covered[slot])
+    slot = (slot + 1) & mask;
+  covered[slot] = tag << 32 | (tuple + 1u);
+  coveredEntries++;
+}
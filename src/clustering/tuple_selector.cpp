@@ -0,0 +1,214 @@
+#include "clustering/tuple_selector.hpp"
+#include "utils/Counters.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Improvements and bounds closer than this are treated as ties
+constexpr double kEps = 1e-9;
+
+} // namespace
+
+ExclusiveTupleSelector::ExclusiveTupleSelector(
+    const std::vector<TransferTuple> &tuples, TupleScore score)
+    : tuples(tuples) {
+  for (const auto &tuple : tuples)
+    weight.push_back(tuple.score(score));
+
+  // weight descending, larger tuples first on ties (as the greedy always did)
+  order.resize(tuples.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this, &tuples](int a, int b) {
+    if (weight[a] != weight[b])
+      return weight[a] > weight[b];
+    size_t sizeA = tuples[a].surplusStationIndices.size() +
+                   tuples[a].deficitStationIndices.size();
+    size_t sizeB = tuples[b].surplusStationIndices.size() +
+                   tuples[b].deficitStationIndices.size();
+    if (sizeA != sizeB)
+      return sizeA > sizeB;
+    return a < b;
+  });
+
+  // map station indices to dense local ids for the bitset
+  std::vector<int> ids;
+  for (const auto &tuple : tuples) {
+    ids.insert(ids.end(), tuple.surplusStationIndices.begin(),
+               tuple.surplusStationIndices.end());
+    ids.insert(ids.end(), tuple.deficitStationIndices.begin(),
+               tuple.deficitStationIndices.end());
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  auto localId = [&ids](int station) {
+    return static_cast<int>(std::lower_bound(ids.begin(), ids.end(), station) -
+                            ids.begin());
+  };
+  offset.push_back(0);
+  for (const auto &tuple : tuples) {
+    for (int sid : tuple.surplusStationIndices)
+      stations.push_back(localId(sid));
+    for (int did : tuple.deficitStationIndices)
+      stations.push_back(localId(did));
+    offset.push_back(static_cast<int>(stations.size()));
+  }
+  used.assign((ids.size() + 63) / 64, 0);
+
+  // A station can serve a single selected tuple, so giving every station the
+  // best per-station share w / |t| of any tuple containing it bounds the
+  // value of every packing.
+  std::vector<double> share(ids.size(), 0.0);
+  for (size_t t = 0; t < tuples.size(); ++t) {
+    int size = offset[t + 1] - offset[t];
+    if (weight[t] <= 0 || size == 0)
+      continue;
+    double perStation = weight[t] / size;
+    for (int k = offset[t]; k < offset[t + 1]; ++k)
+      share[stations[k]] = std::max(share[stations[k]], perStation);
+  }
+  totalShare = std::accumulate(share.begin(), share.end(), 0.0);
+  tupleShare.assign(tuples.size(), 0.0);
+  for (size_t t = 0; t < tuples.size(); ++t)
+    for (int k = offset[t]; k < offset[t + 1]; ++k)
+      tupleShare[t] += share[stations[k]];
+
+  suffixValue.assign(order.size() + 1, 0.0);
+  for (int pos = static_cast<int>(order.size()) - 1; pos >= 0; --pos)
+    suffixValue[pos] =
+        suffixValue[pos + 1] + std::max(0.0, weight[order[pos]]);
+}
+
+bool ExclusiveTupleSelector::conflicts(int tuple) const {
+  for (int k = offset[tuple]; k < offset[tuple + 1]; ++k) {
+    int id = stations[k];
+    if (used[id >> 6] >> (id & 63) & 1)
+      return true;
+  }
+  return false;
+}
+
+void ExclusiveTupleSelector::occupy(int tuple, bool value) {
+  for (int k = offset[tuple]; k < offset[tuple + 1]; ++k) {
+    int id = stations[k];
+    if (value)
+      used[id >> 6] |= std::uint64_t{1} << (id & 63);
+    else
+      used[id >> 6] &= ~(std::uint64_t{1} << (id & 63));
+  }
+}
+
+SelectionResult
+ExclusiveTupleSelector::select(const SelectionOptions &options) {
+  timer = Timer();
+  this->options = &options;
+
+  // greedy pass, also the incumbent of the exact search
+  std::fill(used.begin(), used.end(), 0);
+  best.clear();
+  bestValue = 0.0;
+  conflictCount = 0;
+  for (int t : order) {
+    if (conflicts(t)) {
+      conflictCount++;
+      continue;
+    }
+    occupy(t, true);
+    best.push_back(t);
+    bestValue += weight[t];
+  }
+  const double rootBound =
+      std::max(bestValue, std::min(suffixValue[0], totalShare));
+  if (options.onImprovement)
+    options.onImprovement(makeResult(best, rootBound));
+
+  if (options.strategy == SelectionStrategy::GREEDY) {
+    SelectionResult result = makeResult(best, rootBound);
+    result.provedOptimal = bestValue >= rootBound - kEps;
+    Counters::add(Counter::SELECTION_CONFLICTS, conflictCount);
+    return result;
+  }
+
+  std::fill(used.begin(), used.end(), 0);
+  chosen.clear();
+  openBound = 0.0;
+  timedOut = false;
+  nodes = 0;
+  search(0, 0.0, 0.0);
+
+  double upperBound =
+      timedOut ? std::max(bestValue, std::min(openBound, rootBound))
+               : bestValue;
+  SelectionResult result = makeResult(best, upperBound);
+  result.provedOptimal = !timedOut;
+  result.nodesExplored = nodes;
+  Counters::add(Counter::SELECTION_CONFLICTS, conflictCount);
+  return result;
+}
+
+void ExclusiveTupleSelector::search(int pos, double value, double share) {
+  const int count = static_cast<int>(order.size());
+  // The include branch recurses (depth is bounded by the number of disjoint
+  // tuples); the exclude branch continues this loop.
+  for (;; ++pos) {
+    nodes++;
+    for (; pos < count; ++pos) {
+      if (weight[order[pos]] <= 0)
+        continue;
+      if (!conflicts(order[pos]))
+        break;
+      conflictCount++;
+    }
+    if (pos == count)
+      return;
+
+    double bound = value + std::min(suffixValue[pos], totalShare - share);
+    if (bound <= bestValue + kEps)
+      return;
+    if (timedOut ||
+        ((nodes & 255) == 0 && timer.elapsed() > options->timeLimitSeconds)) {
+      timedOut = true;
+      openBound = std::max(openBound, bound);
+      return;
+    }
+
+    // include order[pos] first: the leftmost path is the greedy selection
+    int t = order[pos];
+    occupy(t, true);
+    chosen.push_back(t);
+    double included = value + weight[t];
+    if (included > bestValue + kEps)
+      record(included);
+    search(pos + 1, included, share + tupleShare[t]);
+    chosen.pop_back();
+    occupy(t, false);
+  }
+}
+
+void ExclusiveTupleSelector::record(double value) {
+  best = chosen;
+  bestValue = value;
+  if (options->onImprovement) {
+    double rootBound = std::min(suffixValue[0], totalShare);
+    options->onImprovement(makeResult(best, std::max(value, rootBound)));
+  }
+}
+
+SelectionResult
+ExclusiveTupleSelector::makeResult(const std::vector<int> &picked,
+                                   double upperBound) const {
+  SelectionResult result;
+  for (int t : picked) {
+    result.selected.push_back(tuples[t]);
+    result.totalDeltaUDF += tuples[t].deltaUDF;
+    result.totalScore += weight[t];
+  }
+  result.upperBound = upperBound;
+  result.gap = upperBound > 0
+                   ? std::max(0.0, upperBound - result.totalScore) /
+                         upperBound
+                   : 0.0;
+  result.nodesExplored = nodes;
+  result.conflicts = conflictCount;
+  return result;
+}
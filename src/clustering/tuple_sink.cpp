@@ -0,0 +1,48 @@
+#include "clustering/tuple_sink.hpp"
+#include <algorithm>
+#include <limits>
+
+TopKTupleSink::TopKTupleSink(std::size_t k, TupleScore score)
+    : k(k), score(score) {
+  heap.reserve(k);
+}
+
+// min-heap on the score: heap.front() is the weakest kept tuple
+bool TopKTupleSink::weaker(const TransferTuple &a,
+                           const TransferTuple &b) const {
+  return a.score(score) > b.score(score);
+}
+
+bool TopKTupleSink::accept(const TransferTuple &tuple) {
+  seen++;
+  if (k == 0)
+    return true;
+  if (heap.size() < k) {
+    heap.push_back(tuple);
+    std::push_heap(heap.begin(), heap.end(), cmp());
+    return true;
+  }
+  if (tuple.score(score) <= heap.front().score(score))
+    return true;
+  std::pop_heap(heap.begin(), heap.end(), cmp());
+  heap.back() = tuple;
+  std::push_heap(heap.begin(), heap.end(), cmp());
+  return true;
+}
+
+double TopKTupleSink::threshold() const {
+  if (k == 0)
+    return std::numeric_limits<double>::infinity();
+  // the search bounds deltaUDF only, so a rate ranking cannot prune
+  if (score != TupleScore::DELTA_UDF)
+    return 0.0;
+  return heap.size() < k ? 0.0 : std::max(0.0, heap.front().deltaUDF);
+}
+
+std::vector<TransferTuple> TopKTupleSink::take() {
+  std::sort_heap(heap.begin(), heap.end(), cmp());
+  std::vector<TransferTuple> tuples;
+  tuples.swap(heap);
+  heap.reserve(k);
+  return tuples;
+}
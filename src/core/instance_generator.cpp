@@ -0,0 +1,121 @@
+#include "core/instance_generator.hpp"
+#include "utils/Random.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr int kReferenceStations = 2109; // data/results.csv
+constexpr double kPi = 3.14159265358979323846;
+
+std::string hexId(RandomEngine &rng) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string id(32, '0');
+  for (int half = 0; half < 2; ++half) {
+    std::uint64_t bits = rng();
+    for (int i = 0; i < 16; ++i, bits >>= 4)
+      id[half * 16 + i] = kDigits[bits & 15];
+  }
+  return id;
+}
+
+void validate(const InstanceGeneratorOptions &options) {
+  if (options.stations < 1)
+    throw std::invalid_argument("generateStations: stations must be >= 1");
+  if (options.minCapacity < 2 || options.minCapacity > options.maxCapacity)
+    throw std::invalid_argument(
+        "generateStations: need 2 <= minCapacity <= maxCapacity");
+  if (options.surplusShare < 0 || options.deficitShare < 0 ||
+      options.surplusShare + options.deficitShare > 1)
+    throw std::invalid_argument(
+        "generateStations: surplus and deficit shares must sum to <= 1");
+  if (options.hotspotShare < 0 || options.hotspotShare > 1)
+    throw std::invalid_argument(
+        "generateStations: hotspotShare must be in [0, 1]");
+  if (options.minLatitude > options.maxLatitude ||
+      options.minLongitude > options.maxLongitude)
+    throw std::invalid_argument("generateStations: empty bounding box");
+}
+
+} // namespace
+
+std::vector<Station> generateStations(const InstanceGeneratorOptions &options) {
+  validate(options);
+  RandomEngine rng(options.seed);
+
+  double minLat = options.minLatitude, maxLat = options.maxLatitude;
+  double minLon = options.minLongitude, maxLon = options.maxLongitude;
+  if (options.scaleArea) {
+    const double scale =
+        std::sqrt(static_cast<double>(options.stations) / kReferenceStations);
+    const double midLat = (minLat + maxLat) / 2, midLon = (minLon + maxLon) / 2;
+    const double halfLat = (maxLat - minLat) / 2 * scale;
+    const double halfLon = (maxLon - minLon) / 2 * scale;
+    minLat = midLat - halfLat, maxLat = midLat + halfLat;
+    minLon = midLon - halfLon, maxLon = midLon + halfLon;
+  }
+  // a degree of longitude is shorter than one of latitude
+  const double lonStretch = 1.0 / std::cos((minLat + maxLat) / 2 * kPi / 180);
+
+  const int hotspotCount = options.hotspots > 0
+                               ? options.hotspots
+                               : std::max(1, options.stations / 100);
+  std::vector<Coordinate> hotspots;
+  for (int h = 0; h < hotspotCount; ++h)
+    hotspots.emplace_back(rng.uniform(minLat, maxLat),
+                          rng.uniform(minLon, maxLon));
+
+  std::vector<Station> stations;
+  stations.reserve(options.stations);
+  for (int i = 1; i <= options.stations; ++i) {
+    double lat, lon;
+    if (rng.uniform() < options.hotspotShare) {
+      const Coordinate &centre = hotspots[rng.below(hotspots.size())];
+      lat = centre.latitude + options.hotspotRadius * rng.normal();
+      lon = centre.longitude +
+            options.hotspotRadius * lonStretch * rng.normal();
+      lat = std::clamp(lat, minLat, maxLat);
+      lon = std::clamp(lon, minLon, maxLon);
+    } else {
+      lat = rng.uniform(minLat, maxLat);
+      lon = rng.uniform(minLon, maxLon);
+    }
+
+    const int capacity = std::clamp(
+        static_cast<int>(std::lround(
+            options.medianCapacity *
+            std::exp(options.capacitySpread * rng.normal()))),
+        options.minCapacity, options.maxCapacity);
+    const int optimal =
+        std::clamp(rng.between(static_cast<int>(0.2 * capacity),
+                               static_cast<int>(0.8 * capacity)),
+                   1, capacity - 1);
+    const double status = rng.uniform();
+    int current = optimal;
+    if (status < options.surplusShare)
+      current = rng.between(optimal + 1, capacity);
+    else if (status < options.surplusShare + options.deficitShare)
+      current = rng.between(0, optimal - 1);
+
+    // each side a power > 1 of the distance from the optimum, rising to
+    // the end of the range, so the curve is convex with its minimum there
+    const double minimum = rng.uniform(0.1, 0.6) * capacity;
+    const double riseEmpty = rng.uniform(0.1, 1.0) * options.udfRise * capacity;
+    const double riseFull = rng.uniform(0.1, 1.0) * options.udfRise * capacity;
+    const double power = rng.uniform(1.5, 3.0);
+    auto rise = [&](double height, int distance, int range) {
+      return height * std::pow(static_cast<double>(distance) / range, power);
+    };
+    std::vector<double> udf(capacity + 1);
+    for (int x = 0; x <= capacity; ++x)
+      udf[x] = minimum + (x < optimal ? rise(riseEmpty, optimal - x, optimal)
+                                      : rise(riseFull, x - optimal,
+                                             capacity - optimal));
+
+    stations.emplace_back(hexId(rng), i, Coordinate(lat, lon), capacity,
+                          current, optimal, udf);
+  }
+  return stations;
+}
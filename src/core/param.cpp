@@ -1,6 +1,7 @@
 #include "core/param.hpp"
 
 Param::Param(double tLoad, double alpha, double beta, int numOfStations,
-             int numOfClusters, int numOfVehicles)
+             int numOfClusters, int numOfVehicles, int vehicleCapacity)
     : tLoad(tLoad), alpha(alpha), beta(beta), numOfStations(numOfStations),
-      numOfClusters(numOfClusters), numOfVehicles(numOfVehicles) {}
+      numOfClusters(numOfClusters), numOfVehicles(numOfVehicles),
+      vehicleCapacity(vehicleCapacity) {}
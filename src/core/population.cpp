@@ -0,0 +1,18 @@
+#include "core/population.hpp"
+#include <algorithm>
+
+Population::Population(int slots, int genomeSize)
+    : genomeSize(genomeSize), pool(static_cast<size_t>(slots) * genomeSize),
+      scratch(slots) {
+  individuals.reserve(slots);
+  for (int slot = 0; slot < slots; ++slot)
+    individuals.emplace_back(
+        pool.data() + static_cast<size_t>(slot) * genomeSize, genomeSize);
+}
+
+void Population::reorder(const std::vector<int> &order) {
+  for (size_t slot = 0; slot < order.size(); ++slot)
+    scratch[slot] = individuals[order[slot]];
+  std::copy(scratch.begin(), scratch.begin() + order.size(),
+            individuals.begin());
+}
@@ -1,10 +1,14 @@
 #include "core/problem.hpp"
+#include "core/station_io.hpp"
+#include "utils/Profiler.hpp"
 #include <curl/curl.h>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <nlohmann/json.hpp>
 #include <sstream>
+#include <stdexcept>
+#include <utility>
 
 // Forward declaration
 void saveMatrixToFile(const std::vector<Station> &stations,
@@ -50,81 +54,21 @@ void parseResponse(const std::string &response,
 }
 
 ProblemInstance::ProblemInstance(const std::string &filename) {
-  // TODO: Implement station loading logic
-  std::ifstream file(filename);
-  std::string line;
-
-  // Skip header line
-  std::getline(file, line);
-  int stationId = 1;
-  std::cout << "Loading station information..." << std::endl;
-  while (std::getline(file, line)) {
-    std::stringstream ss(line);
-    std::string field;
-
-    // Parse CSV fields
-    std::string sysId;
-    std::string name;
-    double latitude;
-    double longitude;
-    int capacity;
-    int currentInventory;
-    int optimalInventory;
-    double minUdf;
-    std::vector<double> udfValues;
-
-    // Read fields
-    std::getline(ss, sysId, ',');
-    std::getline(ss, name, ',');
-    ss >> latitude;
-    ss.ignore(); // Skip comma
-    ss >> longitude;
-    ss.ignore();
-    ss >> capacity;
-    ss.ignore();
-    ss >> currentInventory;
-    ss.ignore();
-    ss >> optimalInventory;
-    ss.ignore();
-    ss >> minUdf;
-    ss.ignore();
-
-    // Read UDF values, the UDF value list should be indexed from 0 to the
-    // capacity, read the value one by one until the capacity is reached
-    for (int i = 0; i < capacity; i++) {
-      double udfValue;
-      ss >> udfValue;
-      udfValues.push_back(udfValue);
-      ss.ignore();
-    }
-
-    // Create station and add to vector
-    Station station(sysId, stationId, Coordinate(latitude, longitude), capacity,
-                    currentInventory, optimalInventory, udfValues);
-    stations.push_back(station);
-    stationId++;
+  PROFILE_SCOPE("load");
+  std::ifstream file(filename, std::ios::binary);
+  if (isStationsBinary(file)) {
+    std::cout << "Loading binary station file..." << std::endl;
+    stations = readStationsBinary(file);
+  } else {
+    std::cout << "Loading station information..." << std::endl;
+    stations = readStationsCsv(file);
   }
 
   std::cout << "Computing Station Centroid..." << std::endl;
-
-  //   Compute the centroid of the network, then add this as the 0th station
-  //   to the vector with sys_id being "depot", capacity/inventory/optimal all
-  //   set to infinity
-  double totalLatitude = 0.0;
-  double totalLongitude = 0.0;
-  for (const auto &station : stations) {
-    totalLatitude += station.getCoordinate().latitude;
-    totalLongitude += station.getCoordinate().longitude;
-  }
-  double centroidLatitude = totalLatitude / stations.size();
-  double centroidLongitude = totalLongitude / stations.size();
-  Station depot("depot", 0, Coordinate(centroidLatitude, centroidLongitude),
-                std::numeric_limits<int>::max(),
-                std::numeric_limits<int>::max(),
-                std::numeric_limits<int>::max(), std::vector<double>());
-  stations.insert(stations.begin(), depot);
+  addDepot();
 
   std::cout << "Computing Duration Matrix..." << std::endl;
+  PROFILE_SCOPE("time matrix");
 
   /**
   // Process in chunks of 25 stations (OSRM's safe limit)
@@ -204,45 +148,107 @@ ProblemInstance::ProblemInstance(const std::string &filename) {
   std::cout << "Time matrix computation completed" << std::endl;
 **/
   // use euclidean distance for now, assuming the truck speed is 25.2km/h
-  // Initialize time matrix
-  timeMatrix.resize(stations.size(), std::vector<double>(stations.size(), 0.0));
 
-  // Try to load existing matrix if available
+  // Try to load existing matrix if available; one saved for another
+  // network is rebuilt
   std::ifstream matrixFile("time_matrix.csv");
   if (matrixFile.is_open()) {
     std::cout << "Loading existing time matrix..." << std::endl;
-    std::string line;
-    // Skip header
-    std::getline(matrixFile, line);
-
-    for (size_t i = 0; i < stations.size(); ++i) {
-      std::getline(matrixFile, line);
-      std::stringstream ss(line);
-      std::string stationId;
-      std::getline(ss, stationId, ',');
-
-      for (size_t j = 0; j < stations.size(); ++j) {
-        std::string value;
-        std::getline(ss, value, ',');
-        if (!value.empty()) {
-          timeMatrix[i][j] = std::stod(value);
-        }
-      }
+    try {
+      timeMatrix = readTimeMatrix(matrixFile, stations);
+      std::cout << "Existing matrix loaded" << std::endl;
+    } catch (const std::runtime_error &e) {
+      std::cout << "Existing matrix does not match: " << e.what()
+                << std::endl;
     }
-    std::cout << "Existing matrix loaded" << std::endl;
-  } else {
-    for (size_t i = 0; i < stations.size(); ++i) {
-      for (size_t j = 0; j < stations.size(); ++j) {
-        std::cout << "Computing distance between "
-                  << stations[i].getCoordinate().latitude << " and "
-                  << stations[j].getCoordinate().longitude << std::endl;
-        timeMatrix[i][j] = euclideanDistance(stations[i].getCoordinate(),
-                                             stations[j].getCoordinate()) /
-                           25.2;
+  }
+  if (timeMatrix.empty()) {
+    std::cout << "Computing Euclidean time matrix..." << std::endl;
+    timeMatrix = computeTimeMatrix(stations);
+    saveMatrixToFile(stations, timeMatrix);
+  }
+}
+
+std::vector<std::vector<double>>
+ProblemInstance::readTimeMatrix(std::istream &in,
+                                const std::vector<Station> &stations) {
+  const size_t size = stations.size();
+  std::vector<std::vector<double>> matrix(size,
+                                          std::vector<double>(size, 0.0));
+  std::string line, cell;
+  // header: the station ids, in order
+  std::getline(in, line);
+  std::stringstream header(line);
+  std::getline(header, cell, ',');
+  for (size_t j = 0; j < size; ++j)
+    if (!std::getline(header, cell, ',') || cell != stations[j].getSysId())
+      throw std::runtime_error("time matrix column " + std::to_string(j) +
+                               " is not station " + stations[j].getSysId());
+  if (std::getline(header, cell, ','))
+    throw std::runtime_error("time matrix has more than " +
+                             std::to_string(size) + " columns");
+
+  for (size_t i = 0; i < size; ++i) {
+    std::string stationId;
+    if (!std::getline(in, line))
+      throw std::runtime_error("time matrix has " + std::to_string(i) +
+                               " rows, not " + std::to_string(size));
+    std::stringstream ss(line);
+    std::getline(ss, stationId, ',');
+    if (stationId != stations[i].getSysId())
+      throw std::runtime_error("time matrix row " + std::to_string(i) +
+                               " is not station " + stations[i].getSysId());
+
+    for (size_t j = 0; j < size; ++j) {
+      std::string value;
+      if (!std::getline(ss, value, ','))
+        throw std::runtime_error("time matrix row " + std::to_string(i) +
+                                 " is short");
+      if (!value.empty()) {
+        matrix[i][j] = std::stod(value);
       }
     }
-    saveMatrixToFile(stations, timeMatrix);
   }
+  return matrix;
+}
+
+std::vector<std::vector<double>>
+ProblemInstance::computeTimeMatrix(const std::vector<Station> &stations) {
+  std::vector<std::vector<double>> matrix(
+      stations.size(), std::vector<double>(stations.size(), 0.0));
+  for (size_t i = 0; i < stations.size(); ++i)
+    for (size_t j = 0; j < stations.size(); ++j)
+      matrix[i][j] = euclideanDistance(stations[i].getCoordinate(),
+                                       stations[j].getCoordinate()) /
+                     25.2;
+  return matrix;
+}
+
+ProblemInstance::ProblemInstance(std::vector<Station> stations,
+                                 bool buildTimeMatrix)
+    : stations(std::move(stations)) {
+  addDepot();
+  if (buildTimeMatrix)
+    timeMatrix = computeTimeMatrix(this->stations);
+}
+
+void ProblemInstance::addDepot() {
+  //   Compute the centroid of the network, then add this as the 0th station
+  //   to the vector with sys_id being "depot", capacity/inventory/optimal all
+  //   set to infinity
+  double totalLatitude = 0.0;
+  double totalLongitude = 0.0;
+  for (const auto &station : stations) {
+    totalLatitude += station.getCoordinate().latitude;
+    totalLongitude += station.getCoordinate().longitude;
+  }
+  double centroidLatitude = totalLatitude / stations.size();
+  double centroidLongitude = totalLongitude / stations.size();
+  Station depot("depot", 0, Coordinate(centroidLatitude, centroidLongitude),
+                std::numeric_limits<int>::max(),
+                std::numeric_limits<int>::max(),
+                std::numeric_limits<int>::max(), std::vector<double>());
+  stations.insert(stations.begin(), depot);
 }
 
 double euclideanDistance(const Coordinate &coord1, const Coordinate &coord2) {
@@ -257,6 +263,7 @@ void saveMatrixToFile(const std::vector<Station> &stations,
   if (!outFile.is_open()) {
     throw std::runtime_error("Failed to open time_matrix.csv for writing");
   }
+  outFile.precision(17); // a loaded matrix equals the computed one
 
   // Write header with station IDs
   outFile << "From/To";
@@ -279,6 +286,10 @@ void saveMatrixToFile(const std::vector<Station> &stations,
 
 std::vector<Station> &ProblemInstance::getStations() { return stations; }
 
+const std::vector<Station> &ProblemInstance::getStations() const {
+  return stations;
+}
+
 const std::vector<std::vector<double>> &ProblemInstance::getTimeMatrix() const {
   return timeMatrix;
 }
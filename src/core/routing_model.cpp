@@ -0,0 +1,180 @@
+#include "core/routing_model.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <numeric>
+
+namespace {
+
+constexpr int kDepot = 0;
+
+} // namespace
+
+RoutingModel::RoutingModel(const ProblemInstance &instance, const Param &param,
+                           const std::vector<TransferTuple> &tuples,
+                           const RoutingOptions &options)
+    : instance(instance), timeMatrix(instance.getTimeMatrix()), param(param),
+      options(options), tuples(tuples) {
+  const std::vector<Station> &stations = instance.getStations();
+  tupleStart.push_back(0);
+  for (size_t t = 0; t < this->tuples.size(); ++t) {
+    const TransferTuple &tuple = this->tuples[t];
+    std::map<int, int> delta; // net bikes loaded per station
+    for (const auto &entry : tuple.bikeAllocations) {
+      delta[entry.first.first] += entry.second;
+      delta[entry.first.second] -= entry.second;
+    }
+    std::vector<int> order = tuple.visitOrder;
+    if (order.empty()) {
+      order = tuple.surplusStationIndices;
+      order.insert(order.end(), tuple.deficitStationIndices.begin(),
+                   tuple.deficitStationIndices.end());
+    }
+    for (int station : order) {
+      int quantity = delta[station];
+      if (quantity == 0)
+        continue;
+      const Station &s = stations[station];
+      int inventory = s.getCurrentInventory();
+      double reduction =
+          s.getUdfAt(inventory) - s.getUdfAt(inventory - quantity);
+      stops.push_back({station, quantity, static_cast<int>(t), reduction});
+    }
+    tupleStart.push_back(static_cast<int>(stops.size()));
+    tuplePickups.push_back(static_cast<int>(std::count_if(
+        stops.begin() + tupleStart[t], stops.end(),
+        [](const Stop &stop) { return stop.quantity > 0; })));
+  }
+}
+
+double RoutingModel::serviceTime(int stop) const {
+  return param.tLoad * std::abs(stops[stop].quantity);
+}
+
+std::vector<int> RoutingModel::tupleOrderTour() const {
+  std::vector<int> order(tuples.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+    return tuples[a].deltaUDF > tuples[b].deltaUDF;
+  });
+  std::vector<int> tour;
+  tour.reserve(stops.size());
+  for (int t : order)
+    for (int stop = tupleStart[t]; stop < tupleStart[t + 1]; ++stop)
+      tour.push_back(stop);
+  return tour;
+}
+
+RouteEvaluation RoutingModel::split(const int *tour, int size,
+                                    int *routeOf) const {
+  const int capacity = param.vehicleCapacity;
+  const double limit = options.routeTimeLimit;
+  RouteEvaluation result;
+
+  int route = 0, load = 0, last = kDepot;
+  double time = 0.0; // open route so far, without the way back
+  bool open = false;
+  auto close = [&]() {
+    result.duration += time + timeMatrix[last][kDepot];
+    route++;
+    open = false;
+  };
+
+  // tuplePrecedence: pickups of each tuple served in route pickupRoute[t]
+  // (per thread, so concurrent splits of a shared model do not interfere)
+  thread_local std::vector<int> pickupRoute, pickupsServed;
+  const bool precedence = options.tuplePrecedence;
+  if (precedence) {
+    pickupRoute.assign(tuples.size(), -1);
+    pickupsServed.assign(tuples.size(), 0);
+  }
+  auto dropReady = [&](const Stop &stop, int inRoute) {
+    return !precedence || tuplePickups[stop.tuple] == 0 ||
+           (pickupRoute[stop.tuple] == inRoute &&
+            pickupsServed[stop.tuple] == tuplePickups[stop.tuple]);
+  };
+  auto served = [&](int id, const Stop &stop) {
+    result.deltaUDF += stop.deltaUDF;
+    if (routeOf)
+      routeOf[id] = route;
+    if (precedence && stop.quantity > 0) {
+      if (pickupRoute[stop.tuple] != route) {
+        pickupRoute[stop.tuple] = route;
+        pickupsServed[stop.tuple] = 0;
+      }
+      pickupsServed[stop.tuple]++;
+    }
+  };
+
+  for (int k = 0; k < size; ++k) {
+    const int id = tour[k];
+    const Stop &stop = stops[id];
+    const double service = param.tLoad * std::abs(stop.quantity);
+    if (routeOf)
+      routeOf[id] = -1;
+
+    if (open) {
+      int newLoad = load + stop.quantity;
+      double newTime = time + timeMatrix[last][stop.station] + service;
+      // not enough bikes on board, or the drop's own pickups are missing
+      if (newLoad < 0 || (stop.quantity < 0 && !dropReady(stop, route))) {
+        result.unserved++;
+        continue;
+      }
+      if (newLoad <= capacity &&
+          newTime + timeMatrix[stop.station][kDepot] <= limit) {
+        load = newLoad;
+        time = newTime;
+        last = stop.station;
+        served(id, stop);
+        continue;
+      }
+      close();
+    }
+
+    // open the next vehicle with this stop
+    double newTime = timeMatrix[kDepot][stop.station] + service;
+    if (route >= param.numOfVehicles || stop.quantity < 0 ||
+        stop.quantity > capacity ||
+        newTime + timeMatrix[stop.station][kDepot] > limit) {
+      result.unserved++;
+      continue;
+    }
+    open = true;
+    load = stop.quantity;
+    time = newTime;
+    last = stop.station;
+    served(id, stop);
+  }
+  if (open)
+    close();
+
+  result.routes = route;
+  result.objective = result.deltaUDF - options.timeWeight * result.duration;
+  return result;
+}
+
+RoutingPlan RoutingModel::decode(const std::vector<int> &tour) const {
+  RoutingPlan plan;
+  std::vector<int> routeOf(stops.size(), -1);
+  plan.evaluation = split(tour.data(), (int)tour.size(), routeOf.data());
+  plan.routes.resize(plan.evaluation.routes);
+  for (int id : tour) {
+    if (routeOf[id] < 0)
+      plan.unserved.push_back(id);
+    else
+      plan.routes[routeOf[id]].push_back(id);
+  }
+  return plan;
+}
+
+Solution RoutingModel::toSolution(const RoutingPlan &plan) const {
+  Solution solution(instance, param);
+  for (const auto &route : plan.routes) {
+    int r = solution.addRoute();
+    for (int id : route)
+      solution.insertVisit(r, solution.getRouteSize(r), stops[id].station,
+                           stops[id].quantity);
+  }
+  return solution;
+}
@@ -0,0 +1,216 @@
+#include "core/solution.hpp"
+#include "utils/BinaryIO.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using namespace BinaryIO;
+
+constexpr int kDepot = 0;
+constexpr char kMagic[4] = {'B', 'R', 'P', 'S'};
+constexpr std::uint32_t kVersion = 1;
+constexpr const char *kReader = "Solution::load";
+
+} // namespace
+
+Solution::Solution(const ProblemInstance &instance, const Param &param)
+    : instance(&instance), param(&param) {}
+
+Solution::Solution(const Solution &other)
+    : instance(other.instance), param(other.param) {
+  other.evaluateAll();
+  routes = other.routes;
+  evaluations = other.evaluations;
+}
+
+Solution &Solution::operator=(const Solution &other) {
+  if (this != &other) {
+    other.evaluateAll();
+    instance = other.instance;
+    param = other.param;
+    routes = other.routes;
+    evaluations = other.evaluations;
+  }
+  return *this;
+}
+
+int Solution::addRoute() {
+  routes.push_back(std::make_shared<Route>());
+  return getNumRoutes() - 1;
+}
+
+void Solution::removeRoute(int route) {
+  if (route < 0 || route >= getNumRoutes())
+    throw std::out_of_range("Solution: no route " + std::to_string(route));
+  routes.erase(routes.begin() + route);
+}
+
+int Solution::getRouteSize(int route) const {
+  return static_cast<int>(read(route).stations.size());
+}
+
+const std::vector<int> &Solution::getStations(int route) const {
+  return read(route).stations;
+}
+
+const std::vector<int> &Solution::getQuantities(int route) const {
+  return read(route).quantities;
+}
+
+void Solution::insertVisit(int route, int pos, int station, int quantity) {
+  if (station <= kDepot || station >= (int)instance->getStations().size())
+    throw std::invalid_argument("Solution: no station " +
+                                std::to_string(station));
+  Route &r = write(route);
+  if (pos < 0 || pos > (int)r.stations.size())
+    throw std::out_of_range("Solution: no position " + std::to_string(pos));
+  r.stations.insert(r.stations.begin() + pos, station);
+  r.quantities.insert(r.quantities.begin() + pos, quantity);
+}
+
+void Solution::eraseVisit(int route, int pos) {
+  Route &r = write(route);
+  if (pos < 0 || pos >= (int)r.stations.size())
+    throw std::out_of_range("Solution: no position " + std::to_string(pos));
+  r.stations.erase(r.stations.begin() + pos);
+  r.quantities.erase(r.quantities.begin() + pos);
+}
+
+void Solution::setQuantity(int route, int pos, int quantity) {
+  Route &r = write(route);
+  if (pos < 0 || pos >= (int)r.quantities.size())
+    throw std::out_of_range("Solution: no position " + std::to_string(pos));
+  r.quantities[pos] = quantity;
+}
+
+const std::vector<int> &Solution::getLoads(int route) const {
+  return read(route).loads;
+}
+
+double Solution::getDuration(int route) const {
+  return read(route).duration;
+}
+
+double Solution::getDeltaUDF(int route) const {
+  return read(route).deltaUDF;
+}
+
+bool Solution::isFeasible(int route) const { return read(route).feasible; }
+
+double Solution::getTotalDuration() const {
+  double total = 0.0;
+  for (int r = 0; r < getNumRoutes(); ++r)
+    total += getDuration(r);
+  return total;
+}
+
+double Solution::getTotalDeltaUDF() const {
+  double total = 0.0;
+  for (int r = 0; r < getNumRoutes(); ++r)
+    total += getDeltaUDF(r);
+  return total;
+}
+
+bool Solution::isFeasible() const {
+  for (int r = 0; r < getNumRoutes(); ++r)
+    if (!isFeasible(r))
+      return false;
+  return true;
+}
+
+const Solution::Route &Solution::read(int route) const {
+  if (route < 0 || route >= getNumRoutes())
+    throw std::out_of_range("Solution: no route " + std::to_string(route));
+  Route &r = *routes[route];
+  if (r.dirty)
+    evaluate(r);
+  return r;
+}
+
+Solution::Route &Solution::write(int route) {
+  if (route < 0 || route >= getNumRoutes())
+    throw std::out_of_range("Solution: no route " + std::to_string(route));
+  std::shared_ptr<Route> &r = routes[route];
+  if (r.use_count() > 1)
+    r = std::make_shared<Route>(*r);
+  r->dirty = true;
+  return *r;
+}
+
+void Solution::evaluate(Route &route) const {
+  const std::vector<Station> &stations = instance->getStations();
+  const std::vector<std::vector<double>> &time = instance->getTimeMatrix();
+  const int n = static_cast<int>(route.stations.size());
+  route.loads.resize(n);
+  route.duration = 0.0;
+  route.deltaUDF = 0.0;
+  route.feasible = true;
+  int load = 0, last = kDepot;
+  for (int k = 0; k < n; ++k) {
+    const int station = route.stations[k], quantity = route.quantities[k];
+    load += quantity;
+    route.loads[k] = load;
+    route.feasible &= load >= 0 && load <= param->vehicleCapacity;
+    route.duration += time[last][station] + param->tLoad * std::abs(quantity);
+    const Station &s = stations[station];
+    int inventory = s.getCurrentInventory();
+    route.deltaUDF += s.getUdfAt(inventory) - s.getUdfAt(inventory - quantity);
+    last = station;
+  }
+  if (n > 0)
+    route.duration += time[last][kDepot];
+  route.dirty = false;
+  evaluations++;
+}
+
+void Solution::evaluateAll() const {
+  for (const auto &route : routes)
+    if (route->dirty)
+      evaluate(*route);
+}
+
+void Solution::save(std::ostream &out) const {
+  out.write(kMagic, sizeof(kMagic));
+  writeVarint(out, kVersion);
+  writeVarint(out, routes.size());
+  for (const auto &route : routes) {
+    writeVarint(out, route->stations.size());
+    for (size_t k = 0; k < route->stations.size(); ++k) {
+      writeVarint(out, route->stations[k]);
+      writeSigned(out, route->quantities[k]);
+    }
+  }
+}
+
+Solution Solution::load(std::istream &in, const ProblemInstance &instance,
+                        const Param &param) {
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), kMagic))
+    throw std::runtime_error("Solution::load: not a solution checkpoint");
+  if (readVarint(in, kReader) != kVersion)
+    throw std::runtime_error("Solution::load: unsupported version");
+
+  Solution solution(instance, param);
+  std::uint64_t numRoutes = readVarint(in, kReader);
+  for (std::uint64_t r = 0; r < numRoutes; ++r) {
+    int route = solution.addRoute();
+    std::uint64_t size = readVarint(in, kReader);
+    for (std::uint64_t k = 0; k < size; ++k) {
+      std::uint64_t station = readVarint(in, kReader);
+      std::int64_t quantity = readSigned(in, kReader);
+      if (station > static_cast<std::uint64_t>(INT32_MAX))
+        throw std::invalid_argument("Solution::load: station out of range");
+      solution.insertVisit(route, static_cast<int>(k),
+                           static_cast<int>(station),
+                           static_cast<int>(quantity));
+    }
+  }
+  return solution;
+}
@@ -1,4 +1,5 @@
 #include "core/station.hpp"
+#include <algorithm>
 
 Station::Station(std::string sysId, int id, const Coordinate &coordinate,
                  int capacity, int currentInventory, int optimalInventory,
@@ -9,6 +10,8 @@ Station::Station(std::string sysId, int id, const Coordinate &coordinate,
 
 void Station::setBcrf(double bcrf) { this->bcrf = bcrf; }
 
+void Station::setCurrentInventory(int inv) { currentInventory = inv; }
+
 double Station::getBcrf() const { return bcrf; }
 
 int Station::getId() const { return id; }
@@ -25,6 +28,13 @@ int Station::getOptimalInventory() const { return optimalInventory; }
 
 const std::vector<double> &Station::getUdfValues() const { return udfValues; }
 
+double Station::getUdfAt(int inventory) const {
+  if (udfValues.empty())
+    return 0.0;
+  inventory = std::max(0, std::min(inventory, (int)udfValues.size() - 1));
+  return udfValues[inventory];
+}
+
 StationStatus Station::getStatus() const {
   if (currentInventory > optimalInventory) {
     return StationStatus::SURPLUS;
@@ -0,0 +1,161 @@
+#include "core/station_io.hpp"
+#include "utils/BinaryIO.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using namespace BinaryIO;
+
+constexpr char kMagic[4] = {'B', 'R', 'P', 'I'};
+constexpr std::uint32_t kVersion = 1;
+constexpr const char *kReader = "readStationsBinary";
+
+} // namespace
+
+std::vector<Station> readStationsCsv(std::istream &in) {
+  std::vector<Station> stations;
+  std::string line;
+
+  // Skip header line
+  std::getline(in, line);
+  int stationId = 1;
+  while (std::getline(in, line)) {
+    std::stringstream ss(line);
+    std::string field;
+
+    // Parse CSV fields
+    std::string sysId;
+    std::string name;
+    double latitude;
+    double longitude;
+    int capacity;
+    int currentInventory;
+    int optimalInventory;
+    double minUdf;
+    std::vector<double> udfValues;
+
+    // Read fields
+    std::getline(ss, sysId, ',');
+    std::getline(ss, name, ',');
+    ss >> latitude;
+    ss.ignore(); // Skip comma
+    ss >> longitude;
+    ss.ignore();
+    ss >> capacity;
+    ss.ignore();
+    ss >> currentInventory;
+    ss.ignore();
+    ss >> optimalInventory;
+    ss.ignore();
+    ss >> minUdf;
+    ss.ignore();
+
+    // Read UDF values, the UDF value list should be indexed from 0 to the
+    // capacity, read the value one by one until the capacity is reached
+    for (int i = 0; i <= capacity; i++) {
+      double udfValue;
+      ss >> udfValue;
+      udfValues.push_back(udfValue);
+      ss.ignore();
+    }
+
+    // Create station and add to vector
+    Station station(sysId, stationId, Coordinate(latitude, longitude), capacity,
+                    currentInventory, optimalInventory, udfValues);
+    stations.push_back(station);
+    stationId++;
+  }
+  return stations;
+}
+
+void writeStationsCsv(std::ostream &out, const std::vector<Station> &stations) {
+  std::size_t columns = 0;
+  for (const Station &station : stations)
+    columns = std::max(columns, station.getUdfValues().size());
+  out << "StationID,StationName,Latitude,Longitude,Capacity,"
+         "CurrentInventory,Optimal Inventory,Min UDF";
+  for (std::size_t i = 0; i < columns; ++i)
+    out << ",UDF(" << i << ")";
+  out << "\n";
+
+  const std::streamsize precision = out.precision(10);
+  for (const Station &station : stations) {
+    const std::vector<double> &udf = station.getUdfValues();
+    out << station.getSysId() << "," << station.getSysId() << ","
+        << station.getCoordinate().latitude << ","
+        << station.getCoordinate().longitude << "," << station.getCapacity()
+        << "," << station.getCurrentInventory() << ","
+        << station.getOptimalInventory() << ","
+        << (udf.empty() ? 0.0 : *std::min_element(udf.begin(), udf.end()));
+    for (double value : udf)
+      out << "," << value;
+    for (std::size_t i = udf.size(); i < columns; ++i)
+      out << ",";
+    out << "\n";
+  }
+  out.precision(precision);
+}
+
+void writeStationsBinary(std::ostream &out,
+                         const std::vector<Station> &stations) {
+  out.write(kMagic, sizeof(kMagic));
+  writeVarint(out, kVersion);
+  writeVarint(out, stations.size());
+  for (const Station &station : stations) {
+    writeString(out, station.getSysId());
+    writeDouble(out, station.getCoordinate().latitude);
+    writeDouble(out, station.getCoordinate().longitude);
+    writeVarint(out, station.getCapacity());
+    writeVarint(out, station.getCurrentInventory());
+    writeVarint(out, station.getOptimalInventory());
+    writeVarint(out, station.getUdfValues().size());
+    for (double value : station.getUdfValues())
+      writeDouble(out, value);
+  }
+}
+
+bool isStationsBinary(std::istream &in) {
+  char magic[sizeof(kMagic)];
+  const std::streampos start = in.tellg();
+  const bool matches = in.read(magic, sizeof(magic)) &&
+                       std::equal(magic, magic + sizeof(magic), kMagic);
+  in.clear();
+  in.seekg(start);
+  return matches;
+}
+
+std::vector<Station> readStationsBinary(std::istream &in) {
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), kMagic))
+    throw std::runtime_error("readStationsBinary: not a station file");
+  if (readVarint(in, kReader) != kVersion)
+    throw std::runtime_error("readStationsBinary: unsupported version");
+
+  const std::uint64_t count = readVarint(in, kReader);
+  std::vector<Station> stations;
+  stations.reserve(std::min<std::uint64_t>(count, 1 << 20));
+  for (std::uint64_t i = 0; i < count; ++i) {
+    const std::string sysId = readString(in, kReader);
+    const double latitude = readDouble(in, kReader);
+    const double longitude = readDouble(in, kReader);
+    const int capacity = readInt(in, kReader);
+    const int currentInventory = readInt(in, kReader);
+    const int optimalInventory = readInt(in, kReader);
+    const int udfCount = readInt(in, kReader);
+    std::vector<double> udf;
+    udf.reserve(std::min(udfCount, 4096));
+    for (int k = 0; k < udfCount; ++k)
+      udf.push_back(readDouble(in, kReader));
+    stations.emplace_back(sysId, static_cast<int>(i) + 1,
+                          Coordinate(latitude, longitude), capacity,
+                          currentInventory, optimalInventory, udf);
+  }
+  return stations;
+}
@@ -0,0 +1,546 @@
+#include "engine/AdaptiveLargeNeighborhoodSearch.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Timer.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kDepot = 0;
+// Changes smaller than this are rounding noise, not improvements
+constexpr double kEps = 1e-9;
+constexpr double kNone = -std::numeric_limits<double>::infinity();
+
+} // namespace
+
+AdaptiveLargeNeighborhoodSearch::AdaptiveLargeNeighborhoodSearch(
+    const RoutingModel &model, const AlnsOptions &options)
+    : model(model), options(options), rng(options.seed) {
+  if (options.iterations < 0 || options.timeLimitSeconds < 0 ||
+      (options.iterations == 0 && options.timeLimitSeconds == 0))
+    throw std::invalid_argument(
+        "AdaptiveLargeNeighborhoodSearch: needs iterations or a time limit");
+  if (!(options.minRemoval > 0 && options.minRemoval <= options.maxRemoval &&
+        options.maxRemoval <= 1))
+    throw std::invalid_argument(
+        "AdaptiveLargeNeighborhoodSearch: need 0 < minRemoval <= maxRemoval "
+        "<= 1");
+  if (options.regretK < 2 || options.segmentLength < 1)
+    throw std::invalid_argument("AdaptiveLargeNeighborhoodSearch: need "
+                                "regretK >= 2 and segmentLength >= 1");
+}
+
+int AdaptiveLargeNeighborhoodSearch::station(const Route &route,
+                                             int pos) const {
+  if (pos <= 0 || pos > (int)route.stops.size())
+    return kDepot;
+  return model.getStop(route.stops[pos - 1]).station;
+}
+
+void AdaptiveLargeNeighborhoodSearch::rebuild(State &state, int r) const {
+  Route &route = state.routes[r];
+  const int m = static_cast<int>(route.stops.size());
+  route.load.resize(m + 1);
+  route.suffixMin.resize(m + 2);
+  route.suffixMax.resize(m + 2);
+  route.load[0] = 0;
+  route.duration = 0.0;
+  route.deltaUDF = 0.0;
+  for (int k = 1; k <= m; ++k) {
+    const int id = route.stops[k - 1];
+    const Stop &stop = model.getStop(id);
+    route.load[k] = route.load[k - 1] + stop.quantity;
+    route.duration += model.travelTime(station(route, k - 1), stop.station) +
+                      model.serviceTime(id);
+    route.deltaUDF += stop.deltaUDF;
+    state.routeOf[id] = r;
+    state.posOf[id] = k;
+  }
+  if (m > 0)
+    route.duration += model.travelTime(station(route, m), kDepot);
+  route.suffixMin[m + 1] = INT_MAX;
+  route.suffixMax[m + 1] = INT_MIN;
+  for (int k = m; k >= 0; --k) {
+    route.suffixMin[k] = std::min(route.suffixMin[k + 1], route.load[k]);
+    route.suffixMax[k] = std::max(route.suffixMax[k + 1], route.load[k]);
+  }
+}
+
+void AdaptiveLargeNeighborhoodSearch::score(State &state) const {
+  double deltaUDF = 0.0, duration = 0.0;
+  for (const Route &route : state.routes) {
+    deltaUDF += route.deltaUDF;
+    duration += route.duration;
+  }
+  state.objective = deltaUDF - model.getOptions().timeWeight * duration;
+}
+
+bool AdaptiveLargeNeighborhoodSearch::precedenceOk(const State &state, int r,
+                                                   int after,
+                                                   int stop) const {
+  if (!model.getOptions().tuplePrecedence)
+    return true;
+  const Stop &s = model.getStop(stop);
+  for (int other = model.getTupleBegin(s.tuple);
+       other < model.getTupleEnd(s.tuple); ++other) {
+    if (other == stop)
+      continue;
+    const int quantity = model.getStop(other).quantity;
+    if (s.quantity < 0 && quantity > 0 &&
+        (state.routeOf[other] != r || state.posOf[other] > after))
+      return false; // a pickup of the tuple is missing or comes later
+    if (s.quantity > 0 && quantity < 0 && state.routeOf[other] == r &&
+        state.posOf[other] <= after)
+      return false; // a drop of the tuple would come first
+  }
+  return true;
+}
+
+AdaptiveLargeNeighborhoodSearch::Insertion
+AdaptiveLargeNeighborhoodSearch::bestInsertion(const State &state, int r,
+                                               int stop) const {
+  const Route &route = state.routes[r];
+  const Stop &s = model.getStop(stop);
+  const int capacity = model.getVehicleCapacity();
+  const double limit = model.getOptions().routeTimeLimit;
+  const double weight = model.getOptions().timeWeight;
+  const double service = model.serviceTime(stop);
+  const int m = static_cast<int>(route.stops.size());
+
+  Insertion best{kNone, -1};
+  for (int after = 0; after <= m; ++after) {
+    // O(1): the stop's own load, then everything behind it shifts
+    const int here = route.load[after] + s.quantity;
+    if (here < 0 || here > capacity)
+      continue;
+    if (after < m && (route.suffixMin[after + 1] + s.quantity < 0 ||
+                      route.suffixMax[after + 1] + s.quantity > capacity))
+      continue;
+    const int prev = station(route, after), next = station(route, after + 1);
+    const double added = model.travelTime(prev, s.station) +
+                         model.travelTime(s.station, next) -
+                         model.travelTime(prev, next) + service;
+    const double value = s.deltaUDF - weight * added;
+    if (value <= best.value || route.duration + added > limit ||
+        !precedenceOk(state, r, after, stop))
+      continue;
+    best = {value, after};
+  }
+  return best;
+}
+
+bool AdaptiveLargeNeighborhoodSearch::removable(const State &state,
+                                               int stop) const {
+  const int r = state.routeOf[stop];
+  if (r < 0)
+    return false;
+  const Route &route = state.routes[r];
+  const int p = state.posOf[stop];
+  const int m = static_cast<int>(route.stops.size());
+  const Stop &s = model.getStop(stop);
+  const int capacity = model.getVehicleCapacity();
+  if (p < m && (route.suffixMin[p + 1] - s.quantity < 0 ||
+                route.suffixMax[p + 1] - s.quantity > capacity))
+    return false;
+  // a shortcut can be longer than the detour it replaces
+  const int prev = station(route, p - 1), next = station(route, p + 1);
+  const double change = model.travelTime(prev, next) -
+                        model.travelTime(prev, s.station) -
+                        model.travelTime(s.station, next) -
+                        model.serviceTime(stop);
+  if (route.duration + change > model.getOptions().routeTimeLimit)
+    return false;
+  if (model.getOptions().tuplePrecedence && s.quantity > 0)
+    for (int other = model.getTupleBegin(s.tuple);
+         other < model.getTupleEnd(s.tuple); ++other)
+      if (model.getStop(other).quantity < 0 && state.routeOf[other] == r)
+        return false; // its drops go first
+  return true;
+}
+
+void AdaptiveLargeNeighborhoodSearch::remove(State &state, int stop) const {
+  const int r = state.routeOf[stop];
+  Route &route = state.routes[r];
+  route.stops.erase(route.stops.begin() + (state.posOf[stop] - 1));
+  state.routeOf[stop] = state.posOf[stop] = -1;
+  state.unassigned.push_back(stop);
+  rebuild(state, r);
+}
+
+void AdaptiveLargeNeighborhoodSearch::insert(State &state, int r, int after,
+                                             int stop) const {
+  Route &route = state.routes[r];
+  route.stops.insert(route.stops.begin() + after, stop);
+  rebuild(state, r);
+}
+
+int AdaptiveLargeNeighborhoodSearch::take(State &state, int stop) const {
+  int removed = 0;
+  const Stop &s = model.getStop(stop);
+  if (model.getOptions().tuplePrecedence && s.quantity > 0)
+    for (int other = model.getTupleBegin(s.tuple);
+         other < model.getTupleEnd(s.tuple); ++other)
+      if (model.getStop(other).quantity < 0 && removable(state, other)) {
+        remove(state, other);
+        removed++;
+      }
+  if (removable(state, stop)) {
+    remove(state, stop);
+    removed++;
+  }
+  return removed;
+}
+
+void AdaptiveLargeNeighborhoodSearch::randomRemoval(State &state, int count) {
+  std::vector<int> served;
+  for (int id = 0; id < model.getNumStops(); ++id)
+    if (state.routeOf[id] >= 0)
+      served.push_back(id);
+  rng.shuffle(served.begin(), served.end());
+  int removed = 0;
+  for (int id : served) {
+    if (removed >= count)
+      break;
+    if (state.routeOf[id] >= 0)
+      removed += take(state, id);
+  }
+}
+
+void AdaptiveLargeNeighborhoodSearch::relatedRemoval(State &state,
+                                                     int count) {
+  std::vector<int> served;
+  for (int id = 0; id < model.getNumStops(); ++id)
+    if (state.routeOf[id] >= 0)
+      served.push_back(id);
+  if (served.empty())
+    return;
+
+  // Shaw removal: stops close in travel time to a random seed stop
+  const int from = model.getStop(served[rng.below(served.size())]).station;
+  std::sort(served.begin(), served.end(), [&](int a, int b) {
+    double ta = model.travelTime(from, model.getStop(a).station);
+    double tb = model.travelTime(from, model.getStop(b).station);
+    return ta != tb ? ta < tb : a < b;
+  });
+  removeRanked(state, served, count);
+}
+
+void AdaptiveLargeNeighborhoodSearch::worstRemoval(State &state, int count) {
+  const double weight = model.getOptions().timeWeight;
+
+  // stops whose ΔUDF barely pays for the time they take
+  std::vector<std::pair<double, int>> worth;
+  for (int id = 0; id < model.getNumStops(); ++id) {
+    const int r = state.routeOf[id];
+    if (r < 0)
+      continue;
+    const Route &route = state.routes[r];
+    const int p = state.posOf[id];
+    const int s = model.getStop(id).station;
+    const int prev = station(route, p - 1), next = station(route, p + 1);
+    const double saved = model.travelTime(prev, s) +
+                         model.travelTime(s, next) -
+                         model.travelTime(prev, next) + model.serviceTime(id);
+    worth.emplace_back(model.getStop(id).deltaUDF - weight * saved, id);
+  }
+  std::sort(worth.begin(), worth.end());
+  std::vector<int> ranked(worth.size());
+  for (size_t k = 0; k < worth.size(); ++k)
+    ranked[k] = worth[k].second;
+  removeRanked(state, ranked, count);
+}
+
+void AdaptiveLargeNeighborhoodSearch::removeRanked(State &state,
+                                                   std::vector<int> &ranked,
+                                                   int count) {
+  int removed = 0;
+  for (int attempt = 0; removed < count && attempt < 2 * count; ++attempt) {
+    // stops taken along with their tuple's pickup have left already
+    int pick = -1;
+    while (!ranked.empty()) {
+      pick = std::min(static_cast<int>(std::pow(rng.uniform(),
+                                                options.removalPower) *
+                                       ranked.size()),
+                      static_cast<int>(ranked.size()) - 1);
+      if (state.routeOf[ranked[pick]] >= 0)
+        break;
+      ranked.erase(ranked.begin() + pick);
+      pick = -1;
+    }
+    if (pick < 0)
+      break;
+    const int stop = ranked[pick];
+    ranked.erase(ranked.begin() + pick);
+    removed += take(state, stop);
+  }
+}
+
+void AdaptiveLargeNeighborhoodSearch::reinsert(State &state,
+                                               InsertionOperator kind) {
+  const int routes = static_cast<int>(state.routes.size());
+  if (routes == 0)
+    return;
+  std::vector<int> &pending = state.unassigned;
+  std::vector<Insertion> table(pending.size() * routes);
+  for (size_t u = 0; u < pending.size(); ++u)
+    for (int r = 0; r < routes; ++r)
+      table[u * routes + r] = bestInsertion(state, r, pending[u]);
+
+  const int k = std::min(options.regretK, routes);
+  std::vector<double> values(routes);
+  while (!pending.empty()) {
+    int chosen = -1, chosenRoute = -1;
+    double chosenKey = kNone, chosenValue = kNone;
+    for (size_t u = 0; u < pending.size(); ++u) {
+      const Insertion *row = &table[u * routes];
+      int bestRoute = 0;
+      for (int r = 1; r < routes; ++r)
+        if (row[r].value > row[bestRoute].value)
+          bestRoute = r;
+      const double value = row[bestRoute].value;
+      if (!(value > kEps))
+        continue; // not worth serving, or nowhere to go
+      double key = value;
+      if (kind == InsertionOperator::REGRET) {
+        // an infeasible route counts as leaving the stop unserved (0)
+        for (int r = 0; r < routes; ++r)
+          values[r] = std::max(row[r].value, 0.0);
+        std::partial_sort(values.begin(), values.begin() + k, values.end(),
+                          std::greater<double>());
+        key = 0.0;
+        for (int h = 1; h < k; ++h)
+          key += values[0] - values[h];
+      }
+      if (key > chosenKey || (key == chosenKey && value > chosenValue)) {
+        chosen = static_cast<int>(u);
+        chosenRoute = bestRoute;
+        chosenKey = key;
+        chosenValue = value;
+      }
+    }
+    if (chosen < 0)
+      break;
+
+    const int stop = pending[chosen];
+    insert(state, chosenRoute, table[chosen * routes + chosenRoute].after,
+           stop);
+    // swap-remove the stop and its row
+    const size_t last = pending.size() - 1;
+    pending[chosen] = pending[last];
+    std::copy(table.begin() + last * routes,
+              table.begin() + (last + 1) * routes,
+              table.begin() + chosen * routes);
+    pending.pop_back();
+    table.resize(pending.size() * routes);
+    // only the changed route's column is stale
+    for (size_t u = 0; u < pending.size(); ++u)
+      table[u * routes + chosenRoute] =
+          bestInsertion(state, chosenRoute, pending[u]);
+  }
+}
+
+int AdaptiveLargeNeighborhoodSearch::roulette(const double *weights,
+                                              int count) {
+  double total = std::accumulate(weights, weights + count, 0.0);
+  double x = rng.uniform(0.0, total);
+  for (int i = 0; i < count; ++i) {
+    if (x < weights[i])
+      return i;
+    x -= weights[i];
+  }
+  return count - 1;
+}
+
+void AdaptiveLargeNeighborhoodSearch::setInitialPlan(const RoutingPlan &plan) {
+  const int n = model.getNumStops();
+  if ((int)plan.routes.size() > model.getNumVehicles())
+    throw std::invalid_argument(
+        "AdaptiveLargeNeighborhoodSearch: more routes than vehicles");
+  State state;
+  state.routes.resize(plan.routes.size());
+  state.routeOf.assign(n, -1);
+  state.posOf.assign(n, -1);
+  for (int r = 0; r < (int)plan.routes.size(); ++r) {
+    for (int id : plan.routes[r]) {
+      if (id < 0 || id >= n || state.routeOf[id] >= 0)
+        throw std::invalid_argument(
+            "AdaptiveLargeNeighborhoodSearch: bad or repeated stop");
+      state.routeOf[id] = r;
+    }
+    state.routes[r].stops = plan.routes[r];
+    rebuild(state, r);
+    const Route &route = state.routes[r];
+    bool ok = route.suffixMin[0] >= 0 &&
+              route.suffixMax[0] <= model.getVehicleCapacity() &&
+              route.duration <= model.getOptions().routeTimeLimit + kEps;
+    for (int k = 0; k < (int)route.stops.size() && ok; ++k)
+      if (model.getStop(route.stops[k]).quantity < 0)
+        ok = precedenceOk(state, r, k, route.stops[k]);
+    if (!ok)
+      throw std::invalid_argument(
+          "AdaptiveLargeNeighborhoodSearch: initial route " +
+          std::to_string(r) + " is infeasible");
+  }
+  initialPlan = plan;
+  hasInitialPlan = true;
+}
+
+RoutingPlan AdaptiveLargeNeighborhoodSearch::toPlan(const State &state) const {
+  RoutingPlan plan;
+  RouteEvaluation &evaluation = plan.evaluation;
+  for (const Route &route : state.routes) {
+    if (route.stops.empty())
+      continue;
+    plan.routes.push_back(route.stops);
+    evaluation.deltaUDF += route.deltaUDF;
+    evaluation.duration += route.duration;
+  }
+  plan.unserved = state.unassigned;
+  std::sort(plan.unserved.begin(), plan.unserved.end());
+  evaluation.routes = static_cast<int>(plan.routes.size());
+  evaluation.unserved = static_cast<int>(plan.unserved.size());
+  evaluation.objective = state.objective;
+  return plan;
+}
+
+AlnsResult AdaptiveLargeNeighborhoodSearch::run() {
+  Timer timer;
+  AlnsResult result;
+  const int n = model.getNumStops();
+
+  State current;
+  current.routes.resize(std::max(0, model.getNumVehicles()));
+  current.routeOf.assign(n, -1);
+  current.posOf.assign(n, -1);
+  for (int r = 0; r < (int)current.routes.size(); ++r) {
+    if (hasInitialPlan && r < (int)initialPlan.routes.size())
+      current.routes[r].stops = initialPlan.routes[r];
+    rebuild(current, r);
+  }
+  for (int id = 0; id < n; ++id)
+    if (current.routeOf[id] < 0)
+      current.unassigned.push_back(id);
+  reinsert(current, InsertionOperator::GREEDY);
+  score(current);
+  State best = current;
+
+  const double startTemperature =
+      options.startWorse * std::max(std::fabs(current.objective), kEps) /
+      std::log(2.0);
+  double removalWeights[3] = {1, 1, 1}, insertionWeights[2] = {1, 1};
+  double removalScores[3] = {}, insertionScores[2] = {};
+  int removalUses[3] = {}, insertionUses[2] = {};
+
+  for (int it = 0;; ++it) {
+    // share of the budget spent, for the cooling schedule
+    double progress = 0.0;
+    if (options.iterations > 0) {
+      if (it >= options.iterations)
+        break;
+      progress = static_cast<double>(it) / options.iterations;
+    }
+    if (options.timeLimitSeconds > 0) {
+      const double elapsed = timer.elapsed();
+      if (elapsed > options.timeLimitSeconds)
+        break;
+      progress = std::max(progress, elapsed / options.timeLimitSeconds);
+    }
+    const double temperature =
+        startTemperature * std::pow(options.endTemperature, progress);
+
+    const int d = roulette(removalWeights, 3);
+    const int i = roulette(insertionWeights, 2);
+    State candidate = current;
+    const int served = n - static_cast<int>(candidate.unassigned.size());
+    if (served > 0) {
+      const int low = std::max(1, (int)std::ceil(options.minRemoval * served));
+      const int high = std::max(low, (int)(options.maxRemoval * served));
+      const int count = rng.between(low, high);
+      switch (static_cast<RemovalOperator>(d)) {
+      case RemovalOperator::RANDOM:
+        randomRemoval(candidate, count);
+        break;
+      case RemovalOperator::RELATED:
+        relatedRemoval(candidate, count);
+        break;
+      case RemovalOperator::WORST:
+        worstRemoval(candidate, count);
+        break;
+      }
+    }
+    reinsert(candidate, static_cast<InsertionOperator>(i));
+    score(candidate);
+
+    double reward = 0.0;
+    bool accept = false;
+    if (candidate.objective > best.objective + kEps) {
+      reward = options.scoreNewBest;
+      accept = true;
+      result.improved++;
+    } else if (candidate.objective > current.objective + kEps) {
+      reward = options.scoreBetter;
+      accept = true;
+    } else if (candidate.objective >= current.objective - kEps) {
+      accept = true; // as good as the current solution: moves on, no reward
+    } else if (rng.uniform() <
+               std::exp((candidate.objective - current.objective) /
+                        temperature)) {
+      reward = options.scoreAccepted;
+      accept = true;
+    }
+    if (accept) {
+      current = std::move(candidate);
+      result.accepted++;
+      if (current.objective > best.objective + kEps)
+        best = current;
+    }
+    removalScores[d] += reward;
+    removalUses[d]++;
+    insertionScores[i] += reward;
+    insertionUses[i]++;
+    if ((it + 1) % options.segmentLength == 0) {
+      auto update = [&](double *weight, double *scores, int *uses, int count) {
+        for (int o = 0; o < count; ++o) {
+          if (uses[o] > 0)
+            weight[o] = (1 - options.reaction) * weight[o] +
+                        options.reaction * scores[o] / uses[o];
+          weight[o] = std::max(weight[o], 1e-3); // every operator stays
+          scores[o] = 0;
+          uses[o] = 0;
+        }
+      };
+      update(removalWeights, removalScores, removalUses, 3);
+      update(insertionWeights, insertionScores, insertionUses, 2);
+    }
+    result.trace.push_back(best.objective);
+    result.iterations++;
+  }
+
+  result.best = toPlan(best);
+  for (const auto &route : result.best.routes)
+    result.bestTour.insert(result.bestTour.end(), route.begin(), route.end());
+  result.bestTour.insert(result.bestTour.end(), result.best.unserved.begin(),
+                         result.best.unserved.end());
+  std::copy(removalWeights, removalWeights + 3, result.removalWeights.begin());
+  std::copy(insertionWeights, insertionWeights + 2,
+            result.insertionWeights.begin());
+  result.elapsedSeconds = timer.elapsed();
+  LOG_DEBUG("ALNS: " << result.iterations << " iterations, "
+                     << result.accepted << " accepted, " << result.improved
+                     << " new best, objective "
+                     << result.best.evaluation.objective << " ("
+                     << result.best.evaluation.routes << " routes, "
+                     << result.best.evaluation.unserved
+                     << " stops unserved)");
+  return result;
+}
+
+Solution AdaptiveLargeNeighborhoodSearch::solve(
+    const ProblemInstance &instance) {
+  requireInstance(instance, model.getInstance());
+  return model.toSolution(run().best);
+}
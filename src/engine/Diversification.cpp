@@ -0,0 +1,277 @@
+#include "engine/Diversification.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+std::uint64_t splitmix64(std::uint64_t &state) {
+  std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+std::uint64_t mix(std::uint64_t z) { return splitmix64(z); }
+
+} // namespace
+
+TourHash::TourHash(int numStops, std::uint64_t seed)
+    : depot(numStops), outKey(numStops + 1), inKey(numStops + 1) {
+  for (int stop = 0; stop <= numStops; ++stop) {
+    outKey[stop] = splitmix64(seed);
+    inKey[stop] = splitmix64(seed);
+  }
+}
+
+std::uint64_t TourHash::edge(int from, int to) const {
+  // non-linear in the keys, so the XOR over a tour is not a constant
+  return mix(outKey[from] ^ inKey[to]);
+}
+
+std::uint64_t TourHash::of(const int *tour, int size) const {
+  std::uint64_t h = 0;
+  int prev = depot;
+  for (int k = 0; k < size; ++k) {
+    h ^= edge(prev, tour[k]);
+    prev = tour[k];
+  }
+  return h ^ edge(prev, depot);
+}
+
+double brokenPairsDistance(const Individual &a, const Individual &b) {
+  const int n = a.getSize();
+  if (b.getSize() != n)
+    throw std::invalid_argument(
+        "brokenPairsDistance: tours of different sizes");
+  std::vector<int> successor(n + 1);
+  int prev = n;
+  for (int gene : b) {
+    successor[prev] = gene;
+    prev = gene;
+  }
+  successor[prev] = n;
+
+  int broken = 0;
+  prev = n;
+  for (int gene : a) {
+    broken += successor[prev] != gene;
+    prev = gene;
+  }
+  broken += successor[prev] != n;
+  return broken / (n + 1.0);
+}
+
+BrokenPairsDiversification::BrokenPairsDiversification(
+    int slots, int numStops, const DiversityOptions &options)
+    : slots(slots), numStops(numStops), options(options), hash(numStops),
+      successors(static_cast<size_t>(slots) * (numStops + 1)),
+      hashOf(slots), known(slots, 0),
+      distances(static_cast<size_t>(slots) * slots), storage(slots),
+      slotOf(slots), byObjective(slots), byDiversity(slots), order(slots),
+      diversity(slots), biased(slots), nearest(slots), fresh(slots),
+      alive(slots), kept(slots) {
+  if (slots < 1 || numStops < 1)
+    throw std::invalid_argument(
+        "BrokenPairsDiversification: slots and numStops must be >= 1");
+  if (options.closest < 1)
+    throw std::invalid_argument(
+        "BrokenPairsDiversification: closest must be >= 1");
+  size_t cells = 16;
+  while (cells < 4 * static_cast<size_t>(slots))
+    cells *= 2;
+  table.assign(cells, 0);
+}
+
+void BrokenPairsDiversification::checkSlots(
+    const Population &population) const {
+  if (population.getSlots() != slots ||
+      population.getGenomeSize() != numStops)
+    throw std::invalid_argument(
+        "BrokenPairsDiversification: population does not match its size");
+}
+
+void BrokenPairsDiversification::insertHash(std::uint64_t h) {
+  h = h ? h : 1;
+  const size_t mask = table.size() - 1;
+  for (size_t cell = h & mask;; cell = (cell + 1) & mask) {
+    if (table[cell] == h)
+      return;
+    if (table[cell] == 0) {
+      table[cell] = h;
+      return;
+    }
+  }
+}
+
+bool BrokenPairsDiversification::containsHash(std::uint64_t h) const {
+  h = h ? h : 1;
+  const size_t mask = table.size() - 1;
+  for (size_t cell = h & mask; table[cell] != 0; cell = (cell + 1) & mask)
+    if (table[cell] == h)
+      return true;
+  return false;
+}
+
+void BrokenPairsDiversification::reset(const Population &population,
+                                       int parents) {
+  checkSlots(population);
+  std::fill(table.begin(), table.end(), 0);
+  for (int slot = 0; slot < population.getSlots(); ++slot) {
+    const int st = population.getStorage(slot);
+    if (slot >= parents) {
+      known[st] = 0; // about to be overwritten
+      continue;
+    }
+    const Individual &parent = population[slot];
+    insertHash(known[st] ? hashOf[st]
+                         : hash.of(parent.begin(), parent.getSize()));
+  }
+}
+
+bool BrokenPairsDiversification::admit(const Individual &individual) {
+  std::uint64_t h = hash.of(individual.begin(), individual.getSize());
+  if (containsHash(h)) {
+    stats.rejected++;
+    return false;
+  }
+  insertHash(h);
+  return true;
+}
+
+void BrokenPairsDiversification::fillSuccessors(int st,
+                                                const Individual &individual) {
+  int *successor = successors.data() + static_cast<size_t>(st) * (numStops + 1);
+  int prev = numStops;
+  for (int gene : individual) {
+    successor[prev] = gene;
+    prev = gene;
+  }
+  successor[prev] = numStops;
+  hashOf[st] = hash.of(individual.begin(), individual.getSize());
+}
+
+void BrokenPairsDiversification::diversify(Population &population,
+                                           int survivors) {
+  checkSlots(population);
+  const int total = population.getSlots();
+  const int stride = numStops + 1;
+
+  // candidates are the evaluated slots; refresh the ones that changed
+  int m = 0;
+  for (int slot = 0; slot < total; ++slot) {
+    if (!population[slot].evaluated)
+      continue;
+    slotOf[m] = slot;
+    storage[m] = population.getStorage(slot);
+    fresh[m] = !known[storage[m]];
+    if (fresh[m])
+      fillSuccessors(storage[m], population[slot]);
+    m++;
+  }
+  for (int c = 0; c < m; ++c) {
+    const int *sc =
+        successors.data() + static_cast<size_t>(storage[c]) * stride;
+    for (int d = c + 1; d < m; ++d) {
+      if (!fresh[c] && !fresh[d])
+        continue;
+      const int *sd =
+          successors.data() + static_cast<size_t>(storage[d]) * stride;
+      int broken = 0;
+      for (int i = 0; i < stride; ++i)
+        broken += sc[i] != sd[i];
+      dist(storage[c], storage[d]) = dist(storage[d], storage[c]) =
+          static_cast<float>(broken) / stride;
+      stats.distances++;
+    }
+  }
+  for (int c = 0; c < m; ++c)
+    known[storage[c]] = 1;
+
+  auto objective = [&](int c) {
+    return population[slotOf[c]].getObjective();
+  };
+  auto better = [&](int a, int b) {
+    double fa = objective(a), fb = objective(b);
+    return fa != fb ? fa > fb : slotOf[a] < slotOf[b];
+  };
+  int best = 0;
+  for (int c = 1; c < m; ++c)
+    if (better(c, best))
+      best = c;
+
+  std::fill(alive.begin(), alive.begin() + m, 1);
+  for (int remaining = m; remaining > std::max(1, survivors); --remaining) {
+    int k = 0;
+    for (int c = 0; c < m; ++c)
+      if (alive[c])
+        byObjective[k++] = c;
+    std::sort(byObjective.begin(), byObjective.begin() + k, better);
+
+    bool clones = false;
+    for (int r = 0; r < k; ++r) {
+      const int c = byObjective[r];
+      int count = 0;
+      for (int d = 0; d < m; ++d)
+        if (alive[d] && d != c)
+          nearest[count++] = dist(storage[c], storage[d]);
+      const int closest = std::min(options.closest, count);
+      std::nth_element(nearest.begin(), nearest.begin() + closest - 1,
+                       nearest.begin() + count);
+      double sum = 0.0;
+      float minimum = 1.0f;
+      for (int j = 0; j < closest; ++j) {
+        sum += nearest[j];
+        minimum = std::min(minimum, nearest[j]);
+      }
+      diversity[c] = sum / closest;
+      clones |= minimum == 0.0f && c != best;
+      biased[c] = r; // objective rank for now
+    }
+    std::copy(byObjective.begin(), byObjective.begin() + k,
+              byDiversity.begin());
+    std::sort(byDiversity.begin(), byDiversity.begin() + k,
+              [&](int a, int b) {
+                return diversity[a] != diversity[b]
+                           ? diversity[a] > diversity[b]
+                           : better(a, b);
+              });
+    const double diversityWeight =
+        1.0 - std::min(1.0, static_cast<double>(options.elites) / k);
+    for (int r = 0; r < k; ++r)
+      biased[byDiversity[r]] =
+          (biased[byDiversity[r]] + diversityWeight * r) / (k - 1);
+
+    // remove a clone first, then the worst biased fitness
+    int victim = -1;
+    for (int r = 0; r < k; ++r) {
+      const int c = byObjective[r];
+      if (c == best)
+        continue;
+      bool clone = false;
+      if (clones)
+        for (int d = 0; d < m && !clone; ++d)
+          clone = alive[d] && d != c &&
+                  dist(storage[c], storage[d]) == 0.0f;
+      if (clones && !clone)
+        continue;
+      if (victim < 0 || biased[c] >= biased[victim])
+        victim = c;
+    }
+    alive[victim] = 0;
+  }
+
+  // survivors best first, then the removed, then unevaluated slots
+  std::fill(kept.begin(), kept.end(), 0);
+  for (int c = 0; c < m; ++c)
+    kept[slotOf[c]] = alive[c] ? 2 : 1;
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    if (kept[a] != kept[b])
+      return kept[a] > kept[b];
+    double fa = population[a].getObjective();
+    double fb = population[b].getObjective();
+    return fa != fb ? fa > fb : a < b;
+  });
+  population.reorder(order);
+}
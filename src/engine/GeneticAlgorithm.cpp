@@ -0,0 +1,193 @@
+#include "engine/GeneticAlgorithm.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Timer.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+GeneticAlgorithm::GeneticAlgorithm(const RoutingModel &model,
+                                   Crossover *crossover, Mutation *mutation,
+                                   LocalSearch *localSearch, Repair *repair,
+                                   const GeneticAlgorithmOptions &options)
+    : model(model), crossover(crossover), mutation(mutation),
+      localSearch(localSearch), repair(repair), options(options),
+      rng(RandomEngine::stream(options.seed, options.stream)),
+      population(2 * std::max(1, options.populationSize),
+                 model.getNumStops()),
+      order(population.getSlots()) {
+  if (options.populationSize < 1)
+    throw std::invalid_argument(
+        "GeneticAlgorithm: populationSize must be >= 1");
+  if (options.tournamentSize < 1)
+    throw std::invalid_argument(
+        "GeneticAlgorithm: tournamentSize must be >= 1");
+}
+
+void GeneticAlgorithm::addInitialTour(const std::vector<int> &tour) {
+  const int n = model.getNumStops();
+  std::vector<bool> seen(n, false);
+  bool valid = (int)tour.size() == n;
+  for (int gene : tour) {
+    if (!valid)
+      break;
+    valid = gene >= 0 && gene < n && !seen[gene];
+    if (valid)
+      seen[gene] = true;
+  }
+  if (!valid)
+    throw std::invalid_argument(
+        "GeneticAlgorithm: initial tour is not a permutation of the stops");
+  initialTours.push_back(tour);
+}
+
+void GeneticAlgorithm::initialize() {
+  const int size = options.populationSize;
+  evaluations = 0;
+  clonesRejected = 0;
+  std::vector<int> tupleOrder = model.tupleOrderTour();
+  for (int slot = 0; slot < size; ++slot) {
+    Individual &individual = population[slot];
+    if (slot < (int)initialTours.size()) {
+      std::copy(initialTours[slot].begin(), initialTours[slot].end(),
+                individual.begin());
+    } else if (slot == (int)initialTours.size()) {
+      std::copy(tupleOrder.begin(), tupleOrder.end(), individual.begin());
+    } else {
+      std::iota(individual.begin(), individual.end(), 0);
+      rng.shuffle(individual.begin(), individual.end());
+    }
+    evaluate(individual);
+  }
+  for (int slot = size; slot < population.getSlots(); ++slot)
+    population[slot].evaluated = false;
+  if (diversification)
+    diversification->reset(population, 0);
+  selectSurvivors();
+}
+
+void GeneticAlgorithm::step() {
+  const int size = options.populationSize;
+  if (diversification)
+    diversification->reset(population, size);
+  const std::size_t operatorsBefore = operatorEvaluations();
+  for (int slot = size; slot < 2 * size; ++slot) {
+    Individual &child = population[slot];
+    const Individual &parent1 = population[tournament()];
+    if (crossover && rng.uniform() < options.crossoverRate)
+      crossover->crossover(parent1, population[tournament()], child, rng);
+    else
+      child.copyFrom(parent1);
+    if (mutation && rng.uniform() < options.mutationRate)
+      mutation->mutate(child, rng);
+    if (repair)
+      repair->repair(child);
+    if (localSearch)
+      localSearch->improve(child, rng);
+    if (diversification && !diversification->admit(child)) {
+      child.evaluated = false; // a clone is not worth an evaluation
+      clonesRejected++;
+      continue;
+    }
+    // repair and local search leave the child evaluated, and a copy keeps
+    // its parent's score
+    if (!child.evaluated)
+      evaluate(child);
+  }
+  evaluations += operatorEvaluations() - operatorsBefore;
+  selectSurvivors();
+}
+
+void GeneticAlgorithm::insertMigrants(const int *tours, int count) {
+  const int size = options.populationSize;
+  const int n = population.getGenomeSize();
+  count = std::min(count, size);
+  if (diversification)
+    diversification->reset(population, size);
+  // offspring slots are free between generations; sorting all slots lets a
+  // migrant in only where it beats a survivor
+  for (int k = 0; k < count; ++k) {
+    Individual &slot = population[size + k];
+    std::copy(tours + static_cast<size_t>(k) * n,
+              tours + static_cast<size_t>(k + 1) * n, slot.begin());
+    if (diversification && !diversification->admit(slot)) {
+      slot.evaluated = false;
+      continue;
+    }
+    evaluate(slot);
+  }
+  selectSurvivors();
+}
+
+GeneticAlgorithmResult GeneticAlgorithm::run() {
+  Timer timer;
+  GeneticAlgorithmResult result;
+  result.trace.reserve(options.generations);
+  initialize();
+  for (int generation = 0; generation < options.generations; ++generation) {
+    if (options.timeLimitSeconds > 0 &&
+        timer.elapsed() > options.timeLimitSeconds)
+      break;
+    step();
+    result.trace.push_back(getBest().getObjective());
+    result.generations++;
+  }
+
+  const Individual &best = getBest();
+  result.bestTour.assign(best.begin(), best.end());
+  result.best = model.decode(result.bestTour);
+  result.evaluations = evaluations;
+  result.clonesRejected = clonesRejected;
+  result.elapsedSeconds = timer.elapsed();
+  LOG_DEBUG("GA: " << result.generations << " generations, "
+                   << result.evaluations << " evaluations, best objective "
+                   << result.best.evaluation.objective << " (deltaUDF "
+                   << result.best.evaluation.deltaUDF << ", "
+                   << result.best.evaluation.routes << " routes, "
+                   << result.best.evaluation.unserved << " stops unserved)");
+  return result;
+}
+
+Solution GeneticAlgorithm::solve(const ProblemInstance &instance) {
+  requireInstance(instance, model.getInstance());
+  return model.toSolution(run().best);
+}
+
+int GeneticAlgorithm::tournament() {
+  const int size = options.populationSize;
+  int winner = rng.below(size);
+  for (int round = 1; round < options.tournamentSize; ++round) {
+    int challenger = rng.below(size);
+    if (population[challenger].getObjective() >
+        population[winner].getObjective())
+      winner = challenger;
+  }
+  return winner;
+}
+
+void GeneticAlgorithm::evaluate(Individual &individual) {
+  individual.evaluate(model);
+  evaluations++;
+}
+
+std::size_t GeneticAlgorithm::operatorEvaluations() const {
+  return (repair ? repair->getEvaluations() : 0) +
+         (localSearch ? localSearch->getEvaluations() : 0);
+}
+
+void GeneticAlgorithm::selectSurvivors() {
+  if (diversification)
+    diversification->diversify(population, options.populationSize);
+  else
+    sortSurvivors();
+}
+
+void GeneticAlgorithm::sortSurvivors() {
+  // (mu + lambda): the best populationSize of parents and offspring survive
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](int a, int b) {
+    double fa = population[a].getObjective();
+    double fb = population[b].getObjective();
+    return fa != fb ? fa > fb : a < b;
+  });
+  population.reorder(order);
+}
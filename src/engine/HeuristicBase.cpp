@@ -0,0 +1,9 @@
+#include "engine/HeuristicBase.hpp"
+#include <stdexcept>
+
+void HeuristicBase::requireInstance(const ProblemInstance &instance,
+                                    const ProblemInstance &expected) {
+  if (&instance != &expected)
+    throw std::invalid_argument(
+        "HeuristicBase: the heuristic was built for another instance");
+}
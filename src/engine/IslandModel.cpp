@@ -0,0 +1,166 @@
+#include "engine/IslandModel.hpp"
+#include "utils/SpscQueue.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Timer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+struct MigrationPacket {
+  int epoch = 0;
+  std::vector<int> tours; // `migrants` giant tours back to back
+};
+
+} // namespace
+
+IslandModel::IslandModel(const RoutingModel &model,
+                         const IslandModelOptions &options)
+    : model(model), options(options) {
+  if (options.islands < 1)
+    throw std::invalid_argument("IslandModel: islands must be >= 1");
+  // Pushing epoch e happens before taking in epoch e - 1, so a queue must
+  // hold two packets or two fully connected islands could wait on each other.
+  if (options.migrationInterval < 1 || options.queueCapacity < 2)
+    throw std::invalid_argument("IslandModel: migrationInterval must be >= 1 "
+                                "and queueCapacity >= 2");
+  if (!this->options.makeOperators)
+    this->options.makeOperators = [] {
+      IslandOperators ops;
+      ops.crossover = std::make_unique<OrderCrossover>();
+      ops.mutation = std::make_unique<InversionMutation>();
+      return ops;
+    };
+}
+
+IslandModelResult IslandModel::run() {
+  Timer timer;
+  const int islands = options.islands;
+  const int n = model.getNumStops();
+  const int migrants =
+      std::max(0, std::min(options.migrants, options.ga.populationSize));
+
+  // channel[from * islands + to], null where the topology has no edge
+  MigrationPacket prototype;
+  prototype.tours.assign(static_cast<size_t>(migrants) * n, 0);
+  std::vector<std::unique_ptr<SpscQueue<MigrationPacket>>> channel(islands *
+                                                                   islands);
+  std::vector<std::vector<int>> outgoing(islands), incoming(islands);
+  for (int from = 0; from < islands; ++from)
+    for (int to = 0; to < islands; ++to) {
+      bool edge = options.topology == MigrationTopology::RING
+                      ? to == (from + 1) % islands
+                      : to != from;
+      if (from == to || !edge || migrants == 0)
+        continue;
+      channel[from * islands + to] =
+          std::make_unique<SpscQueue<MigrationPacket>>(options.queueCapacity,
+                                                       prototype);
+      outgoing[from].push_back(to);
+      incoming[to].push_back(from);
+    }
+
+  std::vector<IslandOperators> operators;
+  std::vector<std::unique_ptr<GeneticAlgorithm>> gas;
+  for (int i = 0; i < islands; ++i) {
+    operators.push_back(options.makeOperators());
+    GeneticAlgorithmOptions gaOptions = options.ga;
+    gaOptions.stream = options.ga.stream + i;
+    gas.push_back(std::make_unique<GeneticAlgorithm>(
+        model, operators[i].crossover.get(), operators[i].mutation.get(),
+        operators[i].localSearch.get(), operators[i].repair.get(),
+        gaOptions));
+    gas[i]->setDiversification(operators[i].diversification.get());
+  }
+
+  IslandModelResult result;
+  result.traces.assign(islands, {});
+  std::vector<std::size_t> received(islands, 0);
+  std::atomic<bool> stop{false};
+
+  auto evolve = [&](int island) {
+    GeneticAlgorithm &ga = *gas[island];
+    std::vector<double> &trace = result.traces[island];
+    trace.reserve(options.ga.generations);
+    MigrationPacket packet = prototype;
+    ga.initialize();
+
+    for (int generation = 1; generation <= options.ga.generations;
+         ++generation) {
+      if (stop.load(std::memory_order_relaxed))
+        break;
+      if (options.ga.timeLimitSeconds > 0 &&
+          timer.elapsed() > options.ga.timeLimitSeconds) {
+        stop.store(true, std::memory_order_relaxed);
+        break;
+      }
+      ga.step();
+      trace.push_back(ga.getBest().getObjective());
+      if (generation % options.migrationInterval != 0)
+        continue;
+
+      // send this epoch's elites, then take in last epoch's
+      const int epoch = generation / options.migrationInterval;
+      Population &population = ga.getPopulation();
+      packet.epoch = epoch;
+      for (int k = 0; k < migrants; ++k)
+        std::copy(population[k].begin(), population[k].end(),
+                  packet.tours.begin() + static_cast<size_t>(k) * n);
+      for (int to : outgoing[island]) {
+        auto &queue = *channel[island * islands + to];
+        while (!queue.tryPush(packet)) {
+          if (stop.load(std::memory_order_relaxed))
+            return;
+          std::this_thread::yield();
+        }
+      }
+      if (epoch < 2)
+        continue;
+      for (int from : incoming[island]) {
+        auto &queue = *channel[from * islands + island];
+        while (!queue.tryPop(packet)) {
+          if (stop.load(std::memory_order_relaxed))
+            return;
+          std::this_thread::yield();
+        }
+        ga.insertMigrants(packet.tours.data(), migrants);
+        received[island]++;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < islands; ++i)
+    threads.emplace_back(evolve, i);
+  evolve(0);
+  for (auto &thread : threads)
+    thread.join();
+
+  for (int i = 0; i < islands; ++i) {
+    const Individual &best = gas[i]->getBest();
+    if (result.bestIsland < 0 ||
+        best.getObjective() >
+            gas[result.bestIsland]->getBest().getObjective())
+      result.bestIsland = i;
+    result.evaluations += gas[i]->getEvaluations();
+    result.migrationsReceived += received[i];
+  }
+  const Individual &best = gas[result.bestIsland]->getBest();
+  result.bestTour.assign(best.begin(), best.end());
+  result.best = model.decode(result.bestTour);
+  result.elapsedSeconds = timer.elapsed();
+  if (result.elapsedSeconds > 0)
+    result.evaluationsPerSecondPerThread =
+        result.evaluations / result.elapsedSeconds / islands;
+  LOG_DEBUG("Island model: " << islands << " islands, "
+                             << result.evaluations << " evaluations ("
+                             << result.evaluationsPerSecondPerThread
+                             << "/s per thread), "
+                             << result.migrationsReceived
+                             << " migrations, best objective "
+                             << result.best.evaluation.objective
+                             << " from island " << result.bestIsland);
+  return result;
+}
@@ -0,0 +1,214 @@
+#include "engine/SavingsConstruction.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Timer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
+
+namespace {
+
+constexpr int kDepot = 0;
+
+struct Saving {
+  double value;
+  int from, to; // block `to` follows block `from`
+};
+
+// larger saving first; a total order, so the result does not depend on how
+// the rows were shared out
+bool operator<(const Saving &a, const Saving &b) {
+  if (a.value != b.value)
+    return a.value > b.value;
+  return a.from != b.from ? a.from < b.from : a.to < b.to;
+}
+
+} // namespace
+
+SavingsConstruction::SavingsConstruction(const RoutingModel &model,
+                                         const ConstructionOptions &options)
+    : model(model), options(options) {}
+
+ConstructionResult SavingsConstruction::run() const {
+  Timer timer;
+  ConstructionResult result;
+  const int blocks = model.getNumTuples();
+  const int capacity = model.getVehicleCapacity();
+  const double limit = model.getOptions().routeTimeLimit;
+
+  // block summaries: visiting order, end stations, internal time, ΔUDF.
+  // Without tuple precedence pickups and drops may alternate to keep the
+  // load in the window: a drop that fits goes first, else a pickup that fits.
+  const bool precedence = model.getOptions().tuplePrecedence;
+  std::vector<int> order(model.getNumStops());
+  std::vector<int> first(blocks, kDepot), last(blocks, kDepot);
+  std::vector<double> cost(blocks, 0.0), deltaUDF(blocks, 0.0);
+  std::vector<char> usable(blocks, 0), taken(model.getNumStops(), 0);
+  for (int b = 0; b < blocks; ++b) {
+    const int begin = model.getTupleBegin(b), end = model.getTupleEnd(b);
+    if (begin == end)
+      continue;
+    bool ok = true;
+    int load = 0;
+    for (int pos = begin; pos < end && ok; ++pos) {
+      int pick = -1;
+      for (int id = begin; id < end; ++id) {
+        if (taken[id])
+          continue;
+        const int after = load + model.getStop(id).quantity;
+        if (after < 0 || after > capacity)
+          continue;
+        if (precedence) { // model order: pickups, then drops
+          pick = id;
+          break;
+        }
+        bool drop = model.getStop(id).quantity < 0;
+        if (pick < 0 || (drop && model.getStop(pick).quantity > 0))
+          pick = id;
+      }
+      if (precedence && pick >= 0 && pick != pos)
+        pick = -1; // the next stop in order does not fit
+      ok = pick >= 0;
+      if (!ok)
+        break;
+      taken[pick] = 1;
+      order[pos] = pick;
+      load += model.getStop(pick).quantity;
+      if (pos > begin)
+        cost[b] += model.travelTime(model.getStop(order[pos - 1]).station,
+                                    model.getStop(pick).station);
+      cost[b] += model.serviceTime(pick);
+      deltaUDF[b] += model.getStop(pick).deltaUDF;
+    }
+    if (!ok) {
+      std::iota(order.begin() + begin, order.begin() + end, begin);
+      continue;
+    }
+    first[b] = model.getStop(order[begin]).station;
+    last[b] = model.getStop(order[end - 1]).station;
+    usable[b] = model.travelTime(kDepot, first[b]) + cost[b] +
+                    model.travelTime(last[b], kDepot) <=
+                limit;
+  }
+
+  // positive savings, rows shared out to the workers
+  unsigned threads = options.threads ? options.threads
+                                     : std::thread::hardware_concurrency();
+  threads = std::max(1u, std::min<unsigned>(threads, std::max(1, blocks)));
+  std::vector<std::vector<Saving>> found(threads);
+  std::atomic<int> nextRow{0};
+  auto worker = [&](unsigned w) {
+    for (int i; (i = nextRow.fetch_add(1)) < blocks;) {
+      if (!usable[i])
+        continue;
+      const size_t rowStart = found[w].size();
+      for (int j = 0; j < blocks; ++j) {
+        if (j == i || !usable[j])
+          continue;
+        double value = model.travelTime(last[i], kDepot) +
+                       model.travelTime(kDepot, first[j]) -
+                       model.travelTime(last[i], first[j]);
+        if (value > 0)
+          found[w].push_back({value, i, j});
+      }
+      const size_t keep = std::max(0, options.neighbours);
+      if (keep > 0 && found[w].size() - rowStart > keep) {
+        auto row = found[w].begin() + rowStart;
+        std::nth_element(row, row + keep, found[w].end());
+        found[w].resize(rowStart + keep);
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned w = 1; w < threads; ++w)
+    pool.emplace_back(worker, w);
+  worker(0);
+  for (std::thread &t : pool)
+    t.join();
+
+  std::vector<Saving> savings;
+  for (const auto &part : found)
+    savings.insert(savings.end(), part.begin(), part.end());
+  std::sort(savings.begin(), savings.end());
+  result.savings = savings.size();
+
+  // one route per usable block, named after its head block
+  std::vector<int> next(blocks, -1), routeOf(blocks, -1), head(blocks),
+      tail(blocks), length(blocks, 1);
+  std::vector<double> duration(blocks, 0.0);
+  for (int b = 0; b < blocks; ++b) {
+    if (!usable[b])
+      continue;
+    routeOf[b] = head[b] = tail[b] = b;
+    duration[b] = model.travelTime(kDepot, first[b]) + cost[b] +
+                  model.travelTime(last[b], kDepot);
+  }
+  for (const Saving &s : savings) {
+    int a = routeOf[s.from], b = routeOf[s.to];
+    if (a == b || tail[a] != s.from || head[b] != s.to)
+      continue;
+    double merged = duration[a] + duration[b] - s.value;
+    if (merged > limit)
+      continue;
+    // relabel the shorter route
+    int keep = length[a] >= length[b] ? a : b, drop = keep == a ? b : a;
+    for (int block = head[drop]; block >= 0; block = next[block])
+      routeOf[block] = keep;
+    next[s.from] = s.to;
+    head[keep] = head[a];
+    tail[keep] = tail[b];
+    length[keep] = length[a] + length[b];
+    duration[keep] = merged;
+    result.merges++;
+  }
+
+  // the fleet takes the best routes
+  std::vector<int> routes;
+  std::vector<double> udf(blocks, 0.0);
+  for (int b = 0; b < blocks; ++b) {
+    if (!usable[b])
+      continue;
+    udf[routeOf[b]] += deltaUDF[b];
+    if (routeOf[b] == b)
+      routes.push_back(b);
+  }
+  const double weight = model.getOptions().timeWeight;
+  auto score = [&](int r) { return udf[r] - weight * duration[r]; };
+  std::sort(routes.begin(), routes.end(), [&](int a, int b) {
+    return score(a) != score(b) ? score(a) > score(b) : a < b;
+  });
+  if ((int)routes.size() > model.getNumVehicles())
+    routes.resize(std::max(0, model.getNumVehicles()));
+
+  std::vector<char> served(blocks, 0);
+  RouteEvaluation &evaluation = result.plan.evaluation;
+  for (int r : routes) {
+    std::vector<int> &stops = result.plan.routes.emplace_back();
+    for (int b = head[r]; b >= 0; b = next[b]) {
+      served[b] = 1;
+      for (int pos = model.getTupleBegin(b); pos < model.getTupleEnd(b);
+           ++pos)
+        stops.push_back(order[pos]);
+    }
+    result.tour.insert(result.tour.end(), stops.begin(), stops.end());
+    evaluation.deltaUDF += udf[r];
+    evaluation.duration += duration[r];
+  }
+  for (int b = 0; b < blocks; ++b)
+    if (!served[b])
+      for (int pos = model.getTupleBegin(b); pos < model.getTupleEnd(b);
+           ++pos)
+        result.plan.unserved.push_back(order[pos]);
+  result.tour.insert(result.tour.end(), result.plan.unserved.begin(),
+                     result.plan.unserved.end());
+  evaluation.routes = static_cast<int>(result.plan.routes.size());
+  evaluation.unserved = static_cast<int>(result.plan.unserved.size());
+  evaluation.objective = evaluation.deltaUDF - weight * evaluation.duration;
+  result.elapsedSeconds = timer.elapsed();
+  LOG_DEBUG("Savings construction: " << blocks << " blocks, "
+                                     << result.savings << " savings, "
+                                     << result.merges << " merges, "
+                                     << evaluation.routes << " routes in "
+                                     << result.elapsedSeconds << "s");
+  return result;
+}
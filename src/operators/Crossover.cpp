@@ -0,0 +1,36 @@
+#include "operators/Crossover.hpp"
+#include <utility>
+
+void OrderCrossover::crossover(const Individual &parent1,
+                               const Individual &parent2, Individual &child,
+                               RandomEngine &rng) {
+  const int n = parent1.getSize();
+  if (n == 0)
+    return;
+  if ((int)taken.size() < n) {
+    taken.assign(n, 0);
+    stamp = 0;
+  }
+  if (++stamp == 0) { // wrapped around: old marks would read as current
+    std::fill(taken.begin(), taken.end(), 0);
+    stamp = 1;
+  }
+
+  int first = rng.below(n), last = rng.below(n);
+  if (first > last)
+    std::swap(first, last);
+  for (int i = first; i <= last; ++i) {
+    child[i] = parent1[i];
+    taken[parent1[i]] = stamp;
+  }
+
+  int out = (last + 1) % n;
+  for (int k = 0; k < n; ++k) {
+    int gene = parent2[(last + 1 + k) % n];
+    if (taken[gene] == stamp)
+      continue;
+    child[out] = gene;
+    out = (out + 1) % n;
+  }
+  child.evaluated = false;
+}
@@ -0,0 +1,836 @@
+#include "operators/LocalSearch.hpp"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Changes smaller than this are rounding noise, not improvements
+constexpr double kEps = 1e-9;
+
+// Re-reads of the input before improve() gives up on it, see load()
+constexpr int kLoadRounds = 4;
+
+int floorLog2(int x) { return 31 - __builtin_clz(static_cast<unsigned>(x)); }
+
+} // namespace
+
+RouteLocalSearch::RouteLocalSearch(const RoutingModel &model,
+                                   const LocalSearchOptions &options)
+    : model(model), options(options) {
+  const int n = model.getNumStops();
+  const int stride = n + 2;
+  levels = floorLog2(stride) + 1;
+
+  // granular neighbourhoods: the nearest stops by travel time
+  neighbours.resize(n);
+  std::vector<std::pair<double, int>> byTime;
+  for (int a = 0; a < n; ++a) {
+    byTime.clear();
+    for (int b = 0; b < n; ++b)
+      if (b != a)
+        byTime.emplace_back(travel(model.getStop(a).station,
+                                   model.getStop(b).station),
+                            b);
+    int keep = std::min<int>(options.neighbours, byTime.size());
+    std::partial_sort(byTime.begin(), byTime.begin() + keep, byTime.end());
+    for (int k = 0; k < keep; ++k)
+      neighbours[a].push_back(byTime[k].second);
+  }
+
+  // every buffer at its largest size once, so improve() never allocates
+  routes.resize(std::max(0, model.getNumVehicles()));
+  for (Route &route : routes) {
+    route.nodes.reserve(stride);
+    route.load.reserve(stride);
+    route.fwd.reserve(stride);
+    route.bwd.reserve(stride);
+    route.svc.reserve(stride);
+    route.time.reserve(stride);
+    route.minLoad.assign(static_cast<size_t>(levels) * stride, 0);
+    route.maxLoad.assign(static_cast<size_t>(levels) * stride, 0);
+  }
+  routeOf.assign(n, -1);
+  posOf.assign(n, -1);
+  unserved.reserve(n);
+  unservedPos.assign(n, -1);
+  stopOrder.resize(n);
+  std::iota(stopOrder.begin(), stopOrder.end(), 0);
+  moveOrder = {MoveType::RELOCATE, MoveType::SWAP,       MoveType::TWO_OPT,
+               MoveType::OR_OPT,   MoveType::TUPLE_SWAP, MoveType::INSERT};
+  routeScratch.reserve(n);
+  tour.resize(n);
+  pickupsSeen.resize(model.getNumTuples());
+  for (std::vector<int> &nodes : saved)
+    nodes.reserve(stride);
+}
+
+int RouteLocalSearch::station(const Route &route, int pos) const {
+  int stop = route.nodes[pos];
+  return stop < 0 ? 0 : model.getStop(stop).station;
+}
+
+double RouteLocalSearch::travel(int fromStation, int toStation) const {
+  return model.travelTime(fromStation, toStation);
+}
+
+int RouteLocalSearch::rangeMin(const Route &route, int first,
+                               int last) const {
+  const int stride = model.getNumStops() + 2;
+  int level = floorLog2(last - first + 1);
+  return std::min(route.minLoad[level * stride + first],
+                  route.minLoad[level * stride + last - (1 << level) + 1]);
+}
+
+int RouteLocalSearch::rangeMax(const Route &route, int first,
+                               int last) const {
+  const int stride = model.getNumStops() + 2;
+  int level = floorLog2(last - first + 1);
+  return std::max(route.maxLoad[level * stride + first],
+                  route.maxLoad[level * stride + last - (1 << level) + 1]);
+}
+
+bool RouteLocalSearch::loadOk(int low, int high) const {
+  return low >= 0 && high <= model.getVehicleCapacity();
+}
+
+bool RouteLocalSearch::durationOk(double duration) const {
+  return duration <= model.getOptions().routeTimeLimit;
+}
+
+bool RouteLocalSearch::improves(double durationDelta, double udfGain) const {
+  if (udfGain > 0)
+    return udfGain - model.getOptions().timeWeight * durationDelta > kEps;
+  return durationDelta < -kEps;
+}
+
+void RouteLocalSearch::rebuild(int r) {
+  Route &route = routes[r];
+  const int m = static_cast<int>(route.nodes.size());
+  const int stride = model.getNumStops() + 2;
+  route.load.resize(m);
+  route.fwd.resize(m);
+  route.bwd.resize(m);
+  route.svc.resize(m);
+  route.time.resize(m);
+  route.load[0] = 0;
+  route.fwd[0] = route.bwd[0] = route.svc[0] = route.time[0] = 0.0;
+  for (int p = 1; p < m; ++p) {
+    int stop = route.nodes[p];
+    int prev = station(route, p - 1), here = station(route, p);
+    const double service = stop < 0 ? 0.0 : model.serviceTime(stop);
+    route.load[p] =
+        route.load[p - 1] + (stop < 0 ? 0 : model.getStop(stop).quantity);
+    route.fwd[p] = route.fwd[p - 1] + travel(prev, here);
+    route.bwd[p] = route.bwd[p - 1] + travel(here, prev);
+    route.svc[p] = route.svc[p - 1] + service;
+    route.time[p] = route.time[p - 1] + travel(prev, here) + service;
+  }
+  route.duration = m > 2 ? route.fwd[m - 1] + route.svc[m - 1] : 0.0;
+
+  std::copy(route.load.begin(), route.load.end(), route.minLoad.begin());
+  std::copy(route.load.begin(), route.load.end(), route.maxLoad.begin());
+  for (int level = 1; (1 << level) <= m; ++level) {
+    const int half = 1 << (level - 1);
+    int *mn = route.minLoad.data() + level * stride;
+    int *mx = route.maxLoad.data() + level * stride;
+    const int *mnPrev = mn - stride, *mxPrev = mx - stride;
+    for (int p = 0; p + (1 << level) <= m; ++p) {
+      mn[p] = std::min(mnPrev[p], mnPrev[p + half]);
+      mx[p] = std::max(mxPrev[p], mxPrev[p + half]);
+    }
+  }
+  // every move predicted feasibility in O(1); the rebuilt route must agree
+  assert(loadOk(rangeMin(route, 0, m - 1), rangeMax(route, 0, m - 1)));
+  assert(durationOk(route.duration - kEps));
+}
+
+void RouteLocalSearch::place(int r) {
+  const Route &route = routes[r];
+  for (int p = 1; p <= route.size(); ++p) {
+    routeOf[route.nodes[p]] = r;
+    posOf[route.nodes[p]] = p;
+  }
+}
+
+// Called by an insert move; commit() puts the stop back if it undoes the move.
+void RouteLocalSearch::removeUnserved(int stop) {
+  int pos = unservedPos[stop];
+  insertedStop = stop;
+  insertedPos = pos;
+  unserved[pos] = unserved.back();
+  unservedPos[unserved[pos]] = pos;
+  unserved.pop_back();
+  unservedPos[stop] = -1;
+}
+
+void RouteLocalSearch::restoreUnserved() {
+  const int stop = insertedStop, pos = insertedPos;
+  if (pos < (int)unserved.size()) {
+    unservedPos[unserved[pos]] = static_cast<int>(unserved.size());
+    unserved.push_back(unserved[pos]);
+    unserved[pos] = stop;
+  } else {
+    unserved.push_back(stop);
+  }
+  unservedPos[stop] = pos;
+  routeOf[stop] = posOf[stop] = -1;
+}
+
+// The routes the split decoder cuts the tour into; `input` is the split of
+// the genes passed in. A stop the decoder skips can still end a route, so
+// the routes alone may split differently; the tour they store is read again
+// until it reproduces them. False if it does not settle within kLoadRounds.
+bool RouteLocalSearch::load(const int *genes, RouteEvaluation &input) {
+  const int n = model.getNumStops();
+  for (int round = 0; round < kLoadRounds; ++round) {
+    RouteEvaluation split = model.split(genes, n, routeOf.data());
+    evaluations++;
+    if (round == 0)
+      input = split;
+    for (Route &route : routes)
+      route.nodes.assign(1, -1);
+    unserved.clear();
+    for (int k = 0; k < n; ++k) {
+      const int id = genes[k];
+      if (routeOf[id] < 0) {
+        unservedPos[id] = static_cast<int>(unserved.size());
+        unserved.push_back(id);
+        posOf[id] = -1;
+      } else {
+        routes[routeOf[id]].nodes.push_back(id);
+      }
+    }
+    for (int r = 0; r < (int)routes.size(); ++r) {
+      routes[r].nodes.push_back(-1);
+      rebuild(r);
+      place(r);
+    }
+    if (decodes())
+      return true;
+    store(tour.data());
+    genes = tour.data();
+  }
+  return false;
+}
+
+void RouteLocalSearch::store(int *genes) const {
+  int out = 0;
+  for (const Route &route : routes)
+    for (int p = 1; p <= route.size(); ++p)
+      genes[out++] = route.nodes[p];
+  for (int id : unserved)
+    genes[out++] = id;
+  assert(out == model.getNumStops());
+}
+
+// Whether the split decoder cuts the stored tour into exactly these routes:
+// every routed stop lands in the same vehicle, empty vehicles left out.
+bool RouteLocalSearch::decodes() {
+  int previous = -1;
+  for (int r = 0; r < (int)routes.size(); ++r) {
+    if (routes[r].size() == 0)
+      continue;
+    if (!routeOk(routes[r]) ||
+        (previous >= 0 && absorbs(routes[previous], routes[r].nodes[1])))
+      return false;
+    previous = r;
+  }
+  return tailUnserved();
+}
+
+// Whether the decoder keeps the route together once it has opened it: the
+// load stays in [0, vehicleCapacity] (every move keeps it there) and no
+// prefix runs over the time limit, which the full duration alone does not
+// rule out.
+bool RouteLocalSearch::routeOk(const Route &route) {
+  const double limit = model.getOptions().routeTimeLimit;
+  if (limit < std::numeric_limits<double>::infinity())
+    for (int p = 1; p <= route.size(); ++p)
+      if (route.time[p] + travel(station(route, p), 0) > limit)
+        return false;
+  return !model.getOptions().tuplePrecedence || precedenceOk(route);
+}
+
+// Whether the decoder appends `stop`, the first stop of the next used
+// route, to this one instead of closing it.
+bool RouteLocalSearch::absorbs(const Route &route, int stop) const {
+  const Stop &s = model.getStop(stop);
+  const int end = route.size();
+  const double time = route.time[end] + travel(station(route, end), s.station) +
+                      model.serviceTime(stop);
+  return route.load[end] + s.quantity <= model.getVehicleCapacity() &&
+         time + travel(s.station, 0) <= model.getOptions().routeTimeLimit;
+}
+
+// Whether the decoder leaves every stop behind the last used route unserved,
+// the way split() reads them: skipped while that route is open, and unable
+// to open another vehicle once it has closed.
+bool RouteLocalSearch::tailUnserved() {
+  const int capacity = model.getVehicleCapacity();
+  const double limit = model.getOptions().routeTimeLimit;
+  const int last = previousUsed(static_cast<int>(routes.size()));
+  int used = 0;
+  for (const Route &route : routes)
+    used += route.size() > 0;
+  bool open = last >= 0;
+  int load = 0, at = 0;
+  double time = 0.0;
+  if (open) {
+    const Route &route = routes[last];
+    load = route.load[route.size()];
+    at = station(route, route.size());
+    time = route.time[route.size()];
+  }
+  // split(): a drop is ready once all pickups of its tuple are in the route
+  auto dropReady = [&](const Stop &stop) {
+    if (!model.getOptions().tuplePrecedence)
+      return true;
+    for (int other = model.getTupleBegin(stop.tuple);
+         other < model.getTupleEnd(stop.tuple); ++other)
+      if (model.getStop(other).quantity > 0 && routeOf[other] != last)
+        return false;
+    return true;
+  };
+  for (int id : unserved) {
+    const Stop &stop = model.getStop(id);
+    const double service = model.serviceTime(id);
+    if (open) {
+      const int newLoad = load + stop.quantity;
+      if (newLoad < 0 || (stop.quantity < 0 && !dropReady(stop)))
+        continue;
+      if (newLoad <= capacity &&
+          time + travel(at, stop.station) + service +
+                  travel(stop.station, 0) <=
+              limit)
+        return false;
+      open = false;
+    }
+    if (used < (int)routes.size() && stop.quantity >= 0 &&
+        stop.quantity <= capacity &&
+        travel(0, stop.station) + service + travel(stop.station, 0) <= limit)
+      return false;
+  }
+  return true;
+}
+
+int RouteLocalSearch::previousUsed(int r) const {
+  for (--r; r >= 0 && routes[r].size() == 0; --r)
+    ;
+  return r;
+}
+
+int RouteLocalSearch::nextUsed(int r) const {
+  for (++r; r < (int)routes.size(); ++r)
+    if (routes[r].size() > 0)
+      return r;
+  return -1;
+}
+
+// The split of the stored tour, from the routes: sums in the decoder's order,
+// so it equals what split() returns.
+RouteEvaluation RouteLocalSearch::evaluation() const {
+  RouteEvaluation result;
+  for (const Route &route : routes) {
+    if (route.size() == 0)
+      continue;
+    for (int p = 1; p <= route.size(); ++p)
+      result.deltaUDF += model.getStop(route.nodes[p]).deltaUDF;
+    result.duration += route.time[route.size() + 1];
+    result.routes++;
+  }
+  result.unserved = static_cast<int>(unserved.size());
+  result.objective =
+      result.deltaUDF - model.getOptions().timeWeight * result.duration;
+  return result;
+}
+
+// Every drop of the route behind all pickups of its tuple.
+bool RouteLocalSearch::precedenceOk(const Route &route) {
+  for (int p = 1; p <= route.size(); ++p)
+    pickupsSeen[model.getStop(route.nodes[p]).tuple] = 0;
+  for (int p = 1; p <= route.size(); ++p) {
+    const Stop &stop = model.getStop(route.nodes[p]);
+    if (stop.quantity > 0)
+      pickupsSeen[stop.tuple]++;
+    else if (pickupsSeen[stop.tuple] != model.getTuplePickups(stop.tuple))
+      return false;
+  }
+  return true;
+}
+
+// Called by a move before it changes route r.
+void RouteLocalSearch::backup(int r) {
+  saved[savedCount].assign(routes[r].nodes.begin(), routes[r].nodes.end());
+  savedRoute[savedCount++] = r;
+}
+
+// Keeps the move just applied if the decoder still cuts the stored tour into
+// these routes, and restores the routes backed up for it otherwise. Only the
+// changed routes and the boundaries next to them are checked, plus the
+// unserved stops when the last route, the number of used routes or the
+// unserved stops changed.
+bool RouteLocalSearch::commit() {
+  bool keep = true, tail = insertedStop >= 0;
+  for (int i = 0; i < savedCount && keep; ++i) {
+    const int r = savedRoute[i];
+    const int previous = previousUsed(r), next = nextUsed(r);
+    const Route &route = routes[r];
+    if (route.size() > 0)
+      keep = routeOk(route) &&
+             (previous < 0 || !absorbs(routes[previous], route.nodes[1])) &&
+             (next < 0 || !absorbs(route, routes[next].nodes[1]));
+    else
+      keep = previous < 0 || next < 0 ||
+             !absorbs(routes[previous], routes[next].nodes[1]);
+    tail = tail || next < 0 || (route.size() == 0) != (saved[i].size() == 2);
+  }
+  if (keep && tail)
+    keep = tailUnserved();
+  if (!keep) {
+    for (int i = 0; i < savedCount; ++i)
+      routes[savedRoute[i]].nodes.swap(saved[i]);
+    for (int i = 0; i < savedCount; ++i) {
+      rebuild(savedRoute[i]);
+      place(savedRoute[i]);
+    }
+    if (insertedStop >= 0)
+      restoreUnserved();
+    stats.undone++;
+  }
+  savedCount = 0;
+  insertedStop = -1;
+  return keep;
+}
+
+void RouteLocalSearch::improve(Individual &individual, RandomEngine &rng) {
+  if (individual.getSize() == 0 || routes.empty()) {
+    if (!individual.evaluated) {
+      individual.evaluate(model);
+      evaluations++;
+    }
+    return;
+  }
+  RouteEvaluation before;
+  const bool loaded = load(individual.begin(), before);
+  individual.evaluation = before;
+  individual.evaluated = true;
+  if (!loaded)
+    return;
+
+  for (int pass = 0; pass < options.maxPasses; ++pass) {
+    stats.passes++;
+    bool improved = false;
+    rng.shuffle(stopOrder.begin(), stopOrder.end());
+    for (int a : stopOrder) {
+      rng.shuffle(moveOrder.begin(), moveOrder.end());
+      for (MoveType type : moveOrder)
+        if (tryMove(type, a)) {
+          stats.applied[static_cast<int>(type)]++;
+          improved = true;
+          break;
+        }
+    }
+    if (!improved)
+      break;
+  }
+
+  // Every kept move decodes to the same routes, but reading the input may
+  // already have cut it differently; keep the input if that turns out worse.
+  const RouteEvaluation after = evaluation();
+  if (after.objective < before.objective - kEps) {
+    stats.reverted++;
+    return;
+  }
+  store(individual.begin());
+  individual.evaluation = after;
+}
+
+bool RouteLocalSearch::tryMove(MoveType type, int a) {
+  if (routeOf[a] < 0) {
+    if (type != MoveType::INSERT)
+      return false;
+    for (int b : neighbours[a])
+      if (routeOf[b] >= 0 && tryInsert(a, b))
+        return true;
+    return tryInsertNewRoute(a);
+  }
+  for (int b : neighbours[a]) {
+    if (routeOf[b] < 0)
+      continue;
+    bool applied = false;
+    switch (type) {
+    case MoveType::RELOCATE:
+      applied = tryRelocate(a, b);
+      break;
+    case MoveType::SWAP:
+      applied = trySwap(a, b);
+      break;
+    case MoveType::TWO_OPT:
+      applied = tryTwoOpt(a, b);
+      break;
+    case MoveType::OR_OPT:
+      applied = tryOrOpt(a, b);
+      break;
+    case MoveType::TUPLE_SWAP:
+      applied = tryTupleSwap(a, b);
+      break;
+    case MoveType::INSERT:
+      return false;
+    }
+    if (applied)
+      return true;
+  }
+  return false;
+}
+
+// Moves nodes [first, last] of route r behind node `after`, which lies
+// outside [first - 1, last].
+bool RouteLocalSearch::moveSegment(int r, int first, int last, int after) {
+  Route &route = routes[r];
+  stats.evaluated++;
+  if (after >= first - 1 && after <= last)
+    return false;
+  double delta = travel(station(route, first - 1), station(route, last + 1)) -
+                 travel(station(route, first - 1), station(route, first)) -
+                 travel(station(route, last), station(route, last + 1)) +
+                 travel(station(route, after), station(route, first)) +
+                 travel(station(route, last), station(route, after + 1)) -
+                 travel(station(route, after), station(route, after + 1));
+  if (!improves(delta, 0) || !durationOk(route.duration + delta))
+    return false;
+
+  const int moved = route.load[last] - route.load[first - 1];
+  const int segLow = rangeMin(route, first, last) - route.load[first - 1];
+  const int segHigh = rangeMax(route, first, last) - route.load[first - 1];
+  if (after > last) {
+    if (!loadOk(rangeMin(route, last + 1, after) - moved,
+                rangeMax(route, last + 1, after) - moved) ||
+        !loadOk(route.load[after] - moved + segLow,
+                route.load[after] - moved + segHigh))
+      return false;
+    backup(r);
+    std::rotate(route.nodes.begin() + first, route.nodes.begin() + last + 1,
+                route.nodes.begin() + after + 1);
+  } else {
+    if (!loadOk(rangeMin(route, after + 1, first - 1) + moved,
+                rangeMax(route, after + 1, first - 1) + moved) ||
+        !loadOk(route.load[after] + segLow, route.load[after] + segHigh))
+      return false;
+    backup(r);
+    std::rotate(route.nodes.begin() + after + 1, route.nodes.begin() + first,
+                route.nodes.begin() + last + 1);
+  }
+  [[maybe_unused]] double expected = route.duration + delta;
+  rebuild(r);
+  place(r);
+  assert(std::fabs(route.duration - expected) <= 1e-6 * (1 + expected));
+  return commit();
+}
+
+bool RouteLocalSearch::tryRelocate(int a, int b) {
+  const int ra = routeOf[a], rb = routeOf[b];
+  const int pa = posOf[a], pb = posOf[b];
+  if (ra == rb)
+    return moveSegment(ra, pa, pa, pb) || moveSegment(ra, pa, pa, pb - 1);
+
+  Route &A = routes[ra], &B = routes[rb];
+  const Stop &stop = model.getStop(a);
+  const double service = model.serviceTime(a);
+  const int s = stop.station, q = stop.quantity;
+  double removal = travel(station(A, pa - 1), station(A, pa + 1)) -
+                   travel(station(A, pa - 1), s) -
+                   travel(s, station(A, pa + 1));
+  if (pa < A.size() && !loadOk(rangeMin(A, pa + 1, A.size()) - q,
+                               rangeMax(A, pa + 1, A.size()) - q))
+    return false;
+
+  for (int after : {pb, pb - 1}) {
+    stats.evaluated++;
+    double insertion = travel(station(B, after), s) +
+                       travel(s, station(B, after + 1)) -
+                       travel(station(B, after), station(B, after + 1));
+    if (!improves(removal + insertion, 0) ||
+        !durationOk(B.duration + insertion + service))
+      continue;
+    int here = B.load[after] + q;
+    if (!loadOk(here, here) ||
+        (after < B.size() && !loadOk(rangeMin(B, after + 1, B.size()) + q,
+                                     rangeMax(B, after + 1, B.size()) + q)))
+      continue;
+
+    [[maybe_unused]] double expectedA =
+        A.nodes.size() > 3 ? A.duration + removal - service : 0.0;
+    [[maybe_unused]] double expectedB = B.duration + insertion + service;
+    backup(ra);
+    backup(rb);
+    A.nodes.erase(A.nodes.begin() + pa);
+    B.nodes.insert(B.nodes.begin() + after + 1, a);
+    rebuild(ra);
+    rebuild(rb);
+    place(ra);
+    place(rb);
+    assert(std::fabs(A.duration - expectedA) <= 1e-6 * (1 + expectedA));
+    assert(std::fabs(B.duration - expectedB) <= 1e-6 * (1 + expectedB));
+    if (commit())
+      return true;
+  }
+  return false;
+}
+
+bool RouteLocalSearch::trySwap(int a, int b) {
+  stats.evaluated++;
+  const int ra = routeOf[a], rb = routeOf[b];
+  const Stop &stopA = model.getStop(a), &stopB = model.getStop(b);
+  const int sa = stopA.station, sb = stopB.station;
+  const int shift = stopB.quantity - stopA.quantity;
+
+  if (ra == rb) {
+    Route &route = routes[ra];
+    int i = std::min(posOf[a], posOf[b]), j = std::max(posOf[a], posOf[b]);
+    int x = station(route, i), y = station(route, j);
+    int before = station(route, i - 1), after = station(route, j + 1);
+    double delta;
+    if (j == i + 1)
+      delta = travel(before, y) + travel(y, x) + travel(x, after) -
+              travel(before, x) - travel(x, y) - travel(y, after);
+    else
+      delta = travel(before, y) + travel(y, station(route, i + 1)) -
+              travel(before, x) - travel(x, station(route, i + 1)) +
+              travel(station(route, j - 1), x) + travel(x, after) -
+              travel(station(route, j - 1), y) - travel(y, after);
+    if (!improves(delta, 0) || !durationOk(route.duration + delta))
+      return false;
+    // nodes i .. j - 1 now start from the other stop's quantity
+    int d = posOf[a] < posOf[b] ? shift : -shift;
+    if (!loadOk(rangeMin(route, i, j - 1) + d, rangeMax(route, i, j - 1) + d))
+      return false;
+    [[maybe_unused]] double expected = route.duration + delta;
+    backup(ra);
+    std::swap(route.nodes[i], route.nodes[j]);
+    rebuild(ra);
+    place(ra);
+    assert(std::fabs(route.duration - expected) <= 1e-6 * (1 + expected));
+    return commit();
+  }
+
+  Route &A = routes[ra], &B = routes[rb];
+  const int pa = posOf[a], pb = posOf[b];
+  const int beforeA = station(A, pa - 1), afterA = station(A, pa + 1);
+  const int beforeB = station(B, pb - 1), afterB = station(B, pb + 1);
+  double deltaA = travel(beforeA, sb) + travel(sb, afterA) -
+                  travel(beforeA, sa) - travel(sa, afterA);
+  double deltaB = travel(beforeB, sa) + travel(sa, afterB) -
+                  travel(beforeB, sb) - travel(sb, afterB);
+  const double serviceShift = model.serviceTime(b) - model.serviceTime(a);
+  if (!improves(deltaA + deltaB, 0) ||
+      !durationOk(A.duration + deltaA + serviceShift) ||
+      !durationOk(B.duration + deltaB - serviceShift))
+    return false;
+  if (!loadOk(rangeMin(A, pa, A.size()) + shift,
+              rangeMax(A, pa, A.size()) + shift) ||
+      !loadOk(rangeMin(B, pb, B.size()) - shift,
+              rangeMax(B, pb, B.size()) - shift))
+    return false;
+
+  [[maybe_unused]] double expectedA = A.duration + deltaA + serviceShift;
+  [[maybe_unused]] double expectedB = B.duration + deltaB - serviceShift;
+  backup(ra);
+  backup(rb);
+  std::swap(A.nodes[pa], B.nodes[pb]);
+  rebuild(ra);
+  rebuild(rb);
+  place(ra);
+  place(rb);
+  assert(std::fabs(A.duration - expectedA) <= 1e-6 * (1 + expectedA));
+  assert(std::fabs(B.duration - expectedB) <= 1e-6 * (1 + expectedB));
+  return commit();
+}
+
+bool RouteLocalSearch::tryTwoOpt(int a, int b) {
+  const int r = routeOf[a];
+  if (routeOf[b] != r)
+    return false;
+  stats.evaluated++;
+  Route &route = routes[r];
+  // reverse so that a and b become adjacent
+  int i, j;
+  if (posOf[a] < posOf[b]) {
+    i = posOf[a] + 1;
+    j = posOf[b];
+  } else {
+    i = posOf[b];
+    j = posOf[a] - 1;
+  }
+  if (j <= i)
+    return false;
+
+  double delta = travel(station(route, i - 1), station(route, j)) +
+                 travel(station(route, i), station(route, j + 1)) -
+                 travel(station(route, i - 1), station(route, i)) -
+                 travel(station(route, j), station(route, j + 1)) +
+                 (route.bwd[j] - route.bwd[i]) - (route.fwd[j] - route.fwd[i]);
+  if (!improves(delta, 0) || !durationOk(route.duration + delta))
+    return false;
+  // after reversal, node i + t carries load[i-1] + load[j] - load[j-t-1]
+  const int base = route.load[i - 1] + route.load[j];
+  if (!loadOk(base - rangeMax(route, i - 1, j - 1),
+              base - rangeMin(route, i - 1, j - 1)))
+    return false;
+
+  [[maybe_unused]] double expected = route.duration + delta;
+  backup(r);
+  std::reverse(route.nodes.begin() + i, route.nodes.begin() + j + 1);
+  rebuild(r);
+  place(r);
+  assert(std::fabs(route.duration - expected) <= 1e-6 * (1 + expected));
+  return commit();
+}
+
+bool RouteLocalSearch::tryOrOpt(int a, int b) {
+  const int r = routeOf[a];
+  if (routeOf[b] != r)
+    return false;
+  const int first = posOf[a], pb = posOf[b];
+  for (int length = 2; length <= 3; ++length) {
+    int last = first + length - 1;
+    if (last > routes[r].size())
+      break;
+    if (moveSegment(r, first, last, pb) || moveSegment(r, first, last, pb - 1))
+      return true;
+  }
+  return false;
+}
+
+bool RouteLocalSearch::tryTupleSwap(int a, int b) {
+  const int ra = routeOf[a], rb = routeOf[b];
+  const int ta = model.getStop(a).tuple, tb = model.getStop(b).tuple;
+  if (ra == rb || ta == tb)
+    return false;
+  stats.evaluated++;
+  Route &A = routes[ra], &B = routes[rb];
+
+  // the runs of consecutive stops of each tuple around a and b
+  auto run = [this](const Route &route, int pos, int tuple, int &first,
+                    int &last) {
+    first = last = pos;
+    while (route.nodes[first - 1] >= 0 &&
+           model.getStop(route.nodes[first - 1]).tuple == tuple)
+      --first;
+    while (route.nodes[last + 1] >= 0 &&
+           model.getStop(route.nodes[last + 1]).tuple == tuple)
+      ++last;
+  };
+  int i1, j1, i2, j2;
+  run(A, posOf[a], ta, i1, j1);
+  run(B, posOf[b], tb, i2, j2);
+
+  const double innerA = A.fwd[j1] - A.fwd[i1], innerB = B.fwd[j2] - B.fwd[i2];
+  double deltaA = travel(station(A, i1 - 1), station(B, i2)) +
+                  travel(station(B, j2), station(A, j1 + 1)) + innerB -
+                  travel(station(A, i1 - 1), station(A, i1)) -
+                  travel(station(A, j1), station(A, j1 + 1)) - innerA;
+  double deltaB = travel(station(B, i2 - 1), station(A, i1)) +
+                  travel(station(A, j1), station(B, j2 + 1)) + innerA -
+                  travel(station(B, i2 - 1), station(B, i2)) -
+                  travel(station(B, j2), station(B, j2 + 1)) - innerB;
+  const double svcA = A.svc[j1] - A.svc[i1 - 1];
+  const double svcB = B.svc[j2] - B.svc[i2 - 1];
+  if (!improves(deltaA + deltaB, 0) ||
+      !durationOk(A.duration + deltaA + svcB - svcA) ||
+      !durationOk(B.duration + deltaB + svcA - svcB))
+    return false;
+
+  const int qa = A.load[j1] - A.load[i1 - 1], qb = B.load[j2] - B.load[i2 - 1];
+  // the incoming run starts from the load in front of the outgoing one
+  if (!loadOk(A.load[i1 - 1] - B.load[i2 - 1] + rangeMin(B, i2, j2),
+              A.load[i1 - 1] - B.load[i2 - 1] + rangeMax(B, i2, j2)) ||
+      !loadOk(B.load[i2 - 1] - A.load[i1 - 1] + rangeMin(A, i1, j1),
+              B.load[i2 - 1] - A.load[i1 - 1] + rangeMax(A, i1, j1)))
+    return false;
+  if ((j1 < A.size() && !loadOk(rangeMin(A, j1 + 1, A.size()) + qb - qa,
+                                rangeMax(A, j1 + 1, A.size()) + qb - qa)) ||
+      (j2 < B.size() && !loadOk(rangeMin(B, j2 + 1, B.size()) + qa - qb,
+                                rangeMax(B, j2 + 1, B.size()) + qa - qb)))
+    return false;
+
+  [[maybe_unused]] double expectedA = A.duration + deltaA + svcB - svcA;
+  [[maybe_unused]] double expectedB = B.duration + deltaB + svcA - svcB;
+  backup(ra);
+  backup(rb);
+  routeScratch.assign(A.nodes.begin() + i1, A.nodes.begin() + j1 + 1);
+  A.nodes.erase(A.nodes.begin() + i1, A.nodes.begin() + j1 + 1);
+  A.nodes.insert(A.nodes.begin() + i1, B.nodes.begin() + i2,
+                 B.nodes.begin() + j2 + 1);
+  B.nodes.erase(B.nodes.begin() + i2, B.nodes.begin() + j2 + 1);
+  B.nodes.insert(B.nodes.begin() + i2, routeScratch.begin(),
+                 routeScratch.end());
+  rebuild(ra);
+  rebuild(rb);
+  place(ra);
+  place(rb);
+  assert(std::fabs(A.duration - expectedA) <= 1e-6 * (1 + expectedA));
+  assert(std::fabs(B.duration - expectedB) <= 1e-6 * (1 + expectedB));
+  return commit();
+}
+
+bool RouteLocalSearch::tryInsert(int a, int b) {
+  const Stop &stop = model.getStop(a);
+  if (!(stop.deltaUDF > 0))
+    return false;
+  const int rb = routeOf[b], pb = posOf[b];
+  Route &B = routes[rb];
+  const double service = model.serviceTime(a);
+  for (int after : {pb, pb - 1}) {
+    stats.evaluated++;
+    double insertion = travel(station(B, after), stop.station) +
+                       travel(stop.station, station(B, after + 1)) -
+                       travel(station(B, after), station(B, after + 1));
+    if (!improves(insertion + service, stop.deltaUDF) ||
+        !durationOk(B.duration + insertion + service))
+      continue;
+    int here = B.load[after] + stop.quantity;
+    if (!loadOk(here, here) ||
+        (after < B.size() &&
+         !loadOk(rangeMin(B, after + 1, B.size()) + stop.quantity,
+                 rangeMax(B, after + 1, B.size()) + stop.quantity)))
+      continue;
+
+    [[maybe_unused]] double expected = B.duration + insertion + service;
+    backup(rb);
+    B.nodes.insert(B.nodes.begin() + after + 1, a);
+    removeUnserved(a);
+    rebuild(rb);
+    place(rb);
+    assert(std::fabs(B.duration - expected) <= 1e-6 * (1 + expected));
+    if (commit())
+      return true;
+  }
+  return false;
+}
+
+bool RouteLocalSearch::tryInsertNewRoute(int a) {
+  const Stop &stop = model.getStop(a);
+  if (!(stop.deltaUDF > 0) || !loadOk(stop.quantity, stop.quantity))
+    return false;
+  for (int r = 0; r < (int)routes.size(); ++r) {
+    if (routes[r].size() > 0)
+      continue;
+    stats.evaluated++;
+    double duration = travel(0, stop.station) + model.serviceTime(a) +
+                      travel(stop.station, 0);
+    if (!improves(duration, stop.deltaUDF) || !durationOk(duration))
+      return false;
+    backup(r);
+    routes[r].nodes.insert(routes[r].nodes.begin() + 1, a);
+    removeUnserved(a);
+    rebuild(r);
+    place(r);
+    return commit();
+  }
+  return false;
+}
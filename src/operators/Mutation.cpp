@@ -0,0 +1,26 @@
+#include "operators/Mutation.hpp"
+#include <algorithm>
+
+void InversionMutation::mutate(Individual &individual, RandomEngine &rng) {
+  const int n = individual.getSize();
+  if (n < 2)
+    return;
+  int first = rng.below(n), last = rng.below(n);
+  if (first > last)
+    std::swap(first, last);
+  std::reverse(individual.begin() + first, individual.begin() + last + 1);
+  individual.evaluated = false;
+}
+
+void RelocateMutation::mutate(Individual &individual, RandomEngine &rng) {
+  const int n = individual.getSize();
+  if (n < 2)
+    return;
+  int from = rng.below(n), to = rng.below(n);
+  int *genes = individual.begin();
+  if (from < to)
+    std::rotate(genes + from, genes + from + 1, genes + to + 1);
+  else if (to < from)
+    std::rotate(genes + to, genes + from, genes + from + 1);
+  individual.evaluated = false;
+}
@@ -0,0 +1,247 @@
+#include "operators/Repair.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+LoadFeasibilityRepair::LoadFeasibilityRepair(const RoutingModel &model)
+    : model(model) {
+  const int n = model.getNumStops();
+  routes.resize(std::max(0, model.getNumVehicles()));
+  for (Route &route : routes) {
+    route.nodes.reserve(n + 2);
+    route.load.reserve(n + 2);
+    route.prefixMin.reserve(n + 2);
+    route.prefixMax.reserve(n + 2);
+    route.suffixMin.reserve(n + 2);
+    route.suffixMax.reserve(n + 2);
+  }
+  routeOf.assign(n, -1);
+  posOf.assign(n, -1);
+  pending.reserve(n);
+  original.resize(n);
+  pickupsKept.assign(model.getNumTuples(), 0);
+}
+
+int LoadFeasibilityRepair::station(const Route &route, int pos) const {
+  int stop = route.nodes[pos];
+  return stop < 0 ? 0 : model.getStop(stop).station;
+}
+
+void LoadFeasibilityRepair::rebuild(int r) {
+  Route &route = routes[r];
+  const int m = static_cast<int>(route.nodes.size());
+  route.load.resize(m);
+  route.prefixMin.resize(m);
+  route.prefixMax.resize(m);
+  route.suffixMin.resize(m);
+  route.suffixMax.resize(m);
+  route.duration = 0.0;
+  route.load[0] = 0;
+  for (int p = 1; p < m; ++p) {
+    int stop = route.nodes[p];
+    route.load[p] =
+        route.load[p - 1] + (stop < 0 ? 0 : model.getStop(stop).quantity);
+    route.duration +=
+        model.travelTime(station(route, p - 1), station(route, p));
+    if (stop >= 0) {
+      route.duration += model.serviceTime(stop);
+      routeOf[stop] = r;
+      posOf[stop] = p;
+    }
+  }
+  route.prefixMin[0] = route.prefixMax[0] = route.load[0];
+  for (int p = 1; p < m; ++p) {
+    route.prefixMin[p] = std::min(route.prefixMin[p - 1], route.load[p]);
+    route.prefixMax[p] = std::max(route.prefixMax[p - 1], route.load[p]);
+  }
+  route.suffixMin[m - 1] = route.suffixMax[m - 1] = route.load[m - 1];
+  for (int p = m - 2; p >= 0; --p) {
+    route.suffixMin[p] = std::min(route.suffixMin[p + 1], route.load[p]);
+    route.suffixMax[p] = std::max(route.suffixMax[p + 1], route.load[p]);
+  }
+  assert(route.prefixMin[m - 1] >= 0 &&
+         route.prefixMax[m - 1] <= model.getVehicleCapacity());
+}
+
+void LoadFeasibilityRepair::filter(int r) {
+  Route &route = routes[r];
+  const int capacity = model.getVehicleCapacity();
+  const bool precedence = model.getOptions().tuplePrecedence;
+  const double limit = model.getOptions().routeTimeLimit;
+
+  // keep the stops that fit, in order; the rest become pending
+  int load = 0, kept = 1, last = 0;
+  double time = 0.0;
+  for (int p = 1; p <= route.size(); ++p) {
+    int stop = route.nodes[p];
+    const Stop &s = model.getStop(stop);
+    bool fits = load + s.quantity >= 0 && load + s.quantity <= capacity;
+    if (fits && precedence && s.quantity < 0)
+      fits = pickupsKept[s.tuple] == model.getTuplePickups(s.tuple);
+    double newTime = time + model.travelTime(last, s.station) +
+                     model.serviceTime(stop);
+    if (fits && newTime + model.travelTime(s.station, 0) > limit)
+      fits = false;
+    if (!fits) {
+      routeOf[stop] = posOf[stop] = -1;
+      pending.push_back(stop);
+      stats.removed++;
+      continue;
+    }
+    load += s.quantity;
+    time = newTime;
+    last = s.station;
+    if (s.quantity > 0)
+      pickupsKept[s.tuple]++;
+    route.nodes[kept++] = stop;
+  }
+  route.nodes[kept] = -1;
+  route.nodes.resize(kept + 1);
+  // reset the counters this route touched
+  for (int p = 1; p <= route.size(); ++p)
+    pickupsKept[model.getStop(route.nodes[p]).tuple] = 0;
+  rebuild(r);
+}
+
+bool LoadFeasibilityRepair::precedenceOk(int r, int after, int stop) const {
+  if (!model.getOptions().tuplePrecedence)
+    return true;
+  const Stop &s = model.getStop(stop);
+  for (int other = model.getTupleBegin(s.tuple);
+       other < model.getTupleEnd(s.tuple); ++other) {
+    if (other == stop)
+      continue;
+    const int quantity = model.getStop(other).quantity;
+    if (s.quantity < 0 && quantity > 0 &&
+        (routeOf[other] != r || posOf[other] > after))
+      return false; // a pickup of the tuple is missing or comes later
+    if (s.quantity > 0 && quantity < 0 && routeOf[other] == r &&
+        posOf[other] <= after)
+      return false; // a drop of the tuple would come first
+  }
+  return true;
+}
+
+bool LoadFeasibilityRepair::insert(int stop) {
+  const Stop &s = model.getStop(stop);
+  const int capacity = model.getVehicleCapacity();
+  const double limit = model.getOptions().routeTimeLimit;
+  const double service = model.serviceTime(stop);
+
+  int bestRoute = -1, bestAfter = -1;
+  double bestCost = std::numeric_limits<double>::infinity();
+  bool emptyTried = false;
+  for (int r = 0; r < (int)routes.size(); ++r) {
+    const Route &route = routes[r];
+    if (route.size() == 0) {
+      if (emptyTried) // all empty vehicles are alike
+        continue;
+      emptyTried = true;
+    }
+    for (int after = 0; after <= route.size(); ++after) {
+      stats.candidates++;
+      // O(1): the stop's own load, then everything behind it shifts
+      int here = route.load[after] + s.quantity;
+      if (here < 0 || here > capacity)
+        continue;
+      if (after < route.size() &&
+          (route.suffixMin[after + 1] + s.quantity < 0 ||
+           route.suffixMax[after + 1] + s.quantity > capacity))
+        continue;
+      int prev = station(route, after), next = station(route, after + 1);
+      double cost = model.travelTime(prev, s.station) +
+                    model.travelTime(s.station, next) -
+                    model.travelTime(prev, next) + service;
+      if (cost >= bestCost || route.duration + cost > limit ||
+          !precedenceOk(r, after, stop))
+        continue;
+      bestCost = cost;
+      bestRoute = r;
+      bestAfter = after;
+    }
+  }
+  if (bestRoute < 0)
+    return false;
+  Route &route = routes[bestRoute];
+  route.nodes.insert(route.nodes.begin() + bestAfter + 1, stop);
+  rebuild(bestRoute);
+  stats.reinserted++;
+  return true;
+}
+
+void LoadFeasibilityRepair::repair(Individual &individual) {
+  const int n = individual.getSize();
+  if (n == 0 || routes.empty())
+    return;
+  stats.repaired++;
+
+  std::copy(individual.begin(), individual.end(), original.begin());
+  if (!individual.evaluated) {
+    individual.evaluate(model);
+    evaluations++;
+  }
+  const RouteEvaluation before = individual.evaluation;
+
+  // cut the child into consecutive routes on the time limit alone, so the
+  // filter sees its load and precedence violations as they are
+  const double limit = model.getOptions().routeTimeLimit;
+  for (Route &route : routes)
+    route.nodes.assign(1, -1);
+  pending.clear();
+  int r = 0, last = 0;
+  double time = 0.0;
+  for (int id : individual) {
+    routeOf[id] = posOf[id] = -1;
+    const Stop &stop = model.getStop(id);
+    double step = model.travelTime(last, stop.station) + model.serviceTime(id);
+    if (routes[r].size() > 0 &&
+        time + step + model.travelTime(stop.station, 0) > limit &&
+        r + 1 < (int)routes.size()) {
+      r++;
+      time = 0.0;
+      step = model.travelTime(0, stop.station) + model.serviceTime(id);
+    }
+    routes[r].nodes.push_back(id);
+    time += step;
+    last = stop.station;
+  }
+  for (r = 0; r < (int)routes.size(); ++r) {
+    routes[r].nodes.push_back(-1);
+    filter(r);
+  }
+
+  // pickups before drops, tuple by tuple
+  std::sort(pending.begin(), pending.end(), [this](int a, int b) {
+    const Stop &sa = model.getStop(a), &sb = model.getStop(b);
+    if (sa.tuple != sb.tuple)
+      return sa.tuple < sb.tuple;
+    if ((sa.quantity > 0) != (sb.quantity > 0))
+      return sa.quantity > 0;
+    return a < b;
+  });
+  int out = 0;
+  for (int stop : pending)
+    if (!insert(stop))
+      pending[out++] = stop;
+  pending.resize(out);
+
+  out = 0;
+  for (const Route &route : routes)
+    for (int p = 1; p <= route.size(); ++p)
+      individual[out++] = route.nodes[p];
+  for (int stop : pending)
+    individual[out++] = stop;
+  assert(out == n);
+
+  // the decoder may cut the concatenation differently; keep the better tour
+  if (std::equal(original.begin(), original.end(), individual.begin()))
+    return;
+  individual.evaluate(model);
+  evaluations++;
+  if (individual.getObjective() < before.objective) {
+    std::copy(original.begin(), original.end(), individual.begin());
+    individual.evaluation = before;
+    stats.reverted++;
+  }
+}
@@ -0,0 +1,512 @@
+#include "pipeline/partition.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include "core/station_io.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/Timer.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <spawn.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <thread>
+#include <unordered_map>
+
+extern char **environ;
+
+namespace {
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+constexpr double kMetersPerDegree = 111320.0;
+
+// Equirectangular projection around the network's mean latitude: plenty
+// for splitting a metro area and measuring margins of a few hundred metres.
+struct Projection {
+  explicit Projection(const std::vector<Station> &stations) {
+    double latitude = 0.0;
+    for (size_t i = 1; i < stations.size(); ++i)
+      latitude += stations[i].getCoordinate().latitude;
+    if (stations.size() > 1)
+      latitude /= stations.size() - 1;
+    lonScale = kMetersPerDegree * std::cos(latitude * M_PI / 180.0);
+  }
+  double x(const Station &s) const {
+    return s.getCoordinate().longitude * lonScale;
+  }
+  double y(const Station &s) const {
+    return s.getCoordinate().latitude * kMetersPerDegree;
+  }
+  double lonScale;
+};
+
+// Cuts `indices` into `parts` leaves of proportional size.
+void kdSplit(std::vector<int> indices, int parts,
+             const std::vector<Station> &stations, const Projection &p,
+             std::vector<std::vector<int>> &leaves) {
+  if (parts <= 1 || indices.size() <= 1) {
+    std::sort(indices.begin(), indices.end());
+    leaves.push_back(std::move(indices));
+    return;
+  }
+  double minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+  for (int i : indices) {
+    minX = std::min(minX, p.x(stations[i]));
+    maxX = std::max(maxX, p.x(stations[i]));
+    minY = std::min(minY, p.y(stations[i]));
+    maxY = std::max(maxY, p.y(stations[i]));
+  }
+  const bool alongX = maxX - minX >= maxY - minY;
+  auto key = [&](int i) {
+    return std::make_pair(alongX ? p.x(stations[i]) : p.y(stations[i]), i);
+  };
+  const int left = parts / 2;
+  const size_t cut = indices.size() * left / parts;
+  std::nth_element(indices.begin(), indices.begin() + cut, indices.end(),
+                   [&](int a, int b) { return key(a) < key(b); });
+  std::vector<int> low(indices.begin(), indices.begin() + cut);
+  indices.erase(indices.begin(), indices.begin() + cut);
+  kdSplit(std::move(low), left, stations, p, leaves);
+  kdSplit(std::move(indices), parts - left, stations, p, leaves);
+}
+
+double metersOutside(const Region &region, const Station &station,
+                     const Projection &p) {
+  const Coordinate &c = station.getCoordinate();
+  const double dLat = std::max(
+      {region.minLatitude - c.latitude, 0.0, c.latitude - region.maxLatitude});
+  const double dLon =
+      std::max({region.minLongitude - c.longitude, 0.0,
+                c.longitude - region.maxLongitude});
+  return std::hypot(dLat * kMetersPerDegree, dLon * p.lonScale);
+}
+
+// The slice's rows and columns of a time_matrix.csv, read a row at a time
+// so that the full matrix is never in memory. Slices list station indices
+// (depot first) in ascending order; each gets the global depot's row.
+void writeMatrixSlices(const std::string &matrixPath,
+                       const std::vector<Station> &stations,
+                       const std::vector<std::vector<int>> &slices,
+                       const std::vector<std::string> &outputs) {
+  std::ifstream in(matrixPath);
+  if (!in)
+    throw std::runtime_error("Cannot open time matrix " + matrixPath);
+  std::vector<std::vector<int>> slicesOf(stations.size());
+  std::vector<std::ofstream> out;
+  for (size_t r = 0; r < slices.size(); ++r) {
+    out.emplace_back(outputs[r]);
+    if (!out.back())
+      throw std::runtime_error("Cannot write " + outputs[r]);
+    out.back().precision(17); // round-trips every double
+    out.back() << "From/To,depot";
+    slicesOf[0].push_back(static_cast<int>(r));
+    for (int station : slices[r]) {
+      out.back() << "," << stations[station].getSysId();
+      slicesOf[station].push_back(static_cast<int>(r));
+    }
+    out.back() << "\n";
+  }
+  std::string line;
+  std::getline(in, line); // header
+  std::vector<double> row(stations.size());
+  for (size_t i = 0; i < stations.size(); ++i) {
+    if (!std::getline(in, line))
+      throw std::runtime_error("Time matrix " + matrixPath + " is truncated");
+    if (slicesOf[i].empty())
+      continue;
+    std::stringstream ss(line);
+    std::string value;
+    std::getline(ss, value, ','); // row id
+    for (double &cell : row) {
+      std::getline(ss, value, ',');
+      cell = value.empty() ? 0.0 : std::stod(value);
+    }
+    for (int r : slicesOf[i]) {
+      out[r] << (i == 0 ? "depot" : stations[i].getSysId()) << "," << row[0];
+      for (int station : slices[r])
+        out[r] << "," << row[station];
+      out[r] << "\n";
+    }
+  }
+  for (size_t r = 0; r < out.size(); ++r)
+    if (!out[r].flush())
+      throw std::runtime_error("Cannot write " + outputs[r]);
+}
+
+struct Worker {
+  pid_t pid = 0;
+  Timer timer;
+};
+
+// Starts `command config` with its output in `log`.
+pid_t spawnWorker(const std::string &command, const std::string &config,
+                  const std::string &log) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, log.c_str(),
+                                   O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+  std::vector<char *> argv = {const_cast<char *>(command.c_str()),
+                              const_cast<char *>(config.c_str()), nullptr};
+  pid_t pid = 0;
+  const int error = posix_spawnp(&pid, command.c_str(), &actions, nullptr,
+                                 argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (error != 0)
+    throw std::runtime_error("Cannot start " + command + ": " +
+                             std::strerror(error));
+  return pid;
+}
+
+// Tuples of a worker's plan, in global station indices, one list per
+// cluster, with each cluster's global stations.
+struct RegionPlan {
+  std::vector<std::vector<int>> clusters;
+  std::vector<std::vector<TransferTuple>> tuples;
+};
+
+RegionPlan readRegionPlan(const std::string &path,
+                          const std::unordered_map<std::string, int> &index) {
+  std::ifstream in(path);
+  if (!in)
+    throw std::runtime_error("Cannot open region plan " + path);
+  const json plan = json::parse(in);
+  auto station = [&](const json &sysId) {
+    const auto found = index.find(sysId.get<std::string>());
+    if (found == index.end())
+      throw std::runtime_error(path + ": unknown station " +
+                               sysId.get<std::string>());
+    return found->second;
+  };
+  RegionPlan result;
+  for (const json &cluster : plan.at("clusters")) {
+    result.clusters.emplace_back();
+    for (const json &sysId : cluster.at("stations"))
+      result.clusters.back().push_back(station(sysId));
+    result.tuples.emplace_back();
+    for (const json &entry : cluster.at("tuples")) {
+      TransferTuple tuple;
+      tuple.deltaUDF = entry.at("deltaUDF").get<double>();
+      std::set<int> from, to;
+      for (const json &transfer : entry.at("transfers")) {
+        const int f = station(transfer.at("from"));
+        const int t = station(transfer.at("to"));
+        tuple.bikeAllocations[{f, t}] = transfer.at("bikes").get<int>();
+        from.insert(f);
+        to.insert(t);
+      }
+      tuple.surplusStationIndices.assign(from.begin(), from.end());
+      tuple.deficitStationIndices.assign(to.begin(), to.end());
+      result.tuples.back().push_back(std::move(tuple));
+    }
+  }
+  return result;
+}
+
+// `tuple` with the station indices of a slice mapped back to the network's.
+TransferTuple toGlobal(TransferTuple tuple, const std::vector<int> &slice) {
+  for (int &station : tuple.surplusStationIndices)
+    station = slice[station];
+  for (int &station : tuple.deficitStationIndices)
+    station = slice[station];
+  for (int &station : tuple.visitOrder)
+    station = slice[station];
+  std::map<std::pair<int, int>, int> allocations;
+  for (const auto &[pair, bikes] : tuple.bikeAllocations)
+    allocations[{slice[pair.first], slice[pair.second]}] = bikes;
+  tuple.bikeAllocations = std::move(allocations);
+  return tuple;
+}
+
+std::string absolute(const std::string &path) {
+  return path.empty() ? path : fs::absolute(path).lexically_normal().string();
+}
+
+} // namespace
+
+std::vector<Region> partitionStations(const std::vector<Station> &stations,
+                                      int regions, double marginMeters) {
+  if (regions < 1 || marginMeters < 0)
+    throw std::invalid_argument(
+        "partitionStations: regions must be positive, the margin not "
+        "negative");
+  const Projection projection(stations);
+  std::vector<int> all;
+  for (size_t i = 1; i < stations.size(); ++i)
+    all.push_back(static_cast<int>(i));
+  std::vector<std::vector<int>> leaves;
+  kdSplit(std::move(all), regions, stations, projection, leaves);
+
+  std::vector<Region> result;
+  std::vector<int> ownerOf(stations.size(), -1);
+  for (std::vector<int> &owned : leaves) {
+    if (owned.empty())
+      continue;
+    Region region;
+    region.minLatitude = region.minLongitude = INFINITY;
+    region.maxLatitude = region.maxLongitude = -INFINITY;
+    for (int i : owned) {
+      const Coordinate &c = stations[i].getCoordinate();
+      region.minLatitude = std::min(region.minLatitude, c.latitude);
+      region.maxLatitude = std::max(region.maxLatitude, c.latitude);
+      region.minLongitude = std::min(region.minLongitude, c.longitude);
+      region.maxLongitude = std::max(region.maxLongitude, c.longitude);
+      ownerOf[i] = static_cast<int>(result.size());
+    }
+    region.owned = std::move(owned);
+    result.push_back(std::move(region));
+  }
+  for (size_t r = 0; r < result.size(); ++r)
+    for (size_t i = 1; i < stations.size(); ++i)
+      if (ownerOf[i] != static_cast<int>(r) &&
+          metersOutside(result[r], stations[i], projection) <= marginMeters)
+        result[r].halo.push_back(static_cast<int>(i));
+  return result;
+}
+
+PartitionedResult runPartitioned(const PipelineConfig &config,
+                                 const PartitionOptions &options) {
+  PROFILE_SCOPE("partitioned");
+  if (options.workDirectory.empty())
+    throw std::invalid_argument("runPartitioned: no work directory");
+  if (options.maxSeamClusterStations < 2)
+    throw std::invalid_argument(
+        "runPartitioned: seam clusters need at least 2 stations");
+  Timer timer;
+  PartitionedResult result;
+  std::vector<Station> &stations = result.plan.stations;
+  {
+    std::ifstream file(config.instance, std::ios::binary);
+    if (!file)
+      throw std::runtime_error("Cannot open station file " + config.instance);
+    stations = ProblemInstance(isStationsBinary(file)
+                                   ? readStationsBinary(file)
+                                   : readStationsCsv(file),
+                               false)
+                   .getStations();
+  }
+  std::unordered_map<std::string, int> index;
+  for (size_t i = 1; i < stations.size(); ++i)
+    index.emplace(stations[i].getSysId(), static_cast<int>(i));
+  result.regions =
+      partitionStations(stations, options.regions, options.marginMeters);
+  const std::vector<Region> &regions = result.regions;
+
+  // region files
+  const fs::path dir = fs::absolute(options.workDirectory);
+  fs::create_directories(dir);
+  auto file = [&dir](size_t r, const char *suffix) {
+    return (dir / ("region-" + std::to_string(r) + suffix)).string();
+  };
+  std::vector<std::vector<int>> slices;
+  for (size_t r = 0; r < regions.size(); ++r) {
+    std::vector<int> slice = regions[r].owned;
+    slice.insert(slice.end(), regions[r].halo.begin(), regions[r].halo.end());
+    std::sort(slice.begin(), slice.end());
+    std::vector<Station> sliceStations;
+    for (int station : slice)
+      sliceStations.push_back(stations[station]);
+    std::ofstream out(file(r, ".bin"), std::ios::binary);
+    writeStationsBinary(out, sliceStations);
+    if (!out.flush())
+      throw std::runtime_error("Cannot write " + file(r, ".bin"));
+
+    RegionReport report;
+    report.k = std::max(
+        1, static_cast<int>(std::lround(static_cast<double>(config.k) *
+                                        slice.size() / (stations.size() - 1))));
+    PipelineConfig regionConfig = config;
+    regionConfig.instance = file(r, ".bin");
+    regionConfig.timeMatrix =
+        config.timeMatrix.empty() ? "" : file(r, ".matrix.csv");
+    regionConfig.cache = absolute(config.cache);
+    regionConfig.output = file(r, ".plan.json");
+    regionConfig.k = report.k;
+    std::ofstream configFile(file(r, ".json"));
+    configFile << regionConfig.toJson().dump(2) << "\n";
+    if (!configFile.flush())
+      throw std::runtime_error("Cannot write " + file(r, ".json"));
+    result.reports.push_back(report);
+    slices.push_back(std::move(slice));
+  }
+  if (!config.timeMatrix.empty()) {
+    std::vector<std::string> outputs;
+    for (size_t r = 0; r < regions.size(); ++r)
+      outputs.push_back(file(r, ".matrix.csv"));
+    writeMatrixSlices(config.timeMatrix, stations, slices, outputs);
+  }
+
+  // workers, options.jobs at a time
+  unsigned jobs =
+      options.jobs ? options.jobs : std::thread::hardware_concurrency();
+  jobs = std::max(1u, jobs);
+  std::map<pid_t, size_t> running;
+  std::vector<Worker> workers(regions.size());
+  std::vector<std::string> failures;
+  for (size_t next = 0; next < regions.size() || !running.empty();) {
+    if (next < regions.size() && running.size() < jobs) {
+      fs::remove(file(next, ".plan.json"));
+      workers[next].timer.reset();
+      try {
+        workers[next].pid = spawnWorker(
+            options.workerCommand, file(next, ".json"), file(next, ".log"));
+      } catch (const std::runtime_error &e) {
+        failures.push_back(e.what());
+        next = regions.size(); // start no more, wait for the running ones
+        continue;
+      }
+      running[workers[next].pid] = next;
+      ++next;
+      continue;
+    }
+    int status = 0;
+    const pid_t pid = ::waitpid(-1, &status, 0);
+    const auto done = running.find(pid);
+    if (done == running.end())
+      continue; // not one of ours, or interrupted
+    const size_t r = done->second;
+    running.erase(done);
+    result.reports[r].seconds = workers[r].timer.elapsed();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      failures.push_back("region " + std::to_string(r) +
+                         " worker failed, see " + file(r, ".log"));
+  }
+  if (!failures.empty())
+    throw std::runtime_error(failures.front());
+
+  // keep each region's tuples clear of the seam
+  std::vector<bool> seam(stations.size(), false), used(stations.size(), false);
+  for (const Region &region : regions)
+    for (int station : region.halo)
+      seam[station] = true;
+  std::vector<int> ownerOf(stations.size(), -1);
+  for (size_t r = 0; r < regions.size(); ++r)
+    for (int station : regions[r].owned)
+      ownerOf[station] = static_cast<int>(r);
+  for (size_t r = 0; r < regions.size(); ++r) {
+    const RegionPlan plan = readRegionPlan(file(r, ".plan.json"), index);
+    RegionReport &report = result.reports[r];
+    for (size_t c = 0; c < plan.clusters.size(); ++c) {
+      SelectionResult selection;
+      for (const TransferTuple &tuple : plan.tuples[c]) {
+        bool inside = true;
+        for (const auto &[pair, bikes] : tuple.bikeAllocations)
+          for (int station : {pair.first, pair.second})
+            inside = inside && ownerOf[station] == static_cast<int>(r) &&
+                     !seam[station];
+        if (!inside) {
+          for (const auto &[pair, bikes] : tuple.bikeAllocations)
+            for (int station : {pair.first, pair.second})
+              if (ownerOf[station] == static_cast<int>(r))
+                seam[station] = true;
+          ++report.tuplesDropped;
+          continue;
+        }
+        for (const auto &[pair, bikes] : tuple.bikeAllocations)
+          used[pair.first] = used[pair.second] = true;
+        selection.totalDeltaUDF += tuple.deltaUDF;
+        selection.selected.push_back(tuple);
+      }
+      report.tuplesKept += selection.selected.size();
+      report.deltaUDF += selection.totalDeltaUDF;
+      std::vector<int> cluster;
+      for (int station : plan.clusters[c])
+        if (ownerOf[station] == static_cast<int>(r))
+          cluster.push_back(station);
+      result.plan.clusters.push_back(std::move(cluster));
+      result.plan.selections.push_back(std::move(selection));
+    }
+  }
+
+  // seam stations: those near a boundary and those of the dropped tuples,
+  // unless a kept tuple already uses them
+  std::vector<int> pool;
+  for (size_t i = 1; i < stations.size(); ++i)
+    if (seam[i] && !used[i])
+      pool.push_back(static_cast<int>(i));
+  for (std::vector<int> &cluster : result.plan.clusters)
+    cluster.erase(std::remove_if(cluster.begin(), cluster.end(),
+                                 [&](int s) { return seam[s] && !used[s]; }),
+                  cluster.end());
+  std::vector<std::vector<int>> seamClusters;
+  if (!pool.empty()) {
+    const int parts = static_cast<int>(
+        (pool.size() + options.maxSeamClusterStations - 1) /
+        options.maxSeamClusterStations);
+    kdSplit(pool, parts, stations, Projection(stations), seamClusters);
+  }
+  // evaluated the way a worker evaluates its region: on the pool's slice
+  // (depot first) with BCRF, route scoring and time matrix as configured
+  std::vector<int> slice = {0};
+  slice.insert(slice.end(), pool.begin(), pool.end());
+  std::vector<int> localOf(stations.size(), -1);
+  std::vector<Station> seamStations;
+  for (size_t i = 0; i < slice.size(); ++i) {
+    localOf[slice[i]] = static_cast<int>(i);
+    seamStations.push_back(stations[slice[i]]);
+  }
+  Param param(config.tLoad, config.alpha, config.beta,
+              static_cast<int>(stations.size()) - 1, config.k, 1,
+              config.vehicleCapacity);
+  MetricCalculator::computeBCRF(seamStations, param);
+  std::vector<std::vector<double>> seamMatrix;
+  TupleClusterEvaluator evaluator(config.maxSurplus, config.maxDeficit);
+  if (config.routeScoring && !pool.empty()) {
+    if (config.timeMatrix.empty()) {
+      seamMatrix = ProblemInstance::computeTimeMatrix(seamStations);
+    } else {
+      const std::string seamFile = (dir / "seam.matrix.csv").string();
+      writeMatrixSlices(config.timeMatrix, stations, {pool}, {seamFile});
+      std::ifstream in(seamFile);
+      seamMatrix = ProblemInstance::readTimeMatrix(in, seamStations);
+    }
+    evaluator.enableRouteScoring(seamMatrix, param);
+  }
+  std::vector<std::vector<int>> localClusters;
+  for (const std::vector<int> &cluster : seamClusters) {
+    localClusters.emplace_back();
+    for (int station : cluster)
+      localClusters.back().push_back(localOf[station]);
+  }
+  NetworkEvaluationOptions evaluation;
+  evaluation.threads = config.threads;
+  evaluation.selection = config.selection;
+  const NetworkPlan seamPlan =
+      evaluator.evaluateNetwork(localClusters, seamStations, evaluation);
+  for (size_t c = 0; c < seamClusters.size(); ++c) {
+    SelectionResult selection;
+    for (const TransferTuple &tuple : seamPlan.clusters[c].assignedTuples)
+      selection.selected.push_back(toGlobal(tuple, slice));
+    selection.totalDeltaUDF = seamPlan.clusters[c].totalDeltaUDF;
+    result.plan.clusters.push_back(seamClusters[c]);
+    result.plan.selections.push_back(std::move(selection));
+  }
+  result.seamStations = pool.size();
+  result.seamClusters = seamClusters.size();
+  result.seamDeltaUDF = seamPlan.totalDeltaUDF;
+
+  for (const SelectionResult &selection : result.plan.selections)
+    result.plan.totalDeltaUDF += selection.totalDeltaUDF;
+  if (!config.output.empty()) {
+    std::ofstream out(config.output);
+    if (!out)
+      throw std::runtime_error("Cannot write plan " + config.output);
+    writePlanJson(out, result.plan);
+  }
+  result.seconds = timer.elapsed();
+  LOG_INFO("Partitioned plan: " << regions.size() << " regions, "
+                                << result.seamStations << " seam stations, "
+                                << "delta UDF " << result.plan.totalDeltaUDF);
+  return result;
+}
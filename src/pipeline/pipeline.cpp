@@ -0,0 +1,703 @@
+#include "pipeline/pipeline.hpp"
+#include "clustering/kmedoids.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include "core/station_io.hpp"
+#include "utils/ArtifactCache.hpp"
+#include "utils/BinaryIO.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/Timer.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using namespace BinaryIO;
+using nlohmann::json;
+
+// Artifacts: "BRPA", varint version, the stage name, then the stage's data.
+// Bump kVersion whenever a stage's computation or format changes, so that
+// stale artifacts stop matching.
+constexpr char kMagic[4] = {'B', 'R', 'P', 'A'};
+constexpr std::uint32_t kVersion = 1;
+constexpr const char *kReader = "pipeline artifact";
+
+void writeHeader(std::ostream &out, const std::string &stage) {
+  out.write(kMagic, sizeof(kMagic));
+  writeVarint(out, kVersion);
+  writeString(out, stage);
+}
+
+void readHeader(std::istream &in, const std::string &stage) {
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), kMagic))
+    throw std::runtime_error("not a pipeline artifact");
+  if (readVarint(in, kReader) != kVersion)
+    throw std::runtime_error("unsupported artifact version");
+  if (readString(in, kReader) != stage)
+    throw std::runtime_error("artifact of another stage");
+}
+
+// Counts are bounded before anything is allocated for them, so that a
+// corrupt one fails to read rather than exhausting memory.
+std::size_t readCount(std::istream &in, std::size_t limit) {
+  const std::uint64_t count = readVarint(in, kReader);
+  if (count > limit)
+    throw std::runtime_error(std::string(kReader) + ": malformed count");
+  return count;
+}
+
+constexpr std::size_t kMaxCount = std::size_t(1) << 32;
+
+void writeInts(std::ostream &out, const std::vector<int> &values) {
+  writeVarint(out, values.size());
+  for (int value : values)
+    writeSigned(out, value);
+}
+
+std::vector<int> readInts(std::istream &in) {
+  std::vector<int> values(readCount(in, 1 << 24));
+  for (int &value : values)
+    value = static_cast<int>(readSigned(in, kReader));
+  return values;
+}
+
+void writeDoubles(std::ostream &out, const std::vector<double> &values) {
+  writeVarint(out, values.size());
+  for (double value : values)
+    writeDouble(out, value);
+}
+
+std::vector<double> readDoubles(std::istream &in) {
+  std::vector<double> values(readCount(in, 1 << 24));
+  for (double &value : values)
+    value = readDouble(in, kReader);
+  return values;
+}
+
+void writeMatrix(std::ostream &out,
+                 const std::vector<std::vector<double>> &matrix) {
+  writeVarint(out, matrix.size());
+  for (const std::vector<double> &row : matrix)
+    writeDoubles(out, row);
+}
+
+std::vector<std::vector<double>> readMatrix(std::istream &in) {
+  std::vector<std::vector<double>> matrix(readCount(in, 1 << 24));
+  for (std::vector<double> &row : matrix)
+    row = readDoubles(in);
+  return matrix;
+}
+
+void writeTuple(std::ostream &out, const TransferTuple &tuple) {
+  writeInts(out, tuple.surplusStationIndices);
+  writeInts(out, tuple.deficitStationIndices);
+  writeVarint(out, tuple.bikeAllocations.size());
+  for (const auto &[stations, bikes] : tuple.bikeAllocations) {
+    writeSigned(out, stations.first);
+    writeSigned(out, stations.second);
+    writeSigned(out, bikes);
+  }
+  writeDouble(out, tuple.deltaUDF);
+  writeDouble(out, tuple.serviceTime);
+  writeInts(out, tuple.visitOrder);
+}
+
+// Station indices must be below `stations`.
+TransferTuple readTuple(std::istream &in, std::size_t stations) {
+  auto checked = [stations](std::vector<int> indices) {
+    for (int index : indices)
+      if (index < 0 || static_cast<std::size_t>(index) >= stations)
+        throw std::runtime_error("tuple station out of range");
+    return indices;
+  };
+  TransferTuple tuple;
+  tuple.surplusStationIndices = checked(readInts(in));
+  tuple.deficitStationIndices = checked(readInts(in));
+  for (std::size_t n = readCount(in, 1 << 16); n > 0; --n) {
+    const int from = static_cast<int>(readSigned(in, kReader));
+    const int to = static_cast<int>(readSigned(in, kReader));
+    checked({from, to});
+    tuple.bikeAllocations[{from, to}] =
+        static_cast<int>(readSigned(in, kReader));
+  }
+  tuple.deltaUDF = readDouble(in, kReader);
+  tuple.serviceTime = readDouble(in, kReader);
+  tuple.visitOrder = readInts(in);
+  return tuple;
+}
+
+void writeTuples(std::ostream &out, const std::vector<TransferTuple> &tuples) {
+  writeVarint(out, tuples.size());
+  for (const TransferTuple &tuple : tuples)
+    writeTuple(out, tuple);
+}
+
+std::vector<TransferTuple> readTuples(std::istream &in, std::size_t stations) {
+  std::vector<TransferTuple> tuples;
+  for (std::size_t n = readCount(in, kMaxCount); n > 0; --n)
+    tuples.push_back(readTuple(in, stations));
+  return tuples;
+}
+
+std::vector<Station> readStationFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("Cannot open station file " + path);
+  return isStationsBinary(file) ? readStationsBinary(file)
+                                : readStationsCsv(file);
+}
+
+enum Stage { LOAD, BCRF, COMPOSITE, CLUSTERING, TUPLES, SELECTION, EXPORT };
+const char *const kStageNames[] = {"load",       "bcrf",   "composite",
+                                   "clustering", "tuples", "selection",
+                                   "export"};
+constexpr int kStages = 7;
+
+// Resolves each stage on demand: from the cache if its artifact exists,
+// otherwise by resolving the stages it reads and computing it.
+class PipelineRunner {
+public:
+  explicit PipelineRunner(const PipelineConfig &config)
+      : config(config), cache(config.cache) {
+    for (int s = 0; s < kStages; ++s)
+      result.stages.push_back({kStageNames[s], "", StageStatus::NOT_NEEDED});
+  }
+
+  PipelineResult run() {
+    Timer timer;
+    computeKeys();
+    const double hashing = timer.elapsed();
+    stations();
+    result.stages[LOAD].seconds += hashing;
+    selection();
+    clusters();
+    // the stations go out with their BCRF even when a cached selection did
+    // not need it: the service plans further from them
+    bcrf();
+    for (const SelectionResult &cluster : result.selections)
+      result.totalDeltaUDF += cluster.totalDeltaUDF;
+    exportPlan();
+    result.timeMatrix = std::move(timeMatrix);
+    return std::move(result);
+  }
+
+  PipelineResult load() {
+    Timer timer;
+    computeKeys();
+    const double hashing = timer.elapsed();
+    stations();
+    result.stages[LOAD].seconds += hashing;
+    result.timeMatrix = std::move(timeMatrix);
+    return std::move(result);
+  }
+
+private:
+  void computeKeys() {
+    ContentHash load;
+    load.add("load").add(kVersion).addFile(config.instance);
+    if (config.timeMatrix.empty())
+      load.add("euclidean");
+    else
+      load.add("matrix").addFile(config.timeMatrix);
+    const std::string loadKey = load.hex();
+    const std::string bcrfKey =
+        ContentHash().add("bcrf").add(loadKey).add(config.tLoad).hex();
+    const std::string compositeKey = ContentHash()
+                                         .add("composite")
+                                         .add(loadKey)
+                                         .add(config.alpha)
+                                         .add(config.beta)
+                                         .hex();
+    const std::string clusteringKey = ContentHash()
+                                          .add("clustering")
+                                          .add(compositeKey)
+                                          .add(bcrfKey)
+                                          .add(config.k)
+                                          .add(config.lambda)
+                                          .add(config.maxIterations)
+                                          .add(config.convergenceThreshold)
+                                          .hex();
+    ContentHash tuples;
+    tuples.add("tuples").add(clusteringKey).add(loadKey);
+    tuples.add(config.maxSurplus).add(config.maxDeficit);
+    tuples.add(config.routeScoring);
+    if (config.routeScoring)
+      tuples.add(config.tLoad).add(config.vehicleCapacity);
+    tuples.add(static_cast<std::int64_t>(config.selection.maxCandidates));
+    if (config.selection.maxCandidates)
+      tuples.add(static_cast<int>(config.selection.score));
+    const std::string tuplesKey = tuples.hex();
+    const std::string selectionKey =
+        ContentHash()
+            .add("selection")
+            .add(tuplesKey)
+            .add(static_cast<int>(config.selection.strategy))
+            .add(static_cast<int>(config.selection.score))
+            .add(config.selection.strategy == SelectionStrategy::ANYTIME
+                     ? config.selection.timeLimitSeconds
+                     : 0.0)
+            .hex();
+    const std::string keys[] = {loadKey,       bcrfKey,   compositeKey,
+                                clusteringKey, tuplesKey, selectionKey,
+                                selectionKey};
+    for (int s = 0; s < kStages; ++s)
+      result.stages[s].key = keys[s];
+  }
+
+  // Loads the stage's artifact or, failing that, resolves its inputs and
+  // computes it; the time of the inputs is reported under their own names.
+  void resolve(Stage stage, const std::function<void(std::istream &)> &read,
+               const std::function<void()> &inputs,
+               const std::function<void()> &compute,
+               const std::function<void(std::ostream &)> &write) {
+    StageReport &report = result.stages[stage];
+    if (report.status != StageStatus::NOT_NEEDED)
+      return;
+    PROFILE_SCOPE(kStageNames[stage]);
+    Timer timer;
+    if (cache.load(report.name, report.key, [&](std::istream &in) {
+          readHeader(in, report.name);
+          read(in);
+        })) {
+      report.status = StageStatus::CACHED;
+      report.seconds = timer.elapsed();
+      return;
+    }
+    double seconds = timer.elapsed();
+    inputs();
+    timer.reset();
+    compute();
+    cache.store(report.name, report.key, [&](std::ostream &out) {
+      writeHeader(out, report.name);
+      write(out);
+    });
+    report.status = StageStatus::COMPUTED;
+    report.seconds = seconds + timer.elapsed();
+  }
+
+  // Stations without the depot, then the time matrix.
+  void stations() {
+    resolve(
+        LOAD,
+        [&](std::istream &in) {
+          result.stations =
+              ProblemInstance(readStationsBinary(in), false).getStations();
+          timeMatrix = readMatrix(in);
+          if (timeMatrix.size() != result.stations.size())
+            throw std::runtime_error("time matrix size mismatch");
+        },
+        [] {},
+        [&] {
+          ProblemInstance instance(readStationFile(config.instance),
+                                   config.timeMatrix.empty());
+          result.stations = instance.getStations();
+          if (config.timeMatrix.empty()) {
+            timeMatrix = instance.getTimeMatrix();
+          } else {
+            std::ifstream in(config.timeMatrix);
+            if (!in)
+              throw std::runtime_error("Cannot open time matrix " +
+                                       config.timeMatrix);
+            try {
+              timeMatrix = ProblemInstance::readTimeMatrix(in, result.stations);
+            } catch (const std::runtime_error &e) {
+              throw std::runtime_error(config.timeMatrix + ": " + e.what());
+            }
+          }
+        },
+        [&](std::ostream &out) {
+          writeStationsBinary(out, std::vector<Station>(
+                                       result.stations.begin() + 1,
+                                       result.stations.end()));
+          writeMatrix(out, timeMatrix);
+        });
+  }
+
+  void bcrf() {
+    resolve(
+        BCRF,
+        [&](std::istream &in) {
+          const std::vector<double> values = readDoubles(in);
+          if (values.size() != result.stations.size())
+            throw std::runtime_error("BCRF count mismatch");
+          for (size_t i = 0; i < values.size(); ++i)
+            result.stations[i].setBcrf(values[i]);
+        },
+        [] {},
+        [&] {
+          Param param = makeParam();
+          MetricCalculator::computeBCRF(result.stations, param);
+        },
+        [&](std::ostream &out) {
+          std::vector<double> values;
+          for (const Station &station : result.stations)
+            values.push_back(station.getBcrf());
+          writeDoubles(out, values);
+        });
+  }
+
+  void composite() {
+    resolve(
+        COMPOSITE,
+        [&](std::istream &in) {
+          compositeDistance = readMatrix(in);
+          if (compositeDistance.size() != result.stations.size())
+            throw std::runtime_error("composite matrix size mismatch");
+        },
+        [] {},
+        [&] {
+          compositeDistance = MetricCalculator::computeCompositeDistanceMatrix(
+              result.stations, timeMatrix, config.alpha, config.beta);
+        },
+        [&](std::ostream &out) { writeMatrix(out, compositeDistance); });
+  }
+
+  void clusters() {
+    resolve(
+        CLUSTERING,
+        [&](std::istream &in) {
+          result.clusters.assign(readCount(in, 1 << 24), {});
+          for (std::vector<int> &cluster : result.clusters) {
+            cluster = readInts(in);
+            for (int station : cluster)
+              if (station < 1 || station >= (int)result.stations.size())
+                throw std::runtime_error("cluster station out of range");
+          }
+        },
+        [&] {
+          bcrf();
+          composite();
+        },
+        [&] {
+          KMedoid kmedoid(result.stations, config.k);
+          kmedoid.setCompositeDistanceMatrix(compositeDistance);
+          result.clusters = kmedoid.run(
+              config.lambda, config.convergenceThreshold, config.maxIterations);
+        },
+        [&](std::ostream &out) {
+          writeVarint(out, result.clusters.size());
+          for (const std::vector<int> &cluster : result.clusters)
+            writeInts(out, cluster);
+        });
+  }
+
+  void tuples() {
+    resolve(
+        TUPLES,
+        [&](std::istream &in) {
+          clusterTuples.assign(readCount(in, 1 << 24), {});
+          for (std::vector<TransferTuple> &tuples : clusterTuples)
+            tuples = readTuples(in, result.stations.size());
+        },
+        [&] {
+          // the greedy transfer ranks stations by BCRF
+          bcrf();
+          clusters();
+        },
+        [&] { generateTuples(); },
+        [&](std::ostream &out) {
+          writeVarint(out, clusterTuples.size());
+          for (const std::vector<TransferTuple> &tuples : clusterTuples)
+            writeTuples(out, tuples);
+        });
+  }
+
+  void selection() {
+    resolve(
+        SELECTION,
+        [&](std::istream &in) {
+          result.selections.assign(readCount(in, 1 << 24), {});
+          for (SelectionResult &cluster : result.selections) {
+            cluster.selected = readTuples(in, result.stations.size());
+            cluster.totalDeltaUDF = readDouble(in, kReader);
+            cluster.totalScore = readDouble(in, kReader);
+            cluster.upperBound = readDouble(in, kReader);
+            cluster.gap = readDouble(in, kReader);
+            cluster.provedOptimal = readVarint(in, kReader) != 0;
+            cluster.nodesExplored = readVarint(in, kReader);
+            cluster.conflicts = readVarint(in, kReader);
+          }
+        },
+        [&] { tuples(); },
+        [&] {
+          TupleClusterEvaluator evaluator(config.maxSurplus,
+                                          config.maxDeficit);
+          result.selections.clear();
+          for (const std::vector<TransferTuple> &tuples : clusterTuples)
+            result.selections.push_back(
+                evaluator.selectExclusiveTuples(tuples, config.selection));
+        },
+        [&](std::ostream &out) {
+          writeVarint(out, result.selections.size());
+          for (const SelectionResult &cluster : result.selections) {
+            writeTuples(out, cluster.selected);
+            writeDouble(out, cluster.totalDeltaUDF);
+            writeDouble(out, cluster.totalScore);
+            writeDouble(out, cluster.upperBound);
+            writeDouble(out, cluster.gap);
+            writeVarint(out, cluster.provedOptimal);
+            writeVarint(out, cluster.nodesExplored);
+            writeVarint(out, cluster.conflicts);
+          }
+        });
+  }
+
+  void exportPlan() {
+    if (config.output.empty())
+      return;
+    StageReport &report = result.stages[EXPORT];
+    Timer timer;
+    std::ofstream out(config.output);
+    if (!out)
+      throw std::runtime_error("Cannot write plan " + config.output);
+    writePlanJson(out, result);
+    report.status = StageStatus::COMPUTED;
+    report.seconds = timer.elapsed();
+  }
+
+  // Clusters on a pool of threads, largest first, one evaluator each.
+  void generateTuples() {
+    const std::vector<std::vector<int>> &clusters = result.clusters;
+    clusterTuples.assign(clusters.size(), {});
+    std::vector<size_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return clusters[a].size() > clusters[b].size();
+    });
+    const Param param = makeParam();
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+      TupleClusterEvaluator evaluator(config.maxSurplus, config.maxDeficit);
+      if (config.routeScoring)
+        evaluator.enableRouteScoring(timeMatrix, param);
+      for (size_t i; (i = next.fetch_add(1)) < order.size();) {
+        const size_t c = order[i];
+        std::vector<int> surplus, deficit;
+        for (int station : clusters[c]) {
+          if (result.stations[station].getStatus() == StationStatus::SURPLUS)
+            surplus.push_back(station);
+          else if (result.stations[station].getStatus() ==
+                   StationStatus::DEFICIT)
+            deficit.push_back(station);
+        }
+        clusterTuples[c] = evaluator.generateCandidates(
+            surplus, deficit, result.stations, config.selection);
+      }
+    };
+    unsigned threads =
+        config.threads ? config.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min<unsigned>(threads, clusters.size()));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+      pool.emplace_back(work);
+    work();
+    for (std::thread &thread : pool)
+      thread.join();
+  }
+
+  Param makeParam() const {
+    return Param(config.tLoad, config.alpha, config.beta,
+                 static_cast<int>(result.stations.size()) - 1, config.k, 1,
+                 config.vehicleCapacity);
+  }
+
+  const PipelineConfig &config;
+  ArtifactCache cache;
+  PipelineResult result;
+  std::vector<std::vector<double>> timeMatrix, compositeDistance;
+  std::vector<std::vector<TransferTuple>> clusterTuples;
+};
+
+std::string resolvePath(const std::string &path, const std::string &base) {
+  if (path.empty() || base.empty() || std::filesystem::path(path).is_absolute())
+    return path;
+  return (std::filesystem::path(base) / path).lexically_normal().string();
+}
+
+} // namespace
+
+PipelineConfig PipelineConfig::fromJson(const nlohmann::json &config,
+                                        const std::string &baseDirectory) {
+  PipelineConfig c;
+  c.instance = resolvePath(config.value("instance", ""), baseDirectory);
+  if (c.instance.empty())
+    throw std::invalid_argument("Pipeline config: \"instance\" is required");
+  c.timeMatrix = resolvePath(config.value("timeMatrix", ""), baseDirectory);
+  c.cache = config.value("cache", "");
+  c.output = config.value("output", "");
+  c.threads = config.value("threads", 0u);
+
+  const json none = json::object();
+  const json &bcrf = config.contains("bcrf") ? config["bcrf"] : none;
+  c.tLoad = bcrf.value("tLoad", c.tLoad);
+  const json &composite =
+      config.contains("composite") ? config["composite"] : none;
+  c.alpha = composite.value("alpha", c.alpha);
+  c.beta = composite.value("beta", c.beta);
+  const json &clustering =
+      config.contains("clustering") ? config["clustering"] : none;
+  c.k = clustering.value("k", c.k);
+  c.lambda = clustering.value("lambda", c.lambda);
+  c.maxIterations = clustering.value("maxIterations", c.maxIterations);
+  c.convergenceThreshold =
+      clustering.value("convergenceThreshold", c.convergenceThreshold);
+  const json &tuples = config.contains("tuples") ? config["tuples"] : none;
+  c.maxSurplus = tuples.value("maxSurplus", c.maxSurplus);
+  c.maxDeficit = tuples.value("maxDeficit", c.maxDeficit);
+  c.routeScoring = tuples.value("routeScoring", c.routeScoring);
+  c.vehicleCapacity = tuples.value("vehicleCapacity", c.vehicleCapacity);
+  const json &selection =
+      config.contains("selection") ? config["selection"] : none;
+  const std::string strategy = selection.value("strategy", "greedy");
+  if (strategy == "greedy")
+    c.selection.strategy = SelectionStrategy::GREEDY;
+  else if (strategy == "anytime")
+    c.selection.strategy = SelectionStrategy::ANYTIME;
+  else
+    throw std::invalid_argument("Pipeline config: unknown strategy \"" +
+                                strategy + "\"");
+  const std::string score = selection.value("score", "deltaUDF");
+  if (score == "deltaUDF")
+    c.selection.score = TupleScore::DELTA_UDF;
+  else if (score == "deltaUDFPerTime")
+    c.selection.score = TupleScore::DELTA_UDF_PER_TIME;
+  else
+    throw std::invalid_argument("Pipeline config: unknown score \"" + score +
+                                "\"");
+  c.selection.timeLimitSeconds =
+      selection.value("timeLimitSeconds", c.selection.timeLimitSeconds);
+  c.selection.maxCandidates =
+      selection.value("maxCandidates", c.selection.maxCandidates);
+
+  if (c.k < 1 || c.maxSurplus < 1 || c.maxDeficit < 1 ||
+      c.maxIterations < 1 || c.vehicleCapacity < 1)
+    throw std::invalid_argument(
+        "Pipeline config: k, maxSurplus, maxDeficit, maxIterations and "
+        "vehicleCapacity must be positive");
+  return c;
+}
+
+json PipelineConfig::toJson() const {
+  json config = {
+      {"instance", instance},
+      {"threads", threads},
+      {"bcrf", {{"tLoad", tLoad}}},
+      {"composite", {{"alpha", alpha}, {"beta", beta}}},
+      {"clustering",
+       {{"k", k},
+        {"lambda", lambda},
+        {"maxIterations", maxIterations},
+        {"convergenceThreshold", convergenceThreshold}}},
+      {"tuples",
+       {{"maxSurplus", maxSurplus},
+        {"maxDeficit", maxDeficit},
+        {"routeScoring", routeScoring},
+        {"vehicleCapacity", vehicleCapacity}}},
+      {"selection",
+       {{"strategy", selection.strategy == SelectionStrategy::ANYTIME
+                         ? "anytime"
+                         : "greedy"},
+        {"score", selection.score == TupleScore::DELTA_UDF_PER_TIME
+                      ? "deltaUDFPerTime"
+                      : "deltaUDF"},
+        {"timeLimitSeconds", selection.timeLimitSeconds},
+        {"maxCandidates", selection.maxCandidates}}}};
+  if (!timeMatrix.empty())
+    config["timeMatrix"] = timeMatrix;
+  if (!cache.empty())
+    config["cache"] = cache;
+  if (!output.empty())
+    config["output"] = output;
+  return config;
+}
+
+PipelineConfig PipelineConfig::load(const std::string &path) {
+  std::ifstream in(path);
+  if (!in)
+    throw std::runtime_error("Cannot open pipeline config " + path);
+  return fromJson(json::parse(in),
+                  std::filesystem::path(path).parent_path().string());
+}
+
+void applyConfigOverride(nlohmann::json &config,
+                         const std::string &assignment) {
+  const size_t equals = assignment.find('=');
+  if (equals == std::string::npos || equals == 0)
+    throw std::invalid_argument("--set needs PATH=VALUE, got " + assignment);
+  std::string pointer = "/" + assignment.substr(0, equals);
+  for (char &c : pointer)
+    if (c == '.')
+      c = '/';
+  const std::string text = assignment.substr(equals + 1);
+  json value = json::parse(text, nullptr, false);
+  if (value.is_discarded())
+    value = text;
+  config[json::json_pointer(pointer)] = value;
+}
+
+PipelineResult runPipeline(const PipelineConfig &config) {
+  PROFILE_SCOPE("pipeline");
+  return PipelineRunner(config).run();
+}
+
+PipelineResult loadInstance(const PipelineConfig &config) {
+  return PipelineRunner(config).load();
+}
+
+const char *toString(StageStatus status) {
+  switch (status) {
+  case StageStatus::COMPUTED:
+    return "computed";
+  case StageStatus::CACHED:
+    return "cached";
+  case StageStatus::NOT_NEEDED:
+    return "not needed";
+  }
+  return "?";
+}
+
+void writePlanJson(std::ostream &out, const PipelineResult &result) {
+  json plan;
+  plan["totalDeltaUDF"] = result.totalDeltaUDF;
+  plan["clusters"] = json::array();
+  for (size_t c = 0; c < result.clusters.size(); ++c) {
+    json cluster;
+    cluster["stations"] = json::array();
+    for (int station : result.clusters[c])
+      cluster["stations"].push_back(result.stations[station].getSysId());
+    cluster["tuples"] = json::array();
+    if (c < result.selections.size()) {
+      cluster["deltaUDF"] = result.selections[c].totalDeltaUDF;
+      for (const TransferTuple &tuple : result.selections[c].selected) {
+        json transfers = json::array();
+        for (const auto &[stations, bikes] : tuple.bikeAllocations)
+          transfers.push_back(
+              {{"from", result.stations[stations.first].getSysId()},
+               {"to", result.stations[stations.second].getSysId()},
+               {"bikes", bikes}});
+        cluster["tuples"].push_back(
+            {{"deltaUDF", tuple.deltaUDF}, {"transfers", transfers}});
+      }
+    }
+    plan["clusters"].push_back(cluster);
+  }
+  plan["stages"] = json::array();
+  for (const StageReport &stage : result.stages)
+    plan["stages"].push_back({{"name", stage.name},
+                              {"key", stage.key},
+                              {"status", toString(stage.status)},
+                              {"seconds", stage.seconds}});
+  out << plan.dump(2) << "\n";
+}
@@ -0,0 +1,294 @@
+#include "pipeline/scenario_runner.hpp"
+#include "clustering/kmedoids.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "core/param.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/Random.hpp"
+#include "utils/Timer.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using Clusters = std::vector<std::vector<int>>;
+
+// Cluster of each station, -1 for none.
+std::vector<int> labelsOf(const Clusters &clusters, size_t stations) {
+  std::vector<int> labels(stations, -1);
+  for (size_t c = 0; c < clusters.size(); ++c)
+    for (int station : clusters[c])
+      labels[station] = static_cast<int>(c);
+  return labels;
+}
+
+// How many stations each pair of labels (one per clustering) shares;
+// label -1 is kept as a group of its own.
+struct Contingency {
+  Contingency(const std::vector<int> &a, const std::vector<int> &b)
+      : columns(*std::max_element(b.begin(), b.end()) + 2),
+        rowSums(*std::max_element(a.begin(), a.end()) + 2),
+        columnSums(columns), cells(rowSums.size() * columns) {
+    for (size_t i = 0; i < a.size(); ++i) {
+      ++cells[(a[i] + 1) * columns + b[i] + 1];
+      ++rowSums[a[i] + 1];
+      ++columnSums[b[i] + 1];
+    }
+  }
+
+  double adjustedRandIndex() const {
+    auto pairs = [](double n) { return n * (n - 1) / 2; };
+    double index = 0, rows = 0, cols = 0, all = 0;
+    for (long n : cells)
+      index += pairs(n);
+    for (long n : rowSums) {
+      rows += pairs(n);
+      all += n;
+    }
+    for (long n : columnSums)
+      cols += pairs(n);
+    const double expected = all > 1 ? rows * cols / pairs(all) : 0.0;
+    const double maximum = (rows + cols) / 2;
+    return maximum == expected ? 1.0
+                               : (index - expected) / (maximum - expected);
+  }
+
+  // |A ∩ B| / |A ∪ B| for the clusters A and B holding a station.
+  double jaccard(int a, int b) const {
+    const double shared = cells[(a + 1) * columns + b + 1];
+    return shared / (rowSums[a + 1] + columnSums[b + 1] - shared);
+  }
+
+  size_t columns;
+  std::vector<long> rowSums, columnSums, cells;
+};
+
+void fillSample(Xoshiro256 random, const std::vector<Station> &stations,
+                double noise, InventoryOverlay &overlay) {
+  overlay.assign(stations.size(), 0);
+  for (size_t i = 1; i < stations.size(); ++i) {
+    const int capacity = stations[i].getCapacity();
+    const double bikes = stations[i].getCurrentInventory() +
+                         noise * capacity * random.normal();
+    overlay[i] = std::clamp(static_cast<int>(std::lround(bikes)), 0, capacity);
+  }
+}
+
+} // namespace
+
+// One thread's share of the scenarios: its own working copy of the
+// stations, overlaid with each scenario's inventories in turn.
+class ScenarioRunner::Worker {
+public:
+  explicit Worker(const ScenarioRunner &runner)
+      : runner(runner), stations(*runner.stations),
+        stability(stations.size(), 0.0) {}
+
+  ScenarioOutcome run(const InventoryOverlay &overlay, Clusters &clusters) {
+    PROFILE_SCOPE("scenario");
+    Timer timer;
+    const PipelineConfig &config = runner.config;
+    ScenarioOutcome outcome;
+    for (size_t i = 1; i < stations.size(); ++i) {
+      stations[i].setCurrentInventory(overlay[i]);
+      outcome.surplusStations +=
+          stations[i].getStatus() == StationStatus::SURPLUS;
+      outcome.deficitStations +=
+          stations[i].getStatus() == StationStatus::DEFICIT;
+    }
+    Param param(config.tLoad, config.alpha, config.beta,
+                static_cast<int>(stations.size()) - 1, config.k, 1,
+                config.vehicleCapacity);
+    MetricCalculator::computeBCRF(stations, param);
+    KMedoid kmedoid(stations, config.k);
+    kmedoid.setCompositeDistanceMatrix(
+        MetricCalculator::computeCompositeDistanceMatrix(
+            stations, *runner.timeMatrix, config.alpha, config.beta));
+    clusters = kmedoid.run(config.lambda, config.convergenceThreshold,
+                           config.maxIterations);
+
+    TupleClusterEvaluator evaluator(config.maxSurplus, config.maxDeficit);
+    if (config.routeScoring)
+      evaluator.enableRouteScoring(*runner.timeMatrix, param);
+    NetworkEvaluationOptions options;
+    options.threads = 1; // parallel across scenarios instead
+    options.selection = config.selection;
+    outcome.totalDeltaUDF =
+        evaluator.evaluateNetwork(clusters, stations, options).totalDeltaUDF;
+    outcome.clusters = static_cast<int>(clusters.size());
+    outcome.seconds = timer.elapsed();
+    return outcome;
+  }
+
+  // Compares a scenario's clustering with the reference labels (depot
+  // excluded) and adds each station's Jaccard similarity to its total.
+  double compare(const Clusters &clusters, const std::vector<int> &reference) {
+    std::vector<int> labels = labelsOf(clusters, stations.size());
+    labels.erase(labels.begin());
+    const Contingency table(labels, reference);
+    for (size_t i = 0; i < labels.size(); ++i)
+      stability[i + 1] += table.jaccard(labels[i], reference[i]);
+    return table.adjustedRandIndex();
+  }
+
+  const ScenarioRunner &runner;
+  std::vector<Station> stations;
+  InventoryOverlay overlay;
+  std::vector<double> stability; // summed over this worker's scenarios
+};
+
+Distribution Distribution::of(std::vector<double> values) {
+  Distribution d;
+  if (values.empty())
+    return d;
+  std::sort(values.begin(), values.end());
+  auto quantile = [&values](double q) {
+    const double rank = q * (values.size() - 1);
+    const size_t below = static_cast<size_t>(rank);
+    const size_t above = std::min(below + 1, values.size() - 1);
+    return values[below] + (rank - below) * (values[above] - values[below]);
+  };
+  double sum = 0.0, squares = 0.0;
+  for (double value : values)
+    sum += value;
+  d.mean = sum / values.size();
+  for (double value : values)
+    squares += (value - d.mean) * (value - d.mean);
+  d.stddev = std::sqrt(squares / values.size());
+  d.min = values.front();
+  d.p05 = quantile(0.05);
+  d.p50 = quantile(0.5);
+  d.p95 = quantile(0.95);
+  d.max = values.back();
+  return d;
+}
+
+ScenarioRunner::ScenarioRunner(
+    std::shared_ptr<const std::vector<Station>> stations,
+    std::shared_ptr<const std::vector<std::vector<double>>> timeMatrix,
+    PipelineConfig config)
+    : stations(std::move(stations)), timeMatrix(std::move(timeMatrix)),
+      config(std::move(config)) {
+  if (!this->stations || !this->timeMatrix ||
+      this->timeMatrix->size() != this->stations->size())
+    throw std::invalid_argument(
+        "ScenarioRunner: stations and time matrix differ in size");
+}
+
+InventoryOverlay ScenarioRunner::sample(std::uint64_t seed,
+                                        std::uint64_t index,
+                                        double noise) const {
+  InventoryOverlay overlay;
+  fillSample(Xoshiro256::stream(seed, index), *stations, noise, overlay);
+  return overlay;
+}
+
+ScenarioSummary ScenarioRunner::run(const ScenarioOptions &options) const {
+  if (options.scenarios < 0 || options.inventoryNoise < 0)
+    throw std::invalid_argument(
+        "ScenarioRunner: scenarios and noise must not be negative");
+  // one stream per scenario, handed out in order, as sample() finds them
+  std::vector<Xoshiro256> streams;
+  Xoshiro256 root(options.seed);
+  for (int s = 0; s < options.scenarios; ++s)
+    streams.push_back(root.split());
+  return runAll(streams.size(), options.threads,
+                [&](size_t s, InventoryOverlay &overlay) {
+                  fillSample(streams[s], *stations, options.inventoryNoise,
+                             overlay);
+                });
+}
+
+ScenarioSummary
+ScenarioRunner::run(const std::vector<InventoryOverlay> &overlays,
+                    unsigned threads) const {
+  for (const InventoryOverlay &overlay : overlays) {
+    if (overlay.size() != stations->size())
+      throw std::invalid_argument("ScenarioRunner: overlay of " +
+                                  std::to_string(overlay.size()) +
+                                  " stations, expected " +
+                                  std::to_string(stations->size()));
+    for (size_t i = 1; i < overlay.size(); ++i)
+      if (overlay[i] < 0 || overlay[i] > (*stations)[i].getCapacity())
+        throw std::invalid_argument(
+            "ScenarioRunner: inventory outside 0..capacity at " +
+            (*stations)[i].getSysId());
+  }
+  return runAll(overlays.size(), threads,
+                [&](size_t s, InventoryOverlay &overlay) {
+                  overlay = overlays[s];
+                });
+}
+
+ScenarioSummary ScenarioRunner::runAll(
+    size_t count, unsigned threads,
+    const std::function<void(size_t, InventoryOverlay &)> &overlay) const {
+  PROFILE_SCOPE("scenarios");
+  Timer timer;
+  ScenarioSummary summary;
+  {
+    Worker base(*this);
+    InventoryOverlay inventories(stations->size());
+    for (size_t i = 1; i < inventories.size(); ++i)
+      inventories[i] = (*stations)[i].getCurrentInventory();
+    summary.reference = base.run(inventories, summary.referenceClusters);
+  }
+  std::vector<int> reference =
+      labelsOf(summary.referenceClusters, stations->size());
+  reference.erase(reference.begin());
+
+  summary.scenarios.resize(count);
+  summary.stationStability.assign(stations->size(), count ? 0.0 : 1.0);
+  std::atomic<size_t> next{0};
+  std::mutex merge;
+  auto work = [&] {
+    Worker worker(*this);
+    Clusters clusters;
+    for (size_t s; (s = next.fetch_add(1)) < count;) {
+      overlay(s, worker.overlay);
+      ScenarioOutcome outcome = worker.run(worker.overlay, clusters);
+      outcome.adjustedRandIndex = worker.compare(clusters, reference);
+      summary.scenarios[s] = outcome;
+    }
+    std::lock_guard<std::mutex> lock(merge);
+    for (size_t i = 0; i < worker.stability.size(); ++i)
+      summary.stationStability[i] += worker.stability[i];
+  };
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(
+      std::max<size_t>(1, std::min<size_t>(threads, count)));
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; ++t)
+    pool.emplace_back(work);
+  work();
+  for (std::thread &thread : pool)
+    thread.join();
+
+  std::vector<double> deltaUDF, rand;
+  for (const ScenarioOutcome &outcome : summary.scenarios) {
+    deltaUDF.push_back(outcome.totalDeltaUDF);
+    rand.push_back(outcome.adjustedRandIndex);
+  }
+  summary.deltaUDF = Distribution::of(std::move(deltaUDF));
+  summary.adjustedRandIndex = Distribution::of(std::move(rand));
+  if (count > 0) {
+    summary.stationStability[0] = 1.0; // the depot is in no cluster
+    for (size_t i = 1; i < stations->size(); ++i)
+      summary.stationStability[i] /= count;
+  }
+  summary.seconds = timer.elapsed();
+  return summary;
+}
+
+double adjustedRandIndex(const Clusters &a, const Clusters &b,
+                         size_t stations) {
+  if (stations == 0)
+    return 1.0;
+  return Contingency(labelsOf(a, stations), labelsOf(b, stations))
+      .adjustedRandIndex();
+}
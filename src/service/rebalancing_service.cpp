@@ -0,0 +1,305 @@
+#include "service/rebalancing_service.hpp"
+#include "clustering/kmedoids.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/metric.hpp"
+#include <stdexcept>
+
+using nlohmann::json;
+
+namespace {
+
+const char *const kOps[] = {"update", "plan",     "recluster", "status",
+                            "latency", "shutdown", "invalid"};
+
+double milliseconds(std::int64_t nanoseconds) { return nanoseconds / 1e6; }
+
+} // namespace
+
+ClusterPlan::ClusterPlan(SelectionResult selection)
+    : selection(std::move(selection)), done(true) {}
+
+const SelectionResult &
+ClusterPlan::get(const std::function<SelectionResult()> &compute) {
+  if (!ready())
+    std::call_once(once, [&] {
+      selection = compute();
+      done.store(true, std::memory_order_release);
+    });
+  return selection;
+}
+
+RebalancingService::RebalancingService(PipelineResult warm,
+                                       PipelineConfig config)
+    : config(std::move(config)),
+      timeMatrix(std::make_shared<const std::vector<std::vector<double>>>(
+          std::move(warm.timeMatrix))) {
+  if (timeMatrix->size() != warm.stations.size())
+    throw std::invalid_argument(
+        "RebalancingService: time matrix and stations differ in size");
+  for (size_t i = 1; i < warm.stations.size(); ++i)
+    stationIndex.emplace(warm.stations[i].getSysId(), static_cast<int>(i));
+  for (const char *op : kOps)
+    histograms[op];
+
+  auto first = std::make_shared<ServiceSnapshot>();
+  first->clusterOf = clusterIndex(warm.clusters, warm.stations.size());
+  for (size_t c = 0; c < warm.clusters.size(); ++c)
+    first->plans.push_back(
+        c < warm.selections.size()
+            ? std::make_shared<ClusterPlan>(std::move(warm.selections[c]))
+            : std::make_shared<ClusterPlan>());
+  first->stations =
+      std::make_shared<const std::vector<Station>>(std::move(warm.stations));
+  first->clusters = std::make_shared<const Clusters>(std::move(warm.clusters));
+  current = std::move(first);
+}
+
+std::shared_ptr<const ServiceSnapshot> RebalancingService::snapshot() const {
+  return std::atomic_load(&current);
+}
+
+void RebalancingService::publish(std::shared_ptr<const ServiceSnapshot> next) {
+  std::atomic_store(&current, std::move(next));
+}
+
+std::shared_ptr<const std::vector<int>>
+RebalancingService::clusterIndex(const Clusters &clusters, size_t stations) {
+  auto clusterOf = std::make_shared<std::vector<int>>(stations, -1);
+  for (size_t c = 0; c < clusters.size(); ++c)
+    for (int station : clusters[c])
+      (*clusterOf)[station] = static_cast<int>(c);
+  return clusterOf;
+}
+
+std::uint64_t RebalancingService::update(
+    const std::vector<std::pair<int, int>> &inventories) {
+  PROFILE_SCOPE("service update");
+  std::lock_guard<std::mutex> lock(writer);
+  const std::shared_ptr<const ServiceSnapshot> previous = snapshot();
+  const std::vector<Station> &stations = *previous->stations;
+  for (const auto &[station, bikes] : inventories) {
+    if (station < 1 || station >= static_cast<int>(stations.size()))
+      throw std::invalid_argument("no station " + std::to_string(station));
+    if (bikes < 0 || bikes > stations[station].getCapacity())
+      throw std::invalid_argument(
+          "inventory " + std::to_string(bikes) + " outside 0.." +
+          std::to_string(stations[station].getCapacity()) + " at " +
+          stations[station].getSysId());
+  }
+
+  auto next = std::make_shared<ServiceSnapshot>(*previous);
+  auto updated = std::make_shared<std::vector<Station>>(stations);
+  for (const auto &[station, bikes] : inventories) {
+    if ((*updated)[station].getCurrentInventory() == bikes)
+      continue;
+    (*updated)[station].setCurrentInventory(bikes);
+    const int cluster = (*previous->clusterOf)[station];
+    if (cluster >= 0 && next->plans[cluster] == previous->plans[cluster])
+      next->plans[cluster] = std::make_shared<ClusterPlan>();
+  }
+  // the tuples of a cluster rank its stations by BCRF
+  Param param = makeParam(stations.size(), previous->clusters->size());
+  MetricCalculator::computeBCRF(*updated, param);
+  next->stations = std::move(updated);
+  next->version = previous->version + 1;
+  publish(next);
+  return next->version;
+}
+
+std::uint64_t RebalancingService::recluster(int k) {
+  PROFILE_SCOPE("service recluster");
+  if (k < 1)
+    throw std::invalid_argument("k must be positive");
+  std::lock_guard<std::mutex> lock(writer);
+  const std::shared_ptr<const ServiceSnapshot> previous = snapshot();
+  auto stations = std::make_shared<std::vector<Station>>(*previous->stations);
+  Param param = makeParam(stations->size(), k);
+  MetricCalculator::computeBCRF(*stations, param);
+  KMedoid kmedoid(*stations, k);
+  kmedoid.setCompositeDistanceMatrix(
+      MetricCalculator::computeCompositeDistanceMatrix(
+          *stations, *timeMatrix, config.alpha, config.beta));
+  Clusters clusters = kmedoid.run(config.lambda, config.convergenceThreshold,
+                                  config.maxIterations);
+
+  auto next = std::make_shared<ServiceSnapshot>();
+  next->version = previous->version + 1;
+  next->clusterOf = clusterIndex(clusters, stations->size());
+  for (size_t c = 0; c < clusters.size(); ++c)
+    next->plans.push_back(std::make_shared<ClusterPlan>());
+  next->clusters = std::make_shared<const Clusters>(std::move(clusters));
+  next->stations = std::move(stations);
+  publish(next);
+  return next->version;
+}
+
+Param RebalancingService::makeParam(size_t stations, size_t clusters) const {
+  return Param(config.tLoad, config.alpha, config.beta,
+               static_cast<int>(stations) - 1, static_cast<int>(clusters), 1,
+               config.vehicleCapacity);
+}
+
+SelectionResult RebalancingService::selectCluster(const ServiceSnapshot &s,
+                                                  int cluster) const {
+  PROFILE_SCOPE("service plan cluster");
+  const std::vector<Station> &stations = *s.stations;
+  std::vector<int> surplus, deficit;
+  for (int station : (*s.clusters)[cluster]) {
+    if (stations[station].getStatus() == StationStatus::SURPLUS)
+      surplus.push_back(station);
+    else if (stations[station].getStatus() == StationStatus::DEFICIT)
+      deficit.push_back(station);
+  }
+  TupleClusterEvaluator evaluator(config.maxSurplus, config.maxDeficit);
+  if (config.routeScoring)
+    evaluator.enableRouteScoring(
+        *timeMatrix, makeParam(stations.size(), s.clusters->size()));
+  return evaluator.selectExclusiveTuples(
+      evaluator.generateCandidates(surplus, deficit, stations,
+                                   config.selection),
+      config.selection);
+}
+
+json RebalancingService::plan(const ServiceSnapshot &s,
+                              const std::vector<int> &clusters) {
+  for (int cluster : clusters)
+    if (cluster < 0 || cluster >= static_cast<int>(s.clusters->size()))
+      throw std::invalid_argument("no cluster " + std::to_string(cluster));
+  const std::vector<Station> &stations = *s.stations;
+  json response = {{"version", s.version}, {"clusters", json::array()}};
+  double total = 0.0;
+  int computed = 0;
+  for (int cluster : clusters) {
+    const SelectionResult &selection = s.plans[cluster]->get([&] {
+      ++computed;
+      return selectCluster(s, cluster);
+    });
+    json tuples = json::array();
+    for (const TransferTuple &tuple : selection.selected) {
+      json transfers = json::array();
+      for (const auto &[pair, bikes] : tuple.bikeAllocations)
+        transfers.push_back({{"from", stations[pair.first].getSysId()},
+                             {"to", stations[pair.second].getSysId()},
+                             {"bikes", bikes}});
+      tuples.push_back(
+          {{"deltaUDF", tuple.deltaUDF}, {"transfers", std::move(transfers)}});
+    }
+    response["clusters"].push_back({{"cluster", cluster},
+                                    {"deltaUDF", selection.totalDeltaUDF},
+                                    {"tuples", std::move(tuples)}});
+    total += selection.totalDeltaUDF;
+  }
+  response["totalDeltaUDF"] = total;
+  response["computed"] = computed;
+  return response;
+}
+
+json RebalancingService::dispatch(const std::string &op,
+                                  const json &request) {
+  if (op == "update") {
+    const json &inventories = request.at("inventories");
+    if (!inventories.is_object())
+      throw std::invalid_argument("\"inventories\" must map sysId to bikes");
+    std::vector<std::pair<int, int>> changes;
+    for (const auto &[sysId, bikes] : inventories.items()) {
+      const auto station = stationIndex.find(sysId);
+      if (station == stationIndex.end())
+        throw std::invalid_argument("unknown station " + sysId);
+      changes.emplace_back(station->second, bikes.get<int>());
+    }
+    return {{"version", update(changes)}};
+  }
+  if (op == "plan") {
+    const std::shared_ptr<const ServiceSnapshot> s = snapshot();
+    std::vector<int> clusters;
+    if (request.contains("clusters"))
+      clusters = request["clusters"].get<std::vector<int>>();
+    else
+      for (size_t c = 0; c < s->clusters->size(); ++c)
+        clusters.push_back(static_cast<int>(c));
+    return plan(*s, clusters);
+  }
+  if (op == "recluster") {
+    const std::uint64_t version = recluster(request.value("k", config.k));
+    return {{"version", version}, {"clusters", snapshot()->clusters->size()}};
+  }
+  if (op == "status") {
+    const std::shared_ptr<const ServiceSnapshot> s = snapshot();
+    size_t ready = 0;
+    for (const std::shared_ptr<ClusterPlan> &plan : s->plans)
+      ready += plan->ready();
+    return {{"version", s->version},
+            {"stations", s->stations->size() - 1},
+            {"clusters", s->clusters->size()},
+            {"plansReady", ready},
+            {"uptimeSeconds", uptime.elapsed()}};
+  }
+  if (op == "latency")
+    return latencyJson();
+  if (op == "shutdown")
+    return json::object();
+  throw std::invalid_argument("unknown op \"" + op + "\"");
+}
+
+json RebalancingService::handle(const json &request) {
+  Timer timer;
+  std::string op = "invalid";
+  json response;
+  try {
+    if (!request.is_object() || !request.contains("op"))
+      throw std::invalid_argument("a request is a JSON object with an \"op\"");
+    const std::string name = request["op"].get<std::string>();
+    if (histograms.count(name))
+      op = name;
+    response = dispatch(name, request);
+  } catch (const std::exception &e) {
+    response = {{"error", e.what()}};
+  }
+  if (request.is_object() && request.contains("id"))
+    response["id"] = request["id"];
+  histograms.at(op).record(timer.elapsedNanoseconds());
+  if (op == "shutdown" && onShutdown)
+    onShutdown();
+  return response;
+}
+
+std::string RebalancingService::handleLine(const std::string &line) {
+  json request = json::parse(line, nullptr, false);
+  if (request.is_discarded()) {
+    histograms.at("invalid").record(0);
+    return json({{"error", "malformed JSON"}}).dump();
+  }
+  return handle(request).dump();
+}
+
+json RebalancingService::latencyJson() const {
+  json latency = json::object();
+  for (const auto &[op, histogram] : histograms) {
+    const std::uint64_t count = histogram.count();
+    if (count == 0)
+      continue;
+    json buckets = json::array();
+    for (const auto &[bound, n] : histogram.buckets())
+      buckets.push_back({milliseconds(bound), n});
+    latency[op] = {
+        {"count", count},
+        {"meanMs", milliseconds(histogram.sumNanoseconds()) / count},
+        {"p50Ms", milliseconds(histogram.quantile(0.5))},
+        {"p90Ms", milliseconds(histogram.quantile(0.9))},
+        {"p99Ms", milliseconds(histogram.quantile(0.99))},
+        {"maxMs", milliseconds(histogram.maxNanoseconds())},
+        {"buckets", std::move(buckets)}};
+  }
+  return latency;
+}
+
+void RebalancingService::setShutdownHandler(std::function<void()> handler) {
+  onShutdown = std::move(handler);
+}
+
+const LatencyHistogram *
+RebalancingService::latency(const std::string &op) const {
+  const auto histogram = histograms.find(op);
+  return histogram == histograms.end() ? nullptr : &histogram->second;
+}
@@ -0,0 +1,140 @@
+#include "service/unix_socket_server.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool sendAll(int fd, const std::string &data) {
+  for (size_t sent = 0; sent < data.size();) {
+    const ssize_t n =
+        ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+} // namespace
+
+UnixSocketServer::UnixSocketServer(std::string path, Handler handler)
+    : path(std::move(path)), handler(std::move(handler)) {}
+
+UnixSocketServer::~UnixSocketServer() { stop(); }
+
+void UnixSocketServer::start() {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Invalid socket path " + path);
+  std::strcpy(address.sun_path, path.c_str());
+
+  listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listenFd < 0)
+    throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+  ::unlink(path.c_str());
+  if (::bind(listenFd, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0 ||
+      ::listen(listenFd, SOMAXCONN) < 0) {
+    const std::string error = std::strerror(errno);
+    ::close(listenFd);
+    listenFd = -1;
+    throw std::runtime_error("Cannot listen on " + path + ": " + error);
+  }
+  running = true;
+  acceptor = std::thread(&UnixSocketServer::acceptLoop, this);
+}
+
+void UnixSocketServer::stop() {
+  if (!running.exchange(false))
+    return;
+  // shutdown() wakes the threads blocked in accept() and recv(); a request
+  // being handled still gets its response
+  ::shutdown(listenFd, SHUT_RDWR);
+  acceptor.join();
+  ::close(listenFd);
+  listenFd = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::unique_ptr<Connection> &connection : connections)
+      ::shutdown(connection->fd, SHUT_RD);
+  }
+  for (const std::unique_ptr<Connection> &connection : connections) {
+    connection->thread.join();
+    ::close(connection->fd);
+  }
+  connections.clear();
+  ::unlink(path.c_str());
+}
+
+void UnixSocketServer::acceptLoop() {
+  while (running) {
+    const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      break; // shut down
+    }
+    reapFinished();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running) {
+      ::close(fd);
+      break;
+    }
+    connections.push_back(std::make_unique<Connection>());
+    Connection &connection = *connections.back();
+    connection.fd = fd;
+    connection.thread = std::thread([this, &connection] {
+      serve(connection);
+      connection.finished = true;
+    });
+  }
+}
+
+// Joins the threads of closed connections, so that a long-running server
+// does not accumulate them.
+void UnixSocketServer::reapFinished() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = connections.begin(); it != connections.end();) {
+    if (!(*it)->finished) {
+      ++it;
+      continue;
+    }
+    (*it)->thread.join();
+    ::close((*it)->fd);
+    it = connections.erase(it);
+  }
+}
+
+void UnixSocketServer::serve(Connection &connection) {
+  std::string buffer;
+  char chunk[4096];
+  for (;;) {
+    const ssize_t n = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return;
+    buffer.append(chunk, static_cast<size_t>(n));
+    size_t start = 0;
+    for (size_t end; (end = buffer.find('\n', start)) != std::string::npos;
+         start = end + 1) {
+      const std::string line = buffer.substr(start, end - start);
+      if (line.find_first_not_of(" \t\r") == std::string::npos)
+        continue;
+      if (!sendAll(connection.fd, handler(line) + "\n"))
+        return;
+    }
+    buffer.erase(0, start);
+    if (buffer.size() > kMaxLineBytes) {
+      sendAll(connection.fd, "{\"error\":\"request line too long\"}\n");
+      return;
+    }
+  }
+}
@@ -0,0 +1,124 @@
+#include "utils/ArtifactCache.hpp"
+#include "utils/Logger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+// 2^88 + 2^8 + 0x3b
+const unsigned __int128 kPrime =
+    (static_cast<unsigned __int128>(1) << 88) | 0x13b;
+
+} // namespace
+
+ContentHash &ContentHash::add(const void *data, std::size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    state ^= bytes[i];
+    state *= kPrime;
+  }
+  return *this;
+}
+
+ContentHash &ContentHash::add(const std::string &value) {
+  add(static_cast<std::int64_t>(value.size()));
+  return add(value.data(), value.size());
+}
+
+ContentHash &ContentHash::add(std::int64_t value) {
+  unsigned char bytes[8];
+  for (int i = 0; i < 8; ++i)
+    bytes[i] = static_cast<unsigned char>(static_cast<std::uint64_t>(value) >>
+                                          (8 * i));
+  return add(bytes, sizeof(bytes));
+}
+
+ContentHash &ContentHash::add(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return add(static_cast<std::int64_t>(bits));
+}
+
+ContentHash &ContentHash::addStream(std::istream &in) {
+  char buffer[1 << 16];
+  std::int64_t total = 0;
+  while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+    add(buffer, in.gcount());
+    total += in.gcount();
+  }
+  if (in.bad())
+    throw std::runtime_error("ContentHash: read error");
+  return add(total);
+}
+
+ContentHash &ContentHash::addFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("ContentHash: cannot open " + path);
+  return addStream(in);
+}
+
+std::string ContentHash::hex() const {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string digits(32, '0');
+  unsigned __int128 value = state;
+  for (int i = 31; i >= 0; --i, value >>= 4)
+    digits[i] = kDigits[static_cast<int>(value & 15)];
+  return digits;
+}
+
+ArtifactCache::ArtifactCache(std::string directory)
+    : directory(std::move(directory)) {}
+
+std::string ArtifactCache::path(const std::string &stage,
+                                const std::string &key) const {
+  return (std::filesystem::path(directory) / (stage + "-" + key + ".bin"))
+      .string();
+}
+
+bool ArtifactCache::load(
+    const std::string &stage, const std::string &key,
+    const std::function<void(std::istream &)> &read) const {
+  if (!enabled())
+    return false;
+  const std::string file = path(stage, key);
+  std::ifstream in(file, std::ios::binary);
+  if (!in)
+    return false;
+  try {
+    read(in);
+    return true;
+  } catch (const std::exception &e) {
+    LOG_WARN("Discarding artifact " << file << ": " << e.what());
+    in.close();
+    std::remove(file.c_str());
+    return false;
+  }
+}
+
+void ArtifactCache::store(
+    const std::string &stage, const std::string &key,
+    const std::function<void(std::ostream &)> &write) const {
+  if (!enabled())
+    return;
+  std::filesystem::create_directories(directory);
+  const std::string file = path(stage, key);
+  // unique per process, so concurrent runs do not write the same file
+  const std::string temporary = file + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream out(temporary, std::ios::binary);
+    if (!out)
+      throw std::runtime_error("ArtifactCache: cannot write " + temporary);
+    write(out);
+    if (!out.flush()) {
+      std::remove(temporary.c_str());
+      throw std::runtime_error("ArtifactCache: cannot write " + temporary);
+    }
+  }
+  std::filesystem::rename(temporary, file);
+}
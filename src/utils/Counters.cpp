@@ -0,0 +1,127 @@
+#include "utils/Counters.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct CounterInfo {
+  const char *name, *help;
+};
+
+const CounterInfo kInfo[kCounters] = {
+    {"brp_tuple_combinations_total",
+     "Surplus/deficit combinations evaluated by tuple generation"},
+    {"brp_tuple_positive_total",
+     "Evaluated combinations with a positive UDF reduction"},
+    {"brp_tuple_subset_rejected_total",
+     "Positive tuples rejected as subsets of an accepted tuple"},
+    {"brp_tuple_accepted_total", "Tuples accepted by tuple generation"},
+    {"brp_kmedoids_iterations_total", "k-medoids iterations"},
+    {"brp_kmedoids_reassignments_total",
+     "Stations moved to another cluster between k-medoids iterations"},
+    {"brp_kmedoids_medoid_swaps_total", "Medoids replaced by k-medoids"},
+    {"brp_selection_conflicts_total",
+     "Tuples skipped by selection for sharing a station"},
+};
+
+// Live thread blocks, and the totals of threads that have exited.
+struct Registry {
+  std::mutex mutex;
+  std::vector<const void *> blocks;
+  CounterSet retired;
+};
+
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+} // namespace
+
+CounterSet &CounterSet::operator+=(const CounterSet &other) {
+  for (std::size_t i = 0; i < kCounters; ++i)
+    values[i] += other.values[i];
+  return *this;
+}
+
+CounterSet &CounterSet::operator-=(const CounterSet &other) {
+  for (std::size_t i = 0; i < kCounters; ++i)
+    values[i] -= other.values[i];
+  return *this;
+}
+
+const char *metricName(Counter counter) {
+  return kInfo[static_cast<std::size_t>(counter)].name;
+}
+
+void writePrometheus(std::ostream &out, const CounterSet &counters,
+                     const std::string &labels) {
+  for (std::size_t i = 0; i < kCounters; ++i) {
+    out << "# HELP " << kInfo[i].name << " " << kInfo[i].help << "\n";
+    out << "# TYPE " << kInfo[i].name << " counter\n";
+    out << kInfo[i].name;
+    if (!labels.empty())
+      out << "{" << labels << "}";
+    out << " " << counters.values[i] << "\n";
+  }
+}
+
+void writePrometheus(const std::string &path, const CounterSet &counters,
+                     const std::string &labels) {
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary);
+    if (!out)
+      throw std::runtime_error("writePrometheus: cannot open " + temporary);
+    writePrometheus(out, counters, labels);
+    if (!out)
+      throw std::runtime_error("writePrometheus: cannot write " + temporary);
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    throw std::runtime_error("writePrometheus: cannot rename to " + path);
+}
+
+Counters::Block::Block() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.blocks.push_back(this);
+}
+
+Counters::Block::~Block() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.retired += read(*this);
+  r.blocks.erase(std::find(r.blocks.begin(), r.blocks.end(), this));
+}
+
+CounterSet Counters::read(const Block &block) {
+  CounterSet counters;
+  for (std::size_t i = 0; i < kCounters; ++i)
+    counters.values[i] = block.values[i].load(std::memory_order_relaxed);
+  return counters;
+}
+
+void Counters::add(const CounterSet &counters) {
+  Block &block = local();
+  for (std::size_t i = 0; i < kCounters; ++i)
+    if (counters.values[i] != 0)
+      block.values[i].store(
+          block.values[i].load(std::memory_order_relaxed) + counters.values[i],
+          std::memory_order_relaxed);
+}
+
+CounterSet Counters::thread() { return read(local()); }
+
+CounterSet Counters::total() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  CounterSet counters = r.retired;
+  for (const void *block : r.blocks)
+    counters += read(*static_cast<const Block *>(block));
+  return counters;
+}
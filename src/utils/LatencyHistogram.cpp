@@ -0,0 +1,56 @@
+#include "utils/LatencyHistogram.hpp"
+#include <algorithm>
+
+int LatencyHistogram::bucketOf(std::int64_t ns) {
+  if (ns < 8)
+    return static_cast<int>(std::max<std::int64_t>(ns, 0));
+  const int octave = 63 - __builtin_clzll(static_cast<std::uint64_t>(ns));
+  const int sub = static_cast<int>((ns >> (octave - 3)) & 7);
+  return (octave - 2) * 8 + sub;
+}
+
+std::int64_t LatencyHistogram::bucketValue(int bucket) {
+  if (bucket < 8)
+    return bucket;
+  const int octave = bucket / 8 + 2, sub = bucket % 8;
+  const std::int64_t width = std::int64_t{1} << (octave - 3);
+  return (8 + sub) * width + width - 1;
+}
+
+void LatencyHistogram::record(std::int64_t nanoseconds) {
+  nanoseconds = std::max<std::int64_t>(nanoseconds, 0);
+  counts[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+  std::int64_t seen = largest.load(std::memory_order_relaxed);
+  while (nanoseconds > seen &&
+         !largest.compare_exchange_weak(seen, nanoseconds,
+                                        std::memory_order_relaxed))
+    ;
+}
+
+std::int64_t LatencyHistogram::quantile(double q) const {
+  std::uint64_t all = 0;
+  std::array<std::uint64_t, kBuckets> snapshot;
+  for (int b = 0; b < kBuckets; ++b)
+    all += snapshot[b] = counts[b].load(std::memory_order_relaxed);
+  if (all == 0)
+    return 0;
+  const double target = std::clamp(q, 0.0, 1.0) * all;
+  std::uint64_t seen = 0;
+  for (int b = 0; b < kBuckets; ++b) {
+    seen += snapshot[b];
+    if (snapshot[b] && seen >= target)
+      return std::min(bucketValue(b), maxNanoseconds());
+  }
+  return maxNanoseconds();
+}
+
+std::vector<std::pair<std::int64_t, std::uint64_t>>
+LatencyHistogram::buckets() const {
+  std::vector<std::pair<std::int64_t, std::uint64_t>> nonEmpty;
+  for (int b = 0; b < kBuckets; ++b)
+    if (std::uint64_t n = counts[b].load(std::memory_order_relaxed))
+      nonEmpty.emplace_back(bucketValue(b), n);
+  return nonEmpty;
+}
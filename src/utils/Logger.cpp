@@ -0,0 +1,166 @@
+#include "utils/Logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const char *const kNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR",
+                              "OFF"};
+
+int initialLevel() {
+  const char *name = std::getenv("BRP_LOG_LEVEL");
+  if (name == nullptr || *name == '\0')
+    return static_cast<int>(LogLevel::INFO);
+  try {
+    return static_cast<int>(parseLogLevel(name));
+  } catch (const std::invalid_argument &) {
+    return static_cast<int>(LogLevel::INFO);
+  }
+}
+
+} // namespace
+
+const char *toString(LogLevel level) {
+  return kNames[static_cast<int>(level)];
+}
+
+LogLevel parseLogLevel(const std::string &name) {
+  std::string upper = name;
+  std::transform(upper.begin(), upper.end(), upper.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  for (int level = 0; level <= static_cast<int>(LogLevel::OFF); ++level)
+    if (upper == kNames[level])
+      return static_cast<LogLevel>(level);
+  throw std::invalid_argument("parseLogLevel: unknown log level '" + name +
+                              "'");
+}
+
+std::atomic<int> Logger::threshold{initialLevel()};
+
+Logger &Logger::getInstance() {
+  static Logger instance;
+  return instance;
+}
+
+Logger::Logger() : slots(new Slot[kCapacity]), out(&std::cout) {
+  for (std::size_t i = 0; i < kCapacity; ++i)
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  writer.join();
+}
+
+// Bounded MPMC ring after Vyukov: a slot is free for position p when its
+// sequence equals p and ready for the writer when it equals p + 1.
+void Logger::log(LogLevel level, const char *text, std::size_t length) {
+  std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+  Slot *slot;
+  for (;;) {
+    slot = &slots[pos & (kCapacity - 1)];
+    const std::size_t sequence =
+        slot->sequence.load(std::memory_order_acquire);
+    if (sequence == pos) {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+        break;
+    } else if (sequence < pos) { // full: the writer is a lap behind
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+  slot->level = level;
+  slot->length = static_cast<unsigned>(std::min(length, kMessageSize));
+  std::memcpy(slot->text, text, slot->length);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  // a burst can fill the ring between two polls: nudge the writer every
+  // quarter lap (no lock; a missed nudge only costs one poll interval)
+  if ((pos & (kCapacity / 4 - 1)) == kCapacity / 4 - 1)
+    wake.notify_one();
+}
+
+bool Logger::ready() const {
+  return slots[dequeuePos & (kCapacity - 1)].sequence.load(
+             std::memory_order_acquire) == dequeuePos + 1;
+}
+
+std::size_t Logger::drain() {
+  std::size_t count = 0;
+  for (;;) {
+    if (!ready())
+      return count;
+    Slot &slot = slots[dequeuePos & (kCapacity - 1)];
+    *out << '[' << toString(slot.level) << "] ";
+    out->write(slot.text, slot.length);
+    *out << '\n';
+    slot.sequence.store(dequeuePos + kCapacity, std::memory_order_release);
+    dequeuePos++;
+    count++;
+  }
+}
+
+void Logger::writerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    if (drain() > 0)
+      continue;
+    out->flush();
+    written = dequeuePos;
+    drained.notify_all();
+    if (stopping)
+      return;
+    // producers rarely signal, so poll; flush() and shutdown wake us early
+    wake.wait_for(lock, std::chrono::milliseconds(10), [this] {
+      return flushRequested || stopping || ready();
+    });
+    flushRequested = false;
+  }
+}
+
+void Logger::flush() {
+  const std::size_t target = enqueuePos.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(mutex);
+  flushRequested = true;
+  wake.notify_one();
+  drained.wait(lock, [&] { return written >= target; });
+}
+
+void Logger::setLogFile(const std::string &filename) {
+  std::lock_guard<std::mutex> lock(mutex);
+  out->flush();
+  if (file.is_open())
+    file.close();
+  if (filename.empty()) {
+    out = &std::cout;
+    return;
+  }
+  file.open(filename);
+  if (!file) {
+    out = &std::cout;
+    throw std::runtime_error("Logger: cannot open " + filename);
+  }
+  out = &file;
+}
+
+LogLine &LogLine::get() {
+  thread_local LogLine line;
+  line.buffer.reset();
+  line.clear();
+  line.flags(std::ios_base::dec | std::ios_base::skipws);
+  line.precision(6);
+  line.width(0);
+  return line;
+}
@@ -0,0 +1,258 @@
+#include "utils/Profiler.hpp"
+#include "utils/LatencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <ostream>
+#include <stdexcept>
+
+struct Profiler::ThreadTree {
+  std::mutex mutex; // node statistics and child lists
+  Node root;
+  Node *current = &root;
+  bool inUse = true;
+};
+
+// Ties a thread to its tree; on thread exit the tree goes back to the pool
+// for the next thread, so short-lived workers do not pile up trees.
+struct ProfilerAttachment {
+  Profiler::ThreadTree *tree = nullptr;
+  ~ProfilerAttachment() {
+    if (tree)
+      Profiler::getInstance().release(tree);
+  }
+};
+
+namespace {
+
+thread_local ProfilerAttachment attachment;
+
+bool initialEnabled() {
+  const char *value = std::getenv("BRP_PROFILE");
+  return value != nullptr && *value != '\0' && std::strcmp(value, "0") != 0;
+}
+
+void clearStats(Profiler::Node &node) {
+  node.count = 0;
+  node.totalNs = node.minNs = node.maxNs = 0;
+  node.histogram.fill(0);
+  for (auto &child : node.children)
+    clearStats(*child);
+}
+
+void mergeInto(Profiler::Node &into, const Profiler::Node &from) {
+  if (from.count > 0) {
+    into.minNs =
+        into.count == 0 ? from.minNs : std::min(into.minNs, from.minNs);
+    into.maxNs = std::max(into.maxNs, from.maxNs);
+    into.count += from.count;
+    into.totalNs += from.totalNs;
+    for (int b = 0; b < Profiler::kBuckets; ++b)
+      into.histogram[b] += from.histogram[b];
+  }
+  for (const auto &child : from.children) {
+    auto it = std::find_if(
+        into.children.begin(), into.children.end(),
+        [&](const std::unique_ptr<Profiler::Node> &node) {
+          return node->name == child->name;
+        });
+    if (it == into.children.end()) {
+      into.children.push_back(std::make_unique<Profiler::Node>());
+      it = into.children.end() - 1;
+      (*it)->name = child->name;
+      (*it)->parent = &into;
+    }
+    mergeInto(**it, *child);
+  }
+}
+
+double seconds(std::int64_t ns) { return ns * 1e-9; }
+
+ScopeStats statsOf(const Profiler::Node &node, const std::string &path,
+                   int depth) {
+  ScopeStats stats;
+  stats.path = path;
+  stats.depth = depth;
+  stats.count = node.count;
+  stats.totalSeconds = seconds(node.totalNs);
+  std::int64_t childNs = 0;
+  for (const auto &child : node.children)
+    childNs += child->totalNs;
+  stats.selfSeconds =
+      seconds(std::max<std::int64_t>(node.totalNs - childNs, 0));
+  stats.minSeconds = seconds(node.minNs);
+  stats.maxSeconds = seconds(node.maxNs);
+  // the smallest bucket bound with at least 99% of the calls at or below it
+  const std::uint64_t rank = node.count - node.count / 100;
+  std::uint64_t seen = 0;
+  for (int b = 0; b < Profiler::kBuckets && node.count > 0; ++b) {
+    seen += node.histogram[b];
+    if (seen >= rank) {
+      stats.p99Seconds =
+          seconds(std::min(LatencyHistogram::bucketValue(b), node.maxNs));
+      break;
+    }
+  }
+  return stats;
+}
+
+using Json = nlohmann::ordered_json; // keys in insertion order
+
+Json toJson(const Profiler::Node &node, const std::string &path, int depth) {
+  const ScopeStats stats = statsOf(node, path, depth);
+  Json json = {{"name", node.name},
+               {"count", stats.count},
+               {"totalSeconds", stats.totalSeconds},
+               {"selfSeconds", stats.selfSeconds},
+               {"minSeconds", stats.minSeconds},
+               {"maxSeconds", stats.maxSeconds},
+               {"p99Seconds", stats.p99Seconds}};
+  json["children"] = Json::array();
+  for (const auto &child : node.children)
+    json["children"].push_back(
+        toJson(*child, path + ";" + child->name, depth + 1));
+  return json;
+}
+
+} // namespace
+
+std::atomic<bool> Profiler::on{initialEnabled()};
+
+Profiler &Profiler::getInstance() {
+  static Profiler instance;
+  return instance;
+}
+
+Profiler::Profiler() {
+  const char *value = std::getenv("BRP_PROFILE");
+  if (value != nullptr && std::strcmp(value, "0") != 0 &&
+      std::strcmp(value, "1") != 0)
+    reportPrefix = value;
+}
+
+Profiler::~Profiler() {
+  if (reportPrefix.empty())
+    return;
+  try {
+    writeReport(reportPrefix);
+  } catch (const std::exception &) {
+    // nowhere left to report it
+  }
+}
+
+Profiler::ThreadTree &Profiler::threadTree() {
+  if (attachment.tree)
+    return *attachment.tree;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &tree : trees)
+    if (!tree->inUse) {
+      tree->inUse = true;
+      attachment.tree = tree.get();
+      return *tree;
+    }
+  trees.push_back(std::make_unique<ThreadTree>());
+  attachment.tree = trees.back().get();
+  return *attachment.tree;
+}
+
+void Profiler::release(ThreadTree *tree) {
+  std::lock_guard<std::mutex> lock(mutex);
+  tree->current = &tree->root;
+  tree->inUse = false;
+}
+
+Profiler::Node *Profiler::enter(const char *name) {
+  ThreadTree &tree = threadTree();
+  Node *parent = tree.current;
+  // only this thread adds children to its tree, so it may search unlocked
+  for (const auto &child : parent->children)
+    if (child->name == name) {
+      tree.current = child.get();
+      return child.get();
+    }
+  auto child = std::make_unique<Node>();
+  child->name = name;
+  child->parent = parent;
+  Node *node = child.get();
+  {
+    std::lock_guard<std::mutex> lock(tree.mutex);
+    parent->children.push_back(std::move(child));
+  }
+  tree.current = node;
+  return node;
+}
+
+void Profiler::leave(Node *node, std::int64_t nanoseconds) {
+  ThreadTree &tree = threadTree();
+  {
+    std::lock_guard<std::mutex> lock(tree.mutex);
+    node->minNs =
+        node->count == 0 ? nanoseconds : std::min(node->minNs, nanoseconds);
+    node->maxNs = std::max(node->maxNs, nanoseconds);
+    node->count++;
+    node->totalNs += nanoseconds;
+    node->histogram[LatencyHistogram::bucketOf(nanoseconds)]++;
+  }
+  tree.current = node->parent;
+}
+
+std::unique_ptr<Profiler::Node> Profiler::merged() const {
+  auto root = std::make_unique<Node>();
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &tree : trees) {
+    std::lock_guard<std::mutex> treeLock(tree->mutex);
+    mergeInto(*root, tree->root);
+  }
+  return root;
+}
+
+void Profiler::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &tree : trees) {
+    std::lock_guard<std::mutex> treeLock(tree->mutex);
+    clearStats(tree->root);
+  }
+}
+
+std::vector<ScopeStats> Profiler::snapshot() const {
+  const std::unique_ptr<Node> root = merged();
+  std::vector<ScopeStats> result;
+  std::function<void(const Node &, const std::string &, int)> visit =
+      [&](const Node &node, const std::string &path, int depth) {
+        result.push_back(statsOf(node, path, depth));
+        for (const auto &child : node.children)
+          visit(*child, path + ";" + child->name, depth + 1);
+      };
+  for (const auto &child : root->children)
+    visit(*child, child->name, 0);
+  return result;
+}
+
+void Profiler::writeJson(std::ostream &out) const {
+  const std::unique_ptr<Node> root = merged();
+  Json scopes = Json::array();
+  for (const auto &child : root->children)
+    scopes.push_back(toJson(*child, child->name, 0));
+  out << Json{{"scopes", scopes}}.dump(2) << "\n";
+}
+
+void Profiler::writeFolded(std::ostream &out) const {
+  for (const ScopeStats &scope : snapshot()) {
+    const long long micros = std::llround(scope.selfSeconds * 1e6);
+    if (micros > 0)
+      out << scope.path << " " << micros << "\n";
+  }
+}
+
+void Profiler::writeReport(const std::string &prefix) const {
+  std::ofstream json(prefix + ".json"), folded(prefix + ".folded");
+  if (!json || !folded)
+    throw std::runtime_error("Profiler: cannot write report " + prefix);
+  writeJson(json);
+  writeFolded(folded);
+}
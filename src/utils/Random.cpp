@@ -0,0 +1,82 @@
+#include "utils/Random.hpp"
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+std::uint64_t splitmix64(std::uint64_t &state) {
+  std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+constexpr std::uint64_t kJump[4] = {0x180ec6d33cfd0abaULL,
+                                    0xd5a61266f0c9392cULL,
+                                    0xa9582618e03fc9aaULL,
+                                    0x39abdc4529b1661cULL};
+constexpr std::uint64_t kLongJump[4] = {
+    0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL,
+    0x39109bb02acbe635ULL};
+
+} // namespace
+
+Xoshiro256::Xoshiro256(std::uint64_t seed) {
+  for (std::uint64_t &word : s)
+    word = splitmix64(seed);
+}
+
+Xoshiro256 Xoshiro256::stream(std::uint64_t seed, std::uint64_t index) {
+  Xoshiro256 generator(seed);
+  for (std::uint64_t k = 0; k < index; ++k)
+    generator.jump();
+  return generator;
+}
+
+void Xoshiro256::apply(const std::uint64_t (&polynomial)[4]) {
+  std::uint64_t t[4] = {0, 0, 0, 0};
+  for (std::uint64_t word : polynomial)
+    for (int b = 0; b < 64; ++b) {
+      if (word & (std::uint64_t{1} << b))
+        for (int i = 0; i < 4; ++i)
+          t[i] ^= s[i];
+      (*this)();
+    }
+  for (int i = 0; i < 4; ++i)
+    s[i] = t[i];
+}
+
+void Xoshiro256::jump() { apply(kJump); }
+
+void Xoshiro256::longJump() { apply(kLongJump); }
+
+void Xoshiro256::fillBelow(std::uint32_t *out, std::size_t n,
+                           std::uint32_t bound) {
+  const std::uint32_t threshold = -bound % bound;
+  std::uint64_t bits = 0;
+  int halves = 0;
+  for (std::size_t k = 0; k < n;) {
+    if (halves == 0) {
+      bits = (*this)();
+      halves = 2;
+    }
+    const std::uint32_t x = static_cast<std::uint32_t>(bits);
+    bits >>= 32;
+    halves--;
+    const std::uint64_t m = static_cast<std::uint64_t>(x) * bound;
+    if (static_cast<std::uint32_t>(m) < threshold)
+      continue; // rejected: would favour the low values
+    out[k++] = static_cast<std::uint32_t>(m >> 32);
+  }
+}
+
+double Xoshiro256::normal() {
+  const double u = 1.0 - uniform(); // (0, 1]
+  return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * kPi * uniform());
+}
+
+void Xoshiro256::fillUniform(double *out, std::size_t n) {
+  for (std::size_t k = 0; k < n; ++k)
+    out[k] = uniform();
+}
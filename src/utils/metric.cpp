@@ -1,10 +1,13 @@
 #include "utils/metric.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
 #include <cstdlib>
 #include <iostream>
 
 namespace MetricCalculator {
 
 void computeBCRF(std::vector<Station> &stations, Param &param) {
+  PROFILE_SCOPE("bcrf");
   for (auto &station : stations) {
     if (station.getId() == 0)
       continue;
@@ -41,6 +44,7 @@ std::vector<std::vector<double>> computeCompositeDistanceMatrix(
     const std::vector<Station> &stations,
     const std::vector<std::vector<double>> &travel_time_matrix, double alpha,
     double beta) {
+  PROFILE_SCOPE("composite matrix");
   // form a |Station| * |Station| matrix
   std::vector<std::vector<double>> composite_distance_matrix(
       stations.size(), std::vector<double>(stations.size(), -1.0));
@@ -54,7 +58,7 @@ std::vector<std::vector<double>> computeCompositeDistanceMatrix(
       complementarity_matrix[i][j] = udfReductionSum(stations[i], stations[j]);
     }
   }
-  std::cout << "Complementarity matrix computed" << std::endl;
+  LOG_DEBUG("Complementarity matrix computed");
 
   // Compute composite distances for actual stations (skip depot)
   for (size_t i = 1; i < stations.size(); ++i) {
@@ -0,0 +1,779 @@
+#include "clustering/tuple_evaluator.hpp"
+#include "core/problem.hpp"
+#include "engine/AdaptiveLargeNeighborhoodSearch.hpp"
+#include "engine/GeneticAlgorithm.hpp"
+#include "engine/IslandModel.hpp"
+#include "engine/SavingsConstruction.hpp"
+#include "utils/Logger.hpp"
+#include "utils/SpscQueue.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Counts heap allocations so the test can check that generations reuse the
+// population pool.
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// Selected tuples of a few random clusters of the real instance.
+std::vector<TransferTuple> selectedTuples(ProblemInstance &instance,
+                                          Param &param) {
+  auto stations = instance.getStations();
+  MetricCalculator::computeBCRF(stations, param);
+
+  std::vector<int> indices(stations.size() - 1);
+  std::iota(indices.begin(), indices.end(), 1);
+  std::mt19937 g(23);
+  std::shuffle(indices.begin(), indices.end(), g);
+  std::vector<std::vector<int>> clusters;
+  for (int c = 0; c < 6; ++c)
+    clusters.emplace_back(indices.begin() + 12 * c,
+                          indices.begin() + 12 * (c + 1));
+
+  TupleClusterEvaluator evaluator(2, 2);
+  NetworkPlan plan = evaluator.evaluateNetwork(clusters, stations);
+  std::vector<TransferTuple> tuples;
+  for (const auto &cluster : plan.clusters)
+    tuples.insert(tuples.end(), cluster.assignedTuples.begin(),
+                  cluster.assignedTuples.end());
+  return tuples;
+}
+
+// The real instance and the tuples selectedTuples() picks from it, which all
+// routing tests share.
+struct RoutingFixture {
+  explicit RoutingFixture(int vehicles = 12)
+      : instance("../data/results.csv"),
+        param(60, 2, 0.5, 10, 10, 3, vehicles),
+        tuples(selectedTuples(instance, param)) {}
+
+  RoutingModel model(const RoutingOptions &options = {}) const {
+    return RoutingModel(instance, param, tuples, options);
+  }
+  // Service time of all stops; route time limits are fractions of it.
+  double serviceTime() const {
+    RoutingModel probe = model();
+    double service = 0.0;
+    for (int id = 0; id < probe.getNumStops(); ++id)
+      service += probe.serviceTime(id);
+    return service;
+  }
+
+  ProblemInstance instance;
+  Param param;
+  std::vector<TransferTuple> tuples;
+};
+
+// Re-simulates a route: load window, time limit; returns its duration.
+double checkRoute(const RoutingModel &model, const std::vector<int> &route) {
+  int load = 0, last = 0;
+  double time = 0.0;
+  for (int id : route) {
+    const Stop &stop = model.getStop(id);
+    load += stop.quantity;
+    assert(load >= 0 && load <= model.getVehicleCapacity());
+    time += model.travelTime(last, stop.station) + model.serviceTime(id);
+    last = stop.station;
+  }
+  time += model.travelTime(last, 0);
+  assert(time <= model.getOptions().routeTimeLimit + 1e-9);
+  return time;
+}
+
+void test_geneticAlgorithm() {
+  RoutingFixture fixture;
+  assert(!fixture.tuples.empty());
+
+  // a shift long enough for roughly half of the work per vehicle
+  RoutingOptions options;
+  options.routeTimeLimit = fixture.serviceTime() / 2;
+  RoutingModel model = fixture.model(options);
+  std::cout << "Routing " << model.getNumStops() << " stops of "
+            << model.getNumTuples() << " tuples\n";
+
+  OrderCrossover crossover;
+  InversionMutation mutation;
+  GeneticAlgorithmOptions gaOptions;
+  gaOptions.populationSize = 30;
+  gaOptions.generations = 80;
+  gaOptions.seed = 7;
+
+  GeneticAlgorithm ga(model, &crossover, &mutation, nullptr, nullptr,
+                      gaOptions);
+  GeneticAlgorithmResult result = ga.run();
+
+  // the best tour is a permutation and decodes to what the GA recorded
+  std::vector<int> sorted = result.bestTour;
+  std::sort(sorted.begin(), sorted.end());
+  for (int i = 0; i < (int)sorted.size(); ++i)
+    assert(sorted[i] == i);
+  const RouteEvaluation &best = result.best.evaluation;
+  assert(best.objective == ga.getBest().getObjective());
+  assert(best.routes <= fixture.param.numOfVehicles);
+
+  double duration = 0.0, deltaUDF = 0.0;
+  int served = 0;
+  for (const auto &route : result.best.routes) {
+    duration += checkRoute(model, route);
+    for (int id : route)
+      deltaUDF += model.getStop(id).deltaUDF;
+    served += route.size();
+  }
+  assert(served + (int)result.best.unserved.size() == model.getNumStops());
+  assert(std::fabs(duration - best.duration) <= 1e-6 * (1 + duration));
+  assert(std::fabs(deltaUDF - best.deltaUDF) <= 1e-9 * (1 + deltaUDF));
+
+  // elitist: the best objective never decreases and beats the seeds
+  for (size_t g = 1; g < result.trace.size(); ++g)
+    assert(result.trace[g] >= result.trace[g - 1]);
+  std::vector<int> seed = model.tupleOrderTour();
+  assert(best.objective >=
+         model.split(seed.data(), (int)seed.size()).objective);
+
+  // same seed, same run
+  GeneticAlgorithm again(model, &crossover, &mutation, nullptr, nullptr,
+                         gaOptions);
+  assert(again.run().bestTour == result.bestTour);
+
+  // once initialized, generations reuse the pool
+  GeneticAlgorithm warm(model, &crossover, &mutation, nullptr, nullptr,
+                        gaOptions);
+  warm.initialize();
+  warm.step();
+  std::size_t before = allocations;
+  for (int g = 0; g < 20; ++g)
+    warm.step();
+  assert(allocations == before);
+
+  std::cout << "GA: objective " << best.objective << ", deltaUDF "
+            << best.deltaUDF << ", " << best.routes << " routes, "
+            << best.unserved << " unserved, " << result.evaluations
+            << " evaluations\n";
+  std::cout << "Test GeneticAlgorithm passed\n";
+}
+
+void test_random() {
+  // seeded streams are reproducible; jumped and split ones are disjoint
+  RandomEngine a(42), b(42);
+  for (int k = 0; k < 100; ++k)
+    assert(a() == b());
+  RandomEngine parent(42);
+  RandomEngine first = parent.split(), second = parent.split();
+  RandomEngine stream1 = RandomEngine::stream(42, 1);
+  assert(second() == stream1());
+  std::vector<std::uint64_t> drawn;
+  for (RandomEngine *g : {&first, &second, &parent})
+    for (int k = 0; k < 1000; ++k)
+      drawn.push_back((*g)());
+  std::sort(drawn.begin(), drawn.end());
+  assert(std::adjacent_find(drawn.begin(), drawn.end()) == drawn.end());
+
+  // bounded draws stay in range and hit every value about equally often
+  RandomEngine rng(7);
+  const int bound = 10, draws = 100000;
+  std::vector<int> counts(bound, 0);
+  for (int k = 0; k < draws; ++k)
+    counts[rng.below(bound)]++;
+  for (int c : counts)
+    assert(std::abs(c - draws / bound) < draws / bound / 10);
+  for (int k = 0; k < 1000; ++k) {
+    int x = rng.between(-3, 3);
+    assert(x >= -3 && x <= 3);
+    double u = rng.uniform();
+    assert(u >= 0.0 && u < 1.0);
+  }
+  assert(rng.below(1) == 0 && rng.between(5, 5) == 5);
+
+  // batched variants
+  std::vector<std::uint32_t> ints(draws);
+  rng.fillBelow(ints.data(), ints.size(), bound);
+  std::fill(counts.begin(), counts.end(), 0);
+  for (std::uint32_t x : ints) {
+    assert(x < (std::uint32_t)bound);
+    counts[x]++;
+  }
+  for (int c : counts)
+    assert(std::abs(c - draws / bound) < draws / bound / 10);
+  std::vector<double> reals(1000);
+  rng.fillUniform(reals.data(), reals.size());
+  double mean = std::accumulate(reals.begin(), reals.end(), 0.0) / 1000;
+  assert(*std::min_element(reals.begin(), reals.end()) >= 0.0);
+  assert(*std::max_element(reals.begin(), reals.end()) < 1.0);
+  assert(std::fabs(mean - 0.5) < 0.05);
+
+  // standard normal: mean 0, variance 1
+  double sum = 0.0, squares = 0.0;
+  for (int k = 0; k < draws; ++k) {
+    double x = rng.normal();
+    sum += x;
+    squares += x * x;
+  }
+  assert(std::fabs(sum / draws) < 0.02);
+  assert(std::fabs(squares / draws - 1.0) < 0.02);
+
+  std::vector<int> items(50);
+  std::iota(items.begin(), items.end(), 0);
+  rng.shuffle(items.begin(), items.end());
+  std::vector<int> sorted = items;
+  std::sort(sorted.begin(), sorted.end());
+  for (int k = 0; k < 50; ++k)
+    assert(sorted[k] == k);
+  std::cout << "Test Random passed\n";
+}
+
+void test_logger() {
+  Logger &logger = Logger::getInstance();
+  const char *path = "logger_test.log";
+  logger.setLogFile(path);
+  Logger::setLevel(LogLevel::DEBUG);
+
+  // below the compile-time or runtime threshold the arguments are not even
+  // evaluated
+  int evaluated = 0;
+  LOG_TRACE("trace " << ++evaluated);
+  Logger::setLevel(LogLevel::WARN);
+  LOG_INFO("info " << ++evaluated);
+  assert(evaluated == 0);
+  Logger::setLevel(LogLevel::DEBUG);
+
+  // many threads at once: every message is written whole or counted as
+  // dropped, never interleaved
+  const int threads = 4, perThread = 2000;
+  const std::size_t droppedBefore = logger.getDropped();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+    workers.emplace_back([t] {
+      for (int i = 0; i < perThread; ++i)
+        LOG_DEBUG("worker " << t << " message " << i);
+    });
+  for (std::thread &worker : workers)
+    worker.join();
+  logger.flush();
+  LOG_ERROR(std::string(2 * Logger::kMessageSize, 'x'));
+  logger.flush();
+
+  std::ifstream in(path);
+  std::string line;
+  int messages = 0, truncated = 0;
+  while (std::getline(in, line)) {
+    if (line.rfind("[DEBUG] worker ", 0) == 0)
+      messages++;
+    else if (line == "[ERROR] " + std::string(Logger::kMessageSize, 'x'))
+      truncated++;
+  }
+  assert(messages + (logger.getDropped() - droppedBefore) ==
+         threads * perThread);
+  assert(truncated == 1);
+  assert(parseLogLevel("warn") == LogLevel::WARN);
+  bool threw = false;
+  try {
+    parseLogLevel("verbose");
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+
+  logger.setLogFile("");
+  Logger::setLevel(LogLevel::INFO);
+  std::remove(path);
+  std::cout << "Test Logger passed (" << messages << " written, "
+            << logger.getDropped() - droppedBefore << " dropped)\n";
+}
+
+void test_spscQueue() {
+  SpscQueue<std::vector<int>> queue(2, std::vector<int>(3, 0));
+  std::vector<int> value(3, 0);
+  assert(!queue.tryPop(value));
+  assert(queue.tryPush({1, 2, 3}));
+  assert(queue.tryPush({4, 5, 6}));
+  assert(!queue.tryPush({7, 8, 9})); // full
+  assert(queue.tryPop(value) && value == std::vector<int>({1, 2, 3}));
+  assert(queue.tryPush({7, 8, 9}));
+  assert(queue.tryPop(value) && value == std::vector<int>({4, 5, 6}));
+  assert(queue.tryPop(value) && value == std::vector<int>({7, 8, 9}));
+  assert(!queue.tryPop(value));
+
+  // one producer thread, one consumer thread, order preserved
+  SpscQueue<int> ints(8);
+  const int count = 100000;
+  std::thread producer([&ints] {
+    for (int i = 0; i < count; ++i)
+      while (!ints.tryPush(i))
+        std::this_thread::yield();
+  });
+  for (int expected = 0; expected < count; ++expected) {
+    int got;
+    while (!ints.tryPop(got))
+      std::this_thread::yield();
+    assert(got == expected);
+  }
+  producer.join();
+  std::cout << "Test SpscQueue passed\n";
+}
+
+void test_islandModel() {
+  RoutingFixture fixture;
+  RoutingOptions routing;
+  routing.routeTimeLimit = 1500;
+  RoutingModel model = fixture.model(routing);
+
+  for (MigrationTopology topology :
+       {MigrationTopology::RING, MigrationTopology::FULLY_CONNECTED}) {
+    IslandModelOptions options;
+    options.islands = 3;
+    options.topology = topology;
+    options.migrationInterval = 5;
+    options.ga.populationSize = 20;
+    options.ga.generations = 40;
+    options.ga.seed = 3;
+
+    IslandModelResult first = IslandModel(model, options).run();
+    IslandModelResult second = IslandModel(model, options).run();
+    assert(first.bestTour == second.bestTour);
+    assert(first.traces == second.traces);
+
+    int edges = topology == MigrationTopology::RING ? 3 : 6;
+    // epochs 2..8 each take in one packet per incoming edge
+    assert(first.migrationsReceived == (size_t)edges * 7);
+    assert(first.traces.size() == 3);
+    for (const auto &trace : first.traces) {
+      assert(trace.size() == 40);
+      assert(trace.back() <= first.best.evaluation.objective);
+    }
+    assert(first.best.evaluation.routes <= fixture.param.numOfVehicles);
+    assert(first.evaluationsPerSecondPerThread > 0);
+    std::cout << "Islands: objective " << first.best.evaluation.objective
+              << ", " << first.evaluationsPerSecondPerThread
+              << " evaluations/s per thread\n";
+  }
+
+  bool threw = false;
+  try {
+    IslandModelOptions options;
+    options.queueCapacity = 1;
+    IslandModel bad(model, options);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+  std::cout << "Test IslandModel passed\n";
+}
+
+void test_localSearch() {
+  RoutingFixture fixture;
+  RoutingOptions routing;
+  routing.routeTimeLimit = 1500;
+  RoutingModel model = fixture.model(routing);
+  const int n = model.getNumStops();
+
+  // never worse than its input, always a permutation; the O(1) move
+  // evaluations are cross-checked against rebuilt routes by asserts inside
+  RouteLocalSearch localSearch(model);
+  RandomEngine rng(9);
+  Population population(1, n);
+  Individual &individual = population[0];
+  double gained = 0.0;
+  for (int trial = 0; trial < 30; ++trial) {
+    std::iota(individual.begin(), individual.end(), 0);
+    std::shuffle(individual.begin(), individual.end(), rng);
+    individual.evaluate(model);
+    double before = individual.getObjective();
+    localSearch.improve(individual, rng);
+    double after = individual.getObjective();
+    assert(after >= before - 1e-9);
+    assert(after == model.split(individual.begin(), n).objective);
+    std::vector<int> sorted(individual.begin(), individual.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < n; ++i)
+      assert(sorted[i] == i);
+    gained += after - before;
+  }
+  const LocalSearchStats &stats = localSearch.getStats();
+  std::size_t applied = 0;
+  for (std::size_t count : stats.applied)
+    applied += count;
+  assert(applied > 0 && gained > 0);
+  // moves the decoder would cut differently were caught without a split
+  assert(stats.undone > 0);
+
+  // with tuplePrecedence no move may pull a drop ahead of its tuple's
+  // pickups; the decoder would skip such a drop
+  RoutingOptions precedence = routing;
+  precedence.tuplePrecedence = true;
+  RoutingModel ordered = fixture.model(precedence);
+  RouteLocalSearch orderedSearch(ordered);
+  for (int trial = 0; trial < 10; ++trial) {
+    std::iota(individual.begin(), individual.end(), 0);
+    std::shuffle(individual.begin(), individual.end(), rng);
+    individual.evaluate(ordered);
+    double before = individual.getObjective();
+    orderedSearch.improve(individual, rng);
+    assert(individual.getObjective() >= before - 1e-9);
+    assert(individual.getObjective() ==
+           ordered.split(individual.begin(), n).objective);
+  }
+  std::size_t orderedApplied = 0;
+  for (std::size_t count : orderedSearch.getStats().applied)
+    orderedApplied += count;
+  assert(orderedApplied > 0);
+
+  // a memetic run keeps the pool warm as well
+  OrderCrossover crossover;
+  InversionMutation mutation;
+  GeneticAlgorithmOptions options;
+  options.populationSize = 10;
+  GeneticAlgorithm ga(model, &crossover, &mutation, &localSearch, nullptr,
+                      options);
+  ga.initialize();
+  ga.step();
+  std::size_t before = allocations;
+  for (int g = 0; g < 5; ++g)
+    ga.step();
+  assert(allocations == before);
+
+  std::cout << "Local search: " << applied << " moves applied of "
+            << stats.evaluated << " evaluated, mean gain " << gained / 30
+            << ", " << stats.undone << " undone, " << stats.reverted
+            << " runs reverted\n";
+  std::cout << "Test LocalSearch passed\n";
+}
+
+void test_repair() {
+  RoutingFixture fixture;
+  RoutingOptions options;
+  options.tuplePrecedence = true;
+  options.routeTimeLimit = fixture.serviceTime() / 4;
+  RoutingModel model = fixture.model(options);
+  const int n = model.getNumStops();
+
+  LoadFeasibilityRepair repair(model);
+  std::mt19937 rng(11);
+  std::vector<int> genes(n);
+  Individual individual(genes.data(), n);
+  double gained = 0.0;
+  for (int trial = 0; trial < 30; ++trial) {
+    std::iota(individual.begin(), individual.end(), 0);
+    std::shuffle(individual.begin(), individual.end(), rng);
+    individual.evaluate(model);
+    double before = individual.getObjective();
+    // the input's score is reused, so at most the repaired tour is split
+    std::size_t evaluations = repair.getEvaluations();
+    repair.repair(individual);
+    assert(repair.getEvaluations() <= evaluations + 1);
+    assert(individual.evaluated);
+    assert(individual.getObjective() ==
+           model.split(individual.begin(), n).objective);
+    assert(individual.getObjective() >= before);
+    gained += individual.getObjective() - before;
+
+    std::vector<int> sorted(individual.begin(), individual.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < n; ++i)
+      assert(sorted[i] == i);
+
+    // every served drop follows all pickups of its tuple in the same route
+    RoutingPlan plan =
+        model.decode(std::vector<int>(individual.begin(), individual.end()));
+    for (const auto &route : plan.routes) {
+      checkRoute(model, route);
+      for (size_t p = 0; p < route.size(); ++p) {
+        const Stop &stop = model.getStop(route[p]);
+        if (stop.quantity > 0)
+          continue;
+        int pickups = 0;
+        for (size_t q = 0; q < p; ++q)
+          if (model.getStop(route[q]).tuple == stop.tuple)
+            pickups += model.getStop(route[q]).quantity > 0;
+        assert(pickups == model.getTuplePickups(stop.tuple));
+      }
+    }
+  }
+  const RepairStats &stats = repair.getStats();
+  assert(stats.repaired == 30 && stats.reinserted > 0 && gained > 0);
+
+  // repair inside the GA does not allocate either
+  OrderCrossover crossover;
+  InversionMutation mutation;
+  GeneticAlgorithmOptions gaOptions;
+  gaOptions.populationSize = 10;
+  GeneticAlgorithm ga(model, &crossover, &mutation, nullptr, &repair,
+                      gaOptions);
+  ga.initialize();
+  ga.step();
+  std::size_t allocated = allocations;
+  for (int g = 0; g < 5; ++g)
+    ga.step();
+  assert(allocations == allocated);
+
+  std::cout << "Repair: " << stats.removed << " removed, " << stats.reinserted
+            << " reinserted, " << stats.reverted << " reverted, mean gain "
+            << gained / 30 << "\n";
+  std::cout << "Test Repair passed\n";
+}
+
+// Mean broken-pairs distance over the parents of a GA.
+double meanDistance(GeneticAlgorithm &ga, int size) {
+  double sum = 0.0;
+  for (int a = 0; a < size; ++a)
+    for (int b = a + 1; b < size; ++b)
+      sum +=
+          brokenPairsDistance(ga.getPopulation()[a], ga.getPopulation()[b]);
+  return sum / (size * (size - 1) / 2);
+}
+
+void test_diversification() {
+  // hash: equal tours agree, and a relocate updates it with six toggles
+  TourHash hash(6);
+  std::vector<int> tour = {0, 1, 2, 3, 4, 5};
+  std::uint64_t h = hash.of(tour.data(), 6);
+  assert(h == hash.of(std::vector<int>(tour).data(), 6));
+  std::vector<int> moved = {0, 2, 3, 1, 4, 5}; // stop 1 moved after 3
+  std::uint64_t relinked = h;
+  for (auto [from, to] : {std::pair{0, 1}, {1, 2}, {3, 4}})
+    relinked = hash.toggle(relinked, from, to);
+  for (auto [from, to] : {std::pair{0, 2}, {3, 1}, {1, 4}})
+    relinked = hash.toggle(relinked, from, to);
+  assert(relinked == hash.of(moved.data(), 6) && relinked != h);
+
+  // broken pairs: 1->2, 2->3 and 3->depot are missing from the second tour
+  std::vector<int> a = {0, 1, 2, 3}, b = {0, 1, 3, 2};
+  Individual ia(a.data(), 4), ib(b.data(), 4);
+  assert(brokenPairsDistance(ia, ia) == 0.0);
+  assert(std::fabs(brokenPairsDistance(ia, ib) - 3.0 / 5) < 1e-12);
+
+  RoutingFixture fixture;
+  RoutingModel model = fixture.model();
+  const int n = model.getNumStops();
+
+  OrderCrossover crossover;
+  RelocateMutation mutation;
+  GeneticAlgorithmOptions options;
+  options.populationSize = 20;
+  options.generations = 60;
+  options.mutationRate = 0.1;
+  options.seed = 3;
+
+  GeneticAlgorithm plain(model, &crossover, &mutation, nullptr, nullptr,
+                         options);
+  GeneticAlgorithmResult plainResult = plain.run();
+
+  BrokenPairsDiversification diversity(2 * options.populationSize, n);
+  GeneticAlgorithm ga(model, &crossover, &mutation, nullptr, nullptr,
+                      options);
+  ga.setDiversification(&diversity);
+  GeneticAlgorithmResult result = ga.run();
+  assert(result.clonesRejected > 0);
+  assert(result.clonesRejected == diversity.getStats().rejected);
+  // the initial tours and every child are split once or rejected as clones;
+  // without clone control, copies of a parent keep its score unsplit
+  const std::size_t tours =
+      static_cast<std::size_t>(options.generations + 1) *
+      options.populationSize;
+  assert(result.evaluations + result.clonesRejected == tours);
+  assert(plainResult.evaluations < tours);
+  for (size_t g = 1; g < result.trace.size(); ++g)
+    assert(result.trace[g] >= result.trace[g - 1]);
+
+  // survivors are distinct, sorted, and spread wider than without control
+  Population &population = ga.getPopulation();
+  for (int a = 0; a < options.populationSize; ++a) {
+    assert(population[a].evaluated);
+    if (a > 0)
+      assert(population[a].getObjective() <=
+             population[a - 1].getObjective());
+    for (int b = a + 1; b < options.populationSize; ++b)
+      assert(brokenPairsDistance(population[a], population[b]) > 0);
+  }
+  double spread = meanDistance(ga, options.populationSize);
+  double plainSpread = meanDistance(plain, options.populationSize);
+  assert(spread > plainSpread);
+
+  // generations stay allocation-free
+  ga.step();
+  std::size_t before = allocations;
+  for (int g = 0; g < 5; ++g)
+    ga.step();
+  assert(allocations == before);
+
+  std::cout << "Diversification: " << result.clonesRejected
+            << " clones rejected, spread " << spread << " vs " << plainSpread
+            << ", objective " << result.best.evaluation.objective << " vs "
+            << plainResult.best.evaluation.objective << "\n";
+  std::cout << "Test Diversification passed\n";
+}
+
+void test_construction() {
+  RoutingFixture fixture(40);
+  RoutingOptions options;
+  options.routeTimeLimit = fixture.serviceTime() / 6;
+  RoutingModel model = fixture.model(options);
+  const int n = model.getNumStops();
+
+  ConstructionOptions construction;
+  construction.threads = 1;
+  ConstructionResult result = SavingsConstruction(model, construction).run();
+  construction.threads = 3;
+  assert(SavingsConstruction(model, construction).run().tour == result.tour);
+
+  // the plan is feasible, within the fleet, and covers every stop once
+  const RoutingPlan &plan = result.plan;
+  assert((int)plan.routes.size() <= fixture.param.numOfVehicles);
+  assert(result.merges > 0);
+  double duration = 0.0;
+  for (const auto &route : plan.routes)
+    duration += checkRoute(model, route);
+  assert(std::fabs(duration - plan.evaluation.duration) <= 1e-6 * duration);
+  std::vector<int> sorted = result.tour;
+  std::sort(sorted.begin(), sorted.end());
+  for (int i = 0; i < n; ++i)
+    assert(sorted[i] == i);
+
+  // as a GA seed it is never lost
+  OrderCrossover crossover;
+  InversionMutation mutation;
+  GeneticAlgorithmOptions gaOptions;
+  gaOptions.populationSize = 20;
+  gaOptions.generations = 20;
+  GeneticAlgorithm ga(model, &crossover, &mutation, nullptr, nullptr,
+                      gaOptions);
+  ga.addInitialTour(result.tour);
+  double seed = model.split(result.tour.data(), n).objective;
+  assert(ga.run().best.evaluation.objective >= seed);
+
+  std::cout << "Construction: " << plan.evaluation.routes << " routes, "
+            << plan.evaluation.unserved << " stops unserved, objective "
+            << plan.evaluation.objective << " (split " << seed << ") in "
+            << result.elapsedSeconds << "s\n";
+  std::cout << "Test Construction passed\n";
+}
+
+void test_alns() {
+  RoutingFixture fixture(40);
+  RoutingOptions routing;
+  routing.tuplePrecedence = true;
+  routing.routeTimeLimit = fixture.serviceTime() / 6;
+  RoutingModel model = fixture.model(routing);
+  const int n = model.getNumStops();
+
+  AlnsOptions options;
+  options.iterations = 300;
+  options.seed = 5;
+  AdaptiveLargeNeighborhoodSearch alns(model, options);
+  ConstructionResult seed = SavingsConstruction(model).run();
+  alns.setInitialPlan(seed.plan);
+  AlnsResult result = alns.run();
+
+  // feasible routes (load, time, precedence) covering each stop once
+  const RoutingPlan &plan = result.best;
+  assert((int)plan.routes.size() <= fixture.param.numOfVehicles);
+  double duration = 0.0, deltaUDF = 0.0;
+  std::vector<int> seen(n, 0);
+  for (const auto &route : plan.routes) {
+    duration += checkRoute(model, route);
+    for (size_t p = 0; p < route.size(); ++p) {
+      const Stop &stop = model.getStop(route[p]);
+      seen[route[p]]++;
+      deltaUDF += stop.deltaUDF;
+      if (stop.quantity > 0)
+        continue;
+      int pickups = 0;
+      for (size_t q = 0; q < p; ++q)
+        pickups += model.getStop(route[q]).tuple == stop.tuple &&
+                   model.getStop(route[q]).quantity > 0;
+      assert(pickups == model.getTuplePickups(stop.tuple));
+    }
+  }
+  for (int id : plan.unserved)
+    seen[id]++;
+  for (int id = 0; id < n; ++id)
+    assert(seen[id] == 1);
+  const RouteEvaluation &evaluation = plan.evaluation;
+  assert(std::fabs(duration - evaluation.duration) <= 1e-6 * duration);
+  assert(std::fabs(evaluation.objective -
+                   (deltaUDF - routing.timeWeight * duration)) < 1e-6);
+
+  // never worse than its start, and the trace is monotone
+  assert(result.iterations == options.iterations);
+  assert(evaluation.objective >= seed.plan.evaluation.objective - 1e-9);
+  for (size_t i = 1; i < result.trace.size(); ++i)
+    assert(result.trace[i] >= result.trace[i - 1]);
+  AdaptiveLargeNeighborhoodSearch again(model, options);
+  again.setInitialPlan(seed.plan);
+  assert(again.run().bestTour == result.bestTour);
+
+  // both heuristics behind the same interface
+  OrderCrossover crossover;
+  InversionMutation mutation;
+  GeneticAlgorithmOptions gaOptions;
+  gaOptions.populationSize = 10;
+  gaOptions.generations = 10;
+  GeneticAlgorithm ga(model, &crossover, &mutation, nullptr, nullptr,
+                      gaOptions);
+  for (HeuristicBase *heuristic :
+       std::vector<HeuristicBase *>{&alns, &ga}) {
+    Solution solution = heuristic->solve(fixture.instance);
+    assert(solution.isFeasible());
+    assert(solution.getNumRoutes() <= fixture.param.numOfVehicles);
+  }
+  AdaptiveLargeNeighborhoodSearch fresh(model, options);
+  fresh.setInitialPlan(seed.plan);
+  Solution solution = fresh.solve(fixture.instance);
+  assert(std::fabs(solution.getTotalDuration() - evaluation.duration) <
+         1e-6 * evaluation.duration);
+  bool threw = false;
+  try {
+    ProblemInstance other;
+    alns.solve(other);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+
+  // the wall-clock budget stops it
+  AlnsOptions timed;
+  timed.iterations = 0;
+  timed.timeLimitSeconds = 0.2;
+  AlnsResult budget = AdaptiveLargeNeighborhoodSearch(model, timed).run();
+  assert(budget.elapsedSeconds < 0.2 + 0.5 && budget.iterations > 0);
+
+  std::cout << "ALNS: objective " << evaluation.objective << " from "
+            << seed.plan.evaluation.objective << ", " << result.improved
+            << " new best of " << result.iterations << " iterations, weights "
+            << result.removalWeights[0] << "/" << result.removalWeights[1]
+            << "/" << result.removalWeights[2] << "\n";
+  std::cout << "Test ALNS passed\n";
+}
+
+int main() {
+  test_geneticAlgorithm();
+  test_localSearch();
+  test_repair();
+  test_diversification();
+  test_construction();
+  test_alns();
+  test_random();
+  test_logger();
+  test_spscQueue();
+  test_islandModel();
+  return 0;
+}
@@ -7,7 +7,7 @@
 
 int main() {
   ProblemInstance instance("../data/results.csv");
-  auto stations = instance.getStations();
+  auto &stations = instance.getStations();
   // Calculate BCRF and composite distance matrix
   Param param(60, 2, 0.5, 10, 10, 10);
   MetricCalculator::computeBCRF(stations, param);
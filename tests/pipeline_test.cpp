@@ -0,0 +1,397 @@
+#include "clustering/tuple_evaluator.hpp"
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include "core/station_io.hpp"
+#include "pipeline/partition.hpp"
+#include "pipeline/pipeline.hpp"
+#include "pipeline/scenario_runner.hpp"
+#include "utils/ArtifactCache.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+std::vector<StageStatus> statuses(const PipelineResult &result) {
+  std::vector<StageStatus> list;
+  for (const StageReport &stage : result.stages)
+    list.push_back(stage.status);
+  return list;
+}
+
+void test_pipelineCache() {
+  const fs::path dir = fs::temp_directory_path() / "brp_pipeline_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  {
+    // the first 127 stations of the real instance
+    std::ifstream in("../data/results.csv");
+    std::ofstream out(dir / "stations.csv");
+    std::string line;
+    for (int row = 0; row < 128 && std::getline(in, line); ++row)
+      out << line << "\n";
+  }
+  nlohmann::json json = {{"instance", "stations.csv"},
+                         {"cache", (dir / "cache").string()},
+                         {"output", (dir / "plan.json").string()},
+                         {"threads", 2},
+                         {"clustering", {{"k", 12}}}};
+  const auto C = StageStatus::COMPUTED, H = StageStatus::CACHED,
+             N = StageStatus::NOT_NEEDED;
+
+  PipelineConfig config = PipelineConfig::fromJson(json, dir.string());
+  const PipelineResult first = runPipeline(config);
+  assert(statuses(first) == std::vector<StageStatus>({C, C, C, C, C, C, C}));
+  assert(first.stations.size() == 128 && first.clusters.size() == 12);
+  assert(first.selections.size() == 12 && first.totalDeltaUDF > 0);
+
+  // same plan as evaluating the clusters directly
+  TupleClusterEvaluator evaluator(2, 2);
+  NetworkPlan plan = evaluator.evaluateNetwork(first.clusters, first.stations);
+  assert(std::fabs(plan.totalDeltaUDF - first.totalDeltaUDF) < 1e-9);
+
+  // nothing changed: the selection and the clusters come from the cache
+  const PipelineResult second = runPipeline(config);
+  assert(statuses(second) == std::vector<StageStatus>({H, H, N, H, N, H, C}));
+  for (size_t i = 0; i < first.stations.size(); ++i)
+    assert(second.stations[i].getBcrf() == first.stations[i].getBcrf());
+  assert(second.clusters == first.clusters);
+  assert(second.totalDeltaUDF == first.totalDeltaUDF);
+  for (size_t c = 0; c < first.selections.size(); ++c)
+    assert(second.selections[c].selected.size() ==
+           first.selections[c].selected.size());
+
+  // a new k starts from clustering
+  json["clustering"]["k"] = 10;
+  const PipelineResult third =
+      runPipeline(PipelineConfig::fromJson(json, dir.string()));
+  assert(statuses(third) == std::vector<StageStatus>({H, H, H, C, C, C, C}));
+  assert(third.clusters.size() == 10);
+
+  // a damaged artifact is discarded and recomputed
+  const std::string selection =
+      ArtifactCache(config.cache).path("selection", first.stages[5].key);
+  fs::resize_file(selection, fs::file_size(selection) / 2);
+  const PipelineResult fourth = runPipeline(config);
+  assert(fourth.stages[5].status == StageStatus::COMPUTED);
+  assert(fourth.stages[4].status == StageStatus::CACHED);
+  assert(fourth.totalDeltaUDF == first.totalDeltaUDF);
+
+  std::ifstream planFile(config.output);
+  const nlohmann::json exported = nlohmann::json::parse(planFile);
+  assert(exported["clusters"].size() == 12);
+  assert(exported["totalDeltaUDF"] == first.totalDeltaUDF);
+
+  // a tuples-only change regenerates the tuples on the cached clusters and
+  // BCRF, and plans exactly what a cold run does
+  nlohmann::json pattern = config.toJson();
+  pattern["tuples"]["maxSurplus"] = 1;
+  const PipelineResult warm = runPipeline(PipelineConfig::fromJson(pattern));
+  assert(statuses(warm) == std::vector<StageStatus>({H, H, N, H, C, C, C}));
+  pattern["cache"] = (dir / "cold").string();
+  const PipelineResult cold = runPipeline(PipelineConfig::fromJson(pattern));
+  assert(statuses(cold) == std::vector<StageStatus>({C, C, C, C, C, C, C}));
+  assert(warm.clusters == cold.clusters);
+  assert(warm.totalDeltaUDF == cold.totalDeltaUDF);
+  for (size_t c = 0; c < cold.selections.size(); ++c) {
+    const std::vector<TransferTuple> &a = warm.selections[c].selected;
+    const std::vector<TransferTuple> &b = cold.selections[c].selected;
+    assert(a.size() == b.size());
+    for (size_t t = 0; t < a.size(); ++t)
+      assert(a[t].bikeAllocations == b[t].bikeAllocations);
+  }
+  fs::remove_all(dir);
+
+  std::cout << "Pipeline: " << first.totalDeltaUDF << " delta UDF, second run "
+            << second.stages[5].seconds << "s vs "
+            << first.stages[4].seconds + first.stages[5].seconds << "s\n";
+  std::cout << "Test PipelineCache passed\n";
+}
+
+void test_pipelineConfig() {
+  bool threw = false;
+  try {
+    PipelineConfig::fromJson({{"cache", "x"}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+  threw = false;
+  try {
+    PipelineConfig::fromJson(
+        {{"instance", "x.csv"}, {"selection", {{"strategy", "best"}}}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+
+  const PipelineConfig config = PipelineConfig::fromJson(
+      {{"instance", "x.csv"}, {"output", "plan.json"}}, "data");
+  assert(config.instance == "data/x.csv" && config.output == "plan.json");
+  nlohmann::json changed = config.toJson();
+  changed["clustering"]["k"] = 7;
+  changed["selection"]["strategy"] = "anytime";
+  const PipelineConfig reread = PipelineConfig::fromJson(changed);
+  assert(reread.toJson() == changed && reread.instance == config.instance);
+  assert(reread.k == 7 &&
+         reread.selection.strategy == SelectionStrategy::ANYTIME);
+
+  // field boundaries are part of the hash
+  assert(ContentHash().add("ab").add("c").hex() !=
+         ContentHash().add("a").add("bc").hex());
+  assert(ContentHash().add("ab").hex() == ContentHash().add("ab").hex());
+  assert(ContentHash().hex().size() == 32);
+  std::cout << "Test PipelineConfig passed\n";
+}
+
+void test_scenarioRunner() {
+  const fs::path dir = fs::temp_directory_path() / "brp_scenario_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  {
+    std::ifstream in("../data/results.csv");
+    std::ofstream out(dir / "stations.csv");
+    std::string line;
+    for (int row = 0; row < 64 && std::getline(in, line); ++row)
+      out << line << "\n";
+  }
+  const PipelineConfig config = PipelineConfig::fromJson(
+      {{"instance", "stations.csv"}, {"clustering", {{"k", 6}}}},
+      dir.string());
+  PipelineResult instance = loadInstance(config);
+  assert(instance.stages[0].status == StageStatus::COMPUTED);
+  assert(instance.stages[1].status == StageStatus::NOT_NEEDED);
+  const auto stations = std::make_shared<const std::vector<Station>>(
+      std::move(instance.stations));
+  const ScenarioRunner runner(
+      stations,
+      std::make_shared<const std::vector<std::vector<double>>>(
+          std::move(instance.timeMatrix)),
+      config);
+
+  // the reference is the pipeline's own result
+  const PipelineResult full = runPipeline(config);
+  ScenarioOptions options;
+  options.scenarios = 12;
+  options.threads = 3;
+  const ScenarioSummary summary = runner.run(options);
+  assert(summary.referenceClusters == full.clusters);
+  assert(std::fabs(summary.reference.totalDeltaUDF - full.totalDeltaUDF) <
+         1e-9);
+
+  // independent of the thread count, reproducible from sample()
+  options.threads = 1;
+  const ScenarioSummary serial = runner.run(options);
+  for (size_t s = 0; s < summary.scenarios.size(); ++s) {
+    assert(serial.scenarios[s].totalDeltaUDF ==
+           summary.scenarios[s].totalDeltaUDF);
+    assert(serial.scenarios[s].adjustedRandIndex ==
+           summary.scenarios[s].adjustedRandIndex);
+  }
+  const ScenarioSummary five = runner.run(
+      std::vector<InventoryOverlay>{runner.sample(options.seed, 5, 0.15)});
+  assert(five.scenarios[0].totalDeltaUDF == summary.scenarios[5].totalDeltaUDF);
+
+  const Distribution &d = summary.deltaUDF;
+  assert(d.min <= d.p05 && d.p05 <= d.p50 && d.p50 <= d.p95 && d.p95 <= d.max);
+  assert(summary.adjustedRandIndex.max <= 1.0 + 1e-12);
+  for (double stability : summary.stationStability)
+    assert(stability >= 0.0 && stability <= 1.0 + 1e-12);
+
+  // the shared stations are never written to
+  for (size_t i = 0; i < stations->size(); ++i)
+    assert((*stations)[i].getCurrentInventory() ==
+           full.stations[i].getCurrentInventory());
+
+  // without noise every scenario is the reference
+  const ScenarioSummary same =
+      runner.run(std::vector<InventoryOverlay>(3, runner.sample(1, 0, 0.0)), 2);
+  for (const ScenarioOutcome &outcome : same.scenarios) {
+    assert(outcome.adjustedRandIndex == 1.0);
+    assert(outcome.totalDeltaUDF == same.reference.totalDeltaUDF);
+  }
+  for (double stability : same.stationStability)
+    assert(stability == 1.0);
+
+  bool threw = false;
+  try {
+    runner.run(std::vector<InventoryOverlay>{InventoryOverlay(3, 0)});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+  assert(adjustedRandIndex({{1, 2}, {3, 4}}, {{3, 4}, {2, 1}}, 5) == 1.0);
+  assert(adjustedRandIndex({{1, 2}, {3, 4}}, {{1, 3}, {2, 4}}, 5) < 0.5);
+  fs::remove_all(dir);
+
+  std::cout << "Scenarios: delta UDF " << d.mean << " +- " << d.stddev
+            << " (reference " << summary.reference.totalDeltaUDF << "), ARI "
+            << summary.adjustedRandIndex.mean << ", " << summary.seconds
+            << "s\n";
+  std::cout << "Test ScenarioRunner passed\n";
+}
+
+void test_partitionedPipeline() {
+  const fs::path dir = fs::temp_directory_path() / "brp_partition_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::vector<Station> prefix;
+  {
+    std::ifstream in("../data/results.csv");
+    std::ofstream out(dir / "stations.csv");
+    std::string line;
+    for (int row = 0; row < 128 && std::getline(in, line); ++row)
+      out << line << "\n";
+  }
+  {
+    std::ifstream in(dir / "stations.csv");
+    prefix = readStationsCsv(in);
+  }
+  const ProblemInstance instance(prefix);
+  const std::vector<Station> &stations = instance.getStations();
+
+  const std::vector<Region> regions = partitionStations(stations, 4, 300);
+  assert(regions.size() == 4);
+  std::vector<int> owners(stations.size(), 0);
+  for (size_t r = 0; r < regions.size(); ++r) {
+    assert(regions[r].owned.size() >= stations.size() / 4 - 1);
+    for (int station : regions[r].owned)
+      ++owners[station];
+    for (int station : regions[r].halo)
+      assert(!std::binary_search(regions[r].owned.begin(),
+                                 regions[r].owned.end(), station));
+  }
+  assert(owners[0] == 0);
+  for (size_t i = 1; i < owners.size(); ++i)
+    assert(owners[i] == 1);
+
+  // the slices of a time matrix file plan exactly like Euclidean times
+  {
+    std::ofstream matrix(dir / "times.csv");
+    matrix.precision(17);
+    matrix << "From/To";
+    for (const Station &station : stations)
+      matrix << "," << station.getSysId();
+    matrix << "\n";
+    for (size_t i = 0; i < stations.size(); ++i) {
+      matrix << stations[i].getSysId();
+      for (double time : instance.getTimeMatrix()[i])
+        matrix << "," << time;
+      matrix << "\n";
+    }
+  }
+  PartitionOptions options;
+  options.regions = 2;
+  options.marginMeters = 300;
+  options.maxSeamClusterStations = 16;
+  options.jobs = 2;
+  options.workDirectory = (dir / "work").string();
+  options.workerCommand = "./BRP-cluster";
+  nlohmann::json json = {{"instance", "stations.csv"},
+                         {"output", (dir / "plan.json").string()},
+                         {"clustering", {{"k", 12}}}};
+  const PartitionedResult euclidean = runPartitioned(
+      PipelineConfig::fromJson(json, dir.string()), options);
+  json["timeMatrix"] = "times.csv";
+  const PartitionedResult sliced = runPartitioned(
+      PipelineConfig::fromJson(json, dir.string()), options);
+  assert(fs::exists(dir / "work" / "region-1.matrix.csv"));
+  assert(sliced.plan.totalDeltaUDF == euclidean.plan.totalDeltaUDF);
+
+  // one plan for the whole network: every station in at most one cluster
+  // and one tuple
+  const PartitionedResult &result = euclidean;
+  assert(result.reports.size() == 2 && result.seamStations > 0);
+  std::vector<int> clustered(stations.size(), 0), moved(stations.size(), 0);
+  double total = 0.0, regional = 0.0;
+  for (size_t c = 0; c < result.plan.clusters.size(); ++c) {
+    for (int station : result.plan.clusters[c])
+      ++clustered[station];
+    for (const TransferTuple &tuple : result.plan.selections[c].selected) {
+      std::set<int> used;
+      for (const auto &[pair, bikes] : tuple.bikeAllocations)
+        used.insert({pair.first, pair.second});
+      for (int station : used)
+        ++moved[station];
+    }
+    total += result.plan.selections[c].totalDeltaUDF;
+  }
+  for (size_t i = 0; i < stations.size(); ++i)
+    assert(clustered[i] <= 1 && moved[i] <= 1);
+  for (const RegionReport &report : result.reports)
+    regional += report.deltaUDF;
+  assert(std::fabs(total - result.plan.totalDeltaUDF) < 1e-9);
+  assert(std::fabs(regional + result.seamDeltaUDF - total) < 1e-9);
+  std::ifstream planFile(dir / "plan.json");
+  assert(nlohmann::json::parse(planFile)["totalDeltaUDF"] == total);
+
+  // seam clusters plan like a direct evaluation over the whole network, with
+  // its BCRF and times, whether those come from coordinates or a matrix file
+  json["tuples"] = {{"routeScoring", true}};
+  for (const bool fromFile : {false, true}) {
+    if (!fromFile)
+      json.erase("timeMatrix");
+    else
+      json["timeMatrix"] = "times.csv";
+    const PipelineConfig config = PipelineConfig::fromJson(json, dir.string());
+    const PartitionedResult routed = runPartitioned(config, options);
+    assert(routed.seamClusters > 0);
+    std::vector<Station> direct = stations;
+    Param param(config.tLoad, config.alpha, config.beta,
+                static_cast<int>(stations.size()) - 1, config.k, 1,
+                config.vehicleCapacity);
+    MetricCalculator::computeBCRF(direct, param);
+    TupleClusterEvaluator evaluator(config.maxSurplus, config.maxDeficit);
+    evaluator.enableRouteScoring(instance.getTimeMatrix(), param);
+    size_t seamTuples = 0;
+    for (size_t c = routed.plan.clusters.size() - routed.seamClusters;
+         c < routed.plan.clusters.size(); ++c) {
+      const std::vector<TransferTuple> &seam =
+          routed.plan.selections[c].selected;
+      const ClusterEvaluationResult expected = evaluator.evaluateCluster(
+          routed.plan.clusters[c], direct, config.selection);
+      assert(seam.size() == expected.assignedTuples.size());
+      for (size_t t = 0; t < seam.size(); ++t) {
+        const TransferTuple &want = expected.assignedTuples[t];
+        assert(seam[t].bikeAllocations == want.bikeAllocations);
+        assert(seam[t].visitOrder == want.visitOrder);
+        assert(std::fabs(seam[t].deltaUDF - want.deltaUDF) < 1e-9);
+        assert(std::fabs(seam[t].serviceTime - want.serviceTime) < 1e-9);
+      }
+      seamTuples += seam.size();
+    }
+    assert(seamTuples > 0);
+  }
+
+  bool threw = false;
+  options.workerCommand = "./no-such-worker";
+  try {
+    runPartitioned(PipelineConfig::fromJson(json, dir.string()), options);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw);
+  fs::remove_all(dir);
+
+  std::cout << "Partitioned: delta UDF " << total << " (seam "
+            << result.seamDeltaUDF << " over " << result.seamStations
+            << " stations) in " << result.seconds << "s\n";
+  std::cout << "Test PartitionedPipeline passed\n";
+}
+
+int main() {
+  test_pipelineConfig();
+  test_pipelineCache();
+  test_scenarioRunner();
+  test_partitionedPipeline();
+  return 0;
+}
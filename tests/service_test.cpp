@@ -0,0 +1,258 @@
+#include "pipeline/pipeline.hpp"
+#include "service/rebalancing_service.hpp"
+#include "service/unix_socket_server.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+// The first 63 stations of the real instance in 6 clusters, no cache.
+RebalancingService warmService(const fs::path &dir) {
+  fs::create_directories(dir);
+  std::ifstream in("../data/results.csv");
+  std::ofstream out(dir / "stations.csv");
+  std::string line;
+  for (int row = 0; row < 64 && std::getline(in, line); ++row)
+    out << line << "\n";
+  out.close();
+  const PipelineConfig config = PipelineConfig::fromJson(
+      {{"instance", "stations.csv"}, {"clustering", {{"k", 6}}}},
+      dir.string());
+  return RebalancingService(runPipeline(config), config);
+}
+
+bool sumsUp(const json &plan) {
+  double total = 0.0;
+  for (const json &cluster : plan["clusters"])
+    total += cluster["deltaUDF"].get<double>();
+  return std::fabs(total - plan["totalDeltaUDF"].get<double>()) < 1e-9;
+}
+
+void test_serviceSnapshots(RebalancingService &service) {
+  const auto first = service.snapshot();
+  const json plan = service.handle({{"op", "plan"}, {"id", 7}});
+  assert(plan["version"] == 1 && plan["id"] == 7);
+  assert(plan["computed"] == 0); // warm: from the pipeline's selection
+  assert(plan["clusters"].size() == first->clusters->size() && sumsUp(plan));
+
+  // move a cluster's first surplus or deficit station to balance
+  int station = -1, cluster = -1;
+  for (size_t c = 0; c < first->clusters->size() && station < 0; ++c)
+    for (int s : (*first->clusters)[c])
+      if ((*first->stations)[s].getStatus() != StationStatus::BALANCED) {
+        station = s;
+        cluster = static_cast<int>(c);
+        break;
+      }
+  assert(station > 0);
+  const Station &before = (*first->stations)[station];
+  const json updated = service.handle(
+      {{"op", "update"},
+       {"inventories", {{before.getSysId(), before.getOptimalInventory()}}}});
+  assert(updated["version"] == 2);
+
+  const auto second = service.snapshot();
+  assert(first->version == 1 && second->version == 2);
+  assert((*first->stations)[station].getCurrentInventory() ==
+         before.getCurrentInventory());
+  assert((*second->stations)[station].getStatus() == StationStatus::BALANCED);
+  assert(second->clusters == first->clusters);
+  for (size_t c = 0; c < first->plans.size(); ++c)
+    assert((second->plans[c] == first->plans[c]) == ((int)c != cluster));
+
+  const json replanned = service.handle({{"op", "plan"}});
+  assert(replanned["version"] == 2 && replanned["computed"] == 1);
+  assert(sumsUp(replanned));
+  assert(service.handle({{"op", "plan"}})["computed"] == 0);
+  // the old snapshot still answers with its own plan
+  assert(service.plan(*first, {cluster})["clusters"][0] ==
+         plan["clusters"][cluster]);
+
+  // rejected requests change nothing
+  const json errors[] = {
+      service.handle({{"op", "update"}, {"inventories", {{"nope", 1}}}}),
+      service.handle(
+          {{"op", "update"},
+           {"inventories", {{before.getSysId(), before.getCapacity() + 1}}}}),
+      service.handle({{"op", "plan"}, {"clusters", {99}}}),
+      service.handle({{"op", "route"}}), service.handle({{"cluster", 1}})};
+  for (const json &error : errors)
+    assert(error.contains("error"));
+  assert(json::parse(service.handleLine("{\"op\":")).contains("error"));
+  assert(service.snapshot()->version == 2);
+
+  const json reclustered = service.handle({{"op", "recluster"}, {"k", 4}});
+  assert(reclustered["version"] == 3 && reclustered["clusters"] == 4);
+  const json status = service.handle({{"op", "status"}});
+  assert(status["clusters"] == 4 && status["plansReady"] == 0);
+  assert(status["stations"] == 63);
+  assert(sumsUp(service.handle({{"op", "plan"}})));
+  std::cout << "Test ServiceSnapshots passed\n";
+}
+
+// Plans on several threads while inventories change under them.
+void test_serviceConcurrency(RebalancingService &service) {
+  const auto start = service.snapshot();
+  std::vector<std::pair<std::string, int>> stations;
+  for (size_t i = 1; i < start->stations->size(); i += 5)
+    stations.emplace_back((*start->stations)[i].getSysId(),
+                          (*start->stations)[i].getCapacity());
+  std::atomic<bool> done{false};
+  std::atomic<int> plans{0}, planning{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t)
+    readers.emplace_back([&] {
+      std::uint64_t lastVersion = 0;
+      for (bool first = true; first || !done; first = false) {
+        const json plan = service.handle({{"op", "plan"}});
+        assert(!plan.contains("error") && sumsUp(plan));
+        assert(plan["version"].get<std::uint64_t>() >= lastVersion);
+        lastVersion = plan["version"];
+        ++plans;
+        if (first)
+          ++planning;
+      }
+    });
+  // every reader is past its first plan before the updates start
+  while (planning < 3)
+    std::this_thread::yield();
+  for (int round = 0; round < 12; ++round) {
+    json inventories = json::object();
+    for (size_t s = round % 3; s < stations.size(); s += 3)
+      inventories[stations[s].first] = (round * 7 + s) % stations[s].second;
+    const json response =
+        service.handle({{"op", "update"}, {"inventories", inventories}});
+    assert(!response.contains("error"));
+  }
+  done = true;
+  for (std::thread &reader : readers)
+    reader.join();
+  assert(service.snapshot()->version == start->version + 12);
+  assert(plans >= 3);
+
+  const json latency = service.handle({{"op", "latency"}});
+  assert(latency["update"]["count"] == 12 + 3); // and three earlier
+  const json &plan = latency["plan"];
+  assert(plan["count"].get<int>() >= plans);
+  assert(plan["p50Ms"] <= plan["p99Ms"] && plan["p99Ms"] <= plan["maxMs"]);
+  std::uint64_t bucketed = 0;
+  for (const json &bucket : plan["buckets"])
+    bucketed += bucket[1].get<std::uint64_t>();
+  assert(bucketed == plan["count"]);
+  std::cout << "Service: " << plans << " plans during 12 updates, p99 "
+            << plan["p99Ms"] << " ms\n";
+  std::cout << "Test ServiceConcurrency passed\n";
+}
+
+// Started from cached stages, the service plans like one started cold, also
+// after an update: both rank the stations of a tuple by BCRF.
+void test_serviceWarmStart(const fs::path &dir) {
+  const PipelineConfig config = PipelineConfig::fromJson(
+      {{"instance", "stations.csv"},
+       {"cache", (dir / "cache").string()},
+       {"clustering", {{"k", 6}}}},
+      dir.string());
+  PipelineResult cold = runPipeline(config);
+  PipelineResult warm = runPipeline(config);
+  assert(warm.stages[1].status == StageStatus::CACHED);
+  for (size_t i = 0; i < cold.stations.size(); ++i)
+    assert(warm.stations[i].getBcrf() == cold.stations[i].getBcrf());
+
+  // empty a station that has bikes and should keep some
+  int station = 1;
+  while (warm.stations[station].getCurrentInventory() == 0 ||
+         warm.stations[station].getOptimalInventory() == 0)
+    ++station;
+  const json update = {
+      {"op", "update"},
+      {"inventories", {{warm.stations[station].getSysId(), 0}}}};
+  RebalancingService fromCold(std::move(cold), config);
+  RebalancingService fromWarm(std::move(warm), config);
+  fromCold.handle(update);
+  fromWarm.handle(update);
+
+  const Station &updated = (*fromWarm.snapshot()->stations)[station];
+  const int optimal = updated.getOptimalInventory();
+  const double bcrf = (updated.getUdfAt(0) - updated.getUdfAt(optimal)) /
+                      (config.tLoad * optimal);
+  assert(std::fabs(updated.getBcrf() - bcrf) < 1e-12);
+  const json plan = fromWarm.handle({{"op", "plan"}});
+  assert(plan["computed"] == 1);
+  assert(plan == fromCold.handle({{"op", "plan"}}));
+  std::cout << "Test ServiceWarmStart passed\n";
+}
+
+void test_unixSocketServer(RebalancingService &service, const fs::path &dir) {
+  const std::string path = (dir / "brp.sock").string();
+  bool shutdownRequested = false;
+  service.setShutdownHandler([&] { shutdownRequested = true; });
+  UnixSocketServer server(path, [&](const std::string &line) {
+    return service.handleLine(line);
+  });
+  server.start();
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+  const int connected = ::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                                  sizeof(address));
+  assert(connected == 0);
+  // two requests in one write, the second split across two
+  const std::string requests[] = {
+      "{\"op\": \"status\", \"id\": 1}\n{\"op\": \"pl",
+      "an\", \"clusters\": [0], \"id\": 2}\n\n{\"op\": \"shutdown\"}\n"};
+  for (const std::string &request : requests) {
+    const ssize_t written = ::write(fd, request.data(), request.size());
+    assert(written == (ssize_t)request.size());
+    ::usleep(10000);
+  }
+  std::string received;
+  char chunk[4096];
+  while (std::count(received.begin(), received.end(), '\n') < 3) {
+    const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+    assert(n > 0);
+    received.append(chunk, n);
+  }
+  std::istringstream lines(received);
+  std::string line;
+  std::getline(lines, line);
+  assert(json::parse(line)["id"] == 1);
+  std::getline(lines, line);
+  const json plan = json::parse(line);
+  assert(plan["id"] == 2 && plan["clusters"].size() == 1);
+  std::getline(lines, line);
+  assert(json::parse(line) == json::object() && shutdownRequested);
+
+  server.stop();
+  const ssize_t remaining = ::read(fd, chunk, sizeof(chunk));
+  assert(remaining == 0); // closed by the server
+  ::close(fd);
+  assert(!fs::exists(path));
+  std::cout << "Test UnixSocketServer passed\n";
+}
+
+int main() {
+  const fs::path dir = fs::temp_directory_path() / "brp_service_test";
+  fs::remove_all(dir);
+  RebalancingService service = warmService(dir);
+  test_serviceSnapshots(service);
+  test_serviceConcurrency(service);
+  test_serviceWarmStart(dir);
+  test_unixSocketServer(service, dir);
+  fs::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,253 @@
+#include "core/instance_generator.hpp"
+#include "core/problem.hpp"
+#include "core/solution.hpp"
+#include "core/station_io.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// Duration of a route, recomputed from scratch.
+double routeDuration(const ProblemInstance &instance, const Param &param,
+                     const std::vector<int> &stations,
+                     const std::vector<int> &quantities) {
+  const auto &time = instance.getTimeMatrix();
+  double duration = 0.0;
+  int last = 0;
+  for (size_t k = 0; k < stations.size(); ++k) {
+    duration += time[last][stations[k]] + param.tLoad * std::abs(quantities[k]);
+    last = stations[k];
+  }
+  return stations.empty() ? 0.0 : duration + time[last][0];
+}
+
+void test_cachedMetrics() {
+  ProblemInstance instance("../data/results.csv");
+  Param param(60, 2, 0.5, 10, 10, 3, 12);
+  Solution solution(instance, param);
+
+  int r0 = solution.addRoute(), r1 = solution.addRoute();
+  solution.insertVisit(r0, 0, 5, 4);
+  solution.insertVisit(r0, 1, 9, -3);
+  solution.insertVisit(r0, 2, 7, -1);
+  solution.insertVisit(r1, 0, 11, 2);
+  solution.insertVisit(r1, 1, 3, -5); // load goes negative
+  assert(solution.getLoads(r0) == std::vector<int>({4, 1, 0}));
+  assert(solution.isFeasible(r0) && !solution.isFeasible(r1));
+  assert(!solution.isFeasible());
+  double d0 = routeDuration(instance, param, solution.getStations(r0),
+                            solution.getQuantities(r0));
+  assert(std::fabs(solution.getDuration(r0) - d0) < 1e-9);
+
+  double udf = 0.0;
+  for (int k = 0; k < 3; ++k) {
+    const Station &s = instance.getStations()[solution.getStations(r0)[k]];
+    int q = solution.getQuantities(r0)[k];
+    udf += s.getUdfAt(s.getCurrentInventory()) -
+           s.getUdfAt(s.getCurrentInventory() - q);
+  }
+  assert(std::fabs(solution.getDeltaUDF(r0) - udf) < 1e-12);
+
+  // only the modified route is re-evaluated
+  solution.getTotalDuration();
+  std::size_t evaluations = solution.getEvaluations();
+  solution.setQuantity(r1, 1, -2);
+  assert(solution.getTotalDuration() > 0 && solution.isFeasible());
+  assert(solution.getEvaluations() == evaluations + 1);
+
+  // copies share routes until one of them writes
+  Solution child = solution;
+  assert(&child.getStations(r0) == &solution.getStations(r0));
+  child.eraseVisit(r0, 2);
+  assert(&child.getStations(r0) != &solution.getStations(r0));
+  assert(&child.getStations(r1) == &solution.getStations(r1));
+  assert(solution.getRouteSize(r0) == 3 && child.getRouteSize(r0) == 2);
+  assert(child.getLoads(r0) == std::vector<int>({4, 1}));
+
+  bool threw = false;
+  try {
+    child.insertVisit(r0, 5, 2, 1);
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  assert(threw);
+  std::cout << "Test CachedMetrics passed\n";
+}
+
+void test_serialization() {
+  ProblemInstance instance("../data/results.csv");
+  Param param(60, 2, 0.5, 10, 10, 3, 12);
+  Solution solution(instance, param);
+  for (int r = 0; r < 3; ++r) {
+    int route = solution.addRoute();
+    for (int k = 0; k < 20; ++k)
+      solution.insertVisit(route, k, 1 + (r * 37 + k * 11) % 200,
+                           k % 2 ? -(k % 5) - 1 : k % 5 + 1);
+  }
+
+  std::stringstream buffer;
+  solution.save(buffer);
+  std::string bytes = buffer.str();
+  // 3 routes x 20 visits fit in well under 4 bytes per visit
+  assert(bytes.size() < 3 * 20 * 4);
+
+  Solution loaded = Solution::load(buffer, instance, param);
+  assert(loaded.getNumRoutes() == 3);
+  for (int r = 0; r < 3; ++r) {
+    assert(loaded.getStations(r) == solution.getStations(r));
+    assert(loaded.getQuantities(r) == solution.getQuantities(r));
+    assert(loaded.getDuration(r) == solution.getDuration(r));
+  }
+
+  std::stringstream truncated(bytes.substr(0, bytes.size() / 2));
+  bool threw = false;
+  try {
+    Solution::load(truncated, instance, param);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw);
+  std::cout << "Checkpoint: " << bytes.size() << " bytes for 60 visits\n";
+  std::cout << "Test Serialization passed\n";
+}
+
+bool sameStations(const std::vector<Station> &a,
+                  const std::vector<Station> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i)
+    if (a[i].getSysId() != b[i].getSysId() || a[i].getId() != b[i].getId() ||
+        a[i].getCoordinate().latitude != b[i].getCoordinate().latitude ||
+        a[i].getCoordinate().longitude != b[i].getCoordinate().longitude ||
+        a[i].getCapacity() != b[i].getCapacity() ||
+        a[i].getCurrentInventory() != b[i].getCurrentInventory() ||
+        a[i].getOptimalInventory() != b[i].getOptimalInventory() ||
+        a[i].getUdfValues() != b[i].getUdfValues())
+      return false;
+  return true;
+}
+
+void test_instanceGenerator() {
+  InstanceGeneratorOptions options;
+  options.stations = 3000;
+  options.seed = 42;
+  const std::vector<Station> stations = generateStations(options);
+  assert(sameStations(stations, generateStations(options)));
+  options.seed = 43;
+  assert(!sameStations(stations, generateStations(options)));
+
+  int surplus = 0, deficit = 0;
+  for (size_t i = 0; i < stations.size(); ++i) {
+    const Station &s = stations[i];
+    assert(s.getId() == static_cast<int>(i) + 1);
+    assert(s.getCapacity() >= 15 && s.getCapacity() <= 123);
+    assert(s.getUdfValues().size() == size_t(s.getCapacity()) + 1);
+    const std::vector<double> &udf = s.getUdfValues();
+    assert(std::min_element(udf.begin(), udf.end()) - udf.begin() ==
+           s.getOptimalInventory());
+    for (int x = 1; x < s.getCapacity(); ++x)
+      assert(udf[x - 1] + udf[x + 1] - 2 * udf[x] >= -1e-9); // convex
+    surplus += s.getCurrentInventory() > s.getOptimalInventory();
+    deficit += s.getCurrentInventory() < s.getOptimalInventory();
+  }
+  assert(std::abs(surplus - 0.36 * 3000) < 100);
+  assert(std::abs(deficit - 0.60 * 3000) < 100);
+
+  // both formats give the stations back as written
+  std::stringstream csv;
+  writeStationsCsv(csv, stations);
+  assert(!isStationsBinary(csv));
+  std::vector<Station> fromCsv = readStationsCsv(csv);
+  assert(fromCsv.size() == stations.size());
+  for (size_t i = 0; i < stations.size(); ++i) {
+    assert(fromCsv[i].getCapacity() == stations[i].getCapacity());
+    assert(fromCsv[i].getOptimalInventory() ==
+           stations[i].getOptimalInventory());
+    assert(std::fabs(fromCsv[i].getUdfAt(3) - stations[i].getUdfAt(3)) <
+           1e-6);
+  }
+  std::stringstream binary;
+  writeStationsBinary(binary, stations);
+  const std::string bytes = binary.str();
+  assert(bytes.size() < csv.str().size());
+  assert(isStationsBinary(binary));
+  assert(sameStations(readStationsBinary(binary), stations));
+  std::stringstream truncated(bytes.substr(0, bytes.size() - 5));
+  bool threw = false;
+  try {
+    readStationsBinary(truncated);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw);
+
+  // the real instance through the binary format, loaded by ProblemInstance
+  std::ifstream real("../data/results.csv");
+  const std::vector<Station> realStations = readStationsCsv(real);
+  {
+    std::ofstream file("stations_test.bin", std::ios::binary);
+    writeStationsBinary(file, realStations);
+  }
+  ProblemInstance fromBinary("stations_test.bin");
+  std::remove("stations_test.bin");
+  assert(fromBinary.getStations().size() == realStations.size() + 1);
+  const std::vector<Station> &loaded = fromBinary.getStations();
+  assert(sameStations({loaded.begin() + 1, loaded.end()}, realStations));
+
+  // in memory: depot first, matrix optional
+  options.stations = 200;
+  ProblemInstance small(generateStations(options));
+  assert(small.getStations().size() == 201);
+  assert(small.getStations()[0].getId() == 0);
+  assert(small.getTimeMatrix().size() == 201);
+  assert(small.getTimeMatrix()[0][0] == 0.0);
+  options.stations = 50000;
+  ProblemInstance large(generateStations(options), false);
+  assert(large.getStations().size() == 50001);
+  assert(large.getTimeMatrix().empty());
+
+  // time_matrix.csv in the working directory only serves the stations it
+  // was saved for
+  options.stations = 40;
+  {
+    std::ofstream file("stations_test.csv");
+    writeStationsCsv(file, generateStations(options));
+  }
+  ProblemInstance generated("stations_test.csv");
+  std::remove("stations_test.csv");
+  assert(generated.getTimeMatrix() ==
+         ProblemInstance::computeTimeMatrix(generated.getStations()));
+  std::stringstream stale("From/To,depot,x\ndepot,0,1\nx,1,0\n");
+  threw = false;
+  try {
+    ProblemInstance::readTimeMatrix(stale, generated.getStations());
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw);
+
+  options.surplusShare = 0.7;
+  threw = false;
+  try {
+    generateStations(options);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+  std::cout << "Binary stations: " << bytes.size() << " bytes vs "
+            << csv.str().size() << " bytes CSV\n";
+  std::cout << "Test InstanceGenerator passed\n";
+}
+
+int main() {
+  test_cachedMetrics();
+  test_serialization();
+  test_instanceGenerator();
+  return 0;
+}
@@ -1,12 +1,59 @@
+#include "clustering/kmedoids.hpp"
 #include "clustering/tuple_evaluator.hpp"
 #include "core/problem.hpp"
+#include "utils/Counters.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/metric.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
 #include <random>
 #include <set>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 
+// The results.csv network, loaded once for all tests.
+const ProblemInstance &resultsInstance() {
+  static const ProblemInstance instance("../data/results.csv");
+  return instance;
+}
+
+// Its stations with BCRF computed, every station but the depot in an order
+// shuffled by `seed`, and the surplus and deficit stations among the first
+// `count` of that order.
+struct StationSample {
+  std::vector<Station> stations;
+  std::vector<int> order;
+  std::vector<int> surplusIndices, deficitIndices;
+};
+
+StationSample sampleStations(unsigned seed, int count) {
+  StationSample sample;
+  sample.stations = resultsInstance().getStations();
+  Param param(60, 2, 0.5, 10, 10, 10);
+  MetricCalculator::computeBCRF(sample.stations, param);
+
+  sample.order.resize(sample.stations.size() - 1);
+  std::iota(sample.order.begin(), sample.order.end(), 1);
+  std::mt19937 g(seed);
+  std::shuffle(sample.order.begin(), sample.order.end(), g);
+
+  for (int i = 0; i < count; ++i) {
+    int idx = sample.order[i];
+    if (sample.stations[idx].getStatus() == StationStatus::SURPLUS)
+      sample.surplusIndices.push_back(idx);
+    else if (sample.stations[idx].getStatus() == StationStatus::DEFICIT)
+      sample.deficitIndices.push_back(idx);
+  }
+  return sample;
+}
+
 void test_evaluateTuple() {
   // read stations using problem
   ProblemInstance instance("../data/results.csv");
@@ -87,7 +134,694 @@ void test_evaluateTuple() {
   std::cout << "Test EvaluateTuple passed\n";
 }
 
+void test_evaluationCache() {
+  StationSample sample = sampleStations(7, 16);
+  const std::vector<Station> &stations = sample.stations;
+  const std::vector<int> &surplusIndices = sample.surplusIndices;
+  const std::vector<int> &deficitIndices = sample.deficitIndices;
+
+  // reference run without memoization
+  TupleClusterEvaluator plain(3, 3);
+  plain.setCacheCapacity(0);
+  std::vector<TransferTuple> expected;
+  plain.generateTuples(surplusIndices, deficitIndices, expected, stations);
+
+  // cached runs, with default options otherwise, must produce exactly the
+  // same tuples, also when the bound is small enough to force evictions
+  for (std::size_t capacity : {std::size_t{1} << 16, std::size_t{4}}) {
+    TupleClusterEvaluator cached(3, 3);
+    cached.setCacheCapacity(capacity);
+    std::vector<TransferTuple> tuples;
+    cached.generateTuples(surplusIndices, deficitIndices, tuples, stations);
+
+    assert(tuples.size() == expected.size());
+    for (size_t i = 0; i < tuples.size(); ++i) {
+      assert(tuples[i].surplusStationIndices ==
+             expected[i].surplusStationIndices);
+      assert(tuples[i].deficitStationIndices ==
+             expected[i].deficitStationIndices);
+      assert(tuples[i].bikeAllocations == expected[i].bikeAllocations);
+      assert(tuples[i].deltaUDF == expected[i].deltaUDF);
+    }
+
+    TupleCacheStats stats = cached.getCacheStats();
+    assert(stats.hits + stats.misses > 0);
+    assert(stats.entries <= capacity);
+    if (capacity == 4)
+      assert(stats.evictions > 0);
+    else
+      assert(stats.hits > 0);
+    std::cout << "Cache capacity " << capacity << ": " << stats.hits
+              << " hits, " << stats.misses << " misses, " << stats.evictions
+              << " evictions, " << stats.bytes << " bytes\n";
+  }
+  std::cout << "Test EvaluationCache passed\n";
+}
+
+void test_branchAndBound() {
+  StationSample sample = sampleStations(11, 20);
+  const std::vector<Station> &stations = sample.stations;
+  const std::vector<int> &surplusIndices = sample.surplusIndices;
+  const std::vector<int> &deficitIndices = sample.deficitIndices;
+
+  // the pruned search must accept exactly the tuples of the full enumeration
+  TupleClusterEvaluator exhaustive(3, 3);
+  exhaustive.setPruning(false);
+  std::vector<TransferTuple> expected;
+  exhaustive.generateTuples(surplusIndices, deficitIndices, expected,
+                            stations);
+
+  TupleClusterEvaluator pruned(3, 3);
+  std::vector<TransferTuple> tuples;
+  pruned.generateTuples(surplusIndices, deficitIndices, tuples, stations);
+
+  assert(tuples.size() == expected.size());
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    assert(tuples[i].surplusStationIndices ==
+           expected[i].surplusStationIndices);
+    assert(tuples[i].deficitStationIndices ==
+           expected[i].deficitStationIndices);
+    assert(tuples[i].deltaUDF == expected[i].deltaUDF);
+  }
+
+  TupleSearchStats stats = pruned.getSearchStats();
+  assert(stats.tuplesAccepted == tuples.size());
+  std::cout << "Branch and bound: " << stats.combinationsEvaluated
+            << " evaluated, " << stats.prunedByBound << " pruned by bound, "
+            << stats.prunedByDominance << " pruned by dominance\n";
+  std::cout << "Test BranchAndBound passed\n";
+}
+
+void test_largeCandidateLists() {
+  // more than 64 deficit candidates, beyond a single mask word
+  StationSample sample = sampleStations(13, 120);
+  const std::vector<Station> &stations = sample.stations;
+  std::vector<int> surplusIndices(sample.surplusIndices.begin(),
+                                  sample.surplusIndices.begin() + 2);
+  const std::vector<int> &deficitIndices = sample.deficitIndices;
+  assert(deficitIndices.size() > 64);
+
+  TupleClusterEvaluator exhaustive(1, 2);
+  exhaustive.setPruning(false);
+  std::vector<TransferTuple> expected;
+  exhaustive.generateTuples(surplusIndices, deficitIndices, expected,
+                            stations);
+
+  TupleClusterEvaluator pruned(1, 2);
+  std::vector<TransferTuple> tuples;
+  pruned.generateTuples(surplusIndices, deficitIndices, tuples, stations);
+
+  assert(tuples.size() == expected.size());
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    assert(tuples[i].surplusStationIndices ==
+           expected[i].surplusStationIndices);
+    assert(tuples[i].deficitStationIndices ==
+           expected[i].deficitStationIndices);
+    assert(tuples[i].deltaUDF == expected[i].deltaUDF);
+  }
+  // the masked search ran: it skipped candidates and hit the memo
+  TupleSearchStats stats = pruned.getSearchStats();
+  assert(stats.prunedByDominance > 0);
+  assert(stats.combinationsEvaluated <
+         exhaustive.getSearchStats().combinationsEvaluated);
+  assert(pruned.getCacheStats().hits > 0);
+  std::cout << "Large lists: " << deficitIndices.size() << " deficits, "
+            << stats.combinationsEvaluated << " of "
+            << exhaustive.getSearchStats().combinationsEvaluated
+            << " evaluated\n";
+  std::cout << "Test LargeCandidateLists passed\n";
+}
+
+void test_exclusiveSelection() {
+  StationSample sample = sampleStations(3, 20);
+  const std::vector<Station> &stations = sample.stations;
+  const std::vector<int> &surplusIndices = sample.surplusIndices;
+  const std::vector<int> &deficitIndices = sample.deficitIndices;
+
+  TupleClusterEvaluator evaluator(3, 3);
+  std::vector<TransferTuple> tuples;
+  evaluator.generateTuples(surplusIndices, deficitIndices, tuples, stations);
+  // keep the brute force below tractable
+  if (tuples.size() > 16)
+    tuples.resize(16);
+
+  auto stationsOf = [](const TransferTuple &tuple) {
+    std::set<int> ids(tuple.surplusStationIndices.begin(),
+                      tuple.surplusStationIndices.end());
+    ids.insert(tuple.deficitStationIndices.begin(),
+               tuple.deficitStationIndices.end());
+    return ids;
+  };
+
+  // optimum by enumerating every subset
+  double optimum = 0.0;
+  for (unsigned subset = 0; subset < (1u << tuples.size()); ++subset) {
+    std::set<int> used;
+    double value = 0.0;
+    bool exclusive = true;
+    for (size_t t = 0; t < tuples.size() && exclusive; ++t) {
+      if (!(subset >> t & 1))
+        continue;
+      for (int id : stationsOf(tuples[t]))
+        exclusive = exclusive && used.insert(id).second;
+      value += tuples[t].deltaUDF;
+    }
+    if (exclusive)
+      optimum = std::max(optimum, value);
+  }
+
+  std::vector<TransferTuple> greedy =
+      evaluator.greedySelectExclusiveTuples(tuples);
+  double greedyValue = 0.0;
+  for (const auto &tuple : greedy)
+    greedyValue += tuple.deltaUDF;
+
+  int improvements = 0;
+  double firstValue = -1.0;
+  SelectionOptions options;
+  options.strategy = SelectionStrategy::ANYTIME;
+  options.timeLimitSeconds = 5.0;
+  options.onImprovement = [&](const SelectionResult &incumbent) {
+    if (improvements++ == 0)
+      firstValue = incumbent.totalDeltaUDF;
+  };
+  SelectionResult result = evaluator.selectExclusiveTuples(tuples, options);
+
+  assert(improvements >= 1);
+  assert(std::abs(firstValue - greedyValue) < 1e-9);
+  assert(result.provedOptimal);
+  assert(result.gap == 0.0);
+  assert(std::abs(result.totalDeltaUDF - optimum) < 1e-9);
+  assert(result.totalDeltaUDF >= greedyValue - 1e-9);
+  std::set<int> used;
+  for (const auto &tuple : result.selected)
+    for (int id : stationsOf(tuple))
+      assert(used.insert(id).second);
+
+  // greedy takes {1, 2} for 3.0; the optimum takes {1} and {2} for 4.0
+  std::vector<TransferTuple> trap(3);
+  trap[0].surplusStationIndices = {1};
+  trap[0].deficitStationIndices = {2};
+  trap[0].deltaUDF = 3.0;
+  trap[1].surplusStationIndices = {1};
+  trap[1].deficitStationIndices = {3};
+  trap[1].deltaUDF = 2.0;
+  trap[2].surplusStationIndices = {4};
+  trap[2].deficitStationIndices = {2};
+  trap[2].deltaUDF = 2.0;
+  assert(evaluator.selectExclusiveTuples(trap).totalDeltaUDF == 3.0);
+  SelectionResult exact = evaluator.selectExclusiveTuples(trap, options);
+  assert(exact.totalDeltaUDF == 4.0 && exact.selected.size() == 2);
+
+  std::cout << "Selection: greedy " << greedyValue << ", exact "
+            << result.totalDeltaUDF << " after " << result.nodesExplored
+            << " nodes\n";
+  std::cout << "Test ExclusiveSelection passed\n";
+}
+
+void test_topKStreaming() {
+  StationSample sample = sampleStations(11, 24);
+  const std::vector<Station> &stations = sample.stations;
+  const std::vector<int> &surplusIndices = sample.surplusIndices;
+  const std::vector<int> &deficitIndices = sample.deficitIndices;
+
+  TupleClusterEvaluator full(3, 3);
+  std::vector<TransferTuple> all;
+  full.generateTuples(surplusIndices, deficitIndices, all, stations);
+  std::sort(all.begin(), all.end(),
+            [](const TransferTuple &a, const TransferTuple &b) {
+              return a.deltaUDF > b.deltaUDF;
+            });
+
+  // the streamed top-k must match the k best of the materialized run
+  const std::size_t k = 10;
+  TupleClusterEvaluator streaming(3, 3);
+  TopKTupleSink sink(k);
+  streaming.generateTuples(surplusIndices, deficitIndices, sink, stations);
+  std::vector<TransferTuple> top = sink.take();
+
+  assert(top.size() == std::min(k, all.size()));
+  for (size_t i = 0; i < top.size(); ++i)
+    assert(top[i].deltaUDF == all[i].deltaUDF);
+  assert(sink.getSeen() <= all.size());
+  assert(streaming.getSearchStats().combinationsEvaluated <=
+         full.getSearchStats().combinationsEvaluated);
+
+  std::cout << "Top-" << k << ": " << sink.getSeen() << " of " << all.size()
+            << " tuples streamed, "
+            << streaming.getSearchStats().prunedByBound
+            << " subtrees pruned by bound\n";
+  std::cout << "Test TopKStreaming passed\n";
+}
+
+void test_boundedCandidates() {
+  StationSample sample = sampleStations(13, 120);
+  const std::vector<Station> &stations = sample.stations;
+  std::vector<int> cluster = sample.surplusIndices;
+  cluster.insert(cluster.end(), sample.deficitIndices.begin(),
+                 sample.deficitIndices.end());
+
+  TupleClusterEvaluator full(1, 2);
+  std::vector<TransferTuple> all;
+  full.generateTuples(sample.surplusIndices, sample.deficitIndices, all,
+                      stations);
+
+  // evaluateCluster only holds the selection's candidates, and their
+  // threshold prunes the search once the bound is reached
+  SelectionOptions options;
+  options.maxCandidates = 256;
+  assert(all.size() > options.maxCandidates);
+  TupleClusterEvaluator bounded(1, 2);
+  std::vector<TransferTuple> candidates = bounded.generateCandidates(
+      sample.surplusIndices, sample.deficitIndices, stations, options);
+  assert(candidates.size() == options.maxCandidates);
+  assert(bounded.getSearchStats().prunedByBound > 0);
+  assert(bounded.getSearchStats().combinationsEvaluated <
+         full.getSearchStats().combinationsEvaluated);
+
+  ClusterEvaluationResult result =
+      bounded.evaluateCluster(cluster, stations, options);
+  assert(result.totalDeltaUDF > 0);
+  double best = 0.0;
+  for (const TransferTuple &tuple : all)
+    best = std::max(best, tuple.deltaUDF);
+  assert(result.assignedTuples.front().deltaUDF == best);
+
+  // the default, 0, keeps every tuple
+  options.maxCandidates = SelectionOptions().maxCandidates;
+  assert(options.maxCandidates == 0);
+  TupleClusterEvaluator unbounded(1, 2);
+  assert(unbounded
+             .generateCandidates(sample.surplusIndices, sample.deficitIndices,
+                                 stations, options)
+             .size() == all.size());
+
+  std::cout << "Bounded candidates: " << candidates.size() << " of "
+            << all.size() << " kept, "
+            << bounded.getSearchStats().prunedByBound
+            << " subtrees pruned by bound\n";
+  std::cout << "Test BoundedCandidates passed\n";
+}
+
+// Service time of visiting the tuple's stations in `order`, or infinity if a
+// drop precedes one of its pickups or the load leaves [0, capacity].
+double routeTime(const TransferTuple &tuple, const std::vector<int> &order,
+                 const std::vector<std::vector<double>> &timeMatrix,
+                 const Param &param) {
+  std::map<int, int> delta;
+  for (const auto &entry : tuple.bikeAllocations) {
+    delta[entry.first.first] += entry.second;
+    delta[entry.first.second] -= entry.second;
+  }
+  std::set<int> visited;
+  int load = 0;
+  double time = 0.0;
+  for (size_t k = 0; k < order.size(); ++k) {
+    for (const auto &entry : tuple.bikeAllocations)
+      if (entry.first.second == order[k] && !visited.count(entry.first.first))
+        return INFINITY;
+    load += delta[order[k]];
+    if (load < 0 || load > param.vehicleCapacity)
+      return INFINITY;
+    if (k > 0)
+      time += timeMatrix[order[k - 1]][order[k]];
+    time += param.tLoad * std::abs(delta[order[k]]);
+    visited.insert(order[k]);
+  }
+  return time;
+}
+
+void test_routeScoring() {
+  StationSample sample = sampleStations(5, 16);
+  const std::vector<Station> &stations = sample.stations;
+  const std::vector<int> &surplusIndices = sample.surplusIndices;
+  const std::vector<int> &deficitIndices = sample.deficitIndices;
+  const auto &timeMatrix = resultsInstance().getTimeMatrix();
+  // a small vehicle, so that many tuples cannot be served
+  Param param(60, 2, 0.5, 10, 10, 10, 10);
+
+  TupleClusterEvaluator plain(3, 3);
+  std::vector<TransferTuple> unscored;
+  plain.generateTuples(surplusIndices, deficitIndices, unscored, stations);
+
+  TupleClusterEvaluator evaluator(3, 3);
+  evaluator.enableRouteScoring(timeMatrix, param);
+  std::vector<TransferTuple> tuples;
+  evaluator.generateTuples(surplusIndices, deficitIndices, tuples, stations);
+
+  auto bestTime = [&](const TransferTuple &tuple) {
+    std::vector<int> order = tuple.surplusStationIndices;
+    order.insert(order.end(), tuple.deficitStationIndices.begin(),
+                 tuple.deficitStationIndices.end());
+    std::sort(order.begin(), order.end());
+    double best = INFINITY;
+    do
+      best = std::min(best, routeTime(tuple, order, timeMatrix, param));
+    while (std::next_permutation(order.begin(), order.end()));
+    return best;
+  };
+  auto find = [](const std::vector<TransferTuple> &in,
+                 const TransferTuple &tuple) {
+    return std::find_if(in.begin(), in.end(), [&tuple](const TransferTuple &t) {
+      return t.bikeAllocations == tuple.bikeAllocations;
+    });
+  };
+
+  // Held-Karp must agree with trying every visiting order
+  std::vector<TransferTuple> unservable;
+  for (const auto &tuple : unscored) {
+    double best = bestTime(tuple);
+    auto it = find(tuples, tuple);
+    if (best == INFINITY) {
+      assert(it == tuples.end());
+      unservable.push_back(tuple);
+      continue;
+    }
+    assert(it != tuples.end());
+    assert(std::fabs(it->serviceTime - best) <= 1e-6 * (1 + best));
+    assert(std::fabs(routeTime(*it, it->visitOrder, timeMatrix, param) -
+                     it->serviceTime) <= 1e-6 * (1 + best));
+  }
+  // A rejected tuple does not hide its sub-tuples: every tuple the unscored
+  // run lacks is a servable one inside a tuple no vehicle can serve.
+  size_t recovered = 0;
+  for (const auto &tuple : tuples) {
+    if (find(unscored, tuple) != unscored.end())
+      continue;
+    assert(bestTime(tuple) < INFINITY);
+    auto sorted = [](std::vector<int> v) {
+      std::sort(v.begin(), v.end());
+      return v;
+    };
+    std::vector<int> surplus = sorted(tuple.surplusStationIndices);
+    std::vector<int> deficit = sorted(tuple.deficitStationIndices);
+    assert(std::any_of(
+        unservable.begin(), unservable.end(), [&](const TransferTuple &u) {
+          std::vector<int> uSurplus = sorted(u.surplusStationIndices);
+          std::vector<int> uDeficit = sorted(u.deficitStationIndices);
+          return std::includes(uSurplus.begin(), uSurplus.end(),
+                               surplus.begin(), surplus.end()) &&
+                 std::includes(uDeficit.begin(), uDeficit.end(),
+                               deficit.begin(), deficit.end());
+        }));
+    recovered++;
+  }
+  assert(tuples.size() + unservable.size() == unscored.size() + recovered);
+  assert(recovered > 0);
+  // the exhaustive loops keep rejected tuples out of the rule the same way
+  TupleClusterEvaluator exhaustive(3, 3);
+  exhaustive.setPruning(false);
+  exhaustive.enableRouteScoring(timeMatrix, param);
+  std::vector<TransferTuple> expected;
+  exhaustive.generateTuples(surplusIndices, deficitIndices, expected,
+                            stations);
+  assert(expected.size() == tuples.size());
+  for (size_t i = 0; i < tuples.size(); ++i)
+    assert(tuples[i].bikeAllocations == expected[i].bikeAllocations);
+
+  // a second pass over the same cluster is answered from the cache
+  RouteCostStats first = evaluator.getRouteCostStats();
+  std::vector<TransferTuple> again;
+  evaluator.generateTuples(surplusIndices, deficitIndices, again, stations);
+  RouteCostStats second = evaluator.getRouteCostStats();
+  assert(second.misses == first.misses);
+  assert(second.hits >= first.hits + again.size());
+
+  // ranking by rate keeps the same tuples, ordered by ΔUDF per second
+  TopKTupleSink sink(5, TupleScore::DELTA_UDF_PER_TIME);
+  evaluator.generateTuples(surplusIndices, deficitIndices, sink, stations);
+  std::vector<TransferTuple> top = sink.take();
+  for (size_t i = 1; i < top.size(); ++i)
+    assert(top[i - 1].score(TupleScore::DELTA_UDF_PER_TIME) >=
+           top[i].score(TupleScore::DELTA_UDF_PER_TIME));
+  // a tuple without a service time is rated per kMinServiceTime, on the
+  // same scale: it does not outrank a faster, better rate
+  TransferTuple untimed, timed;
+  untimed.deltaUDF = 2.0;
+  timed.deltaUDF = 300.0;
+  timed.serviceTime = 100.0;
+  assert(untimed.score(TupleScore::DELTA_UDF_PER_TIME) ==
+         2.0 / TransferTuple::kMinServiceTime);
+  assert(timed.score(TupleScore::DELTA_UDF_PER_TIME) >
+         untimed.score(TupleScore::DELTA_UDF_PER_TIME));
+
+  bool threw = false;
+  try {
+    TupleClusterEvaluator(7, 7).enableRouteScoring(timeMatrix, param);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+
+  std::cout << "Route scoring: " << tuples.size() << " tuples servable, "
+            << recovered << " of them inside one of " << unservable.size()
+            << " unservable, " << second.misses << " Held-Karp solves, "
+            << second.hits << " cache hits\n";
+  std::cout << "Test RouteScoring passed\n";
+}
+
+void test_networkEvaluation() {
+  StationSample sample = sampleStations(17, 0);
+  const std::vector<Station> &stations = sample.stations;
+  const std::vector<int> &indices = sample.order;
+
+  // clusters of uneven sizes, smallest first in the input
+  std::vector<std::vector<int>> clusters;
+  size_t pos = 0;
+  for (int size : {6, 8, 10, 12, 14}) {
+    clusters.emplace_back(indices.begin() + pos, indices.begin() + pos + size);
+    pos += size;
+  }
+
+  TupleClusterEvaluator serial(2, 2);
+  std::vector<ClusterEvaluationResult> expected;
+  for (const auto &cluster : clusters)
+    expected.push_back(serial.evaluateCluster(cluster, stations));
+
+  for (unsigned threads : {1u, 3u}) {
+    TupleClusterEvaluator evaluator(2, 2);
+    NetworkEvaluationOptions options;
+    options.threads = threads;
+    NetworkPlan plan = evaluator.evaluateNetwork(clusters, stations, options);
+    assert(plan.complete);
+    assert(plan.clustersEvaluated == clusters.size());
+
+    double total = 0.0;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+      const ClusterEvaluationResult &result = plan.clusters[c];
+      assert(result.evaluated);
+      assert(result.stationIndices == clusters[c]);
+      assert(result.totalDeltaUDF == expected[c].totalDeltaUDF);
+      assert(result.assignedTuples.size() ==
+             expected[c].assignedTuples.size());
+      std::set<int> used;
+      for (const auto &tuple : result.assignedTuples) {
+        for (int idx : tuple.surplusStationIndices)
+          assert(used.insert(idx).second);
+        for (int idx : tuple.deficitStationIndices)
+          assert(used.insert(idx).second);
+      }
+      total += result.totalDeltaUDF;
+    }
+    assert(std::fabs(plan.totalDeltaUDF - total) <= 1e-9 * (1 + total));
+    assert(evaluator.getSearchStats().combinationsEvaluated ==
+           serial.getSearchStats().combinationsEvaluated);
+  }
+
+  // a deadline that has already passed yields an empty partial plan
+  TupleClusterEvaluator late(2, 2);
+  NetworkEvaluationOptions options;
+  options.deadlineSeconds = 1e-12;
+  NetworkPlan partial = late.evaluateNetwork(clusters, stations, options);
+  assert(!partial.complete);
+  assert(partial.clusters.size() == clusters.size());
+  assert(partial.clustersEvaluated == 0 && partial.totalDeltaUDF == 0.0);
+
+  std::cout << "Test NetworkEvaluation passed\n";
+}
+
+void test_profiler() {
+#if BRP_PROFILING
+  Profiler &profiler = Profiler::getInstance();
+  Profiler::setEnabled(true);
+  profiler.reset();
+
+  ProblemInstance instance("../data/results.csv");
+  std::vector<Station> stations(instance.getStations().begin(),
+                                instance.getStations().begin() + 200);
+  std::vector<std::vector<double>> times(200);
+  for (int i = 0; i < 200; ++i)
+    times[i].assign(instance.getTimeMatrix()[i].begin(),
+                    instance.getTimeMatrix()[i].begin() + 200);
+  Param param(60, 2, 0.5, 10, 10, 10);
+  MetricCalculator::computeBCRF(stations, param);
+  KMedoid kmedoid(stations, 8);
+  kmedoid.setCompositeDistanceMatrix(
+      MetricCalculator::computeCompositeDistanceMatrix(stations, times, 0.5,
+                                                       0.5));
+  std::vector<std::vector<int>> clusters = kmedoid.run(0.5);
+  // a mid-sized cluster; the largest ones take the exhaustive path
+  auto cluster = std::find_if(clusters.begin(), clusters.end(),
+                              [](const std::vector<int> &c) {
+                                return c.size() >= 5 && c.size() <= 20;
+                              });
+  assert(cluster != clusters.end());
+  TupleClusterEvaluator evaluator(2, 2);
+  evaluator.evaluateCluster(*cluster, stations);
+
+  std::map<std::string, ScopeStats> scopes;
+  for (const ScopeStats &scope : profiler.snapshot())
+    scopes[scope.path] = scope;
+  for (const char *path :
+       {"load", "load;time matrix", "bcrf", "composite matrix", "kmedoids",
+        "kmedoids;init medoids", "kmedoids;iteration",
+        "kmedoids;iteration;assign", "kmedoids;iteration;update",
+        "evaluate cluster;tuple generation",
+        "evaluate cluster;tuple selection"})
+    assert(scopes.count(path) && scopes[path].count > 0);
+  for (const auto &[path, scope] : scopes) {
+    assert(scope.minSeconds <= scope.p99Seconds + 1e-12);
+    assert(scope.p99Seconds <= scope.maxSeconds + 1e-12);
+    assert(scope.maxSeconds <= scope.totalSeconds + 1e-12);
+    assert(scope.selfSeconds <= scope.totalSeconds + 1e-12);
+  }
+  const ScopeStats &iteration = scopes["kmedoids;iteration"];
+  assert(scopes["kmedoids;iteration;assign"].count == iteration.count);
+  assert(scopes["kmedoids"].totalSeconds >= iteration.totalSeconds);
+
+  std::ostringstream json, folded;
+  profiler.writeJson(json);
+  profiler.writeFolded(folded);
+  nlohmann::json report = nlohmann::json::parse(json.str());
+  assert(report["scopes"][0]["name"] == "load");
+  assert(report["scopes"][0]["children"][0]["name"] == "time matrix");
+  assert(folded.str().find("kmedoids;iteration;assign ") != std::string::npos);
+
+  // disabled scopes record nothing
+  Profiler::setEnabled(false);
+  MetricCalculator::computeBCRF(stations, param);
+  assert(profiler.snapshot().front().path == "load");
+  for (const ScopeStats &scope : profiler.snapshot())
+    if (scope.path == "bcrf")
+      assert(scope.count == scopes["bcrf"].count);
+  std::cout << "Test Profiler passed (" << iteration.count
+            << " k-medoids iterations)\n";
+#endif
+}
+
+void test_counters() {
+  ProblemInstance instance("../data/results.csv");
+  std::vector<Station> stations(instance.getStations().begin(),
+                                instance.getStations().begin() + 200);
+  std::vector<std::vector<double>> times(200);
+  for (int i = 0; i < 200; ++i)
+    times[i].assign(instance.getTimeMatrix()[i].begin(),
+                    instance.getTimeMatrix()[i].begin() + 200);
+  Param param(60, 2, 0.5, 10, 10, 10);
+  MetricCalculator::computeBCRF(stations, param);
+
+  const CounterSet start = Counters::total();
+  KMedoid kmedoid(stations, 8);
+  kmedoid.setCompositeDistanceMatrix(
+      MetricCalculator::computeCompositeDistanceMatrix(stations, times, 0.5,
+                                                       0.5));
+  std::vector<std::vector<int>> clusters = kmedoid.run(0.5);
+  // only the small clusters, so that the exhaustive comparison stays quick
+  clusters.erase(std::remove_if(clusters.begin(), clusters.end(),
+                                [](const std::vector<int> &c) {
+                                  return c.size() < 5 || c.size() > 20;
+                                }),
+                 clusters.end());
+  assert(!clusters.empty());
+  const CounterSet &kmedoidCounters = kmedoid.getCounters();
+  assert(kmedoidCounters[Counter::KMEDOIDS_ITERATIONS] >= 1);
+  assert(kmedoidCounters[Counter::KMEDOIDS_SWAPS] <=
+         8 * kmedoidCounters[Counter::KMEDOIDS_ITERATIONS]);
+  assert(kmedoidCounters[Counter::KMEDOIDS_REASSIGNMENTS] <=
+         199 * (kmedoidCounters[Counter::KMEDOIDS_ITERATIONS] - 1));
+
+  // per-call counters agree with the search statistics and the selection
+  TupleClusterEvaluator evaluator(2, 2);
+  ClusterEvaluationResult result = evaluator.evaluateCluster(
+      clusters[0], stations);
+  const TupleSearchStats stats = evaluator.getSearchStats();
+  const CounterSet &counters = result.counters;
+  assert(counters[Counter::TUPLE_COMBINATIONS] == stats.combinationsEvaluated);
+  assert(counters[Counter::TUPLE_ACCEPTED] == stats.tuplesAccepted);
+  assert(counters[Counter::TUPLE_POSITIVE] ==
+         stats.tuplesAccepted + stats.rejectedAsSubset);
+  assert(counters[Counter::TUPLE_SUBSET_REJECTED] == stats.rejectedAsSubset);
+  std::vector<int> surplus, deficit;
+  for (int idx : clusters[0])
+    if (stations[idx].getStatus() == StationStatus::SURPLUS)
+      surplus.push_back(idx);
+    else if (stations[idx].getStatus() == StationStatus::DEFICIT)
+      deficit.push_back(idx);
+  std::vector<TransferTuple> tuples;
+  TupleClusterEvaluator exhaustive(2, 2);
+  exhaustive.setPruning(false);
+  exhaustive.generateTuples(surplus, deficit, tuples, stations);
+  assert(tuples.size() == stats.tuplesAccepted);
+  assert(exhaustive.getSearchStats().combinationsEvaluated >=
+         stats.combinationsEvaluated);
+  assert(exhaustive.selectExclusiveTuples(tuples).conflicts ==
+         counters[Counter::SELECTION_CONFLICTS]);
+
+  // worker threads merge on read
+  TupleClusterEvaluator network(2, 2);
+  NetworkEvaluationOptions options;
+  options.threads = 3;
+  NetworkPlan plan = network.evaluateNetwork(clusters, stations, options);
+  CounterSet sum;
+  for (const auto &cluster : plan.clusters)
+    sum += cluster.counters;
+  assert(sum.values == plan.counters.values);
+  CounterSet delta = Counters::total();
+  delta -= start;
+  // everything counted since `start`: k-medoids, the two evaluators and
+  // the selection over the exhaustive tuples
+  assert(delta[Counter::TUPLE_ACCEPTED] ==
+         plan.counters[Counter::TUPLE_ACCEPTED] +
+             counters[Counter::TUPLE_ACCEPTED] + tuples.size());
+  assert(delta[Counter::SELECTION_CONFLICTS] ==
+         plan.counters[Counter::SELECTION_CONFLICTS] +
+             2 * counters[Counter::SELECTION_CONFLICTS]);
+  assert(delta[Counter::KMEDOIDS_ITERATIONS] ==
+         kmedoidCounters[Counter::KMEDOIDS_ITERATIONS]);
+
+  std::ostringstream text;
+  writePrometheus(text, plan.counters, "run=\"test\"");
+  const std::string expected =
+      "brp_tuple_accepted_total{run=\"test\"} " +
+      std::to_string(plan.counters[Counter::TUPLE_ACCEPTED]) + "\n";
+  assert(text.str().find(expected) != std::string::npos);
+  assert(text.str().find("# TYPE brp_kmedoids_iterations_total counter\n") !=
+         std::string::npos);
+  writePrometheus("counters_test.prom", plan.counters);
+  std::ifstream file("counters_test.prom");
+  std::string line;
+  int samples = 0;
+  while (std::getline(file, line))
+    samples += !line.empty() && line[0] != '#';
+  assert(samples == (int)kCounters);
+  std::remove("counters_test.prom");
+  std::cout << "Test Counters passed ("
+            << plan.counters[Counter::TUPLE_COMBINATIONS] << " combinations, "
+            << kmedoidCounters[Counter::KMEDOIDS_REASSIGNMENTS]
+            << " reassignments)\n";
+}
+
 int main() {
   test_evaluateTuple();
+  test_evaluationCache();
+  test_branchAndBound();
+  test_largeCandidateLists();
+  test_exclusiveSelection();
+  test_topKStreaming();
+  test_boundedCandidates();
+  test_routeScoring();
+  test_networkEvaluation();
+  test_profiler();
+  test_counters();
   return 0;
 }
@@ -0,0 +1,105 @@
+#include "core/instance_generator.hpp"
+#include "core/station_io.hpp"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Writes a synthetic station file:
+//   BRP-generate --stations 50000 --seed 7 --output stations_50k.csv
+namespace {
+
+const char *const kUsage =
+    "usage: BRP-generate [options]\n"
+    "  --stations N          station count (default 2109)\n"
+    "  --seed S              random seed (default 1)\n"
+    "  --hotspots N          hotspot count (default stations / 100)\n"
+    "  --hotspot-share F     share of stations around hotspots (0.7)\n"
+    "  --hotspot-radius D    hotspot standard deviation, degrees (0.006)\n"
+    "  --fixed-area          keep the real instance's area at any size\n"
+    "  --median-capacity N   median dock count (25)\n"
+    "  --capacity-spread F   standard deviation of log capacity (0.35)\n"
+    "  --min-capacity N      (15)\n"
+    "  --max-capacity N      (123)\n"
+    "  --surplus F           share of surplus stations (0.36)\n"
+    "  --deficit F           share of deficit stations (0.60)\n"
+    "  --udf-rise F          UDF rise at the ends, per dock (0.15)\n"
+    "  --binary              binary station format instead of CSV\n"
+    "  --output PATH         output file (default standard output)\n";
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  InstanceGeneratorOptions options;
+  bool binary = false;
+  std::string output;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string flag = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc)
+          throw std::invalid_argument(flag + " needs a value");
+        return argv[++i];
+      };
+      if (flag == "--stations")
+        options.stations = std::stoi(value());
+      else if (flag == "--seed")
+        options.seed = std::stoull(value());
+      else if (flag == "--hotspots")
+        options.hotspots = std::stoi(value());
+      else if (flag == "--hotspot-share")
+        options.hotspotShare = std::stod(value());
+      else if (flag == "--hotspot-radius")
+        options.hotspotRadius = std::stod(value());
+      else if (flag == "--fixed-area")
+        options.scaleArea = false;
+      else if (flag == "--median-capacity")
+        options.medianCapacity = std::stoi(value());
+      else if (flag == "--capacity-spread")
+        options.capacitySpread = std::stod(value());
+      else if (flag == "--min-capacity")
+        options.minCapacity = std::stoi(value());
+      else if (flag == "--max-capacity")
+        options.maxCapacity = std::stoi(value());
+      else if (flag == "--surplus")
+        options.surplusShare = std::stod(value());
+      else if (flag == "--deficit")
+        options.deficitShare = std::stod(value());
+      else if (flag == "--udf-rise")
+        options.udfRise = std::stod(value());
+      else if (flag == "--binary")
+        binary = true;
+      else if (flag == "--output")
+        output = value();
+      else if (flag == "--help" || flag == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else
+        throw std::invalid_argument("unknown option " + flag);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-generate: " << e.what() << "\n" << kUsage;
+    return 2;
+  }
+
+  try {
+    const std::vector<Station> stations = generateStations(options);
+    std::ofstream file;
+    if (!output.empty()) {
+      file.open(output, std::ios::binary);
+      if (!file)
+        throw std::runtime_error("cannot open " + output);
+    }
+    std::ostream &out = output.empty() ? std::cout : file;
+    if (binary)
+      writeStationsBinary(out, stations);
+    else
+      writeStationsCsv(out, stations);
+    if (!out.flush())
+      throw std::runtime_error("write failed");
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-generate: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "pipeline/partition.hpp"
+#include "pipeline/pipeline.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+// Plans a network region by region in worker processes, then reconciles
+// the seams (see pipeline/partition.hpp):
+//   BRP-partition ../data/pipeline.json --work-dir regions --regions 8
+namespace {
+
+const char *const kUsage =
+    "usage: BRP-partition CONFIG --work-dir DIR [options]\n"
+    "  --work-dir DIR     region files and worker logs\n"
+    "  --regions N        geographic regions (default 4)\n"
+    "  --margin M         halo around each region, metres (500)\n"
+    "  --seam-size N      stations per seam cluster at most (64)\n"
+    "  --jobs N           worker processes at once (default: all cores)\n"
+    "  --worker PATH      worker executable (default: the BRP-cluster next\n"
+    "                     to this one)\n"
+    "  --set PATH=VALUE   override a config field, e.g. clustering.k=48\n";
+
+std::string siblingWorker() {
+  std::error_code error;
+  const std::filesystem::path self =
+      std::filesystem::read_symlink("/proc/self/exe", error);
+  const std::filesystem::path sibling = self.parent_path() / "BRP-cluster";
+  if (!error && std::filesystem::exists(sibling))
+    return sibling.string();
+  return "BRP-cluster";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string configPath;
+  nlohmann::json config;
+  PartitionOptions options;
+  options.workerCommand = siblingWorker();
+  try {
+    std::vector<std::string> overrides;
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc)
+          throw std::invalid_argument(arg + " needs a value");
+        return argv[++i];
+      };
+      if (arg == "--work-dir")
+        options.workDirectory = value();
+      else if (arg == "--regions")
+        options.regions = std::stoi(value());
+      else if (arg == "--margin")
+        options.marginMeters = std::stod(value());
+      else if (arg == "--seam-size")
+        options.maxSeamClusterStations = std::stoi(value());
+      else if (arg == "--jobs")
+        options.jobs = static_cast<unsigned>(std::stoul(value()));
+      else if (arg == "--worker")
+        options.workerCommand = value();
+      else if (arg == "--set")
+        overrides.push_back(value());
+      else if (arg == "--help" || arg == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else if (arg[0] != '-' && configPath.empty())
+        configPath = arg;
+      else
+        throw std::invalid_argument("unexpected argument " + arg);
+    }
+    if (configPath.empty() || options.workDirectory.empty())
+      throw std::invalid_argument("a config file and --work-dir are required");
+    std::ifstream in(configPath);
+    if (!in)
+      throw std::invalid_argument("cannot open " + configPath);
+    config = nlohmann::json::parse(in);
+    for (const std::string &assignment : overrides)
+      applyConfigOverride(config, assignment);
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-partition: " << e.what() << "\n" << kUsage;
+    return 2;
+  }
+
+  try {
+    const PipelineConfig pipeline = PipelineConfig::fromJson(
+        config, std::filesystem::path(configPath).parent_path().string());
+    const PartitionedResult result = runPartitioned(pipeline, options);
+
+    std::printf("\n%-8s %8s %6s %4s %6s %8s %10s %9s\n", "region", "owned",
+                "halo", "k", "kept", "dropped", "deltaUDF", "seconds");
+    for (size_t r = 0; r < result.regions.size(); ++r) {
+      const RegionReport &report = result.reports[r];
+      std::printf("%-8zu %8zu %6zu %4d %6zu %8zu %10.4f %9.2f\n", r,
+                  result.regions[r].owned.size(),
+                  result.regions[r].halo.size(), report.k, report.tuplesKept,
+                  report.tuplesDropped, report.deltaUDF, report.seconds);
+    }
+    std::printf("%-8s %8zu %6s %4zu %6s %8s %10.4f\n", "seam",
+                result.seamStations, "", result.seamClusters, "", "",
+                result.seamDeltaUDF);
+    std::printf("\ndelta UDF %.4f in %.1fs\n", result.plan.totalDeltaUDF,
+                result.seconds);
+    if (!pipeline.output.empty())
+      std::printf("plan written to %s\n", pipeline.output.c_str());
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-partition: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,491 @@
+#include "clustering/kmedoids.hpp"
+#include "clustering/tuple_evaluator.hpp"
+#include "core/instance_generator.hpp"
+#include "core/param.hpp"
+#include "core/problem.hpp"
+#include "core/station_io.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Timer.hpp"
+#include "utils/metric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Performance regression runner. Runs a fixed matrix of scenarios over the
+// real instance and synthetic ones, each in a child process so that its
+// peak RSS is its own, and records per-phase wall times (median and MAD
+// over the repetitions), peak RSS and solution quality (total delta UDF,
+// k-medoids cost, tuples assigned). Compared against a baseline JSON:
+//
+//   BRP-perf --baseline ../benchmarks/perf_baseline.json
+//   BRP-perf --update ../benchmarks/perf_baseline.json
+//
+// A phase regresses when its median exceeds the baseline's by more than
+// the relative tolerance plus three (scaled) MADs of the noisier run, and
+// by at least --min-delta milliseconds. Peak RSS gets a relative tolerance
+// plus 8 MiB. Every scenario is seeded, so quality must match the baseline
+// to 1e-9 relative in either direction; a change that is meant to alter
+// the plan comes with an updated baseline. Exits 1 on any regression.
+namespace {
+
+using nlohmann::json;
+
+enum class Source { REAL, SYNTHETIC };
+enum class Kind { PIPELINE, STATION_IO };
+
+struct Scenario {
+  std::string name;
+  Kind kind;
+  Source source;
+  int stations; // REAL: prefix size, depot included
+  int k = 0;
+  std::uint64_t seed = 0;
+};
+
+// real-300-k12 has a cluster of over 100 deficit stations, the case the
+// masked branch-and-bound search has to keep fast.
+const std::vector<Scenario> kScenarios = {
+    {"real-128-k12", Kind::PIPELINE, Source::REAL, 128, 12},
+    {"real-256-k24", Kind::PIPELINE, Source::REAL, 256, 24},
+    {"real-300-k12", Kind::PIPELINE, Source::REAL, 300, 12},
+    {"synthetic-300-k30", Kind::PIPELINE, Source::SYNTHETIC, 300, 30, 2},
+    {"synthetic-500-k50", Kind::PIPELINE, Source::SYNTHETIC, 500, 50, 5},
+    {"synthetic-io-50000", Kind::STATION_IO, Source::SYNTHETIC, 50000, 0, 3},
+};
+
+struct Options {
+  std::string baseline, update, output;
+  std::string data = "../data/results.csv";
+  std::string filter;
+  int repetitions = 5;
+  double timeTolerance = 0.25;
+  double rssTolerance = 0.10;
+  double minDeltaMs = 1.0;
+  double qualityTolerance = 1e-9;
+  bool checkTime = true;
+};
+
+const char *const kUsage =
+    "usage: BRP-perf [options]\n"
+    "  --baseline PATH        compare against this baseline, exit 1 on a\n"
+    "                         regression\n"
+    "  --update PATH          write the results as the new baseline\n"
+    "  --output PATH          write the results as JSON\n"
+    "  --data PATH            real instance (../data/results.csv)\n"
+    "  --filter TEXT          only scenarios whose name contains TEXT\n"
+    "  --repetitions N        timed runs per scenario (5)\n"
+    "  --time-tolerance F     relative slowdown allowed (0.25)\n"
+    "  --rss-tolerance F      relative peak RSS growth allowed (0.10)\n"
+    "  --min-delta MS         ignore slowdowns below this (1.0)\n"
+    "  --quality-only         compare quality and RSS, not times (for\n"
+    "                         baselines from another machine)\n";
+
+class QuietStdout {
+public:
+  QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+  ~QuietStdout() { std::cout.rdbuf(saved); }
+
+private:
+  std::ostringstream sink;
+  std::streambuf *saved;
+};
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Median absolute deviation, scaled to estimate a standard deviation.
+double mad(const std::vector<double> &values) {
+  const double m = median(values);
+  std::vector<double> deviations;
+  for (double v : values)
+    deviations.push_back(std::fabs(v - m));
+  return 1.4826 * median(deviations);
+}
+
+// Times of each phase over the repetitions, in milliseconds.
+using PhaseTimes = std::map<std::string, std::vector<double>>;
+
+class Stopwatch {
+public:
+  explicit Stopwatch(PhaseTimes &times) : times(times) {}
+  void lap(const std::string &phase) {
+    times[phase].push_back(timer.elapsed() * 1e3);
+    timer.reset();
+  }
+
+private:
+  PhaseTimes &times;
+  Timer timer;
+};
+
+json summarize(const PhaseTimes &times, int repetitions) {
+  json phases;
+  std::vector<double> totals(repetitions, 0.0);
+  for (const auto &[phase, values] : times) {
+    phases[phase] = {{"medianMs", median(values)}, {"madMs", mad(values)}};
+    for (size_t i = 0; i < values.size(); ++i)
+      totals[i] += values[i];
+  }
+  phases["total"] = {{"medianMs", median(totals)}, {"madMs", mad(totals)}};
+  return phases;
+}
+
+// Sum over clusters of the composite distance to the cluster's medoid.
+double clusteringCost(const std::vector<std::vector<int>> &clusters,
+                      const std::vector<std::vector<double>> &distance) {
+  double cost = 0.0;
+  for (const std::vector<int> &cluster : clusters) {
+    double best = cluster.empty() ? 0.0 : std::numeric_limits<double>::max();
+    for (int medoid : cluster) {
+      double sum = 0.0;
+      for (int station : cluster)
+        sum += distance[medoid][station];
+      best = std::min(best, sum);
+    }
+    cost += best;
+  }
+  return cost;
+}
+
+json runPipeline(const Scenario &scenario, const Options &options) {
+  PhaseTimes times;
+  json quality;
+  for (int rep = 0; rep < options.repetitions; ++rep) {
+    Stopwatch watch(times);
+    ProblemInstance instance;
+    {
+      QuietStdout quiet;
+      if (scenario.source == Source::REAL) {
+        std::ifstream in(options.data, std::ios::binary);
+        if (!in)
+          throw std::runtime_error("cannot open " + options.data);
+        std::vector<Station> prefix =
+            isStationsBinary(in) ? readStationsBinary(in) : readStationsCsv(in);
+        prefix.resize(
+            std::min<size_t>(prefix.size(), scenario.stations - 1));
+        instance = ProblemInstance(std::move(prefix));
+      } else {
+        InstanceGeneratorOptions generator;
+        generator.stations = scenario.stations;
+        generator.seed = scenario.seed;
+        instance = ProblemInstance(generateStations(generator));
+      }
+    }
+    watch.lap("load");
+
+    std::vector<Station> stations = instance.getStations();
+    const std::vector<std::vector<double>> &timeMatrix =
+        instance.getTimeMatrix();
+    Param param(60, 2, 0.5, 10, 10, 10);
+    watch.lap("prepare");
+
+    MetricCalculator::computeBCRF(stations, param);
+    watch.lap("bcrf");
+    std::vector<std::vector<double>> distance;
+    {
+      QuietStdout quiet;
+      distance = MetricCalculator::computeCompositeDistanceMatrix(
+          stations, timeMatrix, 0.5, 0.5);
+    }
+    watch.lap("distance");
+    KMedoid kmedoid(stations, scenario.k);
+    kmedoid.setCompositeDistanceMatrix(distance);
+    std::vector<std::vector<int>> clusters;
+    {
+      QuietStdout quiet;
+      clusters = kmedoid.run(0.5);
+    }
+    watch.lap("kmedoids");
+    NetworkEvaluationOptions evaluation;
+    evaluation.threads = 1;
+    TupleClusterEvaluator evaluator(2, 2);
+    NetworkPlan plan;
+    {
+      QuietStdout quiet;
+      plan = evaluator.evaluateNetwork(clusters, stations, evaluation);
+    }
+    watch.lap("evaluation");
+
+    size_t assigned = 0;
+    for (const ClusterEvaluationResult &cluster : plan.clusters)
+      assigned += cluster.assignedTuples.size();
+    json current = {{"totalDeltaUDF", plan.totalDeltaUDF},
+                    {"clusteringCost", clusteringCost(clusters, distance)},
+                    {"clusters", clusters.size()},
+                    {"assignedTuples", assigned}};
+    if (rep > 0 && current != quality)
+      throw std::runtime_error(scenario.name + ": nondeterministic quality");
+    quality = current;
+  }
+
+  return {{"phases", summarize(times, options.repetitions)},
+          {"quality", quality}};
+}
+
+json runStationIo(const Scenario &scenario, const Options &options) {
+  PhaseTimes times;
+  json quality;
+  for (int rep = 0; rep < options.repetitions; ++rep) {
+    Stopwatch watch(times);
+    InstanceGeneratorOptions generator;
+    generator.stations = scenario.stations;
+    generator.seed = scenario.seed;
+    std::vector<Station> stations = generateStations(generator);
+    watch.lap("generate");
+    std::stringstream csv, binary;
+    writeStationsCsv(csv, stations);
+    watch.lap("write csv");
+    writeStationsBinary(binary, stations);
+    watch.lap("write binary");
+    std::vector<Station> fromCsv = readStationsCsv(csv);
+    watch.lap("read csv");
+    std::vector<Station> fromBinary = readStationsBinary(binary);
+    watch.lap("read binary");
+    ProblemInstance instance(std::move(fromBinary), false);
+    watch.lap("instance");
+
+    double udf = 0.0;
+    for (const Station &station : fromCsv)
+      udf += station.getUdfAt(station.getCurrentInventory());
+    json current = {{"stations", instance.getStations().size()},
+                    {"csvBytes", csv.str().size()},
+                    {"binaryBytes", binary.str().size()},
+                    {"totalUDF", udf}};
+    if (rep > 0 && current != quality)
+      throw std::runtime_error(scenario.name + ": nondeterministic quality");
+    quality = current;
+  }
+  return {{"phases", summarize(times, options.repetitions)},
+          {"quality", quality}};
+}
+
+// Runs the scenario in a child process and adds its peak RSS.
+json runIsolated(const Scenario &scenario, const Options &options) {
+  int fds[2];
+  if (pipe(fds) != 0)
+    throw std::runtime_error("pipe failed");
+  std::cout.flush();
+  const pid_t pid = fork();
+  if (pid < 0)
+    throw std::runtime_error("fork failed");
+  if (pid == 0) {
+    close(fds[0]);
+    int status = 0;
+    std::string text;
+    try {
+      json result = scenario.kind == Kind::PIPELINE
+                        ? runPipeline(scenario, options)
+                        : runStationIo(scenario, options);
+      text = result.dump();
+    } catch (const std::exception &e) {
+      text = json{{"error", e.what()}}.dump();
+      status = 1;
+    }
+    for (size_t done = 0; done < text.size();) {
+      const ssize_t n = write(fds[1], text.data() + done, text.size() - done);
+      if (n <= 0)
+        break;
+      done += n;
+    }
+    close(fds[1]);
+    Logger::getInstance().flush(); // _exit skips the logger's destructor
+    _exit(status);
+  }
+
+  close(fds[1]);
+  std::string text;
+  char buffer[4096];
+  for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;)
+    text.append(buffer, n);
+  close(fds[0]);
+  int status = 0;
+  struct rusage usage {};
+  if (wait4(pid, &status, 0, &usage) != pid)
+    throw std::runtime_error("wait4 failed");
+  if (text.empty())
+    throw std::runtime_error(scenario.name + ": child exited without result");
+  json result = json::parse(text);
+  if (result.contains("error"))
+    throw std::runtime_error(scenario.name + ": " +
+                             result["error"].get<std::string>());
+  result["peakRssKiB"] = usage.ru_maxrss;
+  return result;
+}
+
+bool qualityMatches(const json &current, const json &baseline,
+                    double tolerance) {
+  if (current.is_number() && baseline.is_number()) {
+    const double a = current.get<double>(), b = baseline.get<double>();
+    return std::fabs(a - b) <= tolerance * std::max(1.0, std::fabs(b));
+  }
+  return current == baseline;
+}
+
+// Prints one line per compared value; returns the number of regressions.
+int compare(const json &results, const json &baseline,
+            const Options &options) {
+  int regressions = 0;
+  for (const auto &[name, current] : results["scenarios"].items()) {
+    if (!baseline["scenarios"].contains(name)) {
+      std::cout << name << ": not in the baseline\n";
+      continue;
+    }
+    const json &base = baseline["scenarios"][name];
+    auto report = [&](const std::string &what, const std::string &line,
+                      bool regressed) {
+      std::cout << (regressed ? "REGRESSION " : "ok         ") << name << " "
+                << what << ": " << line << "\n";
+      regressions += regressed;
+    };
+
+    for (const auto &[key, value] : base["quality"].items()) {
+      const bool ok = current["quality"].contains(key) &&
+                      qualityMatches(current["quality"][key], value,
+                                     options.qualityTolerance);
+      report(key,
+             (current["quality"].contains(key)
+                  ? current["quality"][key].dump()
+                  : std::string("missing")) +
+                 " (baseline " + value.dump() + ")",
+             !ok);
+    }
+
+    const double rss = current["peakRssKiB"].get<double>();
+    const double baseRss = base["peakRssKiB"].get<double>();
+    report("peak RSS",
+           std::to_string(static_cast<long>(rss / 1024)) + " MiB (baseline " +
+               std::to_string(static_cast<long>(baseRss / 1024)) + " MiB)",
+           rss > baseRss * (1 + options.rssTolerance) + 8 * 1024);
+
+    if (!options.checkTime)
+      continue;
+    for (const auto &[phase, timing] : base["phases"].items()) {
+      if (!current["phases"].contains(phase))
+        continue;
+      const json &measured = current["phases"][phase];
+      const double now = measured["medianMs"].get<double>();
+      const double was = timing["medianMs"].get<double>();
+      const double noise = std::max(measured["madMs"].get<double>(),
+                                    timing["madMs"].get<double>());
+      const double limit = was * (1 + options.timeTolerance) + 3 * noise;
+      std::ostringstream line;
+      line.precision(3);
+      line << std::fixed << now << " ms (baseline " << was << " ms, limit "
+           << limit << " ms)";
+      report(phase, line.str(),
+             now > limit && now - was >= options.minDeltaMs);
+    }
+  }
+  return regressions;
+}
+
+json readJson(const std::string &path) {
+  std::ifstream in(path);
+  if (!in)
+    throw std::runtime_error("cannot open " + path);
+  return json::parse(in);
+}
+
+void writeJson(const std::string &path, const json &value) {
+  std::ofstream out(path);
+  if (!out)
+    throw std::runtime_error("cannot open " + path);
+  out << value.dump(2) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string flag = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc)
+          throw std::invalid_argument(flag + " needs a value");
+        return argv[++i];
+      };
+      if (flag == "--baseline")
+        options.baseline = value();
+      else if (flag == "--update")
+        options.update = value();
+      else if (flag == "--output")
+        options.output = value();
+      else if (flag == "--data")
+        options.data = value();
+      else if (flag == "--filter")
+        options.filter = value();
+      else if (flag == "--repetitions")
+        options.repetitions = std::stoi(value());
+      else if (flag == "--time-tolerance")
+        options.timeTolerance = std::stod(value());
+      else if (flag == "--rss-tolerance")
+        options.rssTolerance = std::stod(value());
+      else if (flag == "--min-delta")
+        options.minDeltaMs = std::stod(value());
+      else if (flag == "--quality-only")
+        options.checkTime = false;
+      else if (flag == "--help" || flag == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else
+        throw std::invalid_argument("unknown option " + flag);
+    }
+    if (options.repetitions < 1)
+      throw std::invalid_argument("--repetitions must be >= 1");
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-perf: " << e.what() << "\n" << kUsage;
+    return 2;
+  }
+
+  try {
+    json baseline;
+    if (!options.baseline.empty())
+      baseline = readJson(options.baseline);
+
+    json results = {{"repetitions", options.repetitions},
+                    {"compiler", __VERSION__},
+                    {"hardwareThreads", sysconf(_SC_NPROCESSORS_ONLN)},
+                    {"scenarios", json::object()}};
+    for (const Scenario &scenario : kScenarios) {
+      if (scenario.name.find(options.filter) == std::string::npos)
+        continue;
+      std::cout << "running " << scenario.name << "..." << std::endl;
+      results["scenarios"][scenario.name] = runIsolated(scenario, options);
+    }
+
+    if (!options.output.empty())
+      writeJson(options.output, results);
+    if (!options.update.empty()) {
+      writeJson(options.update, results);
+      std::cout << "baseline written to " << options.update << "\n";
+    }
+    if (baseline.is_null())
+      return 0;
+    if (baseline.value("compiler", "") != results["compiler"] ||
+        baseline.value("hardwareThreads", 0) != results["hardwareThreads"])
+      std::cout << "note: the baseline was recorded with another compiler "
+                   "or machine; consider --quality-only\n";
+    const int regressions = compare(results, baseline, options);
+    std::cout << regressions << " regression(s)\n";
+    return regressions ? 1 : 0;
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-perf: " << e.what() << "\n";
+    return 2;
+  }
+}
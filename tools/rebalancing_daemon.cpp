@@ -0,0 +1,101 @@
+#include "pipeline/pipeline.hpp"
+#include "service/rebalancing_service.hpp"
+#include "service/unix_socket_server.hpp"
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <pthread.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Serves rebalancing plans from warm state over a Unix domain socket, one
+// JSON request per line (see service/rebalancing_service.hpp):
+//   BRP-daemon ../data/pipeline.json --socket /tmp/brp.sock
+//   echo '{"op": "plan"}' | socat - UNIX-CONNECT:/tmp/brp.sock
+namespace {
+
+const char *const kUsage =
+    "usage: BRP-daemon CONFIG --socket PATH [options]\n"
+    "  --socket PATH      Unix domain socket to listen on\n"
+    "  --set PATH=VALUE   override a config field, e.g. clustering.k=48\n"
+    "  --no-cache         compute the warm state without the artifact cache\n"
+    "Stops on SIGINT, SIGTERM or a {\"op\": \"shutdown\"} request.\n";
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string configPath, socketPath;
+  nlohmann::json config;
+  try {
+    std::vector<std::string> overrides;
+    bool noCache = false;
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--socket" && i + 1 < argc)
+        socketPath = argv[++i];
+      else if (arg == "--set" && i + 1 < argc)
+        overrides.push_back(argv[++i]);
+      else if (arg == "--no-cache")
+        noCache = true;
+      else if (arg == "--help" || arg == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else if (arg[0] != '-' && configPath.empty())
+        configPath = arg;
+      else
+        throw std::invalid_argument("unexpected argument " + arg);
+    }
+    if (configPath.empty() || socketPath.empty())
+      throw std::invalid_argument("a config file and --socket are required");
+    std::ifstream in(configPath);
+    if (!in)
+      throw std::invalid_argument("cannot open " + configPath);
+    config = nlohmann::json::parse(in);
+    for (const std::string &assignment : overrides)
+      applyConfigOverride(config, assignment);
+    if (noCache)
+      config.erase("cache");
+    // the daemon answers over the socket; it exports no plan file
+    config.erase("output");
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-daemon: " << e.what() << "\n" << kUsage;
+    return 2;
+  }
+
+  // Blocked here, before any thread starts, so that every thread inherits
+  // the mask and the signals reach only the sigwait below.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    const PipelineConfig pipeline = PipelineConfig::fromJson(
+        config, std::filesystem::path(configPath).parent_path().string());
+    RebalancingService service(runPipeline(pipeline), pipeline);
+    service.setShutdownHandler([] { ::kill(::getpid(), SIGTERM); });
+    UnixSocketServer server(socketPath, [&service](const std::string &line) {
+      return service.handleLine(line);
+    });
+    server.start();
+    const auto snapshot = service.snapshot();
+    std::cerr << "BRP-daemon: " << snapshot->stations->size() - 1
+              << " stations, " << snapshot->clusters->size()
+              << " clusters, listening on " << socketPath << "\n";
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+    std::cerr << "BRP-daemon: stopped by "
+              << (signal == SIGINT ? "SIGINT" : "SIGTERM") << ", latency:\n"
+              << service.handle({{"op", "latency"}}).dump(2) << "\n";
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-daemon: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include "pipeline/pipeline.hpp"
+#include "pipeline/scenario_runner.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Monte Carlo inventory scenarios of a pipeline config's network:
+//   BRP-scenarios ../data/pipeline.json --scenarios 200 --noise 0.2
+namespace {
+
+const char *const kUsage =
+    "usage: BRP-scenarios CONFIG [options]\n"
+    "  --scenarios N      sampled scenarios (default 100)\n"
+    "  --seed S           random seed (default 1)\n"
+    "  --noise F          inventory noise, share of capacity (0.15)\n"
+    "  --threads N        scenarios run at once (default: all cores)\n"
+    "  --set PATH=VALUE   override a config field, e.g. clustering.k=48\n"
+    "  --output PATH      write every outcome and the station stability\n"
+    "                     as JSON\n";
+
+nlohmann::json toJson(const Distribution &d) {
+  return {{"mean", d.mean}, {"stddev", d.stddev}, {"min", d.min},
+          {"p05", d.p05},   {"p50", d.p50},       {"p95", d.p95},
+          {"max", d.max}};
+}
+
+void printRow(const char *name, const Distribution &d) {
+  std::printf("%-10s %10.4f %9.4f %10.4f %10.4f %10.4f %10.4f %10.4f\n", name,
+              d.mean, d.stddev, d.min, d.p05, d.p50, d.p95, d.max);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string configPath, output;
+  nlohmann::json config;
+  ScenarioOptions options;
+  try {
+    std::vector<std::string> overrides;
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc)
+          throw std::invalid_argument(arg + " needs a value");
+        return argv[++i];
+      };
+      if (arg == "--scenarios")
+        options.scenarios = std::stoi(value());
+      else if (arg == "--seed")
+        options.seed = std::stoull(value());
+      else if (arg == "--noise")
+        options.inventoryNoise = std::stod(value());
+      else if (arg == "--threads")
+        options.threads = static_cast<unsigned>(std::stoul(value()));
+      else if (arg == "--set")
+        overrides.push_back(value());
+      else if (arg == "--output")
+        output = value();
+      else if (arg == "--help" || arg == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else if (arg[0] != '-' && configPath.empty())
+        configPath = arg;
+      else
+        throw std::invalid_argument("unexpected argument " + arg);
+    }
+    if (configPath.empty())
+      throw std::invalid_argument("no config file");
+    std::ifstream in(configPath);
+    if (!in)
+      throw std::invalid_argument("cannot open " + configPath);
+    config = nlohmann::json::parse(in);
+    for (const std::string &assignment : overrides)
+      applyConfigOverride(config, assignment);
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-scenarios: " << e.what() << "\n" << kUsage;
+    return 2;
+  }
+
+  try {
+    const PipelineConfig pipeline = PipelineConfig::fromJson(
+        config, std::filesystem::path(configPath).parent_path().string());
+    PipelineResult instance = loadInstance(pipeline);
+    const auto stations = std::make_shared<const std::vector<Station>>(
+        std::move(instance.stations));
+    const ScenarioRunner runner(
+        stations,
+        std::make_shared<const std::vector<std::vector<double>>>(
+            std::move(instance.timeMatrix)),
+        pipeline);
+    const ScenarioSummary summary = runner.run(options);
+
+    std::printf("%d scenarios, reference delta UDF %.4f in %zu clusters, "
+                "%.1fs\n\n",
+                options.scenarios, summary.reference.totalDeltaUDF,
+                summary.referenceClusters.size(), summary.seconds);
+    std::printf("%-10s %10s %9s %10s %10s %10s %10s %10s\n", "", "mean",
+                "stddev", "min", "p05", "p50", "p95", "max");
+    printRow("deltaUDF", summary.deltaUDF);
+    printRow("ARI", summary.adjustedRandIndex);
+
+    // the least stable stations, the depot aside
+    const std::vector<double> &stability = summary.stationStability;
+    std::vector<size_t> order(stability.size() - 1);
+    std::iota(order.begin(), order.end(), 1);
+    const size_t shown = std::min<size_t>(10, order.size());
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(),
+                      [&](size_t a, size_t b) {
+                        return stability[a] < stability[b];
+                      });
+    std::printf("\nleast stable stations (mean Jaccard with the reference "
+                "cluster):\n");
+    for (size_t i = 0; i < shown; ++i)
+      std::printf("  %-34s %.3f\n", (*stations)[order[i]].getSysId().c_str(),
+                  stability[order[i]]);
+
+    if (!output.empty()) {
+      nlohmann::json out;
+      out["reference"] = {{"totalDeltaUDF", summary.reference.totalDeltaUDF},
+                          {"clusters", summary.referenceClusters.size()}};
+      out["deltaUDF"] = toJson(summary.deltaUDF);
+      out["adjustedRandIndex"] = toJson(summary.adjustedRandIndex);
+      out["scenarios"] = nlohmann::json::array();
+      for (const ScenarioOutcome &outcome : summary.scenarios)
+        out["scenarios"].push_back(
+            {{"totalDeltaUDF", outcome.totalDeltaUDF},
+             {"adjustedRandIndex", outcome.adjustedRandIndex},
+             {"clusters", outcome.clusters},
+             {"surplusStations", outcome.surplusStations},
+             {"deficitStations", outcome.deficitStations},
+             {"seconds", outcome.seconds}});
+      out["stationStability"] = nlohmann::json::object();
+      for (size_t i = 1; i < stability.size(); ++i)
+        out["stationStability"][(*stations)[i].getSysId()] = stability[i];
+      std::ofstream file(output);
+      if (!(file << out.dump(2) << "\n"))
+        throw std::runtime_error("cannot write " + output);
+      std::printf("\nwritten to %s\n", output.c_str());
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "BRP-scenarios: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}